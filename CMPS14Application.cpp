@@ -8,10 +8,16 @@ CMPS14Application::CMPS14Application():
   sensor(CMPS14_ADDR),
   compass(sensor),
   compass_prefs(compass),
+  pipeline(compass),
+  learner(compass),
+  recorder(compass),
+  wifi(compass_prefs),
   signalk(compass),
-  espnow(compass),
+  espnow(compass, compass_prefs),
+  nmea(),
+  n2k(compass_prefs),
   display(compass, signalk),
-  webui(compass, compass_prefs, signalk, display) {}
+  webui(compass, compass_prefs, wifi, signalk, espnow, nmea, n2k, pipeline, learner, recorder, trends, display) {}
 
 // Init non-wifi-dependent stuff
 void CMPS14Application::begin() {
@@ -31,6 +37,9 @@ void CMPS14Application::begin() {
   // Get saved configuration from ESP32 preferences
   compass_prefs.load();
 
+  // Resume heading filter, live variation and leveling after a software reset
+  compass.restoreWarmState();
+
   // Init appropriate calibration mode or use-mode
   compass.initCalibrationModeBoot();
   
@@ -38,17 +47,28 @@ void CMPS14Application::begin() {
   btStop(); 
 
   // Init WiFi (AP_STA mode enables ESP-NOW alongside WiFi)
-  WiFi.mode(WIFI_AP_STA);
-  WiFi.setSleep(false);
-  WiFi.begin(WIFI_SSID, WIFI_PASS);
-  wifi_state = WifiState::CONNECTING;
-  wifi_conn_start_ms = millis();
+  wifi.begin();
+  wifi_state = wifi.getState();
   display.showInfoMessage("WIFI", "CONNECTING");
   display.setWifiState(wifi_state);
 
   // Init ESP-NOW 
   display.showSuccessMessage("ESPNOW INIT", espnow.begin());
 
+  // Init NMEA 2000 (TWAI)
+  display.showSuccessMessage("N2K INIT", n2k.begin(CAN_TX, CAN_RX));
+
+  // Init flight recorder (LittleFS)
+  display.showSuccessMessage("RECORDER INIT", recorder.begin());
+
+  // Output sinks, each broker declares its rate, deadband and fields
+  signalk.registerSinks(pipeline);
+  espnow.registerSinks(pipeline);
+  nmea.registerSinks(pipeline);
+  n2k.registerSinks(pipeline);
+  recorder.registerSinks(pipeline);
+  trends.registerSinks(pipeline);
+
   // Compass ok?
   display.showSuccessMessage("CMPS14 INIT", compass_ok);
 
@@ -64,8 +84,13 @@ void CMPS14Application::loop() {
   this->handleWebUI();
   this->handleWebsocket(now);
   this->handleCompass(now);
-  this->handleSignalK(now);
+  this->handlePreferences(now);
   this->handleESPNow(now);
+  this->handleNMEA(now);
+  this->handleN2K(now);
+  this->handleOutputs(now);
+  this->handleLearner(now);
+  this->handleRecorder(now);
   this->handleMemory(now); // Debug
   this->handleDisplay();
   const unsigned long loop_runtime = micros() - loop_start; // Debug
@@ -76,64 +101,46 @@ void CMPS14Application::loop() {
 
 // === P R I V A T E ===
 
-// Wifi
+// Wifi: on state change notify dependent services
 void CMPS14Application::handleWifi(const unsigned long now) {
-  if ((long)(now - wifi_last_check_ms) < WIFI_STATUS_CHECK_MS) {
-    return;
-  }
-  wifi_last_check_ms = now;
+  if (!wifi.handle(now)) return;
+  wifi_state = wifi.getState();
+  display.setWifiState(wifi_state);
+
   switch (wifi_state) {
-    
-    case WifiState::INIT:
-      break;
-    
-    case WifiState::CONNECTING: {
-      wl_status_t status = WiFi.status();
-      if (status == WL_CONNECTED) {
-        wifi_state = WifiState::CONNECTED;
-        int32_t rssi = WiFi.RSSI();
-        uint32_t ip = (uint32_t)WiFi.localIP();
-        display.setWifiInfo(rssi, ip);
-        display.showSuccessMessage("WIFI CONNECT", true);
-        display.showWifiStatus();
-        display.setWifiState(wifi_state);
-        this->initWifiServices(); // Init wifi-dependent stuff
-        expn_retry_ms = WS_RETRY_MS;
-      }
-      else if ((long)(now - wifi_conn_start_ms) >= WIFI_TIMEOUT_MS) {
-        wifi_state = WifiState::FAILED;
-        display.showSuccessMessage("WIFI CONNECT", false);
-        WiFi.disconnect(true);
-        WiFi.mode(WIFI_OFF);
-        wifi_state = WifiState::OFF;
-        display.setWifiState(wifi_state);
-      }
-      else if (status == WL_CONNECT_FAILED || status == WL_NO_SSID_AVAIL) {
-        wifi_state = WifiState::FAILED;
-        display.showSuccessMessage("WIFI CONNECT", false);
-        WiFi.disconnect(true);
-        WiFi.mode(WIFI_OFF);
-        wifi_state = WifiState::OFF;
-        display.setWifiState(wifi_state);
+
+    case WifiState::CONNECTED: {
+      int32_t rssi = WiFi.RSSI();
+      uint32_t ip = (uint32_t)WiFi.localIP();
+      display.setWifiInfo(rssi, ip);
+      recorder.logEvent(FlightRecorder::EV_WIFI_UP, rssi);
+      display.showSuccessMessage("WIFI CONNECT", true);
+      display.showWifiStatus();
+      if (!wifi_services_started) {
+        this->initWifiServices(); // Init wifi-dependent stuff once
+        wifi_services_started = true;
+      } else {
+        nmea.onWifiConnected(); // New lease, the subnet may have changed
+        signalk.onWifiConnected();
       }
+      // Websocket reconnect right away
+      expn_retry_ms = WS_RETRY_MS;
+      next_ws_try_ms = now;
       break;
     }
 
-    case WifiState::CONNECTED: {
-      if(!WiFi.isConnected()) {
-        wifi_state = WifiState::DISCONNECTED;
+    case WifiState::DISCONNECTED: {
+      if (wifi.getPreviousState() == WifiState::CONNECTED) {
         display.showInfoMessage("WIFI", "LOST");
-        WiFi.disconnect();
-        WiFi.begin(WIFI_SSID, WIFI_PASS);
-        wifi_state = WifiState::CONNECTING;
-        display.setWifiState(wifi_state);
-        wifi_conn_start_ms = now;
+        recorder.logEvent(FlightRecorder::EV_WIFI_DOWN);
+        if (signalk.isOpen()) signalk.closeWebsocket();
       }
       break;
     }
 
+    case WifiState::CONNECTING:
+    case WifiState::INIT:
     case WifiState::FAILED:
-    case WifiState::DISCONNECTED: // Todo add retry?
     case WifiState::OFF:
       break;
   }
@@ -154,10 +161,7 @@ void CMPS14Application::handleWebUI() {
 
 // Websocket poll and reconnect
 void CMPS14Application::handleWebsocket(const unsigned long now) {
-  if (wifi_state != WifiState::CONNECTED) {
-    compass.setUseManualVariation(true);
-    return;
-  }
+  if (wifi_state != WifiState::CONNECTED) return; // Live variation is held for a while, then manual is used
   signalk.handleStatus();
   
   if (!signalk.isOpen() && (long)(now - next_ws_try_ms) >= 0){ 
@@ -167,7 +171,6 @@ void CMPS14Application::handleWebsocket(const unsigned long now) {
       expn_retry_ms = min(expn_retry_ms * 2, WS_RETRY_MAX_MS);
   }
   if (signalk.isOpen()) expn_retry_ms = WS_RETRY_MS;
-  else compass.setUseManualVariation(true);
 }
 
 // Compass
@@ -196,30 +199,57 @@ void CMPS14Application::handleCompass(const unsigned long now) {
 
 }
 
-// SignalK delta sending
-void CMPS14Application::handleSignalK(const unsigned long now) {
-  if (wifi_state != WifiState::CONNECTED) return;
+// Write-behind of configuration changes to NVS
+void CMPS14Application::handlePreferences(const unsigned long now) {
+  // Last live variation to NVS as a fallback for cold boot
+  if (compass.hasLiveVariation()) compass_prefs.saveLiveVariation(compass.getLiveVariation());
+  compass_prefs.handle(now);
 
-  // Send heading, pitch and roll to SignalK server
-  if ((long)(now - last_tx_ms) >= MIN_TX_INTERVAL_MS) {
-    last_tx_ms = now;
-    signalk.sendHdgPitchRollDelta();
+  // Warm restart state to RTC memory
+  if ((long)(now - last_warm_save_ms) >= WARM_SAVE_MS) {
+    last_warm_save_ms = now;
+    compass.saveWarmState();
   }
+}
 
-  // Send pitch and roll min and max to SignalK server
-  if ((long)(now - last_minmax_tx_ms) >= MINMAX_TX_INTERVAL_MS) {
-    last_minmax_tx_ms = now;
-    signalk.sendPitchRollMinMaxDelta();
+// One compass sample to all output sinks that are due (SignalK, ESP-NOW, NMEA 0183, NMEA 2000)
+void CMPS14Application::handleOutputs(const unsigned long now) {
+  pipeline.publish(now, wifi_state == WifiState::CONNECTED);
+}
+
+// Deviation learning from each new variation and COG/SOG received from SignalK
+void CMPS14Application::handleLearner(const unsigned long now) {
+  const uint32_t mv_updates = signalk.getVariationUpdates();
+  if (mv_updates != last_variation_updates) {
+    last_variation_updates = mv_updates;
+    learner.setVariation(signalk.getVariationDeg(), now);
   }
+  const uint32_t updates = signalk.getCourseUpdates();
+  if (updates == last_course_updates) return;
+  last_course_updates = updates;
+  learner.addCourse(signalk.getCogRad(), signalk.getSogMs(), now);
+}
 
+// Flight recorder: write a started block after its max age
+void CMPS14Application::handleRecorder(const unsigned long now) {
+  recorder.handle(now);
 }
 
-// ESP-NOW broadcast
+// ESP-NOW commands, subscriptions and adaptive rate
 void CMPS14Application::handleESPNow(const unsigned long now) {
-  espnow.processLevelCommand();
-  if ((long)(now - last_espnow_tx_ms) < ESPNOW_TX_INTERVAL_MS) return;
-  last_espnow_tx_ms = now;
-  espnow.sendHeadingDelta();
+  espnow.processCommands();
+  espnow.adaptRate(now);
+}
+
+// NMEA 0183 TCP clients
+void CMPS14Application::handleNMEA(const unsigned long now) {
+  if (wifi_state != WifiState::CONNECTED) return;
+  nmea.handle(now);
+}
+
+// NMEA 2000 receive, address claim and bus recovery, independent of WiFi
+void CMPS14Application::handleN2K(const unsigned long now) {
+  n2k.handle(now);
 }
 
 // LCD and LEDs
@@ -237,12 +267,20 @@ void CMPS14Application::initWifiServices() {
   // OTA
   ArduinoOTA.setHostname(signalk.getSignalKSource());
   ArduinoOTA.setPassword(OTA_PASS);
-  // ArduinoOTA.onStart([](){});
+  ArduinoOTA.onStart([this]() {
+    compass_prefs.flush(); // Pending configuration changes to NVS before flashing
+    compass.saveWarmState();
+    recorder.logEvent(FlightRecorder::EV_OTA);
+    recorder.flush();
+  });
   // ArduinoOTA.onEnd([](){});
   // ArduinoOTA.onProgress([](unsigned int progress, unsigned int total){});
   // ArduinoOTA.onError([](ota_error_t error) {});
   ArduinoOTA.begin();
 
+  // NMEA 0183 UDP and TCP
+  nmea.begin();
+
   // Webserver handlers
   webui.begin();
 }
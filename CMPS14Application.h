@@ -6,6 +6,7 @@
 #include <ArduinoOTA.h>
 #include <esp_system.h>
 #include "WifiState.h"
+#include "WifiManager.h"
 #include "CMPS14Sensor.h"
 #include "CMPS14Processor.h"
 #include "CMPS14Preferences.h"
@@ -13,6 +14,12 @@
 #include "DisplayManager.h"
 #include "WebUIManager.h"
 #include "ESPNowBroker.h"
+#include "NMEA0183Broker.h"
+#include "NMEA2000Broker.h"
+#include "OutputPipeline.h"
+#include "DeviationLearner.h"
+#include "FlightRecorder.h"
+#include "TrendStore.h"
 
 // === C M P S 1 4 A P P L I C A T I O N  C L A S S ===
 //
@@ -21,10 +28,17 @@
 //   - CMPS14Sensor, "the sensor"
 //   - CMPS14Processor, "the compass"
 //   - CMPS14Preferences, "the compass_prefs"
+//   - WifiManager, "the wifi"
 //   - SignalKBroker, "the signalk"
 //   - DisplayManager, "the display"
 //   - WebUIManager, "the webui"
 //   - ESPNowBroker, "the espnow"
+//   - NMEA0183Broker, "the nmea"
+//   - NMEA2000Broker, "the n2k"
+//   - OutputPipeline, "the pipeline" - brokers register their output sinks with it
+//   - DeviationLearner, "the learner"
+//   - FlightRecorder, "the recorder"
+//   - TrendStore, "the trends"
 // - Uses: WifiState, CalMode
 // - Init: app.begin() - called in setup() of the main program
 // - Loop: app.loop() - called in loop() of the main program
@@ -49,28 +63,24 @@ class CMPS14Application {
     static constexpr uint8_t I2C_SDA = 16;
     static constexpr uint8_t I2C_SCL = 17;
 
-    static constexpr unsigned long MIN_TX_INTERVAL_MS    = 101;         // Max frequency for sending deltas to SignalK
-    static constexpr unsigned long MINMAX_TX_INTERVAL_MS = 997;         // Frequency for pitch/roll maximum values sending
+    // SH-ESP32 default pins for CAN (NMEA 2000)
+    static constexpr uint8_t CAN_TX = 32;
+    static constexpr uint8_t CAN_RX = 34;
+
     static constexpr unsigned long READ_MS               = 47;          // Frequency to read values from CMPS14 in loop()
     static constexpr unsigned long CAL_POLL_MS           = 499;         // Frequency to poll calibration status in loop() 
-    static constexpr unsigned long WIFI_STATUS_CHECK_MS  = 503;         // Frequency to check wifi status
-    static constexpr unsigned long WIFI_TIMEOUT_MS       = 90001;       // Try WiFi connection max 1.5 minutes
     static constexpr unsigned long WS_RETRY_MS           = 1999;        // Shortest reconnect delay for SignalK websocket
     static constexpr unsigned long WS_RETRY_MAX_MS       = 119993;      // Max reconnect delay for SignalK websocket
-    static constexpr unsigned long ESPNOW_TX_INTERVAL_MS = 53;          // Frequency for ESP-NOW broadcast
+    static constexpr unsigned long WARM_SAVE_MS          = 997;         // Frequency to store warm restart state to RTC memory
     static constexpr unsigned long MEM_CHECK_MS          = 120007;      // Memory check every 2 mins to LCD - debug
     static constexpr unsigned long RUNTIME_CHECK_MS      = 59999;       // Runtime monitoring of app.loop() - debug
 
     // Timers
     unsigned long expn_retry_ms         = WS_RETRY_MS;
     unsigned long next_ws_try_ms        = 0;
-    unsigned long last_tx_ms            = 0;   
-    unsigned long last_minmax_tx_ms     = 0;         
     unsigned long last_read_ms          = 0;
     unsigned long last_cal_poll_ms      = 0;
-    unsigned long wifi_conn_start_ms    = 0;
-    unsigned long wifi_last_check_ms    = 0;
-    unsigned long last_espnow_tx_ms     = 0;
+    unsigned long last_warm_save_ms     = 0;
     unsigned long last_mem_check_ms     = 0; // Debug
     unsigned long last_runtime_check_ms = 0; // Debug
 
@@ -81,13 +91,24 @@ class CMPS14Application {
     bool compass_ok = false;
 
     WifiState wifi_state = WifiState::INIT;
+    bool wifi_services_started = false;
+
+    uint32_t last_course_updates = 0;
+    uint32_t last_variation_updates = 0;
 
     // Core instances for app
     CMPS14Sensor sensor;
     CMPS14Processor compass;
     CMPS14Preferences compass_prefs;
+    OutputPipeline pipeline;
+    DeviationLearner learner;
+    FlightRecorder recorder;
+    TrendStore trends;
+    WifiManager wifi;
     SignalKBroker signalk;
     ESPNowBroker espnow;
+    NMEA0183Broker nmea;
+    NMEA2000Broker n2k;
     DisplayManager display;
     WebUIManager webui;
 
@@ -97,8 +118,13 @@ class CMPS14Application {
     void handleWebUI();
     void handleWebsocket(const unsigned long now);
     void handleCompass(const unsigned long now);
-    void handleSignalK(const unsigned long now);
+    void handlePreferences(const unsigned long now);
+    void handleOutputs(const unsigned long now);
+    void handleLearner(const unsigned long now);
+    void handleRecorder(const unsigned long now);
     void handleESPNow(const unsigned long now);
+    void handleNMEA(const unsigned long now);
+    void handleN2K(const unsigned long now);
     void handleMemory(const unsigned long now); // Debug
     void handleDisplay();
 
@@ -3,124 +3,130 @@
 // === P U B L I C ===
 
 // Constructor
-CMPS14Preferences::CMPS14Preferences(CMPS14Processor &compassref) : compass(compassref) {}
+CMPS14Preferences::CMPS14Preferences(CMPS14Processor &compassref)
+    : compass(compassref), pending(writeRecordThunk, this, FLUSH_QUIET_MS, FLUSH_MAX_DELAY_MS) {}
 
 // Load all settings from NVS to CMPS14Processor
 void CMPS14Preferences::load() {
 
-    if (!prefs.begin(ns, false)) return;
+    const unsigned long start_us = micros();
 
-    // Installation offset
-    compass.setInstallationOffset(prefs.getFloat("offset_deg", 0.0f));
-
-    // Manual variation
-    compass.setManualVariation(prefs.getFloat("mv_man_deg", 0.0f));
+    if (!this->open()) return;
 
-    // Measured deviations at 8 cardinal and intercardinal points
-    float in[8];
-    for (int i = 0; i < 8; i++) {
-        char key[8];
-        snprintf(key, sizeof(key), "dev%d", i);
-        in[i] = prefs.getFloat(key, 0.0f);
+    // Packed record, or migrate from legacy keys on first boot
+    if (!this->readRecord()) {
+        this->readLegacyKeys();
+        if (this->writeRecord()) {
+            this->removeLegacyKeys();
+            migrated = true;
+        }
+    } else if (stored_version < CONFIG_VERSION) {
+        this->writeRecord(); // Upgrade to the current schema, a newer record is left as it is
     }
-    compass.setMeasuredDeviations(in);
 
-    // Harmonic coefficients
-    HarmonicCoeffs hc;
-    bool haveCoeffs = prefs.isKey("hc_A") && prefs.isKey("hc_B") && prefs.isKey("hc_C") && prefs.isKey("hc_D") && prefs.isKey("hc_E");
-    if (haveCoeffs) {
-        hc.A = prefs.getFloat("hc_A", 0.0f);
-        hc.B = prefs.getFloat("hc_B", 0.0f);
-        hc.C = prefs.getFloat("hc_C", 0.0f);
-        hc.D = prefs.getFloat("hc_D", 0.0f);
-        hc.E = prefs.getFloat("hc_E", 0.0f);
-    } else {
-        hc = computeHarmonicCoeffs(in);
-        prefs.putFloat("hc_A", hc.A);
-        prefs.putFloat("hc_B", hc.B);
-        prefs.putFloat("hc_C", hc.C);
-        prefs.putFloat("hc_D", hc.D);
-        prefs.putFloat("hc_E", hc.E);
-    }
-    compass.setHarmonicCoeffs(hc);
+    this->applyRecord();
 
-    // Send heading mode: true vs magnetic
-    compass.setSendHeadingTrue(prefs.getBool("send_hdg_true", true));
+    load_us = micros() - start_us;
+}
 
-    // Calibration boot mode
-    compass.setCalibrationModeBoot((CalMode)prefs.getUChar("cal_mode_boot", (uint8_t)CalMode::USE));
-  
-    // Full auto timeout
-    compass.setFullAutoTimeout((unsigned long)prefs.getULong("fastop", 0));
+// Write pending changes once the user has stopped editing
+void CMPS14Preferences::handle(const unsigned long now) {
+    if (pending.isDue(now)) this->flush();
+}
 
-    prefs.end();
+// Write pending changes to NVS now
+bool CMPS14Preferences::flush() {
+    if (!pending.isDirty()) return true;
+    const unsigned long start_us = micros();
+    bool ok = pending.flush(millis()); // Retried after the next quiet period on failure
+    last_flush_us = micros() - start_us;
+    if (last_flush_us > max_flush_us) max_flush_us = last_flush_us;
+    return ok;
 }
 
 // Save physical installation offset
 void CMPS14Preferences::saveInstallationOffset(float offset) {
-    if (!prefs.begin(ns, false)) return;
-    prefs.putFloat("offset_deg", offset);
-    prefs.end();
+    cfg.offset_deg = offset;
+    this->markDirty(DIRTY_OFFSET);
 }
 
 // Save manual variation
 void CMPS14Preferences::saveManualVariation(float deg) {
-    if (!prefs.begin(ns, false)) return;
-    prefs.putFloat("mv_man_deg", deg);
-    prefs.end();
+    cfg.mv_man_deg = deg;
+    cfg.mv_man_set = 1;
+    this->markDirty(DIRTY_MAGVAR);
+}
+
+// Save live variation with its timestamp as a cold boot fallback, skip changes below MV_LIVE_SAVE_DEG to spare flash
+void CMPS14Preferences::saveLiveVariation(float deg) {
+    if (!validf(deg)) return;
+    const uint32_t now_s = epochNow();
+    const bool changed = !validf(cfg.mv_live_deg) || fabsf(deg - cfg.mv_live_deg) >= MV_LIVE_SAVE_DEG;
+    const bool stale = now_s != 0 && (cfg.mv_live_epoch_s == 0 || now_s - cfg.mv_live_epoch_s >= MV_LIVE_STAMP_S);
+    if (!changed && !stale) return;
+    cfg.mv_live_deg = deg;
+    cfg.mv_live_epoch_s = now_s;
+    this->markDirty(DIRTY_MAGVAR_LIVE);
 }
 
 // Save measured deviations and 5 coeffs of the harmonic model
 void CMPS14Preferences::saveDeviationSettings(const float out[8], const HarmonicCoeffs &hc) {
-    if (!prefs.begin(ns, false)) return;
-
-    for (int i = 0; i < 8; i++) {
-        char key[8];
-        snprintf(key, sizeof(key), "dev%d", i);
-        prefs.putFloat(key, out[i]);
-    }
-
-    prefs.putFloat("hc_A", hc.A);
-    prefs.putFloat("hc_B", hc.B);
-    prefs.putFloat("hc_C", hc.C);
-    prefs.putFloat("hc_D", hc.D);
-    prefs.putFloat("hc_E", hc.E);
-
-    prefs.end();
+    memcpy(cfg.dev, out, sizeof(cfg.dev));
+    cfg.hc = hc;
+    this->markDirty(DIRTY_DEVIATION);
 }
 
 // Save calibration mode at boot and timeout of FULL AUTO calibration mode
 void CMPS14Preferences::saveCalibrationSettings(CalMode mode, unsigned long ms) {
-    if (!prefs.begin(ns, false)) return;
-    prefs.putUChar("cal_mode_boot", (uint8_t)mode);
-    prefs.putULong("fastop", ms);
-    prefs.end();
+    cfg.cal_mode_boot = (uint8_t)mode;
+    cfg.full_auto_stop_ms = (uint32_t)ms;
+    this->markDirty(DIRTY_CALIBRATION);
 }
 
 // Save send true heading option
 void CMPS14Preferences::saveSendHeadingTrue(bool enable) {
-    if (!prefs.begin(ns, false)) return;
-    prefs.putBool("send_hdg_true", enable);
-    prefs.end();
+    cfg.send_hdg_true = enable ? 1 : 0;
+    this->markDirty(DIRTY_HDG_MODE);
+}
+
+// Save the paired ESP-NOW displays
+void CMPS14Preferences::saveEspNowPeers(const uint8_t macs[][6], uint8_t n) {
+    if (n > ESPNOW_MAX_PAIRED) n = ESPNOW_MAX_PAIRED;
+    memset(cfg.espnow_paired, 0, sizeof(cfg.espnow_paired));
+    memcpy(cfg.espnow_paired, macs, n * 6);
+    cfg.espnow_paired_n = n;
+    this->markDirty(DIRTY_ESPNOW);
+}
+
+// Paired ESP-NOW displays from the loaded record
+uint8_t CMPS14Preferences::loadEspNowPeers(uint8_t out[][6]) const {
+    const uint8_t n = cfg.espnow_paired_n < ESPNOW_MAX_PAIRED ? cfg.espnow_paired_n : ESPNOW_MAX_PAIRED;
+    memcpy(out, cfg.espnow_paired, n * 6);
+    return n;
+}
+
+// Save the claimed NMEA 2000 address, only when it has changed
+void CMPS14Preferences::saveN2kAddress(uint8_t address) {
+    if (address == cfg.n2k_address) return;
+    cfg.n2k_address = address;
+    this->markDirty(DIRTY_N2K);
 }
 
-// Save web password hash to NVS
+// Save web password hash to NVS immediately, not write-behind
 void CMPS14Preferences::saveWebPassword(const char* password_sha256_hex) {
-  prefs.begin(ns, false);
+  if (!this->open()) return;
   prefs.putString("web_pass", password_sha256_hex);
-  prefs.end();
 }
 
 // Load web password hash from NVS
 bool CMPS14Preferences::loadWebPasswordHash(char* out_hash_64bytes) {
   
-  if (!prefs.begin(ns, true)) {
+  if (!this->open()) {
     out_hash_64bytes[0] = '\0';
     return false;
   }
 
   size_t len = prefs.getString("web_pass", out_hash_64bytes, 65);
-  prefs.end();
 
   if (len == 0) {
     out_hash_64bytes[0] = '\0';
@@ -135,3 +141,189 @@ bool CMPS14Preferences::loadWebPasswordHash(char* out_hash_64bytes) {
 
   return true;
 }
+
+// Load the last good WiFi connection, false if missing or corrupt
+bool CMPS14Preferences::loadWifiCache(WifiCache &out) {
+    if (!this->open()) return false;
+
+    uint8_t blob[sizeof(ConfigHeader) + sizeof(WifiCache)];
+    if (prefs.getBytesLength(WIFI_CACHE_KEY) != sizeof(blob)) return false;
+    if (prefs.getBytes(WIFI_CACHE_KEY, blob, sizeof(blob)) != sizeof(blob)) return false;
+
+    ConfigHeader hdr;
+    memcpy(&hdr, blob, sizeof(hdr));
+    if (hdr.magic != WIFI_CACHE_MAGIC || hdr.version != WIFI_CACHE_VERSION || hdr.size != sizeof(WifiCache)) return false;
+    if (crc32(blob + sizeof(ConfigHeader), hdr.size) != hdr.crc) return false;
+
+    memcpy(&wifi_cache, blob + sizeof(ConfigHeader), sizeof(WifiCache));
+    out = wifi_cache;
+    return true;
+}
+
+// Save the last good WiFi connection immediately, only if it has changed
+bool CMPS14Preferences::saveWifiCache(const WifiCache &in) {
+    if (memcmp(&in, &wifi_cache, sizeof(WifiCache)) == 0) return true;
+    if (!this->open()) return false;
+
+    uint8_t blob[sizeof(ConfigHeader) + sizeof(WifiCache)];
+    ConfigHeader hdr;
+    hdr.magic = WIFI_CACHE_MAGIC;
+    hdr.version = WIFI_CACHE_VERSION;
+    hdr.size = sizeof(WifiCache);
+    hdr.crc = crc32(&in, sizeof(WifiCache));
+    memcpy(blob, &hdr, sizeof(hdr));
+    memcpy(blob + sizeof(hdr), &in, sizeof(WifiCache));
+
+    bool ok = prefs.putBytes(WIFI_CACHE_KEY, blob, sizeof(blob)) == sizeof(blob);
+    if (ok) {
+        wifi_cache = in;
+        writes++;
+    }
+    return ok;
+}
+
+// === P R I V A T E ===
+
+// Open the NVS namespace once and keep it open
+bool CMPS14Preferences::open() {
+    if (!opened) opened = prefs.begin(ns, false);
+    return opened;
+}
+
+// Mark a field as changed in RAM, start or extend the quiet period
+void CMPS14Preferences::markDirty(uint8_t field) {
+    pending.mark(field, millis());
+}
+
+// Read and validate the packed config record, false if missing or corrupt
+bool CMPS14Preferences::readRecord() {
+    size_t len = prefs.getBytesLength(CONFIG_KEY);
+    if (len < sizeof(ConfigHeader) || len > CONFIG_MAX_BLOB) return false;
+
+    uint8_t blob[CONFIG_MAX_BLOB];
+    if (prefs.getBytes(CONFIG_KEY, blob, len) != len) return false;
+
+    ConfigHeader hdr;
+    memcpy(&hdr, blob, sizeof(hdr));
+    if (hdr.magic != CONFIG_MAGIC) return false;
+    if (hdr.size != len - sizeof(ConfigHeader)) return false;
+    if (crc32(blob + sizeof(ConfigHeader), hdr.size) != hdr.crc) return false;
+
+    // Older schema leaves the tail to defaults, newer schema tail is ignored
+    ConfigRecord rec;
+    memcpy(&rec, blob + sizeof(ConfigHeader), min((size_t)hdr.size, sizeof(ConfigRecord)));
+    if (hdr.version < 4) rec.mv_man_set = (rec.mv_man_deg != 0.0f) ? 1 : 0; // Before the flag, a non-zero value was set by the user
+    cfg = rec;
+    stored_version = hdr.version;
+    return true;
+}
+
+// Read settings from the legacy per-setting keys (up to v1.2.0)
+void CMPS14Preferences::readLegacyKeys() {
+
+    // Installation offset
+    cfg.offset_deg = prefs.getFloat("offset_deg", 0.0f);
+
+    // Manual variation
+    cfg.mv_man_deg = prefs.getFloat("mv_man_deg", 0.0f);
+    cfg.mv_man_set = prefs.isKey("mv_man_deg") ? 1 : 0;
+
+    // Measured deviations at 8 cardinal and intercardinal points
+    for (int i = 0; i < 8; i++) {
+        char key[8];
+        snprintf(key, sizeof(key), "dev%d", i);
+        cfg.dev[i] = prefs.getFloat(key, 0.0f);
+    }
+
+    // Harmonic coefficients
+    bool haveCoeffs = prefs.isKey("hc_A") && prefs.isKey("hc_B") && prefs.isKey("hc_C") && prefs.isKey("hc_D") && prefs.isKey("hc_E");
+    if (haveCoeffs) {
+        cfg.hc.A = prefs.getFloat("hc_A", 0.0f);
+        cfg.hc.B = prefs.getFloat("hc_B", 0.0f);
+        cfg.hc.C = prefs.getFloat("hc_C", 0.0f);
+        cfg.hc.D = prefs.getFloat("hc_D", 0.0f);
+        cfg.hc.E = prefs.getFloat("hc_E", 0.0f);
+    } else {
+        cfg.hc = computeHarmonicCoeffs(cfg.dev);
+    }
+
+    // Send heading mode: true vs magnetic
+    cfg.send_hdg_true = prefs.getBool("send_hdg_true", true) ? 1 : 0;
+
+    // Calibration boot mode
+    cfg.cal_mode_boot = prefs.getUChar("cal_mode_boot", (uint8_t)CalMode::USE);
+  
+    // Full auto timeout
+    cfg.full_auto_stop_ms = prefs.getULong("fastop", 0);
+}
+
+// Remove the legacy keys once they live in the packed record
+void CMPS14Preferences::removeLegacyKeys() {
+    static const char* const keys[] = {
+        "offset_deg", "mv_man_deg",
+        "dev0", "dev1", "dev2", "dev3", "dev4", "dev5", "dev6", "dev7",
+        "hc_A", "hc_B", "hc_C", "hc_D", "hc_E",
+        "send_hdg_true", "cal_mode_boot", "fastop"
+    };
+    for (const char* key : keys) {
+        if (prefs.isKey(key)) prefs.remove(key);
+    }
+}
+
+// Write the whole record as one blob
+bool CMPS14Preferences::writeRecord() {
+    if (!this->open()) return false;
+
+    uint8_t blob[sizeof(ConfigHeader) + sizeof(ConfigRecord)];
+    ConfigHeader hdr;
+    hdr.magic = CONFIG_MAGIC;
+    hdr.version = CONFIG_VERSION;
+    hdr.size = sizeof(ConfigRecord);
+    hdr.crc = crc32(&cfg, sizeof(ConfigRecord));
+    memcpy(blob, &hdr, sizeof(hdr));
+    memcpy(blob + sizeof(hdr), &cfg, sizeof(ConfigRecord));
+
+    bool ok = prefs.putBytes(CONFIG_KEY, blob, sizeof(blob)) == sizeof(blob);
+    if (ok) {
+        writes++;
+        stored_version = CONFIG_VERSION;
+    }
+    return ok;
+}
+
+// WriteBehind backend
+bool CMPS14Preferences::writeRecordThunk(void* ctx) {
+    return static_cast<CMPS14Preferences*>(ctx)->writeRecord();
+}
+
+// Apply the record to CMPS14Processor
+void CMPS14Preferences::applyRecord() {
+    compass.setInstallationOffset(cfg.offset_deg);
+    compass.setManualVariation(cfg.mv_man_deg, cfg.mv_man_set != 0);
+    compass.setMeasuredDeviations(cfg.dev);
+    compass.setHarmonicCoeffs(cfg.hc);
+    compass.setSendHeadingTrue(cfg.send_hdg_true != 0);
+    compass.setCalibrationModeBoot((CalMode)cfg.cal_mode_boot);
+    compass.setFullAutoTimeout((unsigned long)cfg.full_auto_stop_ms);
+    this->applyLiveVariation();
+}
+
+// Stored live variation: live again only if its age is known and within the hold time,
+// with an unknown age only a default for the manual variation, not reported as known
+void CMPS14Preferences::applyLiveVariation() {
+    if (!validf(cfg.mv_live_deg)) return;
+    const uint32_t now_s = epochNow();
+    if (now_s != 0 && cfg.mv_live_epoch_s != 0 && now_s >= cfg.mv_live_epoch_s) {
+        const uint32_t age_s = now_s - cfg.mv_live_epoch_s;
+        if (age_s > MV_LIVE_MAX_AGE_S) return;
+        if (compass.restoreLiveVariation(cfg.mv_live_deg, age_s * 1000UL)) return;
+    }
+    if (!cfg.mv_man_set) compass.setManualVariation(cfg.mv_live_deg, false);
+}
+
+// Unix time in seconds, 0 if the clock has not been set
+uint32_t CMPS14Preferences::epochNow() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return (tv.tv_sec > 1600000000) ? (uint32_t)tv.tv_sec : 0;
+}
@@ -4,7 +4,55 @@
 #include <Preferences.h> 
 #include "CMPS14Processor.h"
 #include "harmonic.h"
+#include "checksum.h"
 #include "CalMode.h"
+#include "WifiCache.h"
+#include "command_packet.h"
+#include "write_behind.h"
+
+// === C O N F I G R E C O R D  S T R U C T S ===
+//
+// - Configuration is stored as one packed NVS blob: ConfigHeader + ConfigRecord
+// - Header carries magic, schema version, payload size and CRC32 of the payload
+// - Schema evolution: new fields are only ever appended to the end of ConfigRecord
+//   and CONFIG_VERSION is bumped
+//   - Older record (smaller payload): fields missing from the tail keep their defaults
+//   - Newer record (larger payload): unknown fields in the tail are ignored
+// - The whole record is written with one putBytes(), so every change is atomic
+
+struct __attribute__((packed)) ConfigHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;      // Payload size in bytes
+    uint32_t crc;       // CRC32 of the payload
+};
+
+struct ConfigRecord {
+    // Schema v1
+    float offset_deg = 0.0f;                    // Installation offset
+    float mv_man_deg = 0.0f;                    // Manual variation
+    float dev[8] = { 0,0,0,0,0,0,0,0 };         // Measured deviations at 8 cardinal and intercardinal points
+    HarmonicCoeffs hc = { 0,0,0,0,0 };          // Harmonic coeffs computed from the measured deviations
+    uint32_t full_auto_stop_ms = 0;             // FULL AUTO timeout, 0 = never
+    uint8_t send_hdg_true = 1;                  // Send heading true
+    uint8_t cal_mode_boot = (uint8_t)CalMode::USE;
+    uint8_t mv_man_set = 0;                     // Schema v4: manual variation set by the user (reserved in v1...v3)
+    uint8_t reserved_v1[1] = { 0 };
+    // Schema v2
+    float mv_live_deg = NAN;                    // Last live variation from SignalK, fallback after cold boot
+    // Schema v3
+    uint8_t espnow_paired[ESPNOW_MAX_PAIRED][6] = {};   // MACs of the ESP-NOW displays allowed to change the configuration
+    uint8_t espnow_paired_n = 0;
+    uint8_t reserved_v3[3] = { 0,0,0 };
+    // Schema v5
+    uint8_t n2k_address = 255;                  // Last claimed NMEA 2000 address, 255 = none yet
+    uint8_t reserved_v5[3] = { 0,0,0 };
+    // Schema v6
+    uint32_t mv_live_epoch_s = 0;               // When mv_live_deg was saved, Unix time, 0 = clock was not set
+};
+
+// Fields are laid out without implicit padding (packed) but keep natural alignment for direct float access
+static_assert(sizeof(ConfigRecord) == 108, "ConfigRecord layout changed, append new fields and bump CONFIG_VERSION");
 
 // === C M P S 1 4 P R E F E R E N C E S  C L A S S ===
 //
@@ -17,10 +65,21 @@
 //   - Compass calibration mode to be loaded at ESP32 boot
 //   - Timeout for FULL AUTO calibration mode
 //   - Heading mode: HDG(T) / HDG(M)
+//   - ESP-NOW displays paired for configuration commands
+//   - Last claimed NMEA 2000 address
 // - Provides public API to load config from NVS
 // - Provides public API to save and load sha password for web UI
-// - Uses: CMPS14Processor ("the compass"), CalMode
-// - Owns: Preferences
+// - Config is kept in RAM as a ConfigRecord and written to NVS as a single blob,
+//   legacy per-setting keys are migrated into the blob on first boot
+// - The NVS namespace is opened once in load() and kept open
+// - Write-behind: save*() applies the change to the RAM record and marks it dirty,
+//   compass_prefs.handle(now) in loop() writes the record after a quiet period
+//   (or after a max delay during continuous edits), compass_prefs.flush() writes
+//   immediately and must be called before restart/OTA. Timing in WriteBehind
+// - Last good WiFi connection (WifiCache) is a separate CRC-protected blob,
+//   written immediately and only when it has changed
+// - Uses: CMPS14Processor ("the compass"), CalMode, WifiCache
+// - Owns: Preferences, ConfigRecord, WriteBehind
 
 class CMPS14Preferences {
 public:
@@ -28,16 +87,86 @@ public:
     explicit CMPS14Preferences(CMPS14Processor &compassref);
 
     void load();
+    void handle(const unsigned long now);
+    bool flush();
     void saveInstallationOffset(float offset);
     void saveManualVariation(float deg);
+    void saveLiveVariation(float deg);
     void saveDeviationSettings(const float dev[8], const HarmonicCoeffs &hc);
     void saveCalibrationSettings(CalMode mode, unsigned long ms);
     void saveSendHeadingTrue(bool enable);
+    void saveEspNowPeers(const uint8_t macs[][6], uint8_t n);
+    uint8_t loadEspNowPeers(uint8_t out[][6]) const;
+    void saveN2kAddress(uint8_t address);
+    uint8_t loadN2kAddress() const { return cfg.n2k_address; }
     void saveWebPassword(const char* password_sha256_hex);
     bool loadWebPasswordHash(char* out_hash_64bytes);
+    bool loadWifiCache(WifiCache &out);
+    bool saveWifiCache(const WifiCache &in);
+
+    bool isDirty() const { return pending.isDirty(); }
+    uint8_t getDirtyFields() const { return pending.getFields(); }
+
+    // Debug
+    unsigned long getLoadTimeUs() const { return load_us; }
+    uint16_t getStoredVersion() const { return stored_version; }
+    bool isMigrated() const { return migrated; }
+    uint32_t getWriteCount() const { return writes; }
+    uint32_t getSaveCount() const { return pending.getSaves(); }
+    unsigned long getLastFlushUs() const { return last_flush_us; }
+    unsigned long getMaxFlushUs() const { return max_flush_us; }
 
 private:
+
+    bool open();
+    void markDirty(uint8_t field);
+    bool readRecord();
+    void readLegacyKeys();
+    void removeLegacyKeys();
+    bool writeRecord();
+    void applyRecord();
+    void applyLiveVariation();
+    static uint32_t epochNow();
+    static bool writeRecordThunk(void* ctx);
+
     const char* ns = "cmps14";
+    const char* CONFIG_KEY = "cfg";
+    static constexpr uint32_t CONFIG_MAGIC = 0x31474643;   // "CFG1" little-endian
+    static constexpr uint16_t CONFIG_VERSION = 6;
+    static constexpr size_t CONFIG_MAX_BLOB = 256;          // Upper limit for records written by future versions
+    const char* WIFI_CACHE_KEY = "wifi";
+    static constexpr uint32_t WIFI_CACHE_MAGIC = 0x31464957; // "WIF1" little-endian
+    static constexpr uint16_t WIFI_CACHE_VERSION = 1;
+    static constexpr unsigned long FLUSH_QUIET_MS = 2999;   // Write after this long without new changes
+    static constexpr unsigned long FLUSH_MAX_DELAY_MS = 29989; // Write at latest this long after the first pending change
+
+    // Dirty field flags
+    static constexpr uint8_t DIRTY_OFFSET      = 0x01;
+    static constexpr uint8_t DIRTY_MAGVAR      = 0x02;
+    static constexpr uint8_t DIRTY_DEVIATION   = 0x04;
+    static constexpr uint8_t DIRTY_CALIBRATION = 0x08;
+    static constexpr uint8_t DIRTY_HDG_MODE    = 0x10;
+    static constexpr uint8_t DIRTY_MAGVAR_LIVE = 0x20;
+    static constexpr uint8_t DIRTY_ESPNOW      = 0x40;
+    static constexpr uint8_t DIRTY_N2K         = 0x80;
+
+    static constexpr float MV_LIVE_SAVE_DEG = 0.1f;         // Live variation is written only when it changes more
+    static constexpr uint32_t MV_LIVE_STAMP_S = 21600;      // ...or to refresh its timestamp, every 6 h
+    static constexpr uint32_t MV_LIVE_MAX_AGE_S = 2592000;  // Stored live variation older than 30 days is not used
+
     Preferences prefs;
     CMPS14Processor &compass;
+    ConfigRecord cfg;
+    WifiCache wifi_cache;          // Copy of the stored cache to skip unchanged writes
+    bool opened = false;
+
+    WriteBehind pending;           // Fields changed in RAM but not yet in NVS
+
+    // Debug
+    unsigned long load_us = 0;
+    uint16_t stored_version = 0;   // Schema version found in NVS, 0 = none
+    bool migrated = false;         // Legacy keys migrated on this boot
+    uint32_t writes = 0;           // Blob writes since boot
+    unsigned long last_flush_us = 0;
+    unsigned long max_flush_us = 0;
 };
@@ -1,9 +1,22 @@
 #include "CMPS14Processor.h"
 
+// === S T A T I C ===
+
+// Survives software resets, not power loss
+RTC_NOINIT_ATTR CMPS14Processor::WarmState CMPS14Processor::rtc_warm;
+
+// micros() for the MotionAnalyzer step runtimes
+static uint32_t motionMicros() { return micros(); }
+
 // === P U B L I C ===
 
 // Constructor
-CMPS14Processor::CMPS14Processor(CMPS14Sensor &cmps14Sensor) : sensor(cmps14Sensor), wire(nullptr) {}
+CMPS14Processor::CMPS14Processor(CMPS14Sensor &cmps14Sensor) : sensor(cmps14Sensor), wire(nullptr), motion(motionMicros) {
+    for (uint8_t i = 0; i < MINMAX_WINDOWS; i++) {
+        pitch_win[i].setWindow(MINMAX_WINDOW_MS[i]);
+        roll_win[i].setWindow(MINMAX_WINDOW_MS[i]);
+    }
+}
 
 // Begin
 bool CMPS14Processor::begin(TwoWire &wirePort) {
@@ -13,38 +26,29 @@ bool CMPS14Processor::begin(TwoWire &wirePort) {
     return ok;
 }
 
-// Process the values received from CMPS14Sensor::read(...)
+// Process the values received from CMPS14Sensor::readRaw(...)
 bool CMPS14Processor::update() {
-    float raw_deg, pitch_raw, roll_raw;
+    uint16_t raw_10;
+    int8_t pitch_i, roll_i;
 
-    if (!sensor.read(raw_deg, pitch_raw, roll_raw)) return false;
-    
-    // Heading (C)
-    raw_deg += installation_offset_deg;
-    if (raw_deg >= 360.0f) raw_deg -= 360.0f;
-    if (raw_deg < 0.0f) raw_deg += 360.0f;
-    if (isnan(compass_deg)) {
-        compass_deg = raw_deg;
-    } else {
-        float diff = raw_deg - compass_deg;
-        if (diff > 180.0f) diff -= 360.0f;
-        if (diff < -180.0f) diff += 360.0f;
-        compass_deg += HEADING_ALPHA * diff;
-        if (compass_deg >= 360.0f) compass_deg -= 360.0f;
-        if (compass_deg < 0.0f) compass_deg += 360.0f;
-    }
+    // Continue a pending deviation table build, swapped in when complete
+    dev_lut.buildStep(DEV_BUILD_STEP);
 
-    // Heading (M)
-    dev_deg = dev_lut.lookup(compass_deg);
-    heading_deg = compass_deg + dev_deg;
-    if (heading_deg >= 360.0f) heading_deg -= 360.0f;
-    if (heading_deg < 0.0f) heading_deg += 360.0f;
+    if (!sensor.readRaw(raw_10, pitch_i, roll_i)) return false;
+    raw_bearing_10 = raw_10;
+    raw_pitch = pitch_i;
+    raw_roll = roll_i;
 
-    // Heading (T)
-    heading_true_deg = heading_deg + this->getVariation();
-    if (heading_true_deg >= 360.0f) heading_true_deg -= 360.0f;
-    if (heading_true_deg < 0.0f) heading_true_deg += 360.0f;
+    // Heading (C), (M), (T) and rate of turn
+    const unsigned long now_ms = millis();
+    const unsigned long start_us = micros(); // Debug
+    this->processHeading(hs, raw_10, now_ms, this->getVariation());
+    const float us = (float)(micros() - start_us);
+    process_avg_us = (process_avg_us == 0.0f) ? us : 0.9f * process_avg_us + 0.1f * us;
+    if (first_true_hdg_ms == 0 && validf(hs.heading_true_deg) && !this->isUsingManualVariation()) first_true_hdg_ms = millis();
 
+    const float pitch_raw = (float)pitch_i;
+    const float roll_raw = (float)roll_i;
     pitch_level_raw = pitch_raw;
     roll_level_raw = roll_raw;
 
@@ -54,6 +58,11 @@ bool CMPS14Processor::update() {
     // Radians for SignalK
     this->updateHeadingDelta();
     this->updateMinMaxDelta();
+    this->updateWindowMinMaxDelta();
+
+    // Roll and pitch spectrum, one bounded step per update, after the heading outputs are ready
+    motion.add(now_ms, pitch_deg, roll_deg);
+    motion.step();
 
     return true;
 }
@@ -67,7 +76,68 @@ void CMPS14Processor::level() {
         minMaxDelta.pitch_min_rad = NAN;
         minMaxDelta.roll_max_rad = NAN;
         minMaxDelta.roll_min_rad = NAN;
+        for (uint8_t i = 0; i < MINMAX_WINDOWS; i++) {
+            pitch_win[i].reset();
+            roll_win[i].reset();
+        }
+    }
+}
+
+// Keep heading filter, live variation, leveling and min/max in RTC memory for a warm restart
+void CMPS14Processor::saveWarmState() {
+    const uint64_t now_rtc = rtcNowMs();
+    WarmState st = {};
+    st.magic = WARM_MAGIC;
+    st.saved_ms = now_rtc;
+    st.magvar_ms = now_rtc - (millis() - magvar_live_ms);
+    st.compass_deg = hs.compass_deg;
+    st.magvar_live_deg = this->hasLiveVariation() ? magvar_live_deg : NAN;
+    st.pitch_level = pitch_level;
+    st.roll_level = roll_level;
+    st.pitch_min_rad = minMaxDelta.pitch_min_rad;
+    st.pitch_max_rad = minMaxDelta.pitch_max_rad;
+    st.roll_min_rad = minMaxDelta.roll_min_rad;
+    st.roll_max_rad = minMaxDelta.roll_max_rad;
+    st.crc = crc32(&st, offsetof(WarmState, crc));
+    rtc_warm = st;
+}
+
+// Resume from RTC memory after a software reset, false on power-on or if state is invalid or too old
+bool CMPS14Processor::restoreWarmState() {
+    esp_reset_reason_t reason = esp_reset_reason();
+    if (reason == ESP_RST_POWERON || reason == ESP_RST_BROWNOUT) return false;
+
+    WarmState st = rtc_warm;
+    rtc_warm.magic = 0; // Use once
+    if (st.magic != WARM_MAGIC) return false;
+    if (crc32(&st, offsetof(WarmState, crc)) != st.crc) return false;
+
+    const uint64_t now_rtc = rtcNowMs();
+    if (now_rtc < st.saved_ms || now_rtc - st.saved_ms > WARM_MAX_AGE_MS) return false;
+
+    // Heading filter
+    if (now_rtc - st.saved_ms <= WARM_FILTER_MAX_AGE_MS && validf(st.compass_deg)) {
+        hs.compass_deg = st.compass_deg;
+        hs.warm_filter_check = true;
+    }
+
+    // Live variation with its original age
+    if (validf(st.magvar_live_deg) && now_rtc >= st.magvar_ms) {
+        this->restoreLiveVariation(st.magvar_live_deg, (unsigned long)(now_rtc - st.magvar_ms));
     }
+
+    // Leveling and min/max
+    if (validf(st.pitch_level) && validf(st.roll_level)) {
+        pitch_level = st.pitch_level;
+        roll_level = st.roll_level;
+    }
+    minMaxDelta.pitch_min_rad = st.pitch_min_rad;
+    minMaxDelta.pitch_max_rad = st.pitch_max_rad;
+    minMaxDelta.roll_min_rad = st.roll_min_rad;
+    minMaxDelta.roll_max_rad = st.roll_max_rad;
+
+    warm_started = true;
+    return true;
 }
 
 // Reset CMPS14Sensor
@@ -183,6 +253,7 @@ void CMPS14Processor::requestCalStatus(uint8_t out[4]) {
     uint8_t byte = this->readCalStatusByte();
     uint8_t mag = 255, acc = 255, gyr = 255, sys = 255;
     if (!sensor.isNack(byte)) {
+        cal_status_byte = byte;
         mag = (byte     ) & REG_MASK;
         acc = (byte >> 2) & REG_MASK;
         gyr = (byte >> 4) & REG_MASK;
@@ -211,12 +282,33 @@ uint8_t CMPS14Processor::readFwVersion() {
     return sensor.readRegister(REG_FIRMWARE);
 }
 
+// Milliseconds of the RTC backed system time, keeps running over software resets
+uint64_t CMPS14Processor::rtcNowMs() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return (uint64_t)tv.tv_sec * 1000ULL + (uint64_t)(tv.tv_usec / 1000);
+}
+
+// One heading sample through the compile-time selected path (heading_filter.h)
+void CMPS14Processor::processHeading(HeadingState &st, uint16_t raw_10, const unsigned long now_ms, float var_deg) const {
+    HeadingParams p;
+    p.offset_deg = installation_offset_deg;
+    p.variation_deg = var_deg;
+    p.heading_alpha = HEADING_ALPHA;
+    p.rot_alpha = ROT_ALPHA;
+    if (FIXED_POINT_HEADING) processHeadingFixed(st, p, dev_lut, raw_10, now_ms);
+    else processHeadingFloat(st, p, dev_lut, raw_10, now_ms);
+}
+
 // Update values of HeadingDelta struct
 void CMPS14Processor::updateHeadingDelta() {
-    headingDelta.heading_rad      = heading_deg * DEG_TO_RAD;
-    headingDelta.heading_true_rad = heading_true_deg * DEG_TO_RAD;
+    headingDelta.heading_rad      = hs.heading_deg * DEG_TO_RAD;
+    headingDelta.heading_true_rad = hs.heading_true_deg * DEG_TO_RAD;
     headingDelta.pitch_rad        = pitch_deg * DEG_TO_RAD;
     headingDelta.roll_rad         = roll_deg * DEG_TO_RAD;
+    headingDelta.rot_rad          = hs.rot_rad;
+    headingDelta.heading_bam      = hs.heading_bam;
+    headingDelta.heading_true_bam = hs.heading_true_bam;
 }
 
 // Update values of MinMaxDelta struct
@@ -234,3 +326,23 @@ void CMPS14Processor::updateMinMaxDelta() {
     else if (headingDelta.roll_rad < minMaxDelta.roll_min_rad) minMaxDelta.roll_min_rad = headingDelta.roll_rad;
 }
 
+// Add the latest pitch and roll to the sliding windows and update WindowMinMaxDelta struct
+void CMPS14Processor::updateWindowMinMaxDelta() {
+    const unsigned long now_ms = hs.sample_ms;
+    bool moved = false;
+    auto set = [&](float &dst, float v) {
+        if (v == dst || (isnan(v) && isnan(dst))) return;
+        dst = v;
+        moved = true;
+    };
+    for (uint8_t i = 0; i < MINMAX_WINDOWS; i++) {
+        pitch_win[i].add(now_ms, headingDelta.pitch_rad);
+        roll_win[i].add(now_ms, headingDelta.roll_rad);
+        set(windowMinMaxDelta.pitch_min_rad[i], pitch_win[i].min(now_ms));
+        set(windowMinMaxDelta.pitch_max_rad[i], pitch_win[i].max(now_ms));
+        set(windowMinMaxDelta.roll_min_rad[i], roll_win[i].min(now_ms));
+        set(windowMinMaxDelta.roll_max_rad[i], roll_win[i].max(now_ms));
+    }
+    if (moved) windowMinMaxDelta.seq++;
+}
+
@@ -2,9 +2,16 @@
 
 #include <Arduino.h>
 #include <Wire.h>
+#include <esp_system.h>
+#include <sys/time.h>
 #include "CalMode.h"
 #include "harmonic.h"
+#include "bam.h"
+#include "heading_filter.h"
 #include "CMPS14Sensor.h"
+#include "checksum.h"
+#include "window_minmax.h"
+#include "MotionAnalyzer.h"
 
 // === C M P S 1 4 P R O C E S S O R  C L A S S ===
 //
@@ -12,15 +19,43 @@
 // - Initialise: compass.begin(Wire)
 // - Read the sensor and process the raw values: compass.update()
 // - Level the attitude output to zero: compass.level()
+// - Heading processing in binary angles (FIXED_POINT_HEADING, see bam.h) or in
+//   float degrees, selected at compile time, float degrees and radians are
+//   produced only for the outputs (heading_filter.h)
+// - Pitch and roll min/max: all-time values reset by compass.level(), plus
+//   sliding window values (MINMAX_WINDOW_MS, monotonic deques, see
+//   window_minmax.h) that are not kept over a restart
+// - Roll and pitch spectrum (MotionAnalyzer) fed at every update(), one
+//   bounded analysis step per update() after the heading is processed
+// - Warm restart: compass.saveWarmState() keeps heading filter, live variation,
+//   leveling and min/max in RTC slow memory, compass.restoreWarmState() at boot
+//   resumes from it after a software reset (restart, OTA, watchdog, panic)
 // - Provides public API to
 //   - Manage the calibration of CMPS14 sensor
 //   - Get the processed sensor values and configuration data
 //   - Set the configuration data
 // - Uses: CMPS14Sensor ("the sensor"), CalMode, TwoWire
-// - Owns: DeviationLookup
+// - Owns: DeviationLookup, MotionAnalyzer
 
 class CMPS14Processor {
 public:
+    // Sliding windows for pitch and roll min/max
+    static constexpr uint8_t MINMAX_WINDOWS = 3;
+    static constexpr unsigned long MINMAX_WINDOW_MS[MINMAX_WINDOWS] = { 60000, 600000, 3600000 };
+    static constexpr const char* MINMAX_WINDOW_NAMES[MINMAX_WINDOWS] = { "1m", "10m", "1h" };
+
+    // Pitch and roll min/max of each window in radians
+    struct WindowMinMaxDelta {
+        float pitch_min_rad[MINMAX_WINDOWS], pitch_max_rad[MINMAX_WINDOWS];
+        float roll_min_rad[MINMAX_WINDOWS], roll_max_rad[MINMAX_WINDOWS];
+        uint32_t seq = 0;                  // Incremented whenever one of the values changes
+        WindowMinMaxDelta() {
+            for (uint8_t i = 0; i < MINMAX_WINDOWS; i++) {
+                pitch_min_rad[i] = pitch_max_rad[i] = roll_min_rad[i] = roll_max_rad[i] = NAN;
+            }
+        }
+    };
+
     explicit CMPS14Processor (CMPS14Sensor &cmps14Sensor);
 
     bool begin(TwoWire &wirePort);
@@ -37,17 +72,18 @@ public:
     void requestCalStatus(uint8_t out[4]);
     
     // Getters
-    float getCompassDeg() const { return compass_deg; }
-    float getHeadingDeg() const { return heading_deg; }
-    float getHeadingTrueDeg() const { return heading_true_deg; }
+    float getCompassDeg() const { return hs.compass_deg; }
+    float getHeadingDeg() const { return hs.heading_deg; }
+    float getHeadingTrueDeg() const { return hs.heading_true_deg; }
     float getPitchDeg() const { return pitch_deg; }
     float getRollDeg() const { return roll_deg; }
     float getPitchLevel() const { return pitch_level; }
     float getRollLevel() const { return roll_level; }
     float getInstallationOffset() const { return installation_offset_deg; }
-    float getDeviation() const { return dev_deg; }
-    float getVariation() const {return use_manual_magvar ? magvar_manual_deg : magvar_live_deg; }
+    float getDeviation() const { return hs.dev_deg; }
+    float getVariation() const {return this->isUsingManualVariation() ? magvar_manual_deg : magvar_live_deg; }
     float getManualVariation() const { return magvar_manual_deg; }
+    float getLiveVariation() const { return magvar_live_deg; }
     unsigned long getFullAutoTimeout() const { return full_auto_stop_ms; }
     unsigned long getFullAutoStart() const { return full_auto_start_ms; }
     unsigned long getFullAutoLeft() const { return full_auto_left_ms; }
@@ -56,12 +92,25 @@ public:
 
     auto getHeadingDelta() const { return headingDelta; }
     auto getMinMaxDelta() const { return minMaxDelta; }
+    const WindowMinMaxDelta& getWindowMinMaxDelta() const { return windowMinMaxDelta; }
+    unsigned long getSampleMs() const { return hs.sample_ms; }
+    float getProcessUs() const { return process_avg_us; }
+    uint16_t getRawBearing10() const { return raw_bearing_10; }
+    int8_t getRawPitch() const { return raw_pitch; }
+    int8_t getRawRoll() const { return raw_roll; }
+    static constexpr bool isFixedPointHeading() { return FIXED_POINT_HEADING; }
+    uint8_t getCalStatusByte() const { return cal_status_byte; }
     CalMode getCalibrationModeBoot() const { return cal_mode_boot; }
     CalMode getCalibrationModeRuntime() const { return cal_mode_runtime; }
     HarmonicCoeffs getHarmonicCoeffs() const { return hc; }
+    uint32_t getHarmonicHash() const { return dev_lut.getHash(); }
     const DeviationLookup& getDeviationLookup() const { return dev_lut; }
+    const MotionAnalyzer& getMotionAnalyzer() const { return motion; }
 
-    bool isUsingManualVariation() const { return use_manual_magvar; }
+    bool isUsingManualVariation() const { return use_manual_magvar || !this->hasLiveVariation(); }
+    bool hasLiveVariation() const { return validf(magvar_live_deg) && (millis() - magvar_live_ms) < MAGVAR_HOLD_MS; }
+    bool isVariationKnown() const { return !this->isUsingManualVariation() || magvar_manual_set; }  // Live, or manual set by the user
+    bool isManualVariationSet() const { return magvar_manual_set; }
     bool isCalProfileStored() const { return cal_profile_stored; }
     bool isSendingHeadingTrue() const { return send_hdg_true; }
 
@@ -69,8 +118,21 @@ public:
 
     // Setters
     void setInstallationOffset(float offset) { installation_offset_deg = offset; }
-    void setManualVariation(float variation) { magvar_manual_deg = variation; }
-    void setLiveVariation(float variation) { magvar_live_deg = variation; }
+    void setManualVariation(float variation, bool set_by_user = true) {
+        magvar_manual_deg = variation;
+        magvar_manual_set = set_by_user;
+    }
+    void setLiveVariation(float variation) {
+        magvar_live_deg = variation;
+        magvar_live_ms = millis();
+    }
+    bool restoreLiveVariation(float variation, unsigned long age_ms) {
+        if (!validf(variation) || age_ms >= MAGVAR_HOLD_MS) return false;
+        magvar_live_deg = variation;
+        magvar_live_ms = millis() - age_ms;
+        use_manual_magvar = false;
+        return true;
+    }
     void setUseManualVariation(bool manual) { use_manual_magvar = manual; }
     void setCalProfileStored(bool stored) { cal_profile_stored = stored; }
     void setSendHeadingTrue(bool hdg) { send_hdg_true = hdg; }
@@ -79,9 +141,16 @@ public:
     void setMeasuredDeviations(const float in[8]) { memcpy(measured_deviations, in, sizeof(measured_deviations)); }
     void setFullAutoTimeout(unsigned long ms) { full_auto_stop_ms = ms; }
     void setFullAutoLeft(unsigned long ms) { full_auto_left_ms = ms; }
+    // Warm restart
+    void saveWarmState();
+    bool restoreWarmState();
+    bool isWarmStarted() const { return warm_started; }
+    unsigned long getFirstTrueHeadingMs() const { return first_true_hdg_ms; }
+
+    // New table is built in the background by update() and swapped in when complete
     void setHarmonicCoeffs(const HarmonicCoeffs &coeffs) {
         hc = coeffs;
-        dev_lut.build(hc);
+        dev_lut.rebuild(hc);
     }
 
 private:
@@ -89,8 +158,11 @@ private:
     bool enableBackgroundCal(bool autosave);
     uint8_t readCalStatusByte();
     uint8_t readFwVersion();
+    void processHeading(HeadingState &st, uint16_t raw_10, const unsigned long now_ms, float var_deg) const;
     void updateHeadingDelta();
     void updateMinMaxDelta();
+    void updateWindowMinMaxDelta();
+    static uint64_t rtcNowMs();
     
     CMPS14Sensor &sensor;
     TwoWire *wire;
@@ -100,9 +172,10 @@ private:
 
     // CMPS14 processing
     float installation_offset_deg = 0.0f;  // Physical installation offset of the CMPS14 sensor in degrees
-    float dev_deg = 0.0f;                  // Deviation calculated by harmonic model
     float magvar_manual_deg = 0.0f;        // Variation that is set manually from web UI
-    float magvar_live_deg = 0.0f;          // Variation from SignalK navigation.magneticVariation path
+    bool magvar_manual_set = false;        // Manual variation was set by the user, not only the default
+    float magvar_live_deg = NAN;           // Variation from SignalK navigation.magneticVariation path
+    unsigned long magvar_live_ms = 0;      // When the live variation was received
     float pitch_level = 0.0f;              // Leveling of pitch
     float roll_level = 0.0f;               // Leveling of roll
     float pitch_level_raw = NAN;           // Leveling of pitch
@@ -114,25 +187,48 @@ private:
     // Five harmonic coeffs to compute deviations - as a struct, because part of computing model A, B, C, D and E.
     HarmonicCoeffs hc = { 0,0,0,0,0 }; 
 
-    // Lookup table for deviations                 
+    // Double-buffered lookup table for deviations, hash of its coeffs changes when a new table is swapped in
     DeviationLookup dev_lut;                            
+    static constexpr int DEV_BUILD_STEP = 45;      // Table entries built per update()
     
     // Measured deviations (deg) in cardinal and intercardinal directions, as an array, because imput only
     float measured_deviations[8] = { 0,0,0,0,0,0,0,0 }; 
 
+    static constexpr bool FIXED_POINT_HEADING = true;  // Heading path in binary angles, false = float degrees
     static constexpr float HEADING_ALPHA = 0.15f;  // Smoothing factor for Heading (C)
+    static constexpr float ROT_ALPHA = 0.2f;       // Smoothing factor for rate of turn
     static constexpr uint8_t CAL_OK_REQUIRED = 3;  // Autocalibration save condition threshold
+    static constexpr unsigned long MAGVAR_HOLD_MS = 900000;       // Live variation stays in use 15 mins after the last update
 
-    // Compass and attitude in degrees
-    float compass_deg = NAN;
-    float heading_deg = NAN;
-    float heading_true_deg = NAN;
+    // Warm restart state in RTC slow memory, validated with magic, CRC32 and age
+    struct WarmState {
+        uint32_t magic;
+        uint32_t reserved;
+        uint64_t saved_ms;                 // RTC time (gettimeofday) when saved
+        uint64_t magvar_ms;                // RTC time when the live variation was received
+        float compass_deg;
+        float magvar_live_deg;
+        float pitch_level, roll_level;
+        float pitch_min_rad, pitch_max_rad, roll_min_rad, roll_max_rad;
+        uint32_t crc;                      // CRC32 of everything above
+    };
+    static WarmState rtc_warm;
+    static constexpr uint32_t WARM_MAGIC = 0x4D524157;            // "WARM"
+    static constexpr unsigned long WARM_MAX_AGE_MS = 600000;      // Older state is ignored (10 mins)
+    static constexpr unsigned long WARM_FILTER_MAX_AGE_MS = 30000; // Heading filter resumes only after a quick restart
+    bool warm_started = false;
+    unsigned long first_true_hdg_ms = 0;  // Time from boot to first true heading with live variation
+
+    // Compass (live heading state) and attitude in degrees
+    HeadingState hs;
     float pitch_deg = NAN;
     float roll_deg = NAN;
 
     // Compass and attitude in radians
     struct HeadingDelta {
         float heading_rad = NAN, heading_true_rad = NAN, pitch_rad = NAN, roll_rad = NAN;
+        float rot_rad = NAN;    // Rate of turn, rad/s
+        bam32_t heading_bam = 0, heading_true_bam = 0;
     } headingDelta;
 
     // Pitch and roll min/max values in radians
@@ -140,8 +236,25 @@ private:
         float pitch_min_rad = NAN, pitch_max_rad = NAN, roll_min_rad = NAN, roll_max_rad = NAN;
     } minMaxDelta;
 
+    // Pitch and roll min/max over the sliding windows
+    static constexpr size_t MINMAX_WINDOW_SLOTS = 60;   // Window edge resolution: 1 s for 1 min, 1 min for 1 h
+    WindowMinMax<MINMAX_WINDOW_SLOTS> pitch_win[MINMAX_WINDOWS];
+    WindowMinMax<MINMAX_WINDOW_SLOTS> roll_win[MINMAX_WINDOWS];
+    WindowMinMaxDelta windowMinMaxDelta;
+
+    // Roll and pitch spectral analysis
+    MotionAnalyzer motion;
+
+    float process_avg_us = 0.0f;           // EMA of the heading path runtime
+
+    // Latest raw frame as read from CMPS14
+    uint16_t raw_bearing_10 = 0;
+    int8_t raw_pitch = 0;
+    int8_t raw_roll = 0;
+
     // Calibration
     uint8_t cal_ok_count = 0;
+    uint8_t cal_status_byte = 0;           // Latest calibration status byte as read from CMPS14
     unsigned long full_auto_start_ms   = 0;  // Full auto mode start timestamp
     unsigned long full_auto_stop_ms    = 0;  // Full auto mode timeout, 0 = never
     unsigned long full_auto_left_ms    = 0;  // Full auto mode time left
@@ -20,6 +20,19 @@ bool CMPS14Sensor::available() const {
 
 // Read values from sensor
 bool CMPS14Sensor::read(float &angle_deg, float &pitch_deg, float &roll_deg) {
+    uint16_t ang10;
+    int8_t pitch, roll;
+    if (!this->readRaw(ang10, pitch, roll)) return false;
+
+    angle_deg = ((float)ang10) / 10.0f;
+    pitch_deg = (float)pitch;
+    roll_deg = (float)roll;
+
+    return true;
+}
+
+// Read values from sensor as integers, bearing in tenths of a degree
+bool CMPS14Sensor::readRaw(uint16_t &angle_10, int8_t &pitch_deg, int8_t &roll_deg) {
     wire->beginTransmission(addr);
     wire->write(REG_ANGLE_16_H);
     if (wire->endTransmission(false) != 0) return false;
@@ -30,13 +43,10 @@ bool CMPS14Sensor::read(float &angle_deg, float &pitch_deg, float &roll_deg) {
 
     uint8_t hi = wire->read();
     uint8_t lo = wire->read();
-    int8_t pitch = (int8_t)wire->read();
-    int8_t roll  = (int8_t)wire->read();
+    pitch_deg = (int8_t)wire->read();
+    roll_deg  = (int8_t)wire->read();
 
-    uint16_t ang10 = ((uint16_t)hi << 8) | lo;
-    angle_deg = ((float)ang10) / 10.0f;
-    pitch_deg = (float)pitch;
-    roll_deg = (float)roll;
+    angle_10 = ((uint16_t)hi << 8) | lo;
 
     return true;
 }
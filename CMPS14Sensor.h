@@ -10,6 +10,9 @@
 // - Read raw data to float variables:
 //      float angle_deg, pitch_deg, roll_deg;
 //      if (sensor.available() && sensor.read(angle_deg, pitch_deg, roll_deg)) ...
+// - Read raw data as delivered by CMPS14 (bearing in tenths of a degree):
+//      uint16_t angle_10; int8_t pitch, roll;
+//      if (sensor.readRaw(angle_10, pitch, roll)) ...
 // - Send a command byte:
 //      uint8_t cmd = 0x80;
 //      if (sensor.sendCommand(cmd)) ...
@@ -28,6 +31,7 @@ public:
     bool begin(TwoWire &wirePort);
     bool available() const;
     bool read(float &angle_deg, float &pitch_deg, float &roll_deg);
+    bool readRaw(uint16_t &angle_10, int8_t &pitch_deg, int8_t &roll_deg);
     bool sendCommand(uint8_t cmd);
     uint8_t readRegister(uint8_t reg);
     bool isAck(uint8_t byte);
@@ -0,0 +1,159 @@
+#include "DeviationLearner.h"
+
+// === P U B L I C ===
+
+// Constructor
+DeviationLearner::DeviationLearner(CMPS14Processor &compassref):
+    compass(compassref) {
+    this->reset();
+}
+
+// COG/SOG update from GNSS: detect straight-line conditions and learn from the residual
+void DeviationLearner::addCourse(float cog_rad, float sog_ms, const unsigned long now) {
+    
+    const float rot = compass.getHeadingDelta().rot_rad;
+    const bool cog_fresh = validf(last_cog_rad) && (long)(now - last_cog_ms) < COG_GAP_MS;
+    const bool cog_stable = cog_fresh && validf(cog_rad) && fabsf(computeAngDiffRad(cog_rad, last_cog_rad)) < MAX_COG_STEP_RAD;
+    const bool straight = cog_stable && validf(sog_ms) && sog_ms >= MIN_SOG_MS && validf(rot) && fabsf(rot) < MAX_ROT_RAD_S;
+
+    last_cog_rad = cog_rad;
+    last_cog_ms = now;
+
+    if (!straight) {
+        steady = false;
+        return;
+    }
+    if (!steady) {
+        steady = true;
+        steady_since_ms = now;
+    }
+    if ((long)(now - steady_since_ms) < STEADY_MS) return;
+
+    const float compass_deg = compass.getCompassDeg();
+    if (!validf(compass_deg)) return;
+    const float var_deg = this->variationDeg(now);
+    if (!validf(var_deg)) {
+        no_variation++;
+        return;
+    }
+
+    // Deviation = magnetic course - compass heading, on the shortest arc
+    const float mag_course_rad = cog_rad - var_deg * DEG_TO_RAD;
+    const float y_deg = computeAngDiffRad(mag_course_rad, compass_deg * DEG_TO_RAD) * RAD_TO_DEG;
+    this->update(compass_deg, y_deg);
+}
+
+// Live magnetic variation, NAN when the source has none
+void DeviationLearner::setVariation(float deg, const unsigned long now) {
+    if (!validf(deg)) return; // Keep the last one until it is too old
+    var_live_deg = deg;
+    var_live_ms = now;
+}
+
+// Start over from zero coeffs
+void DeviationLearner::reset() {
+    for (uint8_t r = 0; r < 5; r++) {
+        x[r] = 0.0f;
+        for (uint8_t c = 0; c < 5; c++) P[r][c] = (r == c) ? P0 : 0.0f;
+    }
+    for (uint8_t i = 0; i < 8; i++) sector_count[i] = 0;
+    res_var = 0.0f;
+    samples = 0;
+    rejected = 0;
+    no_variation = 0;
+    steady = false;
+    last_cog_rad = NAN;
+}
+
+// Hand the learned model to the compass, returns the 8 cardinal deviations and coeffs for saving
+bool DeviationLearner::adopt(float dev_out[8], HarmonicCoeffs &hc_out) {
+    if (!this->isReady()) return false;
+    const HarmonicCoeffs learned = this->getCoeffs();
+    for (uint8_t i = 0; i < 8; i++) dev_out[i] = computeDeviation(learned, headings_deg[i]);
+    hc_out = computeHarmonicCoeffs(dev_out); // Same curve, kept consistent with the 8 values
+    compass.setMeasuredDeviations(dev_out);
+    compass.setHarmonicCoeffs(hc_out);
+    return true;
+}
+
+// Standard deviation of one coefficient in degrees
+float DeviationLearner::getCoeffStdDeg(uint8_t i) const {
+    if (i >= 5 || samples == 0) return NAN;
+    return sqrtf(fmaxf(P[i][i], 0.0f) * res_var);
+}
+
+// Sectors of 45° around the cardinal points with enough samples
+uint8_t DeviationLearner::getSectorsCovered() const {
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < 8; i++) if (sector_count[i] >= SECTOR_MIN) n++;
+    return n;
+}
+
+// 0...100 %: heading coverage, sample count and coefficient uncertainty
+uint8_t DeviationLearner::getConfidence() const {
+    if (samples < SETTLED_SAMPLES) return 0;
+    const float coverage = this->getSectorsCovered() / 8.0f;
+    float worst_std = 0.0f;
+    for (uint8_t i = 0; i < 5; i++) worst_std = fmaxf(worst_std, this->getCoeffStdDeg(i));
+    const float certainty = 1.0f / (1.0f + worst_std);   // 1° std -> 50 %
+    return (uint8_t)lroundf(100.0f * coverage * certainty);
+}
+
+// === P R I V A T E ===
+
+// Live variation while fresh, else the manual one if the user has set it, else NAN
+float DeviationLearner::variationDeg(const unsigned long now) const {
+    if (validf(var_live_deg) && (long)(now - var_live_ms) < (long)VAR_HOLD_MS) return var_live_deg;
+    if (compass.isManualVariationSet()) return compass.getManualVariation();
+    return NAN;
+}
+
+// One RLS step: k = P·φ / (λ + φᵀ·P·φ), x += k·e, P = (P - k·φᵀ·P) / λ
+void DeviationLearner::update(float theta_deg, float y_deg) {
+    const unsigned long t0 = micros();
+
+    const float th = theta_deg * DEG_TO_RAD;
+    const float phi[5] = { 1.0f, sinf(th), cosf(th), sinf(2.0f * th), cosf(2.0f * th) };
+
+    float e = y_deg;
+    for (uint8_t r = 0; r < 5; r++) e -= phi[r] * x[r];
+
+    if (samples >= SETTLED_SAMPLES && fabsf(e) > OUTLIER_DEG) {
+        rejected++;
+        return;
+    }
+
+    float Pphi[5];
+    float denom = LAMBDA;
+    for (uint8_t r = 0; r < 5; r++) {
+        Pphi[r] = 0.0f;
+        for (uint8_t c = 0; c < 5; c++) Pphi[r] += P[r][c] * phi[c];
+        denom += phi[r] * Pphi[r];
+    }
+
+    float k[5];
+    for (uint8_t r = 0; r < 5; r++) {
+        k[r] = Pphi[r] / denom;
+        x[r] += k[r] * e;
+    }
+
+    // P is symmetric, so φᵀ·P = (P·φ)ᵀ, no forgetting once P has grown back to the prior (wind-up)
+    float trace = 0.0f;
+    for (uint8_t r = 0; r < 5; r++) trace += P[r][r];
+    const float lambda = (trace > 5.0f * P0) ? 1.0f : LAMBDA;
+    for (uint8_t r = 0; r < 5; r++) {
+        for (uint8_t c = r; c < 5; c++) {
+            const float v = (P[r][c] - k[r] * Pphi[c]) / lambda;
+            P[r][c] = v;
+            P[c][r] = v;
+        }
+    }
+
+    res_var = samples ? res_var + 0.01f * (e * e - res_var) : e * e;
+    samples++;
+    const uint8_t sector = (uint8_t)(((int)lroundf(theta_deg / 45.0f)) & 7);
+    if (sector_count[sector] < UINT16_MAX) sector_count[sector]++;
+
+    const float us = (float)(micros() - t0);
+    update_us = (samples > 1) ? 0.9f * update_us + 0.1f * us : us;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <Arduino.h>
+#include "harmonic.h"
+#include "CMPS14Processor.h"
+
+// === D E V I A T I O N L E A R N E R  C L A S S ===
+//
+// - Class DeviationLearner - "the learner" estimates the deviation curve
+//   online from GNSS course over ground, no swinging of the compass
+// - Feed: learner.addCourse(cog_rad, sog_ms, now) for each COG/SOG update
+//   and learner.setVariation(deg, now) for each magnetic variation update
+//   from SignalK (~1 Hz)
+// - Variation is kept here, independent of the heading mode of the compass:
+//   the live one while younger than VAR_HOLD_MS, else the manual variation
+//   only if the user has set it, otherwise samples are rejected (a default 0°
+//   would be learned into A)
+// - Observed deviation = COG - variation - compass heading (before deviation),
+//   taken only in steady straight-line conditions: SOG above MIN_SOG_MS,
+//   rate of turn below MAX_ROT_RAD_S and COG stable for STEADY_MS
+// - Recursive least squares fit of the same A...E harmonic model as
+//   computeHarmonicCoeffs(), O(1) per sample (5x5), forgetting factor LAMBDA,
+//   residuals beyond OUTLIER_DEG rejected once the fit has settled
+// - Confidence from samples, heading sectors covered (8 x 45°), residual RMS
+//   and coefficient standard deviations, isReady() when adoption makes sense
+// - learner.adopt() hands the learned coeffs to the compass, 8 deviations at
+//   the cardinal points are derived from them for the web UI and NVS
+// - Leeway and current show up as deviation, so learn in calm conditions
+// - Uses: CMPS14Processor ("the compass")
+
+class DeviationLearner {
+
+public:
+
+    explicit DeviationLearner(CMPS14Processor &compassref);
+
+    void addCourse(float cog_rad, float sog_ms, const unsigned long now);
+    void setVariation(float deg, const unsigned long now);
+    void reset();
+    bool adopt(float dev_out[8], HarmonicCoeffs &hc_out);
+
+    HarmonicCoeffs getCoeffs() const { return { x[0], x[1], x[2], x[3], x[4] }; }
+    float getCoeffStdDeg(uint8_t i) const;
+    uint32_t getSampleCount() const { return samples; }
+    uint32_t getRejectedCount() const { return rejected; }
+    uint32_t getNoVariationCount() const { return no_variation; }
+    uint8_t getSectorsCovered() const;
+    float getResidualRmsDeg() const { return sqrtf(res_var); }
+    uint8_t getConfidence() const;
+    bool isReady() const { return this->getConfidence() >= READY_CONFIDENCE; }
+    bool isSteady() const { return steady; }
+    float getUpdateUs() const { return update_us; } // Debug
+
+private:
+
+    static constexpr float LAMBDA             = 0.9995f;   // Forgetting factor, memory ~2000 samples
+    static constexpr float P0                 = 100.0f;    // Initial covariance, weak prior at zero coeffs
+    static constexpr float MIN_SOG_MS         = 1.54f;     // 3 kn
+    static constexpr float MAX_ROT_RAD_S      = 0.0175f;   // 1°/s
+    static constexpr float MAX_COG_STEP_RAD   = 0.0524f;   // 3° between COG updates
+    static constexpr unsigned long STEADY_MS  = 9973;      // Straight line before samples are taken
+    static constexpr unsigned long COG_GAP_MS = 2999;      // Older COG breaks the straight line
+    static constexpr float OUTLIER_DEG        = 15.0f;
+    static constexpr uint32_t SETTLED_SAMPLES = 60;
+    static constexpr uint16_t SECTOR_MIN      = 30;        // Samples for a sector to count as covered
+    static constexpr uint8_t READY_CONFIDENCE = 70;        // %
+    static constexpr unsigned long VAR_HOLD_MS = 900000;   // Live variation used 15 min after the last update, as the compass
+
+    void update(float theta_deg, float y_deg);
+    float variationDeg(const unsigned long now) const;
+
+    CMPS14Processor &compass;
+
+    // RLS state: coeffs and covariance
+    float x[5] = { 0, 0, 0, 0, 0 };
+    float P[5][5];
+
+    float res_var = 0.0f;                // EMA of squared residuals, deg²
+    uint32_t samples = 0;
+    uint32_t rejected = 0;
+    uint32_t no_variation = 0;           // Steady samples skipped without a known variation
+    uint16_t sector_count[8] = {};
+
+    // Straight-line detection
+    float last_cog_rad = NAN;
+    unsigned long last_cog_ms = 0;
+    unsigned long steady_since_ms = 0;
+    bool steady = false;
+
+    // Live variation from SignalK
+    float var_live_deg = NAN;
+    unsigned long var_live_ms = 0;
+
+    float update_us = 0.0f;              // Debug
+
+};
@@ -3,13 +3,27 @@
 
 // === S T A T I C ===
 
-uint8_t ESPNowBroker::last_sender_mac[6] = {0};
-volatile bool ESPNowBroker::level_command_received = false;
+SpscQueue<ESPNowBroker::QueuedCommand, 8> ESPNowBroker::cmd_queue;
+std::atomic<uint32_t> ESPNowBroker::cmd_dropped{0};
+std::atomic<uint32_t> ESPNowBroker::cmd_invalid{0};
+std::atomic<uint64_t> ESPNowBroker::sub_keys[ESPNowBroker::MAX_SUBSCRIBERS];
+std::atomic<uint32_t> ESPNowBroker::sub_ok[ESPNowBroker::MAX_SUBSCRIBERS];
+std::atomic<uint32_t> ESPNowBroker::sub_fail[ESPNowBroker::MAX_SUBSCRIBERS];
+std::atomic<uint32_t> ESPNowBroker::tx_ok{0};
+std::atomic<uint32_t> ESPNowBroker::tx_fail{0};
+std::atomic<uint32_t> ESPNowBroker::tx_in_flight{0};
+std::atomic<uint32_t> ESPNowBroker::send_us[ESPNowBroker::SEND_FIFO];
+std::atomic<uint32_t> ESPNowBroker::send_head{0};
+std::atomic<uint32_t> ESPNowBroker::send_tail{0};
+std::atomic<uint32_t> ESPNowBroker::lat_sum_us{0};
+std::atomic<uint32_t> ESPNowBroker::lat_count{0};
+std::atomic<uint32_t> ESPNowBroker::lat_max_us{0};
 
 // === P U B L I C ===
 
 // Constructor
-ESPNowBroker::ESPNowBroker(CMPS14Processor &compassref) : compass(compassref) {}
+ESPNowBroker::ESPNowBroker(CMPS14Processor &compassref, CMPS14Preferences &compass_prefsref)
+    : compass(compassref), compass_prefs(compass_prefsref) {}
 
 // Initialize ESP-NOW
 bool ESPNowBroker::begin() {
@@ -24,6 +38,9 @@ bool ESPNowBroker::begin() {
 
     if (esp_now_add_peer(&peer) != ESP_OK) return false;
 
+    // Displays paired earlier
+    paired_n = compass_prefs.loadEspNowPeers(paired);
+
     // Register callbacks
     esp_now_register_send_cb(onDataSent);
     esp_now_register_recv_cb(onDataRecv);
@@ -33,77 +50,445 @@ bool ESPNowBroker::begin() {
     return true;
 }
 
-// Send heading delta from the compass as ESP-NOW broadcast packet
-void ESPNowBroker::sendHeadingDelta() {
-    
-    if (!initialized) return;
+// Heading packets as an output sink at the adaptive rate, WiFi not needed
+void ESPNowBroker::registerSinks(OutputPipeline &pipelineref) {
+    OutputSink k;
+    k.name = "espnow";
+    k.fn = sinkThunk<ESPNowBroker, &ESPNowBroker::sendHeadingDelta>;
+    k.ctx = this;
+    k.interval_ms = tx_interval_ms;
+    k.policy = SinkPolicy::ALWAYS;
+    k.fields = OUT_HEADING | OUT_HEADING_TRUE | OUT_PITCH | OUT_ROLL | OUT_ROT | OUT_CAL;
+    pipeline = &pipelineref;
+    sink_id = pipeline->addSink(k);
+}
 
-    auto delta = compass.getHeadingDelta();
+// Send heading delta as unicast to subscribers, broadcast without subscribers or as a beacon
+bool ESPNowBroker::sendHeadingDelta(const OutputSample &sample, uint8_t /* changed */) {
+    
+    if (!initialized) return false;
 
     // Validate data
-    if (!validf(delta.heading_rad) || !validf(delta.pitch_rad) || !validf(delta.roll_rad)) return;
+    if (!validf(sample.heading_rad) || !validf(sample.pitch_rad) || !validf(sample.roll_rad)) return false;
+
+    const unsigned long now = sample.now_ms;
 
-    // Deadband check (same logic as SignalKBroker::sendHdgPitchRollDelta())
-    bool changed_h = false, changed_p = false, changed_r = false;
+    HeadingSample s;
+    s.sample_ms        = (uint16_t)sample.sample_ms;
+    s.heading_rad      = sample.heading_rad;
+    s.heading_true_rad = sample.heading_true_rad;
+    s.pitch_rad        = sample.pitch_rad;
+    s.roll_rad         = sample.roll_rad;
+    s.rot_rad          = sample.rot_rad;
+    s.cal              = sample.cal;
+    bool sent = false;
 
-    if (!validf(last_h) || fabsf(computeAngDiffRad(delta.heading_rad, last_h)) >= DB_HDG_RAD) {
-        changed_h = true;
-        last_h = delta.heading_rad;
+    // Unicast to subscribers at their own rate and deadband
+    bool subscribed = false;
+    for (uint8_t i = 0; i < MAX_SUBSCRIBERS; i++) {
+        Subscriber &sub = subscribers[i];
+        if (!sub.active) continue;
+        if ((long)(now - sub.last_hello_ms) >= PEER_EXPIRY_MS) {
+            sub.active = false;
+            sub_keys[i].store(0, std::memory_order_relaxed);
+            peers_expired++;
+            continue;
+        }
+        subscribed = true;
+        if ((long)(now - sub.last_send_ms) < sub.interval_ms) continue;
+        const bool moved = this->deadbandExceeded(s, sub.fields, sub.track);
+        if (!moved && (long)(now - sub.last_send_ms) < KEEPALIVE_MS) continue;
+        if (tx_in_flight.load(std::memory_order_relaxed) >= MAX_IN_FLIGHT) {
+            tx_skipped++;
+            continue;
+        }
+        s.seq = sub.seq;
+        if (!this->sendSample(sub.mac, s, sub.fields)) continue;
+        sub.seq++;
+        sub.last_send_ms = now;
+        deadbandSent(s, sub.fields, sub.track);
+        sent = true;
     }
-    if (!validf(last_p) || fabsf(delta.pitch_rad - last_p) >= DB_ATT_RAD) {
-        changed_p = true;
-        last_p = delta.pitch_rad;
+
+    // Broadcast: full rate for discovery and legacy listeners, only a beacon once someone has subscribed
+    const bool moved = this->deadbandExceeded(s, HP_FIELDS_ALL, bc_track);
+    if (subscribed) {
+        if ((long)(now - last_send_ms) < BEACON_MS) return sent;
+    } else if (!moved && (long)(now - last_send_ms) < KEEPALIVE_MS) return sent;
+
+    // Back off while the radio has not confirmed earlier packets
+    if (tx_in_flight.load(std::memory_order_relaxed) >= MAX_IN_FLIGHT) {
+        tx_skipped++;
+        return sent;
     }
-    if (!validf(last_r) || fabsf(delta.roll_rad - last_r) >= DB_ATT_RAD) {
-        changed_r = true;
-        last_r = delta.roll_rad;
+    s.seq = tx_seq;
+    if (!this->sendSample(BROADCAST_ADDR, s, HP_FIELDS_ALL)) return sent;
+    tx_seq++;
+    last_send_ms = now;
+    deadbandSent(s, HP_FIELDS_ALL, bc_track);
+    return true;
+}
+
+// Execute queued remote commands and acknowledge each to its sender
+void ESPNowBroker::processCommands() {
+    if (!initialized) return;
+
+    const unsigned long now = millis();
+    if (pairing && (long)(now - pairing_start_ms) >= PAIRING_WINDOW_MS) pairing = false;
+
+    QueuedCommand c;
+    uint8_t n = 0;
+    while (n++ < MAX_COMMANDS_PER_LOOP && cmd_queue.pop(c)) {
+        if (pairing && !c.legacy && !this->isPaired(c.mac)) this->pair(c.mac);
+        if (c.hello) {
+            this->registerSubscriber(c.mac, c.fields, c.interval_ms, now);
+            continue;
+        }
+        EspNowAck status;
+        if (commandNeedsPairing((EspNowCmd)c.cmd) && !this->isPaired(c.mac)) {
+            status = EspNowAck::NOT_PAIRED;
+            cmds_rejected++;
+        } else status = this->executeCommand((EspNowCmd)c.cmd, c.arg);
+        last_ack = status;
+        cmds_processed++;
+
+        if (!this->ensurePeer(c.mac)) continue;
+
+        if (c.legacy) {
+            const uint8_t response[8] = { 'L', 'V', 'L', 'R', (uint8_t)(status == EspNowAck::OK ? 1 : 0), 0, 0, 0 };
+            this->send(c.mac, response, sizeof(response));
+        } else {
+            AckPacket ack = {};
+            ack.cmd = c.cmd;
+            ack.seq = c.seq;
+            ack.status = (uint8_t)status;
+            sealAckPacket(ack);
+            this->send(c.mac, (const uint8_t*)&ack, sizeof(ack));
+        }
+    }
+}
+
+// Turn the send callback counters into a rolling success rate and adapt transmit interval and deadband
+void ESPNowBroker::adaptRate(const unsigned long now) {
+    if (!initialized) return;
+    if ((long)(now - last_adapt_ms) < ADAPT_MS) return;
+    last_adapt_ms = now;
+
+    const uint32_t ok = tx_ok.load(std::memory_order_relaxed);
+    const uint32_t fail = tx_fail.load(std::memory_order_relaxed) + tx_errors;
+    const uint32_t lat_sum = lat_sum_us.load(std::memory_order_relaxed);
+    const uint32_t lat_n = lat_count.load(std::memory_order_relaxed);
+    const uint32_t d_ok = ok - prev_ok, d_fail = fail - prev_fail;
+    const uint32_t d_lat_sum = lat_sum - prev_lat_sum, d_lat_n = lat_n - prev_lat_count;
+    prev_ok = ok; prev_fail = fail; prev_lat_sum = lat_sum; prev_lat_count = lat_n;
+
+    if (d_ok + d_fail == 0) return;
+    const float rate = (float)d_ok / (float)(d_ok + d_fail);
+    success_rate += SUCCESS_ALPHA * (rate - success_rate);
+    if (d_lat_n > 0) lat_avg_us = d_lat_sum / d_lat_n;
+
+    if (success_rate < CONGESTED_RATE || lat_avg_us > CONGESTED_LAT_US) {
+        // Congested: fewer and larger steps
+        if (tx_interval_ms < TX_INTERVAL_MAX_MS || db_scale < DB_SCALE_MAX) congestions++;
+        tx_interval_ms = min(tx_interval_ms * 2, TX_INTERVAL_MAX_MS);
+        db_scale = min((uint8_t)(db_scale * 2), DB_SCALE_MAX);
+    } else if (success_rate > CLEAR_RATE && lat_avg_us < CLEAR_LAT_US) {
+        // Cleared: recover step by step
+        tx_interval_ms = max(tx_interval_ms / 2, TX_INTERVAL_MIN_MS);
+        db_scale = max((uint8_t)(db_scale / 2), (uint8_t)1);
     }
+    if (pipeline) pipeline->setInterval(sink_id, tx_interval_ms);
+}
+
+// Pair the next display that sends a hello or a command within the pairing window
+void ESPNowBroker::startPairing(const unsigned long now) {
+    pairing = true;
+    pairing_start_ms = now;
+}
+
+// Forget all paired displays
+void ESPNowBroker::unpairAll() {
+    paired_n = 0;
+    pairing = false;
+    compass_prefs.saveEspNowPeers(paired, 0);
+}
 
-    // Only send if something changed
-    if (!(changed_h || changed_p || changed_r)) return;
+// === P R I V A T E ===
 
-    // Send delta directly
-    esp_now_send(BROADCAST_ADDR, (const uint8_t*)&delta, sizeof(delta));
+// Debug: copy the active subscribers with their delivery counters
+uint8_t ESPNowBroker::getPeers(PeerInfo* out, uint8_t max, const unsigned long now) const {
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < MAX_SUBSCRIBERS && n < max; i++) {
+        const Subscriber &sub = subscribers[i];
+        if (!sub.active) continue;
+        memcpy(out[n].mac, sub.mac, 6);
+        out[n].fields = sub.fields;
+        out[n].interval_ms = sub.interval_ms;
+        out[n].ok = sub_ok[i].load(std::memory_order_relaxed);
+        out[n].fail = sub_fail[i].load(std::memory_order_relaxed);
+        out[n].age_ms = now - sub.last_hello_ms;
+        n++;
+    }
+    return n;
 }
 
-// Process the received attitude leveling command coming from ESP-NOW peer
-void ESPNowBroker::processLevelCommand() {
-    if(!level_command_received) return;
-    level_command_received = false;
+// Execute one remote command, same effect as the web UI counterpart
+EspNowAck ESPNowBroker::executeCommand(EspNowCmd cmd, int16_t arg) {
+    switch (cmd) {
+
+        case EspNowCmd::LEVEL:
+            compass.level();
+            return EspNowAck::OK;
 
-    compass.level();
+        case EspNowCmd::START_CAL: {
+            const CalMode mode = (CalMode)arg;
+            if (mode != CalMode::FULL_AUTO && mode != CalMode::AUTO && mode != CalMode::MANUAL) return EspNowAck::BAD_ARG;
+            return compass.startCalibration(mode) ? EspNowAck::OK : EspNowAck::FAILED;
+        }
+
+        case EspNowCmd::STOP_CAL:
+            return compass.stopCalibration() ? EspNowAck::OK : EspNowAck::FAILED;
+
+        case EspNowCmd::SET_OFFSET: {
+            if (arg < -1800 || arg > 1800) return EspNowAck::BAD_ARG;
+            const float v = arg / 10.0f;
+            compass.setInstallationOffset(v);
+            compass_prefs.saveInstallationOffset(v);
+            return EspNowAck::OK;
+        }
+
+        case EspNowCmd::SET_HDG_MODE: {
+            if (arg < -1 || arg > 1) return EspNowAck::BAD_ARG;
+            const bool hdg_true = (arg == -1) ? !compass.isSendingHeadingTrue() : (arg == 1);
+            compass.setSendHeadingTrue(hdg_true);
+            compass_prefs.saveSendHeadingTrue(hdg_true);
+            return EspNowAck::OK;
+        }
+
+        default:
+            return EspNowAck::UNKNOWN_CMD;
+    }
+}
+
+// Register a unicast peer once, evicting the oldest cached non-subscriber when full
+bool ESPNowBroker::ensurePeer(const uint8_t* mac) {
+    for (uint8_t i = 0; i < peer_count; i++) {
+        if (memcmp(peer_cache[i], mac, 6) == 0) return true;
+    }
 
-    uint8_t response[8];
-    response[0] = 'L';
-    response[1] = 'V';
-    response[2] = 'L';
-    response[3] = 'R';
-    response[4] = 1;
-    response[5] = 0;
-    response[6] = 0;
-    response[7] = 0;
+    uint8_t slot = peer_count;
+    if (peer_count == PEER_CACHE_SIZE) {
+        // PEER_CACHE_SIZE > MAX_SUBSCRIBERS, so there is always a slot to evict
+        while (this->isSubscriber(peer_cache[peer_next])) peer_next = (peer_next + 1) % PEER_CACHE_SIZE;
+        slot = peer_next;
+        peer_next = (peer_next + 1) % PEER_CACHE_SIZE;
+        esp_now_del_peer(peer_cache[slot]);
+        memcpy(peer_cache[slot], peer_cache[peer_count - 1], 6); // Keep the cache compact
+        peer_count--;
+        slot = peer_count;
+    }
 
     esp_now_peer_info_t peer = {};
-    memcpy(peer.peer_addr, last_sender_mac, 6);
+    memcpy(peer.peer_addr, mac, 6);
     peer.channel = 0;
     peer.encrypt = false;
+    esp_err_t err = esp_now_add_peer(&peer);
+    if (err != ESP_OK && err != ESP_ERR_ESPNOW_EXIST) return false;
 
-    if (!esp_now_is_peer_exist(last_sender_mac)) esp_now_add_peer(&peer);
+    memcpy(peer_cache[slot], mac, 6);
+    peer_count++;
+    return true;
+}
 
-    esp_err_t result = esp_now_send(last_sender_mac, response, sizeof(response));
+// Active subscriber with this MAC
+bool ESPNowBroker::isSubscriber(const uint8_t* mac) const {
+    for (uint8_t i = 0; i < MAX_SUBSCRIBERS; i++) {
+        if (subscribers[i].active && memcmp(subscribers[i].mac, mac, 6) == 0) return true;
+    }
+    return false;
 }
 
-// === P R I V A T E ===
+// Paired display with this MAC
+bool ESPNowBroker::isPaired(const uint8_t* mac) const {
+    for (uint8_t i = 0; i < paired_n; i++) {
+        if (memcmp(paired[i], mac, 6) == 0) return true;
+    }
+    return false;
+}
 
-// Static callback for data send
-void ESPNowBroker::onDataSent(const esp_now_send_info_t* info, esp_now_send_status_t status) {}
+// Pair a display and close the pairing window, the oldest pairing is dropped when full
+void ESPNowBroker::pair(const uint8_t* mac) {
+    if (paired_n == ESPNOW_MAX_PAIRED) {
+        memmove(paired[0], paired[1], (ESPNOW_MAX_PAIRED - 1) * 6);
+        paired_n--;
+    }
+    memcpy(paired[paired_n++], mac, 6);
+    pairing = false;
+    compass_prefs.saveEspNowPeers(paired, paired_n);
+}
 
-// Static callback for data receive
-void ESPNowBroker::onDataRecv(const esp_now_recv_info_t* recv_info, const uint8_t* data, int len) {
-    if (len == 8) {
-        if (data[0] == 'L' && data[1] == 'V' && data[2] == 'L' && data[3] == 'C') {
-            memcpy(last_sender_mac, recv_info->src_addr, 6);
-            level_command_received = true;
+// Register or refresh a subscriber from a hello, replacing the longest silent one when full
+void ESPNowBroker::registerSubscriber(const uint8_t* mac, uint8_t fields, uint16_t interval_ms, const unsigned long now) {
+    int8_t slot = -1;
+    for (uint8_t i = 0; i < MAX_SUBSCRIBERS; i++) {
+        if (subscribers[i].active && memcmp(subscribers[i].mac, mac, 6) == 0) {
+            slot = i;
+            break;
+        }
+    }
+
+    if (slot < 0) {
+        for (uint8_t i = 0; i < MAX_SUBSCRIBERS; i++) {
+            if (!subscribers[i].active) {
+                slot = i;
+                break;
+            }
+        }
+        if (slot < 0) {
+            slot = 0;
+            for (uint8_t i = 1; i < MAX_SUBSCRIBERS; i++) {
+                if ((long)(subscribers[i].last_hello_ms - subscribers[slot].last_hello_ms) < 0) slot = i;
+            }
+            peers_expired++;
+        }
+        if (!this->ensurePeer(mac)) return;
+        subscribers[slot] = Subscriber();
+        memcpy(subscribers[slot].mac, mac, 6);
+        sub_keys[slot].store(0, std::memory_order_relaxed);      // Not counted while the counters are reset
+        sub_ok[slot].store(0, std::memory_order_relaxed);
+        sub_fail[slot].store(0, std::memory_order_relaxed);
+        sub_keys[slot].store(macKey(mac), std::memory_order_release);
+        subscribers[slot].active = true;
+    }
+
+    Subscriber &sub = subscribers[slot];
+    sub.fields = fields & HP_FIELDS_ALL;
+    sub.interval_ms = min(interval_ms, PEER_INTERVAL_MAX_MS);
+    sub.last_hello_ms = now;
+}
+
+// Deadband check on the subscribed fields against the values last sent
+bool ESPNowBroker::deadbandExceeded(const HeadingSample &s, uint8_t fields, const DeadbandTrack &t) const {
+    const float db_hdg = DB_HDG_RAD * db_scale;
+    const float db_att = DB_ATT_RAD * db_scale;
+
+    if (!validf(t.h) || fabsf(computeAngDiffRad(s.heading_rad, t.h)) >= db_hdg) return true;
+    if (!(fields & HP_FIELD_ATTITUDE)) return false;
+    if (!validf(t.p) || fabsf(s.pitch_rad - t.p) >= db_att) return true;
+    return !validf(t.r) || fabsf(s.roll_rad - t.r) >= db_att;
+}
+
+// Move the deadband references to the values of a packet that was sent
+void ESPNowBroker::deadbandSent(const HeadingSample &s, uint8_t fields, DeadbandTrack &t) {
+    t.h = s.heading_rad;
+    if (!(fields & HP_FIELD_ATTITUDE)) return;
+    t.p = s.pitch_rad;
+    t.r = s.roll_rad;
+}
+
+// MAC address as a 48-bit key, 0 is never a unicast MAC in use
+uint64_t ESPNowBroker::macKey(const uint8_t* mac) {
+    uint64_t k = 0;
+    for (uint8_t i = 0; i < 6; i++) k = (k << 8) | mac[i];
+    return k;
+}
+
+// Mask the fields not subscribed, encode and send one heading packet
+bool ESPNowBroker::sendSample(const uint8_t* mac, HeadingSample s, uint8_t fields) {
+    if (!(fields & HP_FIELD_HEADING_TRUE)) s.heading_true_rad = NAN;
+    if (!(fields & HP_FIELD_ATTITUDE)) {
+        s.pitch_rad = NAN;
+        s.roll_rad = NAN;
+    }
+    if (!(fields & HP_FIELD_ROT)) s.rot_rad = NAN;
+    if (!(fields & HP_FIELD_CAL)) s.cal = 0;
+
+    HeadingPacket packet;
+    encodeHeadingPacket(s, packet);
+    return this->send(mac, (const uint8_t*)&packet, sizeof(packet));
+}
+
+// Send and account a packet, the result comes later to onDataSent()
+bool ESPNowBroker::send(const uint8_t* mac, const uint8_t* data, size_t len) {
+    // Timestamp into the FIFO before sending, the callback may run before esp_now_send() returns
+    const uint32_t head = send_head.load(std::memory_order_relaxed);
+    if (head - send_tail.load(std::memory_order_acquire) >= SEND_FIFO) {
+        tx_errors++;   // Too many sends without a callback
+        return false;
+    }
+    send_us[head % SEND_FIFO].store((uint32_t)micros(), std::memory_order_relaxed);
+    send_head.store(head + 1, std::memory_order_release);
+    tx_in_flight.fetch_add(1, std::memory_order_relaxed);
+
+    if (esp_now_send(mac, data, len) != ESP_OK) {
+        // No callback for a refused send, and none for a later one has run yet, so take the timestamp back
+        send_head.store(head, std::memory_order_release);
+        tx_in_flight.fetch_sub(1, std::memory_order_relaxed);
+        tx_errors++;
+        return false;
+    }
+    return true;
+}
+
+// Static callback for data send, runs in the WiFi task: counters only
+void ESPNowBroker::onDataSent(const esp_now_send_info_t* info, esp_now_send_status_t status) {
+    const bool ok = (status == ESP_NOW_SEND_SUCCESS);
+    if (ok) tx_ok.fetch_add(1, std::memory_order_relaxed);
+    else tx_fail.fetch_add(1, std::memory_order_relaxed);
+
+    // Per subscriber, unicast results are MAC-layer acknowledged
+    if (info && info->des_addr) {
+        const uint64_t key = macKey(info->des_addr);
+        for (uint8_t i = 0; i < MAX_SUBSCRIBERS; i++) {
+            if (sub_keys[i].load(std::memory_order_acquire) != key) continue;
+            if (ok) sub_ok[i].fetch_add(1, std::memory_order_relaxed);
+            else sub_fail[i].fetch_add(1, std::memory_order_relaxed);
+            break;
         }
     }
+    if (tx_in_flight.load(std::memory_order_relaxed) > 0) tx_in_flight.fetch_sub(1, std::memory_order_relaxed);
+
+    // Latency against the oldest unmatched send, callbacks come in send order
+    const uint32_t tail = send_tail.load(std::memory_order_relaxed);
+    if (tail == send_head.load(std::memory_order_acquire)) return;
+    const uint32_t lat = (uint32_t)micros() - send_us[tail % SEND_FIFO].load(std::memory_order_relaxed);
+    send_tail.store(tail + 1, std::memory_order_release);
+    lat_sum_us.fetch_add(lat, std::memory_order_relaxed);
+    lat_count.fetch_add(1, std::memory_order_relaxed);
+    if (lat > lat_max_us.load(std::memory_order_relaxed)) lat_max_us.store(lat, std::memory_order_relaxed); // Only writer
+}
+
+// Static callback for data receive, runs in the WiFi task: validate and queue only
+void ESPNowBroker::onDataRecv(const esp_now_recv_info_t* recv_info, const uint8_t* data, int len) {
+    if (len != 8) return;
+
+    QueuedCommand c = {};
+    memcpy(c.mac, recv_info->src_addr, 6);
+
+    if (data[0] == 'L' && data[1] == 'V' && data[2] == 'L' && data[3] == 'C') {
+        c.cmd = (uint8_t)EspNowCmd::LEVEL;
+        c.legacy = true;
+    } else if (data[0] == HELLO_PACKET_MAGIC) {
+        HelloPacket p;
+        memcpy(&p, data, sizeof(p));
+        if (!helloPacketValid(p)) {
+            cmd_invalid.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        c.hello = true;
+        c.fields = p.fields;
+        c.interval_ms = p.interval_ms;
+    } else if (data[0] == COMMAND_PACKET_MAGIC) {
+        CommandPacket p;
+        memcpy(&p, data, sizeof(p));
+        if (!commandPacketValid(p)) {
+            cmd_invalid.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        c.cmd = p.cmd;
+        c.seq = p.seq;
+        c.arg = p.arg;
+    } else return;
+
+    if (!cmd_queue.push(c)) cmd_dropped.fetch_add(1, std::memory_order_relaxed);
 }
@@ -2,7 +2,13 @@
 
 #include <Arduino.h>
 #include <esp_now.h>
+#include <atomic>
 #include "CMPS14Processor.h"
+#include "CMPS14Preferences.h"
+#include "heading_packet.h"
+#include "command_packet.h"
+#include "spsc_queue.h"
+#include "OutputPipeline.h"
 
 // === E S P N O W B R O K E R  C L A S S ===
 //
@@ -10,38 +16,211 @@
 // - Init: espnow.begin()
 // - Provides public API to
 //   - Initialize ESP-NOW in broadcast mode
-//   - Send compass heading delta to all ESP-NOW listeners
-//   - Process attitude leveling command received from ESP-NOW peer
-// - Uses: CMPS14Processor ("the compass")
+//   - Send compass heading delta as a HeadingPacket (versioned, sequenced,
+//     quantized, CRC-16), at least every KEEPALIVE_MS, as an output sink of
+//     the pipeline at the adaptive rate, deadbands kept per destination
+// - Peer registry: displays subscribe with a HelloPacket (fields, interval) and
+//   get unicast packets with MAC-layer ACK and retries, each with its own
+//   sequence, deadband and rate, silent peers expire after PEER_EXPIRY_MS
+// - Broadcast at full rate only while nobody has subscribed (discovery and
+//   legacy listeners), otherwise only a 1 Hz beacon
+//   - Execute remote commands received from ESP-NOW peers (level, start/stop
+//     calibration, set installation offset, set heading mode) and acknowledge
+//     each with a status code, legacy "LVLC" leveling command still accepted
+// - Pairing: configuration commands (start calibration, set offset, set
+//   heading mode) only from paired displays. espnow.startPairing(now) from the
+//   web UI opens a PAIRING_WINDOW_MS window, the first display sending a hello
+//   or a command in it is paired, paired MACs are stored by compass_prefs
+// - Commands: the receive callback (WiFi task) validates and pushes them into
+//   a lock-free SPSC queue, espnow.processCommands() in loop() drains it, so
+//   back-to-back commands from several displays are all executed
+// - Peers for acknowledgements are registered once and cached
+// - Delivery statistics: the send callback (WiFi task) feeds lock-free atomic
+//   counters and send-to-callback latency, espnow.adaptRate(now) in loop()
+//   turns them into a rolling success rate once a second. Latency: send
+//   timestamps in a FIFO, matched in order with the callbacks (ESP-NOW reports
+//   sends in order)
+// - Subscriber MACs are shared with the send callback as atomic 48-bit keys,
+//   the subscriber table itself is used in loop() only
+// - Deadband references are moved only when a packet was actually sent
+// - Adaptive rate: on congestion (low success rate, high latency or queue
+//   errors) the transmit interval and deadband are doubled, and halved back
+//   step by step when the medium has cleared
+// - Uses: CMPS14Processor ("the compass"), CMPS14Preferences ("the compass_prefs"),
+//   HeadingPacket, CommandPacket, SpscQueue, OutputPipeline
 
 class ESPNowBroker {
 
 public:
     
-    explicit ESPNowBroker(CMPS14Processor &compassref);
+    explicit ESPNowBroker(CMPS14Processor &compassref, CMPS14Preferences &compass_prefsref);
 
     bool begin();
-    void sendHeadingDelta();
-    void processLevelCommand();
+    void registerSinks(OutputPipeline &pipelineref);
+    bool sendHeadingDelta(const OutputSample &sample, uint8_t changed);
+    void processCommands();
+    void adaptRate(const unsigned long now);
+    void startPairing(const unsigned long now);
+    void unpairAll();
+
+    bool isPairing() const { return pairing; }
+    uint8_t getPairedCount() const { return paired_n; }
+
+    unsigned long getTxIntervalMs() const { return tx_interval_ms; }
+
+    // Debug
+    uint32_t getTxOk() const { return tx_ok.load(std::memory_order_relaxed); }
+    uint32_t getTxFail() const { return tx_fail.load(std::memory_order_relaxed); }
+    uint32_t getTxErrors() const { return tx_errors; }
+    uint32_t getTxSkipped() const { return tx_skipped; }
+    uint32_t getInFlight() const { return tx_in_flight.load(std::memory_order_relaxed); }
+    float getSuccessRate() const { return success_rate; }
+    uint32_t getLatencyAvgUs() const { return lat_avg_us; }
+    uint32_t getLatencyMaxUs() const { return lat_max_us.load(std::memory_order_relaxed); }
+    float getDeadbandDeg() const { return DB_HDG_RAD * db_scale * RAD_TO_DEG; }
+    uint32_t getCongestionCount() const { return congestions; }
+    uint32_t getCommandCount() const { return cmds_processed; }
+    uint32_t getCommandDrops() const { return cmd_dropped.load(std::memory_order_relaxed); }
+    uint32_t getCommandInvalid() const { return cmd_invalid.load(std::memory_order_relaxed); }
+    uint32_t getCommandRejected() const { return cmds_rejected; }
+    EspNowAck getLastAck() const { return last_ack; }
+
+    // Debug: registered peers
+    static constexpr uint8_t MAX_SUBSCRIBERS = 4;
+    struct PeerInfo {
+        uint8_t mac[6];
+        uint8_t fields;
+        uint16_t interval_ms;
+        uint32_t ok;
+        uint32_t fail;
+        unsigned long age_ms;          // Since the latest hello
+    };
+    uint8_t getPeers(PeerInfo* out, uint8_t max, const unsigned long now) const;
+    uint32_t getPeerExpiredCount() const { return peers_expired; }
 
 private:
+
+    bool send(const uint8_t* mac, const uint8_t* data, size_t len);
+    EspNowAck executeCommand(EspNowCmd cmd, int16_t arg);
+    bool ensurePeer(const uint8_t* mac);
+    bool isSubscriber(const uint8_t* mac) const;
+    bool isPaired(const uint8_t* mac) const;
+    void pair(const uint8_t* mac);
+    void registerSubscriber(const uint8_t* mac, uint8_t fields, uint16_t interval_ms, const unsigned long now);
+
+    // Deadband state per destination, the values last sent
+    struct DeadbandTrack {
+        float h = NAN, p = NAN, r = NAN;
+    };
+    bool deadbandExceeded(const HeadingSample &s, uint8_t fields, const DeadbandTrack &t) const;
+    static void deadbandSent(const HeadingSample &s, uint8_t fields, DeadbandTrack &t);
+    static uint64_t macKey(const uint8_t* mac);
+    bool sendSample(const uint8_t* mac, HeadingSample s, uint8_t fields);
     
     CMPS14Processor &compass;
+    CMPS14Preferences &compass_prefs;
 
     bool initialized = false;
 
-    // Attitude leveling command related static variables
-    static uint8_t last_sender_mac[6];
-    static volatile bool level_command_received;
+    // Remote commands from the receive callback to loop()
+    struct QueuedCommand {
+        uint8_t mac[6];
+        uint8_t cmd;           // EspNowCmd
+        bool legacy;           // "LVLC", answered with "LVLR"
+        bool hello;            // Subscription, no acknowledgement
+        uint8_t fields;        // Hello: HP_FIELD_* bits
+        uint16_t interval_ms;  // Hello: wanted interval
+        uint16_t seq;
+        int16_t arg;
+    };
+    static SpscQueue<QueuedCommand, 8> cmd_queue;
+    static std::atomic<uint32_t> cmd_dropped;      // Queue full
+    static std::atomic<uint32_t> cmd_invalid;      // Bad CRC
+    uint32_t cmds_processed = 0;
+    EspNowAck last_ack = EspNowAck::OK;
+    static constexpr uint8_t MAX_COMMANDS_PER_LOOP = 4;
+
+    // Displays allowed to change the configuration
+    uint8_t paired[ESPNOW_MAX_PAIRED][6] = {};
+    uint8_t paired_n = 0;
+    bool pairing = false;
+    unsigned long pairing_start_ms = 0;
+    uint32_t cmds_rejected = 0;                    // Configuration commands from displays not paired
+    static constexpr unsigned long PAIRING_WINDOW_MS = 60013;
 
-    // Deadband tracking (same pattern as SignalKBroker)
-    float last_h = NAN;
-    float last_p = NAN;
-    float last_r = NAN;
+    // Unicast peers registered for acknowledgements
+    static constexpr uint8_t PEER_CACHE_SIZE = 8;
+    uint8_t peer_cache[PEER_CACHE_SIZE][6] = {};
+    uint8_t peer_count = 0;
+    uint8_t peer_next = 0;                         // Next slot to evict when full
+
+    // Subscribed peers, MAC keys and delivery counters shared with the send callback
+    struct Subscriber {
+        bool active = false;
+        uint8_t mac[6] = {};
+        uint8_t fields = HP_FIELDS_ALL;
+        uint16_t interval_ms = 0;
+        uint16_t seq = 0;
+        unsigned long last_hello_ms = 0;
+        unsigned long last_send_ms = 0;
+        DeadbandTrack track;
+    };
+    Subscriber subscribers[MAX_SUBSCRIBERS];
+    static std::atomic<uint64_t> sub_keys[MAX_SUBSCRIBERS];   // macKey(), 0 = free
+    static std::atomic<uint32_t> sub_ok[MAX_SUBSCRIBERS];
+    static std::atomic<uint32_t> sub_fail[MAX_SUBSCRIBERS];
+    uint32_t peers_expired = 0;
+    static constexpr unsigned long PEER_EXPIRY_MS = 10007;    // Without a hello
+    static constexpr unsigned long BEACON_MS = 997;           // Broadcast while there are subscribers
+    static constexpr uint16_t PEER_INTERVAL_MAX_MS = 9973;
+
+    // Output pipeline sink, its rate follows tx_interval_ms
+    OutputPipeline* pipeline = nullptr;
+    uint8_t sink_id = OutputPipeline::NO_SINK;
+
+    // Broadcast deadband tracking, per destination unlike the pipeline deadband
+    DeadbandTrack bc_track;
+    unsigned long last_send_ms = 0;
+    uint16_t tx_seq = 0;
 
     static constexpr uint8_t BROADCAST_ADDR[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
     static constexpr float DB_HDG_RAD = 0.00436f;  // 0.25° deadband for heading
     static constexpr float DB_ATT_RAD = 0.00436f;  // 0.25° deadband for pitch/roll
+    static constexpr unsigned long KEEPALIVE_MS = 997; // Send also without changes, receivers see the link is alive
+
+    // Delivery statistics, written by the send callback in the WiFi task
+    static std::atomic<uint32_t> tx_ok;
+    static std::atomic<uint32_t> tx_fail;
+    static std::atomic<uint32_t> tx_in_flight;
+    static constexpr uint32_t SEND_FIFO = 16;      // Send timestamps awaiting their callback
+    static std::atomic<uint32_t> send_us[SEND_FIFO];
+    static std::atomic<uint32_t> send_head;        // Written by send() in loop()
+    static std::atomic<uint32_t> send_tail;        // Written by the send callback
+    static std::atomic<uint32_t> lat_sum_us;
+    static std::atomic<uint32_t> lat_count;
+    static std::atomic<uint32_t> lat_max_us;
+
+    // Loop side statistics and adaptive rate
+    uint32_t tx_errors = 0;                        // esp_now_send() refused, e.g. queue full
+    uint32_t tx_skipped = 0;                       // Not sent, too many in flight
+    uint32_t prev_ok = 0, prev_fail = 0, prev_lat_sum = 0, prev_lat_count = 0;
+    uint32_t lat_avg_us = 0;                       // Latest window
+    float success_rate = 1.0f;                     // Rolling, 0...1
+    uint32_t congestions = 0;
+    unsigned long tx_interval_ms = TX_INTERVAL_MIN_MS;
+    uint8_t db_scale = 1;
+    unsigned long last_adapt_ms = 0;
+
+    static constexpr unsigned long TX_INTERVAL_MIN_MS = 53;   // Normal rate ~20 Hz
+    static constexpr unsigned long TX_INTERVAL_MAX_MS = 211;  // Congested rate ~5 Hz
+    static constexpr uint8_t DB_SCALE_MAX = 4;                // Deadband up to 1°
+    static constexpr unsigned long ADAPT_MS = 997;
+    static constexpr uint32_t MAX_IN_FLIGHT = 4;
+    static constexpr float SUCCESS_ALPHA = 0.3f;
+    static constexpr float CONGESTED_RATE = 0.90f;
+    static constexpr float CLEAR_RATE = 0.98f;
+    static constexpr uint32_t CONGESTED_LAT_US = 9973;
+    static constexpr uint32_t CLEAR_LAT_US = 2999;
 
     // Static callback methods to be registered for ESP-NOW
     static void onDataSent(const esp_now_send_info_t* info, esp_now_send_status_t status);
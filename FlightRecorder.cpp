@@ -0,0 +1,233 @@
+#include "FlightRecorder.h"
+#include <esp_system.h>
+
+// === P U B L I C ===
+
+// Constructor
+FlightRecorder::FlightRecorder(CMPS14Processor &compassref) : compass(compassref), log(this->littleFs()) {}
+
+// Mount LittleFS, start a new log file for this boot
+bool FlightRecorder::begin() {
+    ok = LittleFS.begin(true);
+    if (!ok) return false;
+    if (!LittleFS.exists(DIR)) LittleFS.mkdir(DIR);
+
+    uint32_t oldest = 0, newest = 0;
+    uint8_t count = 0;
+    this->scanFiles(oldest, newest, count);
+    ok = log.begin(oldest, newest, count);
+    if (ok) this->logEvent(EV_BOOT, (int32_t)esp_reset_reason());
+    return ok;
+}
+
+// Register the sample sink with the pipeline
+void FlightRecorder::registerSinks(OutputPipeline &pipeline) {
+    OutputSink k;
+    k.name = "recorder";
+    k.fn = sinkThunk<FlightRecorder, &FlightRecorder::record>;
+    k.ctx = this;
+    k.interval_ms = RECORD_MS;
+    k.policy = SinkPolicy::ALWAYS;
+    k.fields = OUT_HEADING | OUT_HEADING_TRUE | OUT_PITCH | OUT_ROLL | OUT_ROT | OUT_CAL;
+    k.needs_wifi = false;
+    pipeline.addSink(k);
+}
+
+// Append one sample in its quantized form
+bool FlightRecorder::record(const OutputSample &s, uint8_t /* changed */) {
+    if (!ok) return false;
+    this->detectChanges();
+
+    auto hdg = [](float deg) -> uint16_t {
+        if (!validf(deg)) return RECORDER_NA_U16;
+        long c = lroundf(deg * 100.0f) % 36000;
+        return (uint16_t)(c < 0 ? c + 36000 : c);
+    };
+
+    RecorderFrame f;
+    f.t_ms   = s.sample_ms;
+    f.raw_10 = compass.getRawBearing10();
+    f.pitch  = compass.getRawPitch();
+    f.roll   = compass.getRawRoll();
+    f.hdg_c  = hdg(s.compass_deg);
+    f.hdg_m  = hdg(s.heading_deg);
+    f.hdg_t  = hdg(s.heading_true_deg);
+    f.rot    = RECORDER_NA_I16;
+    if (validf(s.rot_rad)) {
+        const long r = lroundf(s.rot_rad * 10000.0f);
+        f.rot = (int16_t)(r > 32767 ? 32767 : (r < -32767 ? -32767 : r));
+    }
+    f.cal    = s.cal;
+    return log.record(f);
+}
+
+// Append an event record
+void FlightRecorder::logEvent(uint8_t code, int32_t arg) {
+    if (ok) log.logEvent(code, arg);
+}
+
+// Write the current block now (before restart, OTA or download)
+void FlightRecorder::flush() {
+    if (ok) log.flush();
+}
+
+// Bounded data loss: a started block is written at latest after FLUSH_MS
+void FlightRecorder::handle(const unsigned long now) {
+    if (ok) log.handle(now);
+}
+
+// End of the download part starting at from, the first part flushes the current block
+RecorderCursor FlightRecorder::span(RecorderCursor &from) {
+    if (!ok) return from;
+    if (from.seq == 0) log.flush();
+    return log.span(from, STREAM_BYTES);
+}
+
+// Write one download part into a chunked response, returns bytes
+size_t FlightRecorder::stream(ResponseWriter &out, RecorderCursor &from, const RecorderCursor &end) {
+    if (!ok) return 0;
+    size_t total = 0, n;
+    while ((n = log.read(from, end, io, sizeof(io))) > 0) {
+        out.write((const char*)io, n);
+        total += n;
+    }
+    read_file.close();
+    return total;
+}
+
+// === P R I V A T E ===
+
+// LittleFS backend for the log
+RecorderStorage FlightRecorder::littleFs() {
+    RecorderStorage st;
+    st.ctx = this;
+    st.create = fsCreate;
+    st.append = fsAppend;
+    st.read = fsRead;
+    st.size = fsSize;
+    st.remove = fsRemove;
+    st.clock = fsClock;
+    return st;
+}
+
+// Find the oldest and newest log file sequence numbers and the number of files
+void FlightRecorder::scanFiles(uint32_t &oldest, uint32_t &newest, uint8_t &count) {
+    oldest = 0;
+    newest = 0;
+    count = 0;
+    File dir = LittleFS.open(DIR);
+    if (!dir || !dir.isDirectory()) return;
+    File f = dir.openNextFile();
+    while (f) {
+        const uint32_t seq = strtoul(f.name(), nullptr, 10);
+        if (seq > 0) {
+            if (count == 0 || seq < oldest) oldest = seq;
+            if (seq > newest) newest = seq;
+            count++;
+        }
+        f = dir.openNextFile();
+    }
+}
+
+// Path of a log file
+void FlightRecorder::pathFor(uint32_t seq, char* path, size_t n) const {
+    snprintf(path, n, "%s/%08lu.bin", DIR, (unsigned long)seq);
+}
+
+// Events for configuration and calibration changes seen on the compass
+void FlightRecorder::detectChanges() {
+    const uint8_t cal_mode = (uint8_t)compass.getCalibrationModeRuntime();
+    const bool cal_stored = compass.isCalProfileStored();
+    const float offset = compass.getInstallationOffset();
+    const uint32_t hash = compass.getHarmonicHash();
+    const float pitch_level = compass.getPitchLevel();
+    const float roll_level = compass.getRollLevel();
+    const bool hdg_true = compass.isSendingHeadingTrue();
+
+    if (watch_init) {
+        if (cal_mode != last_cal_mode) this->logEvent(EV_CAL_MODE, cal_mode);
+        if (cal_stored != last_cal_stored) this->logEvent(EV_CAL_STORED, cal_stored ? 1 : 0);
+        if (offset != last_offset) this->logEvent(EV_OFFSET, (int32_t)lroundf(offset * 100.0f));
+        if (hash != last_hash) this->logEvent(EV_DEVIATION, (int32_t)hash);
+        if (pitch_level != last_pitch_level || roll_level != last_roll_level) {
+            const int32_t p = (int16_t)lroundf(pitch_level);
+            const int32_t r = (int16_t)lroundf(roll_level);
+            this->logEvent(EV_LEVEL, (int32_t)(((uint32_t)p << 16) | ((uint32_t)r & 0xFFFF)));
+        }
+        if (hdg_true != last_hdg_true) this->logEvent(EV_HDG_MODE, hdg_true ? 1 : 0);
+    }
+    watch_init = true;
+    last_cal_mode = cal_mode;
+    last_cal_stored = cal_stored;
+    last_offset = offset;
+    last_hash = hash;
+    last_pitch_level = pitch_level;
+    last_roll_level = roll_level;
+    last_hdg_true = hdg_true;
+}
+
+// Close the current file and start file seq
+bool FlightRecorder::fsCreate(void* ctx, uint32_t seq) {
+    FlightRecorder* r = static_cast<FlightRecorder*>(ctx);
+    if (r->file) r->file.close();
+    char path[24];
+    r->pathFor(seq, path, sizeof(path));
+    r->file = LittleFS.open(path, "w");
+    return (bool)r->file;
+}
+
+// Write and flush to the current file, timed for the debug average
+bool FlightRecorder::fsAppend(void* ctx, const uint8_t* p, size_t n) {
+    FlightRecorder* r = static_cast<FlightRecorder*>(ctx);
+    if (!r->file) return false;
+    const unsigned long start_us = micros();
+    const bool written = r->file.write(p, n) == n;
+    r->file.flush();
+    const float us = (float)(micros() - start_us);
+    r->write_avg_us = (r->appends++ == 0) ? us : 0.9f * r->write_avg_us + 0.1f * us;
+    return written;
+}
+
+// Read from file seq, kept open until the download part is written
+size_t FlightRecorder::fsRead(void* ctx, uint32_t seq, uint32_t offset, uint8_t* p, size_t n) {
+    FlightRecorder* r = static_cast<FlightRecorder*>(ctx);
+    if (!r->read_file || r->read_seq != seq) {
+        r->read_file.close();
+        char path[24];
+        r->pathFor(seq, path, sizeof(path));
+        r->read_file = LittleFS.open(path, "r");
+        r->read_seq = seq;
+        if (!r->read_file) return 0;
+    }
+    if (offset >= r->read_file.size() || !r->read_file.seek(offset)) return 0;
+    return r->read_file.read(p, n);
+}
+
+// Size of file seq, 0 if it does not exist
+uint32_t FlightRecorder::fsSize(void* ctx, uint32_t seq) {
+    FlightRecorder* r = static_cast<FlightRecorder*>(ctx);
+    if (r->file && seq == r->log.getFileSeq()) return r->file.size();
+    char path[24];
+    r->pathFor(seq, path, sizeof(path));
+    File f = LittleFS.open(path, "r");
+    if (!f) return 0;
+    const uint32_t size = f.size();
+    f.close();
+    return size;
+}
+
+// Delete file seq
+bool FlightRecorder::fsRemove(void* ctx, uint32_t seq) {
+    FlightRecorder* r = static_cast<FlightRecorder*>(ctx);
+    char path[24];
+    r->pathFor(seq, path, sizeof(path));
+    return LittleFS.remove(path);
+}
+
+// millis() and the system time if it has been set
+void FlightRecorder::fsClock(void* /* ctx */, uint32_t &ms, uint32_t &epoch_s) {
+    ms = millis();
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    epoch_s = (tv.tv_sec > 1600000000) ? (uint32_t)tv.tv_sec : 0;   // Only if the clock has been set
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+#include <LittleFS.h>
+#include <sys/time.h>
+#include "recorder_log.h"
+#include "CMPS14Processor.h"
+#include "OutputPipeline.h"
+#include "ResponseWriter.h"
+
+// === F L I G H T R E C O R D E R  C L A S S ===
+//
+// - Class FlightRecorder - "the recorder" keeps a rotating binary log of raw
+//   CMPS14 frames, processed headings, calibration status and key events on
+//   LittleFS, to look back at what the compass did when something went wrong
+// - Init: recorder.begin() mounts LittleFS (formatted if it does not mount),
+//   starts a new log file and logs a BOOT event with the reset reason
+// - Samples: registered as an output sink, recorder.registerSinks(pipeline),
+//   every 199 ms and independent of WiFi
+// - Events: recorder.logEvent(code, arg) from the app (WiFi, restart, OTA),
+//   calibration, offset, deviation, leveling and heading mode changes are
+//   detected from the compass at each sample
+// - Log: RecorderLog encodes the samples and events into blocks and rotates
+//   the files (format and decoder in recorder_log.h), this class provides the
+//   LittleFS backend, /rec/<seq>.bin, and the samples from the compass
+// - Flash wear: only whole blocks are written, when full or at latest
+//   FLUSH_MS after the first record in the block, recorder.flush() before
+//   restart and OTA. At 5 samples/s the log grows ~30 B/s (max ~150 B/s)
+// - Rotation: a new file at each boot and at MAX_FILE_BYTES, the oldest
+//   deleted beyond MAX_FILES (8 x 128 kB, hours of history)
+// - Download in parts of at most STREAM_BYTES, so one request does not hold
+//   up the loop: end = recorder.span(from) flushes on the first part (from.seq
+//   0) and returns where the part ends, recorder.stream(out, from, end) writes
+//   it, the next part continues at end until recorder.isEnd(end)
+// - Uses: CMPS14Processor ("the compass"), OutputPipeline, LittleFS, ResponseWriter
+// - Owns: RecorderLog
+
+class FlightRecorder {
+
+public:
+
+    // Event codes
+    static constexpr uint8_t EV_BOOT       = 1;   // arg: esp_reset_reason()
+    static constexpr uint8_t EV_WIFI_UP    = 2;
+    static constexpr uint8_t EV_WIFI_DOWN  = 3;
+    static constexpr uint8_t EV_CAL_MODE   = 4;   // arg: runtime CalMode
+    static constexpr uint8_t EV_CAL_STORED = 5;   // arg: 1 = profile stored
+    static constexpr uint8_t EV_OFFSET     = 6;   // arg: installation offset, centidegrees
+    static constexpr uint8_t EV_DEVIATION  = 7;   // arg: harmonic hash of the new table
+    static constexpr uint8_t EV_LEVEL      = 8;   // arg: pitch level << 16 | roll level, degrees
+    static constexpr uint8_t EV_HDG_MODE   = 9;   // arg: 1 = true heading sent
+    static constexpr uint8_t EV_RESTART    = 10;
+    static constexpr uint8_t EV_OTA        = 11;
+
+    explicit FlightRecorder(CMPS14Processor &compassref);
+
+    bool begin();
+    void registerSinks(OutputPipeline &pipeline);
+    bool record(const OutputSample &s, uint8_t changed);
+    void logEvent(uint8_t code, int32_t arg = 0);
+    void flush();
+    void handle(const unsigned long now);
+    RecorderCursor span(RecorderCursor &from);
+    size_t stream(ResponseWriter &out, RecorderCursor &from, const RecorderCursor &end);
+    bool isEnd(const RecorderCursor &c) const { return log.isEnd(c); }
+
+    // Debug
+    bool isOk() const { return ok; }
+    uint32_t getSamples() const { return log.getSamples(); }
+    uint32_t getEvents() const { return log.getEvents(); }
+    uint32_t getBlocks() const { return log.getBlocks(); }
+    uint32_t getBytesWritten() const { return log.getBytesWritten(); }
+    uint32_t getWriteErrors() const { return log.getWriteErrors(); }
+    uint32_t getFileSeq() const { return log.getFileSeq(); }
+    uint8_t getFileCount() const { return log.getFileCount(); }
+    float getWriteUs() const { return write_avg_us; }
+    size_t getFsUsed() const { return ok ? LittleFS.usedBytes() : 0; }
+    size_t getFsTotal() const { return ok ? LittleFS.totalBytes() : 0; }
+
+private:
+
+    static constexpr unsigned long RECORD_MS      = 199;
+    static constexpr size_t STREAM_BYTES          = 16384;   // Per download request
+    static constexpr const char* DIR              = "/rec";
+
+    RecorderStorage littleFs();
+    void scanFiles(uint32_t &oldest, uint32_t &newest, uint8_t &count);
+    void pathFor(uint32_t seq, char* path, size_t n) const;
+    void detectChanges();
+
+    // LittleFS backend of the log
+    static bool fsCreate(void* ctx, uint32_t seq);
+    static bool fsAppend(void* ctx, const uint8_t* p, size_t n);
+    static size_t fsRead(void* ctx, uint32_t seq, uint32_t offset, uint8_t* p, size_t n);
+    static uint32_t fsSize(void* ctx, uint32_t seq);
+    static bool fsRemove(void* ctx, uint32_t seq);
+    static void fsClock(void* ctx, uint32_t &ms, uint32_t &epoch_s);
+
+    CMPS14Processor &compass;
+    RecorderLog log;
+    File file;                    // Appended to
+    File read_file;               // Open while a download part is written
+    uint32_t read_seq = 0;
+    uint8_t io[RecorderLog::BLOCK_SIZE];
+    bool ok = false;
+
+    // Change detection for events
+    bool watch_init = false;
+    uint8_t last_cal_mode = 0;
+    bool last_cal_stored = false;
+    float last_offset = 0.0f;
+    uint32_t last_hash = 0;
+    float last_pitch_level = 0.0f, last_roll_level = 0.0f;
+    bool last_hdg_true = false;
+
+    // Debug
+    uint32_t appends = 0;
+    float write_avg_us = 0.0f;
+
+};
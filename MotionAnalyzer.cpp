@@ -0,0 +1,168 @@
+#include "MotionAnalyzer.h"
+
+// === P U B L I C ===
+
+// Constructor, Hann window and FFT twiddle factors
+MotionAnalyzer::MotionAnalyzer(MicrosFn micros_fn) : micros_fn(micros_fn) {
+    window_power = 0.0f;
+    for (int n = 0; n < N; n++) {
+        window[n] = 0.5f - 0.5f * cosf(2.0f * (float)M_PI * n / N);
+        window_power += window[n] * window[n];
+    }
+    for (int k = 0; k < N / 2; k++) {
+        twiddle_cos[k] = cosf(2.0f * (float)M_PI * k / N);
+        twiddle_sin[k] = -sinf(2.0f * (float)M_PI * k / N);
+    }
+}
+
+// Average samples into DECIM_MS bins, a finished bin goes to the ring
+void MotionAnalyzer::add(uint32_t t_ms, float pitch_deg, float roll_deg) {
+    if (isnan(pitch_deg) || isnan(roll_deg)) return;
+
+    uint32_t next_start_ms = t_ms;
+    if (bin_valid) {
+        const uint32_t gap = (t_ms - bin_start_ms) / DECIM_MS;   // Bins passed, across the millis() wrap
+        if (gap > 0) {
+            const float p = bin_pitch / bin_n, r = bin_roll / bin_n;
+            if (gap * DECIM_MS > MAX_GAP_MS) {
+                // Too long without samples (or time went backwards), start over
+                count = 0;
+                since_block = 0;
+            } else {
+                // Short gap: hold the last value
+                for (uint32_t i = 0; i < gap; i++) this->push(p, r);
+                next_start_ms = bin_start_ms + gap * DECIM_MS;
+            }
+            bin_valid = false;
+        }
+    }
+    if (!bin_valid) {
+        bin_start_ms = next_start_ms;
+        bin_pitch = 0.0f;
+        bin_roll = 0.0f;
+        bin_n = 0;
+        bin_valid = true;
+    }
+    bin_pitch += pitch_deg;
+    bin_roll += roll_deg;
+    bin_n++;
+}
+
+// Run one step of a pending block, or start a block when HOP new values are in
+void MotionAnalyzer::step() {
+    if (phase == PHASE_IDLE) {
+        if (count < N || since_block < HOP) return;
+        since_block = 0;
+        block_acc_us = 0;
+        phase = PHASE_PREPARE;
+    }
+
+    const uint32_t start_us = micros_fn ? micros_fn() : 0;
+    if (phase == PHASE_PREPARE) this->prepare();
+    else if (phase < PHASE_SPECTRUM) this->butterflies(phase - PHASE_PREPARE - 1);
+    else this->spectrum();
+    const uint32_t us = micros_fn ? micros_fn() - start_us : 0;
+
+    block_acc_us += us;
+    if (us > step_max_us) step_max_us = us;
+    if (phase == PHASE_SPECTRUM) {
+        block_us = block_acc_us;
+        blocks++;
+        phase = PHASE_IDLE;
+    } else phase++;
+}
+
+// === P R I V A T E ===
+
+// Append one decimated value to the ring
+void MotionAnalyzer::push(float pitch_deg, float roll_deg) {
+    ring_pitch[head] = pitch_deg;
+    ring_roll[head] = roll_deg;
+    head = (head + 1) % N;
+    if (count < N) count++;
+    since_block++;
+}
+
+// Copy the ring oldest first without its mean, apply the window, bit-reversed order for the FFT
+void MotionAnalyzer::prepare() {
+    float mean_p = 0.0f, mean_r = 0.0f;
+    for (int n = 0; n < N; n++) {
+        mean_p += ring_pitch[n];
+        mean_r += ring_roll[n];
+    }
+    mean_p /= N;
+    mean_r /= N;
+
+    for (int n = 0; n < N; n++) {
+        int rev = 0;
+        for (int b = 0; b < LOG2N; b++) rev |= ((n >> b) & 1) << (LOG2N - 1 - b);
+        const int src = (head + n) % N;   // head is the oldest value when the ring is full
+        re[rev] = (ring_pitch[src] - mean_p) * window[n];
+        im[rev] = (ring_roll[src] - mean_r) * window[n];
+    }
+}
+
+// One radix-2 decimation in time stage, stage 0...LOG2N-1
+void MotionAnalyzer::butterflies(int stage) {
+    const int half = 1 << stage;
+    const int tw_step = N / (2 * half);
+    for (int start = 0; start < N; start += 2 * half) {
+        for (int j = 0; j < half; j++) {
+            const float wr = twiddle_cos[j * tw_step], wi = twiddle_sin[j * tw_step];
+            const int a = start + j, b = a + half;
+            const float tr = re[b] * wr - im[b] * wi;
+            const float ti = re[b] * wi + im[b] * wr;
+            re[b] = re[a] - tr;
+            im[b] = im[a] - ti;
+            re[a] += tr;
+            im[a] += ti;
+        }
+    }
+}
+
+// Separate pitch and roll spectra, one-sided PSD in place (re: pitch, im: roll), estimates
+void MotionAnalyzer::spectrum() {
+    const float scale = 2.0f / (FS_HZ * window_power);   // PSD in deg^2/Hz
+    for (int k = 1; k < N / 2; k++) {
+        const float a = re[k], b = im[k], c = re[N - k], d = im[N - k];
+        const float p2 = ((a + c) * (a + c) + (b - d) * (b - d)) * 0.25f;   // |P[k]|^2
+        const float r2 = ((b + d) * (b + d) + (a - c) * (a - c)) * 0.25f;   // |R[k]|^2
+        re[k] = p2 * scale;
+        im[k] = r2 * scale;
+    }
+
+    const float df = FS_HZ / N;
+    int k_lo = (int)ceilf(F_MIN_HZ / df);
+    int k_hi = (int)floorf(F_MAX_HZ / df);
+    if (k_lo < 1) k_lo = 1;
+    if (k_hi > N / 2 - 2) k_hi = N / 2 - 2;
+    estimateBand(re, k_lo, k_hi, estimate.pitch_period_s, estimate.pitch_rms_deg, estimate.pitch_sig_deg);
+    estimateBand(im, k_lo, k_hi, estimate.roll_period_s, estimate.roll_rms_deg, estimate.roll_sig_deg);
+    estimate.seq++;
+}
+
+// Peak period, RMS and significant amplitude from a PSD between bins k_lo and k_hi
+void MotionAnalyzer::estimateBand(const float* psd, int k_lo, int k_hi, float &period_s, float &rms_deg, float &sig_deg) {
+    const float df = FS_HZ / N;
+    float m0 = 0.0f, peak = -1.0f;
+    int k_peak = k_lo;
+    for (int k = k_lo; k <= k_hi; k++) {
+        m0 += psd[k] * df;
+        if (psd[k] > peak) { peak = psd[k]; k_peak = k; }
+    }
+    rms_deg = sqrtf(m0);
+    sig_deg = 2.0f * rms_deg;
+    if (rms_deg < MIN_RMS_DEG) {
+        period_s = NAN;
+        return;
+    }
+
+    // Parabolic interpolation of the peak between its neighbours
+    float delta = 0.0f;
+    if (k_peak > k_lo && k_peak < k_hi) {
+        const float l = psd[k_peak - 1], c = psd[k_peak], r = psd[k_peak + 1];
+        const float den = l - 2.0f * c + r;
+        if (den < 0.0f) delta = 0.5f * (l - r) / den;
+    }
+    period_s = 1.0f / ((k_peak + delta) * df);
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+
+// === M O T I O N A N A L Y Z E R  C L A S S ===
+//
+// - Class MotionAnalyzer - roll and pitch spectrum of the vessel motion:
+//   dominant period, RMS (square root of the spectral energy) and
+//   significant amplitude for comfort and sea state dashboards
+// - Owned by CMPS14Processor, fed with pitch and roll at every update():
+//   motion.add(t_ms, pitch_deg, roll_deg), samples averaged into a
+//   decimated ring buffer of N values at FS_HZ (2 Hz, 128 s)
+// - Every HOP new values a block is analysed: mean removed, Hann window,
+//   one complex radix-2 FFT with pitch as the real and roll as the
+//   imaginary part, spectra separated by symmetry, one-sided PSD in
+//   F_MIN_HZ...F_MAX_HZ
+// - Bounded CPU: the block is split into steps (prepare, log2(N) butterfly
+//   stages, spectrum), motion.step() runs one of them per update(), so a
+//   block never takes one loop() pass. Step and block runtimes are measured
+// - Estimates: period of the spectral peak (parabolic interpolation), RMS =
+//   sqrt(m0), significant amplitude = 2 * sqrt(m0) (mean of the highest
+//   third of the amplitudes for a narrow band motion), period NAN when the
+//   RMS is below MIN_RMS_DEG
+// - Gaps longer than MAX_GAP_MS restart the collection. Bins are counted
+//   from the previous bin in wrapping 32-bit millis(), not as t_ms / DECIM_MS
+// - No Arduino dependency: the caller passes millis(), step runtimes are
+//   read from a MicrosFn (micros() on target, stubbed in the host test),
+//   nullptr = not measured
+
+class MotionAnalyzer {
+
+public:
+
+    static constexpr int N = 256;                  // FFT size, power of two
+    static constexpr int LOG2N = 8;
+    static constexpr int HOP = 64;                 // New values between blocks (32 s)
+    static constexpr float FS_HZ = 2.0f;           // Decimated sample rate
+    static constexpr uint32_t DECIM_MS = 500;      // 1 / FS_HZ
+    static constexpr float F_MIN_HZ = 0.04f;       // Longest period 25 s
+    static constexpr float F_MAX_HZ = 0.9f;        // Shortest period ~1.1 s
+    static constexpr float MIN_RMS_DEG = 0.25f;    // Below this there is no motion to find a period for
+    static constexpr uint32_t MAX_GAP_MS = 5003;
+    static_assert((1 << LOG2N) == N, "LOG2N");
+
+    // Latest estimates, degrees and seconds, NAN = not available
+    struct Estimate {
+        float roll_period_s = NAN, roll_rms_deg = NAN, roll_sig_deg = NAN;
+        float pitch_period_s = NAN, pitch_rms_deg = NAN, pitch_sig_deg = NAN;
+        uint32_t seq = 0;                           // Incremented with every analysed block
+    };
+
+    using MicrosFn = uint32_t (*)();
+
+    explicit MotionAnalyzer(MicrosFn micros_fn = nullptr);
+
+    void add(uint32_t t_ms, float pitch_deg, float roll_deg);
+    void step();
+
+    const Estimate& getEstimate() const { return estimate; }
+
+    // Debug
+    uint8_t getFillPercent() const { return (uint8_t)(count * 100 / N); }
+    uint32_t getBlocks() const { return blocks; }
+    uint32_t getBlockUs() const { return block_us; }
+    uint32_t getStepMaxUs() const { return step_max_us; }
+
+private:
+
+    static constexpr uint8_t PHASE_IDLE = 0;
+    static constexpr uint8_t PHASE_PREPARE = 1;
+    static constexpr uint8_t PHASE_SPECTRUM = PHASE_PREPARE + LOG2N + 1;
+
+    void push(float pitch_deg, float roll_deg);
+    void prepare();
+    void butterflies(int stage);
+    void spectrum();
+    static void estimateBand(const float* psd, int k_lo, int k_hi, float &period_s, float &rms_deg, float &sig_deg);
+
+    MicrosFn micros_fn;
+
+    // Decimation
+    uint32_t bin_start_ms = 0;        // millis() of the current bin start
+    bool bin_valid = false;
+    float bin_pitch = 0.0f, bin_roll = 0.0f;
+    uint16_t bin_n = 0;
+
+    // Decimated ring of pitch and roll
+    float ring_pitch[N];
+    float ring_roll[N];
+    uint16_t head = 0;                 // Next write position
+    uint16_t count = 0;
+    uint16_t since_block = 0;          // Values added since the last block started
+
+    // FFT work buffers and tables
+    float re[N], im[N];
+    float twiddle_cos[N / 2], twiddle_sin[N / 2];
+    float window[N];
+    float window_power = 0.0f;         // Sum of window^2
+
+    uint8_t phase = PHASE_IDLE;
+    Estimate estimate;
+
+    // Debug
+    uint32_t blocks = 0;
+    uint32_t block_us = 0;             // Sum of the step runtimes of the last block
+    uint32_t block_acc_us = 0;
+    uint32_t step_max_us = 0;
+
+};
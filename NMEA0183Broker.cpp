@@ -0,0 +1,136 @@
+#include "NMEA0183Broker.h"
+
+// === P U B L I C ===
+
+// Constructor
+NMEA0183Broker::NMEA0183Broker():
+    server(TCP_PORT) {}
+
+// Start UDP and TCP output
+bool NMEA0183Broker::begin() {
+    if (started) return true;
+    this->onWifiConnected();
+    if (TCP_ENABLED) {
+        server.begin();
+        server.setNoDelay(true);
+    }
+    started = true;
+    return true;
+}
+
+// Take new TCP clients
+void NMEA0183Broker::handle(const unsigned long now) {
+    if (!started) return;
+    if (TCP_ENABLED) this->acceptClients();
+}
+
+// UDP broadcast address of the current subnet, the address may change with a reconnect
+void NMEA0183Broker::onWifiConnected() {
+    broadcast_ip = WiFi.broadcastIP();
+}
+
+// Heading and attitude sentences as output sinks, sent only with WiFi
+void NMEA0183Broker::registerSinks(OutputPipeline &pipeline) {
+    OutputSink k;
+    k.name = "nmea0183-hdg";
+    k.fn = sinkThunk<NMEA0183Broker, &NMEA0183Broker::publishHeading>;
+    k.ctx = this;
+    k.interval_ms = HEADING_MS;
+    k.policy = SinkPolicy::ALWAYS;
+    k.fields = OUT_HEADING | OUT_HEADING_TRUE;
+    k.needs_wifi = true;
+    pipeline.addSink(k);
+
+    k.name = "nmea0183-att";
+    k.fn = sinkThunk<NMEA0183Broker, &NMEA0183Broker::publishAttitude>;
+    k.interval_ms = ATTITUDE_MS;
+    k.fields = OUT_PITCH | OUT_ROLL | OUT_ROT;
+    pipeline.addSink(k);
+}
+
+// HDG, HDM and HDT
+bool NMEA0183Broker::publishHeading(const OutputSample &s, uint8_t /* changed */) {
+    if (!started) return false;
+    bool sent = false;
+    if (validf(s.compass_deg)) {
+        buildHDG(sentence, s.compass_deg, s.deviation_deg, s.variation_known ? s.variation_deg : NAN);
+        sent |= this->publish();
+    }
+    if (validf(s.heading_deg)) {
+        buildHDM(sentence, s.heading_deg);
+        sent |= this->publish();
+    }
+    if (validf(s.heading_true_deg)) {
+        buildHDT(sentence, s.heading_true_deg);
+        sent |= this->publish();
+    }
+    return sent;
+}
+
+// XDR pitch and roll, ROT
+bool NMEA0183Broker::publishAttitude(const OutputSample &s, uint8_t /* changed */) {
+    if (!started) return false;
+    bool sent = false;
+    if (validf(s.pitch_deg) || validf(s.roll_deg)) {
+        buildXDR(sentence, s.pitch_deg, s.roll_deg);
+        sent |= this->publish();
+    }
+    if (validf(s.rot_rad)) {
+        buildROT(sentence, s.rot_rad * RAD_TO_DEG * 60.0f); // rad/s to deg/min
+        sent |= this->publish();
+    }
+    return sent;
+}
+
+// === P R I V A T E ===
+
+// Take new TCP clients into free slots, release disconnected ones
+void NMEA0183Broker::acceptClients() {
+    for (uint8_t i = 0; i < MAX_CLIENTS; i++) {
+        if (clients[i] && !clients[i].connected()) clients[i].stop();
+    }
+
+    while (server.hasClient()) {
+        WiFiClient client = server.accept();
+        bool taken = false;
+        for (uint8_t i = 0; i < MAX_CLIENTS && !taken; i++) {
+            if (clients[i]) continue;
+            clients[i] = client;
+            clients[i].setNoDelay(true);
+            taken = true;
+        }
+        if (!taken) client.stop(); // All slots in use
+    }
+
+    client_count = 0;
+    for (uint8_t i = 0; i < MAX_CLIENTS; i++) {
+        if (clients[i]) client_count++;
+    }
+}
+
+// Current sentence to UDP and TCP clients
+bool NMEA0183Broker::publish() {
+    if (!sentence.isValid()) return false;
+    const uint8_t* data = (const uint8_t*)sentence.c_str();
+    const size_t len = sentence.length();
+    sentences++;
+
+    if (UDP_ENABLED) {
+        if (!udp.beginPacket(broadcast_ip, UDP_PORT)) udp_errors++;
+        else {
+            udp.write(data, len);
+            if (!udp.endPacket()) udp_errors++;
+        }
+    }
+
+    if (!TCP_ENABLED) return true;
+    for (uint8_t i = 0; i < MAX_CLIENTS; i++) {
+        if (!clients[i]) continue;
+        if (clients[i].availableForWrite() < (int)len) {
+            tcp_dropped++; // Slow client, do not block the loop
+            continue;
+        }
+        clients[i].write(data, len);
+    }
+    return true;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include "OutputPipeline.h"
+#include "nmea0183.h"
+
+// === N M E A 0 1 8 3 B R O K E R  C L A S S ===
+//
+// - Class NMEA0183Broker - "the nmea" responsible for NMEA 0183 output over WiFi
+// - Init: nmea.begin() - once WiFi is connected, nmea.onWifiConnected() after
+//   every reconnect to follow a changed subnet
+// - Loop: nmea.handle(now) - while WiFi is connected, takes new TCP clients
+// - Sentences HDG, HDM, HDT, XDR (pitch, roll) and ROT, talker "HC", as two
+//   output sinks of the pipeline: heading sentences and attitude sentences,
+//   each with its own interval, HDT only when true heading is being sent
+// - Transports, both enabled by default:
+//   - UDP broadcast to the subnet on UDP_PORT, one sentence per datagram
+//   - TCP listener on TCP_PORT for up to MAX_CLIENTS clients (OpenCPN,
+//     instruments), new clients beyond that are refused
+// - Never blocks the loop: a sentence is dropped for a TCP client whose
+//   send buffer is full, disconnected clients are released
+// - Uses: OutputPipeline, NmeaSentence
+// - Owns: WiFiUDP, WiFiServer
+
+class NMEA0183Broker {
+
+public:
+
+    explicit NMEA0183Broker();
+
+    bool begin();
+    void handle(const unsigned long now);
+    void onWifiConnected();
+    void registerSinks(OutputPipeline &pipeline);
+    bool publishHeading(const OutputSample &s, uint8_t changed);
+    bool publishAttitude(const OutputSample &s, uint8_t changed);
+
+    // Debug
+    uint32_t getSentenceCount() const { return sentences; }
+    uint32_t getUdpErrors() const { return udp_errors; }
+    uint32_t getTcpDropped() const { return tcp_dropped; }
+    uint8_t getClientCount() const { return client_count; }
+
+private:
+
+    // Transport configuration
+    static constexpr bool UDP_ENABLED         = true;
+    static constexpr bool TCP_ENABLED         = true;
+    static constexpr uint16_t UDP_PORT        = 10110;
+    static constexpr uint16_t TCP_PORT        = 10110;
+    static constexpr uint8_t MAX_CLIENTS      = 4;
+
+    // Sentence intervals
+    static constexpr unsigned long HEADING_MS  = 101;    // HDG, HDM, HDT
+    static constexpr unsigned long ATTITUDE_MS = 199;    // XDR, ROT
+
+    void acceptClients();
+    bool publish();
+
+    WiFiUDP udp;
+    WiFiServer server;
+    WiFiClient clients[MAX_CLIENTS];
+    NmeaSentence sentence;
+    IPAddress broadcast_ip;
+
+    bool started = false;
+
+    // Debug
+    uint32_t sentences = 0;
+    uint32_t udp_errors = 0;
+    uint32_t tcp_dropped = 0;
+    uint8_t client_count = 0;
+
+};
@@ -0,0 +1,226 @@
+#include "NMEA2000Broker.h"
+
+// === P U B L I C ===
+
+// Constructor
+NMEA2000Broker::NMEA2000Broker(CMPS14Preferences &compass_prefsref) : compass_prefs(compass_prefsref) {}
+
+// Install and start the TWAI driver, build the NAME and claim an address
+bool NMEA2000Broker::begin(int tx_pin, int rx_pin) {
+    if (started) return true;
+
+    twai_general_config_t g_config = TWAI_GENERAL_CONFIG_DEFAULT((gpio_num_t)tx_pin, (gpio_num_t)rx_pin, TWAI_MODE_NORMAL);
+    g_config.tx_queue_len = TX_QUEUE_LEN;
+    g_config.rx_queue_len = RX_QUEUE_LEN;
+    const twai_timing_config_t t_config = TWAI_TIMING_CONFIG_250KBITS();
+    const twai_filter_config_t f_config = TWAI_FILTER_CONFIG_ACCEPT_ALL();
+
+    if (twai_driver_install(&g_config, &t_config, &f_config) != ESP_OK) return false;
+    if (twai_start() != ESP_OK) return false;
+
+    // Unique number from the low 21 bits of the MAC address
+    uint8_t m[6];
+    esp_efuse_mac_get_default(m);
+    N2kName n;
+    n.unique_number = ((uint32_t)m[3] << 16 | (uint32_t)m[4] << 8 | m[5]) & 0x1FFFFF;
+    n.manufacturer_code = MANUFACTURER_CODE;
+    n.device_function = DEVICE_FUNCTION;
+    n.device_class = DEVICE_CLASS;
+    n.industry_group = INDUSTRY_GROUP;
+    name = n2kEncodeName(n);
+
+    // Address claimed at the previous start
+    const uint8_t saved = compass_prefs.loadN2kAddress();
+    address = (saved <= N2K_ADDR_MAX) ? saved : PREFERRED_ADDRESS;
+    first_address = address;
+
+    started = true;
+    bus_state = TWAI_STATE_RUNNING;
+    this->claimAddress(millis());
+    return true;
+}
+
+// Receive, keep the bus up and complete the address claim
+void NMEA2000Broker::handle(const unsigned long now) {
+    if (!started) return;
+    this->processRx(now);
+    this->checkBus(now);
+    if (!claimed && address != N2K_ADDR_NULL && (long)(now - claim_ms) >= CLAIM_HOLD_MS) this->onClaimed();
+}
+
+// Heading/rate of turn and attitude PGNs as output sinks, independent of WiFi
+void NMEA2000Broker::registerSinks(OutputPipeline &pipeline) {
+    OutputSink k;
+    k.name = "n2k-hdg";
+    k.fn = sinkThunk<NMEA2000Broker, &NMEA2000Broker::publishHeading>;
+    k.ctx = this;
+    k.interval_ms = HEADING_MS;
+    k.policy = SinkPolicy::ALWAYS;
+    k.fields = OUT_HEADING | OUT_HEADING_TRUE | OUT_ROT;
+    pipeline.addSink(k);
+
+    k.name = "n2k-att";
+    k.fn = sinkThunk<NMEA2000Broker, &NMEA2000Broker::publishAttitude>;
+    k.interval_ms = ATTITUDE_MS;
+    k.fields = OUT_PITCH | OUT_ROLL;
+    pipeline.addSink(k);
+}
+
+// PGN 127250 magnetic (and true) heading, PGN 127251 rate of turn
+bool NMEA2000Broker::publishHeading(const OutputSample &s, uint8_t /* changed */) {
+    if (!this->ready()) return false;
+    this->updateSid(s);
+    bool sent = false;
+    if (validf(s.compass_deg)) {
+        // Sensor heading with its deviation, receivers add them for the magnetic heading
+        const float var_rad = s.variation_known ? s.variation_deg * DEG_TO_RAD : NAN;
+        n2kVesselHeading(frame, address, sid, s.compass_deg * DEG_TO_RAD, s.deviation_deg * DEG_TO_RAD, var_rad, N2K_REF_MAGNETIC);
+        sent |= this->transmit(frame);
+    }
+    if (validf(s.heading_true_rad)) {
+        n2kVesselHeading(frame, address, sid, s.heading_true_rad, NAN, NAN, N2K_REF_TRUE);
+        sent |= this->transmit(frame);
+    }
+    if (validf(s.rot_rad)) {
+        n2kRateOfTurn(frame, address, sid, s.rot_rad);
+        sent |= this->transmit(frame);
+    }
+    return sent;
+}
+
+// PGN 127257 pitch and roll
+bool NMEA2000Broker::publishAttitude(const OutputSample &s, uint8_t /* changed */) {
+    if (!this->ready()) return false;
+    if (!validf(s.pitch_rad) && !validf(s.roll_rad)) return false;
+    this->updateSid(s);
+    n2kAttitude(frame, address, sid, NAN, s.pitch_rad, s.roll_rad);
+    return this->transmit(frame);
+}
+
+// Bus state as text
+const char* NMEA2000Broker::getBusState() const {
+    if (!started) return "OFF";
+    switch (bus_state) {
+        case TWAI_STATE_RUNNING:    return "RUNNING";
+        case TWAI_STATE_BUS_OFF:    return "BUS OFF";
+        case TWAI_STATE_RECOVERING: return "RECOVERING";
+        case TWAI_STATE_STOPPED:    return "STOPPED";
+    }
+    return "UNKNOWN";
+}
+
+// === P R I V A T E ===
+
+// Handle address claims and ISO requests from the bus
+void NMEA2000Broker::processRx(const unsigned long now) {
+    twai_message_t msg;
+    for (uint8_t i = 0; i < RX_PER_LOOP; i++) {
+        if (twai_receive(&msg, 0) != ESP_OK) return;
+        rx_frames++;
+        if (!msg.extd || msg.rtr) continue;
+
+        N2kFrame f;
+        f.id = msg.identifier;
+        f.len = msg.data_length_code > 8 ? 8 : msg.data_length_code;
+        memcpy(f.data, msg.data, f.len);
+
+        uint64_t other_name;
+        uint32_t requested_pgn;
+        if (n2kParseAddressClaim(f, other_name)) {
+            this->onAddressClaim(n2kSource(f.id), other_name, now);
+        } else if (n2kParseRequest(f, requested_pgn)) {
+            const uint8_t dest = n2kDest(f.id);
+            if (requested_pgn == N2K_PGN_ADDRESS_CLAIM && (dest == address || dest == N2K_ADDR_GLOBAL)) {
+                n2kAddressClaim(frame, address, name);
+                this->transmit(frame);
+            }
+        }
+    }
+}
+
+// Recover from bus-off, restart after recovery and claim the address again
+void NMEA2000Broker::checkBus(const unsigned long now) {
+    if ((long)(now - last_bus_check_ms) < BUS_CHECK_MS) return;
+    last_bus_check_ms = now;
+
+    twai_status_info_t status;
+    if (twai_get_status_info(&status) != ESP_OK) return;
+
+    switch (status.state) {
+        case TWAI_STATE_BUS_OFF:
+            if (twai_initiate_recovery() == ESP_OK) {
+                bus_off_count++;
+                status.state = TWAI_STATE_RECOVERING;
+            }
+            break;
+        case TWAI_STATE_STOPPED:
+            if (bus_state == TWAI_STATE_RECOVERING && twai_start() == ESP_OK) {
+                status.state = TWAI_STATE_RUNNING;
+                this->claimAddress(now);
+            }
+            break;
+        case TWAI_STATE_RUNNING:
+        case TWAI_STATE_RECOVERING:
+            break;
+    }
+    bus_state = status.state;
+}
+
+// Send address claim for the current address, data held until CLAIM_HOLD_MS has passed
+void NMEA2000Broker::claimAddress(const unsigned long now) {
+    claimed = false;
+    claim_ms = now;
+    n2kAddressClaim(frame, address, name);
+    this->transmit(frame);
+}
+
+// Address claim from another device: lower NAME wins the address
+void NMEA2000Broker::onAddressClaim(uint8_t source, uint64_t other_name, const unsigned long now) {
+    if (source != address || address == N2K_ADDR_NULL || other_name == name) return;
+
+    if (name < other_name) {
+        this->claimAddress(now); // Defend
+        this->onClaimed();       // Already held, no need to wait again
+        return;
+    }
+
+    // Lost: try the next address, give up after a full round
+    address_changes++;
+    address = (address >= N2K_ADDR_MAX) ? 0 : address + 1;
+    if (address == first_address) {
+        address = N2K_ADDR_NULL;
+        claimed = false;
+        n2kAddressClaim(frame, N2K_ADDR_NULL, name); // Cannot claim
+        this->transmit(frame);
+        return;
+    }
+    this->claimAddress(now);
+}
+
+// Address held: data may be sent, the address is claimed first at the next start
+void NMEA2000Broker::onClaimed() {
+    claimed = true;
+    compass_prefs.saveN2kAddress(address);
+}
+
+// Same SID for all PGNs of one sensor sample
+void NMEA2000Broker::updateSid(const OutputSample &s) {
+    if (s.sample_ms == sid_sample_ms) return;
+    sid_sample_ms = s.sample_ms;
+    sid = n2kNextSid(sid);
+}
+
+// Queue one frame without waiting, dropped if the transmit queue is full
+bool NMEA2000Broker::transmit(const N2kFrame &f) {
+    twai_message_t msg = {};
+    msg.extd = 1;
+    msg.identifier = f.id;
+    msg.data_length_code = f.len;
+    memcpy(msg.data, f.data, f.len);
+    if (twai_transmit(&msg, 0) != ESP_OK) {
+        tx_dropped++;
+        return false;
+    }
+    tx_frames++;
+    return true;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <Arduino.h>
+#include <driver/twai.h>
+#include <esp_mac.h>
+#include "OutputPipeline.h"
+#include "CMPS14Preferences.h"
+#include "nmea2000.h"
+
+// === N M E A 2 0 0 0 B R O K E R  C L A S S ===
+//
+// - Class NMEA2000Broker - "the n2k" responsible for NMEA 2000 output
+//   through the ESP32 TWAI (CAN) controller, 250 kbit/s
+// - Init: n2k.begin(tx_pin, rx_pin) - independent of WiFi
+// - Loop: n2k.handle(now) - receive, address claim and bus-off recovery
+// - PGNs 127250 Vessel Heading (magnetic, and true when true heading is
+//   being sent), 127251 Rate of Turn and 127257 Attitude as two output sinks
+//   of the pipeline (heading and rate of turn, attitude), one SID per
+//   sensor sample
+// - Address claim (60928) at start, defended against devices with a higher
+//   NAME, next free address taken when losing, answers ISO requests for it,
+//   data sent only 250 ms after the claim. The address held after the claim
+//   is saved by compass_prefs and claimed first at the next start
+// - Bounded transmit queue in the TWAI driver, frames are dropped when it is
+//   full instead of blocking the loop, bus-off is recovered automatically
+// - Uses: OutputPipeline, CMPS14Preferences ("the compass_prefs"), nmea2000 encoder
+
+class NMEA2000Broker {
+
+public:
+
+    explicit NMEA2000Broker(CMPS14Preferences &compass_prefsref);
+
+    bool begin(int tx_pin, int rx_pin);
+    void handle(const unsigned long now);
+    void registerSinks(OutputPipeline &pipeline);
+    bool publishHeading(const OutputSample &s, uint8_t changed);
+    bool publishAttitude(const OutputSample &s, uint8_t changed);
+
+    // Debug
+    uint8_t getAddress() const { return address; }
+    bool isClaimed() const { return claimed; }
+    const char* getBusState() const;
+    uint32_t getTxFrames() const { return tx_frames; }
+    uint32_t getTxDropped() const { return tx_dropped; }
+    uint32_t getRxFrames() const { return rx_frames; }
+    uint32_t getBusOffCount() const { return bus_off_count; }
+    uint32_t getAddressChanges() const { return address_changes; }
+
+private:
+
+    static constexpr uint32_t TX_QUEUE_LEN          = 8;
+    static constexpr uint32_t RX_QUEUE_LEN          = 16;
+    static constexpr uint8_t RX_PER_LOOP            = 8;       // Max frames handled per loop()
+    static constexpr uint8_t PREFERRED_ADDRESS      = 35;
+
+    static constexpr unsigned long CLAIM_HOLD_MS    = 251;     // Wait after address claim before sending data
+    static constexpr unsigned long HEADING_MS       = 101;     // 127250, 127251
+    static constexpr unsigned long ATTITUDE_MS      = 199;     // 127257
+    static constexpr unsigned long BUS_CHECK_MS     = 997;
+
+    // NAME: experimental manufacturer code, navigation class, ownship attitude function, marine industry
+    static constexpr uint16_t MANUFACTURER_CODE     = 2046;
+    static constexpr uint8_t DEVICE_FUNCTION        = 140;
+    static constexpr uint8_t DEVICE_CLASS           = 60;
+    static constexpr uint8_t INDUSTRY_GROUP         = 4;
+
+    void processRx(const unsigned long now);
+    void checkBus(const unsigned long now);
+    void claimAddress(const unsigned long now);
+    void onAddressClaim(uint8_t source, uint64_t other_name, const unsigned long now);
+    void onClaimed();
+    bool ready() const { return started && claimed && bus_state == TWAI_STATE_RUNNING; }
+    void updateSid(const OutputSample &s);
+    bool transmit(const N2kFrame &f);
+
+    CMPS14Preferences &compass_prefs;
+    N2kFrame frame;
+
+    bool started = false;
+    uint64_t name = 0;
+    uint8_t address = PREFERRED_ADDRESS;
+    uint8_t first_address = PREFERRED_ADDRESS;   // Claimed first at start, a full round back to it gives up
+    bool claimed = false;
+    unsigned long claim_ms = 0;
+    twai_state_t bus_state = TWAI_STATE_STOPPED;
+
+    uint8_t sid = 0;
+    unsigned long sid_sample_ms = 0;
+
+    unsigned long last_bus_check_ms = 0;
+
+    // Debug
+    uint32_t tx_frames = 0;
+    uint32_t tx_dropped = 0;
+    uint32_t rx_frames = 0;
+    uint32_t bus_off_count = 0;
+    uint32_t address_changes = 0;
+
+};
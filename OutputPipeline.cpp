@@ -0,0 +1,157 @@
+#include "OutputPipeline.h"
+
+// === P U B L I C ===
+
+// Constructor
+OutputPipeline::OutputPipeline(CMPS14Processor &compassref):
+    compass(compassref) {}
+
+// Register a sink, returns its id or NO_SINK when full
+uint8_t OutputPipeline::addSink(const OutputSink &sink) {
+    if (sink_count >= MAX_SINKS || !sink.fn) return NO_SINK;
+    sinks[sink_count] = sink;
+    sinks[sink_count].deadband_bam = bamFromRad(sink.deadband_rad);
+    return sink_count++;
+}
+
+// Change the rate of a sink (e.g. adaptive ESP-NOW rate)
+void OutputPipeline::setInterval(uint8_t id, unsigned long interval_ms) {
+    if (id >= sink_count) return;
+    sinks[id].interval_ms = interval_ms;
+}
+
+// One fan-out pass: build the sample once and hand it to every due sink
+void OutputPipeline::publish(const unsigned long now, bool wifi_connected) {
+    
+    bool due = false;
+    for (uint8_t i = 0; i < sink_count && !due; i++) {
+        const OutputSink &k = sinks[i];
+        if (k.needs_wifi && !wifi_connected) continue;
+        due = (long)(now - k.last_ms) >= (long)k.interval_ms;
+    }
+    if (!due) return;
+
+    const unsigned long t0 = micros();
+    this->buildSample(now);
+
+    for (uint8_t i = 0; i < sink_count; i++) {
+        OutputSink &k = sinks[i];
+        if (k.needs_wifi && !wifi_connected) continue;
+        if ((long)(now - k.last_ms) < (long)k.interval_ms) continue;
+        k.last_ms = now;
+
+        const bool keepalive = k.keepalive_ms > 0 && (long)(now - k.last_send_ms) >= (long)k.keepalive_ms;
+        const uint8_t changed = this->changedFields(k, keepalive);
+        if (k.policy == SinkPolicy::ON_CHANGE && changed == 0) {
+            k.skipped++;
+            continue;
+        }
+
+        const unsigned long s0 = micros();
+        const bool sent = k.fn(k.ctx, sample, changed);
+        const float us = (float)(micros() - s0);
+        k.avg_us = (k.sends + k.skipped) ? 0.9f * k.avg_us + 0.1f * us : us;
+
+        if (!sent) {
+            k.skipped++;
+            continue;
+        }
+        k.sends++;
+        k.last_send_ms = now;
+        this->markSent(k, changed);
+    }
+
+    const uint32_t pass_us = micros() - t0;
+    pass_avg_us = passes ? 0.9f * pass_avg_us + 0.1f * pass_us : (float)pass_us;
+    if (pass_us > pass_max_us) pass_max_us = pass_us;
+    passes++;
+}
+
+// === P R I V A T E ===
+
+// Snapshot of the compass for this pass
+void OutputPipeline::buildSample(const unsigned long now) {
+    auto delta = compass.getHeadingDelta();
+    auto minmax = compass.getMinMaxDelta();
+    const bool hdg_true = compass.isSendingHeadingTrue();
+
+    sample.now_ms           = now;
+    sample.sample_ms        = compass.getSampleMs();
+    sample.heading_rad      = delta.heading_rad;
+    sample.heading_true_rad = hdg_true ? delta.heading_true_rad : NAN;
+    sample.pitch_rad        = delta.pitch_rad;
+    sample.roll_rad         = delta.roll_rad;
+    sample.rot_rad          = delta.rot_rad;
+    sample.heading_bam      = delta.heading_bam;
+    sample.heading_true_bam = delta.heading_true_bam;
+    sample.compass_deg      = compass.getCompassDeg();
+    sample.heading_deg      = compass.getHeadingDeg();
+    sample.heading_true_deg = hdg_true ? compass.getHeadingTrueDeg() : NAN;
+    sample.deviation_deg    = compass.getDeviation();
+    sample.variation_deg    = compass.getVariation();
+    sample.variation_known  = compass.isVariationKnown();
+    sample.pitch_deg        = compass.getPitchDeg();
+    sample.roll_deg         = compass.getRollDeg();
+    sample.pitch_min_rad    = minmax.pitch_min_rad;
+    sample.pitch_max_rad    = minmax.pitch_max_rad;
+    sample.roll_min_rad     = minmax.roll_min_rad;
+    sample.roll_max_rad     = minmax.roll_max_rad;
+    sample.minmax_win       = compass.getWindowMinMaxDelta();
+    sample.motion           = compass.getMotionAnalyzer().getEstimate();
+    sample.cal              = compass.getCalStatusByte();
+}
+
+// Fields of the sink that are valid and moved past its deadband (all valid ones for ALWAYS or keepalive)
+uint8_t OutputPipeline::changedFields(const OutputSink &k, bool keepalive) const {
+    const bool all = keepalive || k.policy == SinkPolicy::ALWAYS;
+    const float db = k.deadband_rad;
+    uint8_t changed = 0;
+
+    auto angle = [&](uint8_t bit, float v, bam32_t b, float last, bam32_t last_b) {
+        if (!(k.fields & bit) || !validf(v)) return;
+        if (all || !validf(last) || bamAbsDiff(b, last_b) >= k.deadband_bam) changed |= bit;
+    };
+    auto linear = [&](uint8_t bit, float v, float last) {
+        if (!(k.fields & bit) || !validf(v)) return;
+        if (all || !validf(last) || fabsf(v - last) >= db) changed |= bit;
+    };
+
+    angle(OUT_HEADING, sample.heading_rad, sample.heading_bam, k.last_heading, k.last_heading_bam);
+    angle(OUT_HEADING_TRUE, sample.heading_true_rad, sample.heading_true_bam, k.last_heading_true, k.last_heading_true_bam);
+    linear(OUT_PITCH, sample.pitch_rad, k.last_pitch);
+    linear(OUT_ROLL, sample.roll_rad, k.last_roll);
+    linear(OUT_ROT, sample.rot_rad, k.last_rot);
+
+    if (k.fields & OUT_MINMAX) {
+        auto moved = [&](float v, float last) { return validf(v) && v != last; };
+        if (all || moved(sample.pitch_min_rad, k.last_pitch_min) || moved(sample.pitch_max_rad, k.last_pitch_max)
+                || moved(sample.roll_min_rad, k.last_roll_min) || moved(sample.roll_max_rad, k.last_roll_max)) changed |= OUT_MINMAX;
+    }
+    if ((k.fields & OUT_MINMAX_WIN) && (all || sample.minmax_win.seq != k.last_minmax_win_seq)) changed |= OUT_MINMAX_WIN;
+    if ((k.fields & OUT_CAL) && (all || sample.cal != k.last_cal)) changed |= OUT_CAL;
+
+    return changed;
+}
+
+// New deadband reference values for the fields that were sent
+void OutputPipeline::markSent(OutputSink &k, uint8_t changed) {
+    if (changed & OUT_HEADING) {
+        k.last_heading = sample.heading_rad;
+        k.last_heading_bam = sample.heading_bam;
+    }
+    if (changed & OUT_HEADING_TRUE) {
+        k.last_heading_true = sample.heading_true_rad;
+        k.last_heading_true_bam = sample.heading_true_bam;
+    }
+    if (changed & OUT_PITCH)        k.last_pitch = sample.pitch_rad;
+    if (changed & OUT_ROLL)         k.last_roll = sample.roll_rad;
+    if (changed & OUT_ROT)          k.last_rot = sample.rot_rad;
+    if (changed & OUT_MINMAX) {
+        k.last_pitch_min = sample.pitch_min_rad;
+        k.last_pitch_max = sample.pitch_max_rad;
+        k.last_roll_min  = sample.roll_min_rad;
+        k.last_roll_max  = sample.roll_max_rad;
+    }
+    if (changed & OUT_MINMAX_WIN)   k.last_minmax_win_seq = sample.minmax_win.seq;
+    if (changed & OUT_CAL)          k.last_cal = sample.cal;
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <Arduino.h>
+#include "harmonic.h"
+#include "CMPS14Processor.h"
+#include "bam.h"
+
+// === G L O B A L  O U T P U T  S A M P L E ===
+//
+// - OutputSample - one immutable snapshot of the compass per output cycle,
+//   built once and handed to every sink that is due, no sink reads the compass
+// - Angles in radians and degrees, heading true NaN unless true heading is
+//   being sent, NaN = not available
+// - Headings also as binary angles for the integer deadband comparison
+// - OUT_* field bits: what a sink consumes, and in the changed mask passed to
+//   the sink, which fields have moved past its deadband
+
+static constexpr uint8_t OUT_HEADING      = 0x01;
+static constexpr uint8_t OUT_HEADING_TRUE = 0x02;
+static constexpr uint8_t OUT_PITCH        = 0x04;
+static constexpr uint8_t OUT_ROLL         = 0x08;
+static constexpr uint8_t OUT_ROT          = 0x10;
+static constexpr uint8_t OUT_MINMAX       = 0x20;   // Pitch and roll min/max
+static constexpr uint8_t OUT_CAL          = 0x40;   // CMPS14 calibration status byte
+static constexpr uint8_t OUT_MINMAX_WIN   = 0x80;   // Pitch and roll min/max over the sliding windows
+
+struct OutputSample {
+    unsigned long now_ms = 0;
+    unsigned long sample_ms = 0;
+    float heading_rad = NAN, heading_true_rad = NAN, pitch_rad = NAN, roll_rad = NAN;
+    float rot_rad = NAN;                        // rad/s, positive to starboard
+    bam32_t heading_bam = 0, heading_true_bam = 0;
+    float compass_deg = NAN, heading_deg = NAN, heading_true_deg = NAN;
+    float deviation_deg = NAN, variation_deg = NAN;
+    bool variation_known = false;               // Live, or manual set by the user, otherwise only the default
+    float pitch_deg = NAN, roll_deg = NAN;
+    float pitch_min_rad = NAN, pitch_max_rad = NAN, roll_min_rad = NAN, roll_max_rad = NAN;
+    CMPS14Processor::WindowMinMaxDelta minmax_win;
+    MotionAnalyzer::Estimate motion;            // Roll and pitch period, RMS, significant amplitude
+    uint8_t cal = 0;
+};
+
+// === O U T P U T S I N K  S T R U C T ===
+//
+// - OutputSink - a transport registered with the pipeline: callback and
+//   context (type-erased, no heap), rate, deadband policy and fields
+// - Callback returns true when the sample was actually sent, only then the
+//   deadband reference values move
+// - SinkPolicy::ALWAYS: called at its rate, changed mask has every valid field
+// - SinkPolicy::ON_CHANGE: called at its rate only when a field has moved at
+//   least deadband_rad (headings compared as binary angles in integer,
+//   min/max, window min/max and cal: any change), or keepalive_ms
+//   has passed since the last send (0 = no keepalive)
+// - sinkThunk<T, &T::method> adapts a member function to the callback
+
+enum class SinkPolicy : uint8_t { ALWAYS, ON_CHANGE };
+
+using SinkFn = bool (*)(void* ctx, const OutputSample& s, uint8_t changed);
+
+template <typename T, bool (T::*M)(const OutputSample&, uint8_t)>
+bool sinkThunk(void* ctx, const OutputSample& s, uint8_t changed) {
+    return (static_cast<T*>(ctx)->*M)(s, changed);
+}
+
+struct OutputSink {
+    // Declaration
+    const char* name = nullptr;
+    SinkFn fn = nullptr;
+    void* ctx = nullptr;
+    unsigned long interval_ms = 0;
+    SinkPolicy policy = SinkPolicy::ALWAYS;
+    float deadband_rad = 0.0f;
+    uint8_t fields = 0;
+    unsigned long keepalive_ms = 0;
+    bool needs_wifi = false;
+
+    // State
+    unsigned long last_ms = 0;
+    unsigned long last_send_ms = 0;
+    uint32_t deadband_bam = 0;               // deadband_rad as binary angle, set by addSink()
+    float last_heading = NAN, last_heading_true = NAN, last_pitch = NAN, last_roll = NAN, last_rot = NAN;
+    bam32_t last_heading_bam = 0, last_heading_true_bam = 0;
+    float last_pitch_min = NAN, last_pitch_max = NAN, last_roll_min = NAN, last_roll_max = NAN;
+    uint32_t last_minmax_win_seq = 0;
+    uint8_t last_cal = 0;
+
+    // Debug
+    uint32_t sends = 0;
+    uint32_t skipped = 0;    // Due but nothing changed, or not sent
+    float avg_us = 0.0f;     // EMA of the callback runtime
+};
+
+// === O U T P U T P I P E L I N E  C L A S S ===
+//
+// - Class OutputPipeline - "the pipeline" fans one compass sample out to all
+//   registered output sinks (SignalK, ESP-NOW, NMEA 0183, NMEA 2000 ...)
+// - Sinks register once: pipeline.addSink(sink), brokers do it in their
+//   registerSinks(), new transports need no changes in the app loop
+// - Loop: pipeline.publish(now, wifi_connected) - the sample is built only
+//   when at least one sink is due, sinks needing WiFi are skipped without it
+// - Deadband and keepalive per sink are evaluated here, once, instead of in
+//   every broker
+// - Runtime of the whole fan-out pass measured for the web UI
+// - Uses: CMPS14Processor ("the compass")
+
+class OutputPipeline {
+
+public:
+
+    static constexpr uint8_t MAX_SINKS = 12;
+    static constexpr uint8_t NO_SINK = 0xFF;
+
+    explicit OutputPipeline(CMPS14Processor &compassref);
+
+    uint8_t addSink(const OutputSink &sink);
+    void setInterval(uint8_t id, unsigned long interval_ms);
+    void publish(const unsigned long now, bool wifi_connected);
+
+    // Debug
+    uint8_t getSinkCount() const { return sink_count; }
+    const OutputSink& getSink(uint8_t id) const { return sinks[id]; }
+    uint32_t getPassCount() const { return passes; }
+    float getPassUs() const { return pass_avg_us; }
+    uint32_t getPassMaxUs() const { return pass_max_us; }
+
+private:
+
+    void buildSample(const unsigned long now);
+    uint8_t changedFields(const OutputSink &k, bool keepalive) const;
+    void markSent(OutputSink &k, uint8_t changed);
+
+    CMPS14Processor &compass;
+    OutputSink sinks[MAX_SINKS];
+    uint8_t sink_count = 0;
+    OutputSample sample;
+
+    // Debug
+    uint32_t passes = 0;
+    float pass_avg_us = 0.0f;
+    uint32_t pass_max_us = 0;
+
+};
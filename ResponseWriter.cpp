@@ -0,0 +1,76 @@
+#include "ResponseWriter.h"
+
+// === P U B L I C ===
+
+// Constructor
+ResponseWriter::ResponseWriter(WebServer &serverref) : server(serverref) {}
+
+// Start a new response, reset buffer and stats
+void ResponseWriter::begin() {
+  len = 0;
+  appends = 0;
+  chunks = 0;
+  bytes = 0;
+  flushes = 0;
+}
+
+// Append a null terminated string
+void ResponseWriter::print(const char* s) {
+  this->write(s, strlen(s));
+}
+
+// Append n bytes, flushing every time the buffer gets full
+void ResponseWriter::write(const char* data, size_t n) {
+  appends++;
+  while (n > 0) {
+    size_t room = CHUNK_SIZE - len;
+    size_t take = n < room ? n : room;
+    memcpy(buf + len, data, take);
+    len += take;
+    data += take;
+    n -= take;
+    if (len == CHUNK_SIZE) this->flush();
+  }
+}
+
+// Append formatted content, directly into the buffer if it fits, otherwise through a stack buffer
+void ResponseWriter::printf(const char* fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  size_t room = CHUNK_SIZE - len;
+  int n = vsnprintf(buf + len, room, fmt, args);
+  va_end(args);
+  if (n < 0) return;
+  if ((size_t)n < room) {
+    appends++;
+    len += n;
+    if (len == CHUNK_SIZE) this->flush();
+    return;
+  }
+
+  // Did not fit: format again into a temporary buffer and let write() split it over two chunks
+  char tmp[FMT_SIZE];
+  va_start(args, fmt);
+  n = vsnprintf(tmp, sizeof(tmp), fmt, args);
+  va_end(args);
+  if (n < 0) return;
+  this->write(tmp, min((size_t)n, sizeof(tmp) - 1));
+}
+
+// Flush the tail and terminate the chunked response
+void ResponseWriter::end() {
+  this->flush();
+  server.sendContent("");
+}
+
+// === P R I V A T E ===
+
+// Send buffered content as one chunk
+void ResponseWriter::flush() {
+  flushes++;
+  if (len == 0) return;
+  server.sendContent(buf, len);
+  chunks++;
+  bytes += len;
+  len = 0;
+}
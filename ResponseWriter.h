@@ -0,0 +1,55 @@
+#pragma once
+
+#include <Arduino.h>
+#include <WebServer.h>
+
+// === R E S P O N S E W R I T E R  C L A S S ===
+//
+// - Class ResponseWriter - write-coalescing buffer for chunked WebServer responses
+// - Start: call writer.begin() right after server.send(200, type, "")
+//   with CONTENT_LENGTH_UNKNOWN set
+// - Append: writer.print("..."), writer.write(data, len), writer.printf("%d", x)
+// - Finish: writer.end() - flushes the tail and terminates the chunked response
+// - Content is collected into one MTU-sized buffer and only full chunks are
+//   flushed to the WebServer before end(), so that one chunk fills roughly one
+//   TCP segment instead of one tiny chunk per sendContent() call
+// - Counts appends, chunks, bytes and flushes per response
+// - Uses: WebServer
+
+class ResponseWriter {
+
+public:
+
+  explicit ResponseWriter(WebServer &serverref);
+
+  void begin();
+  void print(const char* s);
+  void write(const char* data, size_t n);
+  void printf(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+  void end();
+
+  uint32_t getAppends() const { return appends; }
+  uint32_t getChunks() const { return chunks; }
+  uint32_t getBytes() const { return bytes; }
+  uint32_t getFlushes() const { return flushes; }
+
+private:
+
+  void flush();
+
+  WebServer &server;
+
+  // TCP MSS (1460) minus chunked-encoding framing ("5A0\r\n" + "\r\n") and some headroom
+  static constexpr size_t CHUNK_SIZE = 1436;
+  static constexpr size_t FMT_SIZE = 256;   // Max length of one printf() append
+
+  char buf[CHUNK_SIZE];
+  size_t len = 0;
+
+  // Per response stats
+  uint32_t appends = 0;   // Calls to print(), write() and printf()
+  uint32_t chunks  = 0;   // Chunks sent to the WebServer
+  uint32_t bytes   = 0;   // Content bytes sent
+  uint32_t flushes = 0;   // Calls to flush(), including the final one
+
+};
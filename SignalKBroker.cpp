@@ -8,6 +8,13 @@ using namespace websockets;
 // Constructor
 SignalKBroker::SignalKBroker(CMPS14Processor &compassref)
     : compass(compassref) {
+    for (uint8_t i = 0; i < CMPS14Processor::MINMAX_WINDOWS; i++) {
+        const char* w = CMPS14Processor::MINMAX_WINDOW_NAMES[i];
+        snprintf(window_paths[i][0], sizeof(window_paths[i][0]), "navigation.attitude.pitch.min%s", w);
+        snprintf(window_paths[i][1], sizeof(window_paths[i][1]), "navigation.attitude.pitch.max%s", w);
+        snprintf(window_paths[i][2], sizeof(window_paths[i][2]), "navigation.attitude.roll.min%s", w);
+        snprintf(window_paths[i][3], sizeof(window_paths[i][3]), "navigation.attitude.roll.max%s", w);
+    }
 }
 
 // Begin
@@ -15,9 +22,18 @@ bool SignalKBroker::begin() {
     if (strlen(SK_HOST)<= 0 || SK_PORT <= 0) return false;
     this->setSignalKURL();
     this->setSignalKSource();
+    this->onWifiConnected();
     return this->connectWebsocket();
 }
 
+// Resolve SK_HOST for UDP deltas, the address may change with a reconnect
+void SignalKBroker::onWifiConnected() {
+    if (!SK_UDP_ENABLED) return;
+    udp_resolved = false;
+    last_resolve_ms = 0;
+    this->resolveUdpHost();
+}
+
 // Poll websocket - possibly other stuff if needed
 void SignalKBroker::handleStatus() {
 
@@ -26,6 +42,9 @@ void SignalKBroker::handleStatus() {
         ws.poll();
     }
 
+    // SK_HOST did not resolve when WiFi connected
+    if (SK_UDP_ENABLED && !udp_resolved) this->resolveUdpHost();
+
     // This was a safety net to kill a ghost websocket
     // but the library should take care of it by
     // WebSocketsEvent::connectionClosed -event.
@@ -56,31 +75,44 @@ void SignalKBroker::closeWebsocket() {
     ws_open = false;
 }
 
-// Send heading, pitch and roll to SignalK server
-void SignalKBroker::sendHdgPitchRollDelta() {
-  
-    if (!ws_open) return; 
-    
-    auto delta = compass.getHeadingDelta();
-    if (!validf(delta.heading_rad) || !validf(delta.pitch_rad) || !validf(delta.roll_rad)) return; 
-
-    static float last_h = NAN, last_p = NAN, last_r = NAN;
-    bool changed_h = false, changed_p = false, changed_r = false;
-
-    if (!validf(last_h) || fabsf(computeAngDiffRad(delta.heading_rad, last_h)) >= DB_HDG_RAD) {
-        changed_h = true;
-        last_h = delta.heading_rad;
-    }
-    if (!validf(last_p) || fabsf(delta.pitch_rad - last_p) >= DB_ATT_RAD) {
-        changed_p = true;
-        last_p = delta.pitch_rad;
-    }
-    if (!validf(last_r) || fabsf(delta.roll_rad - last_r) >= DB_ATT_RAD) {
-        changed_r = true;
-        last_r = delta.roll_rad;
-    }
+// Heading/attitude and min/max deltas as output sinks
+void SignalKBroker::registerSinks(OutputPipeline &pipeline) {
+    OutputSink k;
+    k.name = "signalk";
+    k.fn = sinkThunk<SignalKBroker, &SignalKBroker::sendHdgPitchRollDelta>;
+    k.ctx = this;
+    k.interval_ms = TX_INTERVAL_MS;
+    k.policy = SinkPolicy::ON_CHANGE;
+    k.deadband_rad = DB_RAD;
+    k.fields = OUT_HEADING | OUT_HEADING_TRUE | OUT_PITCH | OUT_ROLL;
+    k.needs_wifi = true;
+    pipeline.addSink(k);
+
+    k.name = "signalk-minmax";
+    k.fn = sinkThunk<SignalKBroker, &SignalKBroker::sendPitchRollMinMaxDelta>;
+    k.interval_ms = MINMAX_TX_INTERVAL_MS;
+    k.deadband_rad = 0.0f;
+    k.fields = OUT_MINMAX;
+    pipeline.addSink(k);
+
+    k.name = "signalk-window";
+    k.fn = sinkThunk<SignalKBroker, &SignalKBroker::sendPitchRollWindowDelta>;
+    k.fields = OUT_MINMAX_WIN;
+    pipeline.addSink(k);
+
+    // Motion estimates change once per spectrum block, the callback checks for a new one
+    k.name = "signalk-motion";
+    k.fn = sinkThunk<SignalKBroker, &SignalKBroker::sendMotionDelta>;
+    k.interval_ms = MOTION_TX_INTERVAL_MS;
+    k.policy = SinkPolicy::ALWAYS;
+    k.fields = 0;
+    pipeline.addSink(k);
+}
 
-    if (!(changed_h || changed_p || changed_r)) return;  
+// Send changed heading, pitch and roll to SignalK server
+bool SignalKBroker::sendHdgPitchRollDelta(const OutputSample &s, uint8_t changed) {
+  
+    if (!ws_open && !SK_UDP_ENABLED) return false; 
 
     hdg_pitch_roll_doc.clear();
     hdg_pitch_roll_doc["context"] = "vessels.self";
@@ -95,37 +127,24 @@ void SignalKBroker::sendHdgPitchRollDelta() {
         o["value"] = v;
     };
 
-    if (changed_h) add("navigation.headingMagnetic", last_h); 
-    if (changed_p) add("navigation.attitude.pitch",  last_p);
-    if (changed_r) add("navigation.attitude.roll",   last_r);
-    if (changed_h && compass.isSendingHeadingTrue()) add("navigation.headingTrue", delta.heading_true_rad);
+    if (changed & OUT_HEADING)      add("navigation.headingMagnetic", s.heading_rad); 
+    if (changed & OUT_PITCH)        add("navigation.attitude.pitch",  s.pitch_rad);
+    if (changed & OUT_ROLL)         add("navigation.attitude.roll",   s.roll_rad);
+    if (changed & OUT_HEADING_TRUE) add("navigation.headingTrue",     s.heading_true_rad);
 
-    if (values.size() == 0) return;
+    if (values.size() == 0) return false;
+    this->addDeltaSeq(values);
 
     char buf[640];
     size_t n = serializeJson(hdg_pitch_roll_doc, buf, sizeof(buf));
-    bool ok = ws.send(buf, n);
-    if (!ok) {
-        ws.close();
-        ws_open = false;
-    }
+    return this->transmitDelta(buf, n);
 }
 
 // Send pitch and roll min/max values to SignalK
-void SignalKBroker::sendPitchRollMinMaxDelta() {
+bool SignalKBroker::sendPitchRollMinMaxDelta(const OutputSample &s, uint8_t changed) {
   
-    if (!ws_open) return; 
-
-    auto delta = compass.getMinMaxDelta();
-
-    static float last_sent_pitch_min = NAN, last_sent_pitch_max = NAN, last_sent_roll_min = NAN, last_sent_roll_max = NAN;
-
-    bool ch_pmin = (validf(delta.pitch_min_rad) && delta.pitch_min_rad != last_sent_pitch_min);
-    bool ch_pmax = (validf(delta.pitch_max_rad) && delta.pitch_max_rad != last_sent_pitch_max);
-    bool ch_rmin = (validf(delta.roll_min_rad)  && delta.roll_min_rad  != last_sent_roll_min);
-    bool ch_rmax = (validf(delta.roll_max_rad)  && delta.roll_max_rad  != last_sent_roll_max);
-
-    if (!(ch_pmin || ch_pmax || ch_rmin || ch_rmax)) return;
+    if (!ws_open && !SK_UDP_ENABLED) return false; 
+    if (!(changed & OUT_MINMAX)) return false;
 
     minmax_doc.clear();
     minmax_doc["context"] = "vessels.self";
@@ -135,30 +154,95 @@ void SignalKBroker::sendPitchRollMinMaxDelta() {
     auto values  = up.createNestedArray("values");
 
     auto add = [&](const char* path, float v) {
+        if (!validf(v)) return;
         auto o = values.createNestedObject();
         o["path"]  = path;
         o["value"] = v; 
     };
 
-    if (ch_pmin) add("navigation.attitude.pitch.min", delta.pitch_min_rad); 
-    if (ch_pmax) add("navigation.attitude.pitch.max", delta.pitch_max_rad);
-    if (ch_rmin) add("navigation.attitude.roll.min",  delta.roll_min_rad);
-    if (ch_rmax) add("navigation.attitude.roll.max",  delta.roll_max_rad);
+    add("navigation.attitude.pitch.min", s.pitch_min_rad); 
+    add("navigation.attitude.pitch.max", s.pitch_max_rad);
+    add("navigation.attitude.roll.min",  s.roll_min_rad);
+    add("navigation.attitude.roll.max",  s.roll_max_rad);
 
-    if (values.size() == 0) return;
+    if (values.size() == 0) return false;
+    this->addDeltaSeq(values);
 
     char buf[640];
     size_t n = serializeJson(minmax_doc, buf, sizeof(buf));
-    bool ok = ws.send(buf, n);
-    if (!ok){
-        ws.close();
-        ws_open = false;
+    return this->transmitDelta(buf, n); // Retried on the next round if failed
+}
+
+// Send pitch and roll min/max of the sliding windows to SignalK
+bool SignalKBroker::sendPitchRollWindowDelta(const OutputSample &s, uint8_t changed) {
+
+    if (!ws_open && !SK_UDP_ENABLED) return false; 
+    if (!(changed & OUT_MINMAX_WIN)) return false;
+
+    window_doc.clear();
+    window_doc["context"] = "vessels.self";
+    auto updates = window_doc.createNestedArray("updates");
+    auto up      = updates.createNestedObject();
+    up["$source"] = SK_SOURCE;
+    auto values  = up.createNestedArray("values");
+
+    auto add = [&](const char* path, float v) {
+        if (!validf(v)) return;
+        auto o = values.createNestedObject();
+        o["path"]  = path;
+        o["value"] = v; 
+    };
+
+    const auto &w = s.minmax_win;
+    for (uint8_t i = 0; i < CMPS14Processor::MINMAX_WINDOWS; i++) {
+        add(window_paths[i][0], w.pitch_min_rad[i]);
+        add(window_paths[i][1], w.pitch_max_rad[i]);
+        add(window_paths[i][2], w.roll_min_rad[i]);
+        add(window_paths[i][3], w.roll_max_rad[i]);
     }
 
-    if (ch_pmin) last_sent_pitch_min = delta.pitch_min_rad;
-    if (ch_pmax) last_sent_pitch_max = delta.pitch_max_rad;
-    if (ch_rmin) last_sent_roll_min  = delta.roll_min_rad;
-    if (ch_rmax) last_sent_roll_max  = delta.roll_max_rad;
+    if (values.size() == 0) return false;
+    this->addDeltaSeq(values);
+
+    char buf[1024];
+    size_t n = serializeJson(window_doc, buf, sizeof(buf));
+    return this->transmitDelta(buf, n); // Retried on the next round if failed
+}
+
+// Send roll and pitch period, RMS and significant amplitude of a new spectrum block to SignalK
+bool SignalKBroker::sendMotionDelta(const OutputSample &s, uint8_t /* changed */) {
+
+    if (!ws_open && !SK_UDP_ENABLED) return false; 
+    const auto &m = s.motion;
+    if (m.seq == 0 || m.seq == motion_sent_seq) return false;
+
+    motion_doc.clear();
+    motion_doc["context"] = "vessels.self";
+    auto updates = motion_doc.createNestedArray("updates");
+    auto up      = updates.createNestedObject();
+    up["$source"] = SK_SOURCE;
+    auto values  = up.createNestedArray("values");
+
+    auto add = [&](const char* path, float v) {
+        auto o = values.createNestedObject();
+        o["path"]  = path;
+        if (validf(v)) o["value"] = v;
+        else o["value"] = nullptr;   // No period in calm conditions
+    };
+
+    add("navigation.attitude.roll.period",       m.roll_period_s);
+    add("navigation.attitude.roll.rms",          m.roll_rms_deg * DEG_TO_RAD);
+    add("navigation.attitude.roll.significant",  m.roll_sig_deg * DEG_TO_RAD);
+    add("navigation.attitude.pitch.period",      m.pitch_period_s);
+    add("navigation.attitude.pitch.rms",         m.pitch_rms_deg * DEG_TO_RAD);
+    add("navigation.attitude.pitch.significant", m.pitch_sig_deg * DEG_TO_RAD);
+    this->addDeltaSeq(values);
+
+    char buf[640];
+    size_t n = serializeJson(motion_doc, buf, sizeof(buf));
+    if (!this->transmitDelta(buf, n)) return false;   // Retried on the next round
+    motion_sent_seq = m.seq;
+    return true;
 }
 
 // === P R I V A T E ===
@@ -178,9 +262,64 @@ void SignalKBroker::setSignalKSource() {
   snprintf(SK_SOURCE, sizeof(SK_SOURCE), "esp32.cmps14-%02x%02x%02x", m[3], m[4], m[5]);
 }
 
+// Delta to the server: UDP datagram in UDP mode, otherwise websocket
+bool SignalKBroker::transmitDelta(const char* buf, size_t n) {
+    delta_seq++;   // Also for failed sends, they show as loss on the receiver
+    if (SK_UDP_ENABLED) return this->sendUdp(buf, n);
+
+    const unsigned long t0 = micros();
+    bool ok = ws.send(buf, n);
+    ws_send_us = ws_sends ? 0.9f * ws_send_us + 0.1f * (micros() - t0) : (float)(micros() - t0);
+    ws_sends++;
+    if (!ok) {
+        ws.close();
+        ws_open = false;
+    }
+    return ok;
+}
+
+// One delta as one datagram, fire and forget, dropped until SK_HOST is resolved
+bool SignalKBroker::sendUdp(const char* buf, size_t n) {
+    if (!udp_resolved) {
+        udp_errors++;
+        return false;
+    }
+
+    const unsigned long t0 = micros();
+    bool ok = udp.beginPacket(udp_ip, SK_UDP_PORT);
+    if (ok) {
+        udp.write((const uint8_t*)buf, n);
+        ok = udp.endPacket();
+    }
+    udp_send_us = udp_sends ? 0.9f * udp_send_us + 0.1f * (micros() - t0) : (float)(micros() - t0);
+    udp_sends++;
+    if (!ok) udp_errors++;
+    return ok;
+}
+
+// SK_HOST to an IP address, without DNS if it is an address, DNS retried at most every UDP_RESOLVE_MS
+bool SignalKBroker::resolveUdpHost() {
+    if (udp_ip.fromString(SK_HOST)) {
+        udp_resolved = true;
+        return true;
+    }
+    const unsigned long now = millis();
+    if (last_resolve_ms != 0 && (long)(now - last_resolve_ms) < UDP_RESOLVE_MS) return false;
+    last_resolve_ms = now;
+    udp_resolved = WiFi.hostByName(SK_HOST, udp_ip);   // Blocking, only from WiFi connect and handleStatus()
+    return udp_resolved;
+}
+
+// Sequence number of the delta about to be transmitted, counted per transmitted delta
+void SignalKBroker::addDeltaSeq(JsonArray values) {
+    if (!SK_DELTA_SEQ) return;
+    auto o = values.createNestedObject();
+    o["path"]  = "sensors.cmps14.deltaSeq";
+    o["value"] = delta_seq + 1;
+}
+
 // Callback for onMessage, handle incoming SignalK delta 
 void SignalKBroker::onMessageCallback(WebsocketsMessage msg) {
-    if (!compass.isSendingHeadingTrue()) return;
     if (!msg.isText()) return;
     incoming_doc.clear();
     if (deserializeJson(incoming_doc, msg.data())) return;
@@ -191,12 +330,22 @@ void SignalKBroker::onMessageCallback(WebsocketsMessage msg) {
             if (!v.containsKey("path")) continue;
             const char* path = v["path"];
             if (!path) continue;
-            if (strcmp(path, "navigation.magneticVariation") == 0) {
+            if (strcmp(path, "navigation.courseOverGroundTrue") == 0) {
+                if (v["value"].is<float>() || v["value"].is<double>()) {
+                    cog_rad = v["value"].as<float>();
+                    course_updates++;
+                }
+            } else if (strcmp(path, "navigation.speedOverGround") == 0) {
+                if (v["value"].is<float>() || v["value"].is<double>()) sog_ms = v["value"].as<float>();
+            } else if (strcmp(path, "navigation.magneticVariation") == 0) {
                 if (v["value"].is<float>() || v["value"].is<double>()) {  
                     float mv = v["value"].as<float>();
+                    mv_deg = validf(mv) ? mv * RAD_TO_DEG : NAN;
+                    mv_updates++;
+                    if (!compass.isSendingHeadingTrue()) continue;
                     if (validf(mv)) { 
                         compass.setUseManualVariation(false);
-                        compass.setLiveVariation(mv * RAD_TO_DEG);
+                        compass.setLiveVariation(mv_deg);
                     } else compass.setUseManualVariation(true);
                 }
             }
@@ -209,7 +358,7 @@ void SignalKBroker::onEventCallback(WebsocketsEvent event) {
     switch (event) {
         case WebsocketsEvent::ConnectionOpened: {
             ws_open = true;
-            this->handleVariationDelta();
+            this->subscribe();
             break;
         }   
         case WebsocketsEvent::ConnectionClosed:
@@ -224,19 +373,23 @@ void SignalKBroker::onEventCallback(WebsocketsEvent event) {
     }
 }
 
-// When in heading true mode, subscribe the navigation.magneticVariation from SignalK at ~1 Hz cycles
-void SignalKBroker::handleVariationDelta(){  
-    if (!compass.isSendingHeadingTrue()) return;
+// Subscribe COG, SOG and navigation.magneticVariation from SignalK at ~1 Hz cycles
+void SignalKBroker::subscribe(){  
     subscribe_doc.clear();
     subscribe_doc["context"] = "vessels.self";
-    auto subscribe = subscribe_doc.createNestedArray("subscribe");
-    auto s = subscribe.createNestedObject();
-    s["path"] = "navigation.magneticVariation";
-    s["format"] = "delta";
-    s["policy"] = "ideal";
-    s["period"] = 1000;
-
-    char buf[256];
+    auto paths = subscribe_doc.createNestedArray("subscribe");
+    auto add = [&](const char* path) {
+        auto s = paths.createNestedObject();
+        s["path"] = path;
+        s["format"] = "delta";
+        s["policy"] = "ideal";
+        s["period"] = 1000;
+    };
+    add("navigation.courseOverGroundTrue");
+    add("navigation.speedOverGround");
+    add("navigation.magneticVariation");
+
+    char buf[512];
     size_t n = serializeJson(subscribe_doc, buf, sizeof(buf));
     ws.send(buf, n);
 }
@@ -3,8 +3,11 @@
 #include <Arduino.h>
 #include <ArduinoWebsockets.h>
 #include <ArduinoJson.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
 #include <esp_mac.h>
 #include "CMPS14Processor.h"
+#include "OutputPipeline.h"
 
 // === S I G N A L K B R O K E R  C L A S S ===
 //
@@ -13,11 +16,28 @@
 // - Init: signalk.begin()
 // - Provides public API to
 //   - Connect and disconnect the websocket
-//   - Send SignalK deltas as JSON to the server
+//   - Send SignalK deltas as JSON to the server, as output sinks of the
+//     pipeline: heading/attitude at ~10 Hz with a 0.25° deadband, pitch and
+//     roll min/max at ~1 Hz when changed, all-time (.min, .max) and over
+//     the sliding windows of the compass (e.g. .min1m, .max1h), roll and
+//     pitch period, RMS and significant amplitude every ~5 s when a new
+//     spectrum block is ready
 //   - Get the source name that is visible to the server
 //   - Check the websocket connection status
-// - Uses: CMPS14Processor ("the compass")
-// - Owns: WebsocketsClient
+// - Subscribes course and speed over ground and magnetic variation
+//   (deviation learning), the variation is applied to the compass only in
+//   heading true mode
+// - UDP delta mode (SK_UDP_ENABLED): deltas are sent as JSON datagrams to
+//   SK_HOST:SK_UDP_PORT (a SignalK "UDP" data connection on the server),
+//   no TCP head-of-line blocking, also while the websocket is down; the
+//   websocket is still used for subscriptions (magnetic variation)
+// - SK_HOST is resolved once when WiFi connects (begin(), onWifiConnected()),
+//   retried from handleStatus(), never from the output sinks
+// - SK_DELTA_SEQ adds a delta sequence number (sensors.cmps14.deltaSeq) for
+//   measuring loss and jitter with tools/sk_udp_listen.py
+// - Send counters and average send time per transport for the web UI
+// - Uses: CMPS14Processor ("the compass"), OutputPipeline
+// - Owns: WebsocketsClient, WiFiUDP
 
 namespace websockets {
     class WebsocketsClient;
@@ -30,13 +50,30 @@ public:
     explicit SignalKBroker(CMPS14Processor &compassref);
 
     bool begin();
+    void onWifiConnected();
     void handleStatus();
     bool connectWebsocket();
     void closeWebsocket();
-    void sendHdgPitchRollDelta();
-    void sendPitchRollMinMaxDelta();
+    void registerSinks(OutputPipeline &pipeline);
+    bool sendHdgPitchRollDelta(const OutputSample &s, uint8_t changed);
+    bool sendPitchRollMinMaxDelta(const OutputSample &s, uint8_t changed);
+    bool sendPitchRollWindowDelta(const OutputSample &s, uint8_t changed);
+    bool sendMotionDelta(const OutputSample &s, uint8_t changed);
     const char* getSignalKSource() { return SK_SOURCE; }
     bool isOpen() const { return ws_open; }
+    bool isUdpMode() const { return SK_UDP_ENABLED; }
+    float getCogRad() const { return cog_rad; }
+    float getSogMs() const { return sog_ms; }
+    uint32_t getCourseUpdates() const { return course_updates; }
+    float getVariationDeg() const { return mv_deg; }
+    uint32_t getVariationUpdates() const { return mv_updates; }
+
+    // Debug
+    uint32_t getWsSends() const { return ws_sends; }
+    float getWsSendUs() const { return ws_send_us; }
+    uint32_t getUdpSends() const { return udp_sends; }
+    uint32_t getUdpErrors() const { return udp_errors; }
+    float getUdpSendUs() const { return udp_send_us; }
 
 private:
 
@@ -44,23 +81,58 @@ private:
     void setSignalKSource();
     void onMessageCallback(websockets::WebsocketsMessage msg);
     void onEventCallback(websockets::WebsocketsEvent event);
-    void handleVariationDelta();
+    void subscribe();
+    bool transmitDelta(const char* buf, size_t n);
+    bool sendUdp(const char* buf, size_t n);
+    bool resolveUdpHost();
+    void addDeltaSeq(JsonArray values);
 
 private:
     
     CMPS14Processor &compass;
     websockets::WebsocketsClient ws;
+    WiFiUDP udp;
+    IPAddress udp_ip;
+    bool udp_resolved = false;
+    unsigned long last_resolve_ms = 0;
+    uint32_t delta_seq = 0;               // Deltas transmitted, SK_DELTA_SEQ
 
     // Reusable JSON documents
     StaticJsonDocument<512> hdg_pitch_roll_doc; 
     StaticJsonDocument<512> minmax_doc;
+    StaticJsonDocument<1024> window_doc;
+    StaticJsonDocument<768> motion_doc;
     StaticJsonDocument<1024> incoming_doc;
-    StaticJsonDocument<256> subscribe_doc;
+    StaticJsonDocument<512> subscribe_doc;
 
     bool ws_open = false;
+    uint32_t motion_sent_seq = 0;         // Spectrum block last sent
+
+    // Course and speed over ground from GNSS via SignalK
+    float cog_rad = NAN;
+    float sog_ms = NAN;
+    uint32_t course_updates = 0;
+    float mv_deg = NAN;                   // Magnetic variation, whatever the heading mode
+    uint32_t mv_updates = 0;
 
     char SK_URL[512];     // URL of SignalK server
     char SK_SOURCE[32];   // ESP32 source name for SignalK, used also as the OTA hostname
-    static constexpr float DB_HDG_RAD = 0.00436f;    // 0.25°: deadband threshold for heading
-    static constexpr float DB_ATT_RAD = 0.00436f;    // 0.25°: pitch/roll deadband threshold
+    char window_paths[CMPS14Processor::MINMAX_WINDOWS][4][40];  // pitch min/max, roll min/max per window
+    static constexpr float DB_RAD = 0.00436f;                   // 0.25°: heading and pitch/roll deadband threshold
+    static constexpr unsigned long TX_INTERVAL_MS = 101;        // Max frequency for sending deltas
+    static constexpr unsigned long MINMAX_TX_INTERVAL_MS = 997; // Frequency for pitch/roll maximum values sending
+    static constexpr unsigned long MOTION_TX_INTERVAL_MS = 4999; // Check for a new roll/pitch spectrum block
+
+    // UDP delta transport, the server needs a matching SignalK UDP data connection
+    static constexpr bool SK_UDP_ENABLED = false;
+    static constexpr uint16_t SK_UDP_PORT = 4123;
+    static constexpr unsigned long UDP_RESOLVE_MS = 9973;  // Retry interval for resolving SK_HOST
+    static constexpr bool SK_DELTA_SEQ = false;            // Sequence number in every delta, for measurements
+
+    // Debug
+    uint32_t ws_sends = 0;
+    float ws_send_us = 0.0f;     // EMA of send duration
+    uint32_t udp_sends = 0;
+    uint32_t udp_errors = 0;
+    float udp_send_us = 0.0f;    // EMA of send duration
 };
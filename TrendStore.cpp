@@ -0,0 +1,205 @@
+#include "TrendStore.h"
+
+// === P U B L I C ===
+
+// Constructor, lay out the rings of the tiers in the bucket array
+TrendStore::TrendStore() {
+    size_t offset = 0;
+    for (uint8_t i = 0; i < TIERS; i++) {
+        tiers[i].ring = &buckets[offset];
+        tiers[i].len = TIER_LEN[i];
+        tiers[i].bucket_ms = (unsigned long)TIER_BUCKET_S[i] * 1000UL;
+        offset += TIER_LEN[i];
+    }
+}
+
+// Register the sample sink with the pipeline
+void TrendStore::registerSinks(OutputPipeline &pipeline) {
+    OutputSink k;
+    k.name = "trends";
+    k.fn = sinkThunk<TrendStore, &TrendStore::record>;
+    k.ctx = this;
+    k.interval_ms = RECORD_MS;
+    k.policy = SinkPolicy::ALWAYS;
+    k.fields = OUT_HEADING | OUT_PITCH | OUT_ROLL | OUT_ROT | OUT_CAL;
+    k.needs_wifi = false;
+    pipeline.addSink(k);
+}
+
+// Add one sample to the open bucket of every tier
+bool TrendStore::record(const OutputSample &s, uint8_t /* changed */) {
+    if (samples > 0 && s.sample_ms == last_sample_ms) return false; // No new sensor reading
+    const unsigned long start_us = micros();
+
+    const bool hdg_ok = validf(s.heading_deg);
+    if (hdg_ok) {
+        if (!hdg_prev_valid) hdg_unwrapped = s.heading_bam;
+        else hdg_unwrapped += bamDiff(s.heading_bam, hdg_prev_bam);
+        hdg_prev_bam = s.heading_bam;
+        hdg_prev_valid = true;
+    }
+    const float rot_dpm = validf(s.rot_rad) ? s.rot_rad * RAD_TO_DEG * 60.0f : NAN;
+
+    for (uint8_t i = 0; i < TIERS; i++) {
+        this->add(tiers[i], s.sample_ms, hdg_ok, s.pitch_deg, s.roll_deg, rot_dpm, s.cal);
+    }
+
+    samples++;
+    last_sample_ms = s.sample_ms;
+    const float us = (float)(micros() - start_us);
+    update_avg_us = (samples == 1) ? us : 0.9f * update_avg_us + 0.1f * us;
+    return true;
+}
+
+// Write the header and the buckets of a tier closed after sequence number since, oldest first
+size_t TrendStore::stream(ResponseWriter &out, uint8_t tier, uint32_t since) const {
+    if (tier >= TIERS) tier = 0;
+    const Tier &t = tiers[tier];
+
+    const uint16_t count = this->getCount(tier);
+    uint32_t first = t.seq - count;
+    if (since >= first && since <= t.seq) first = since;    // Otherwise the whole ring
+    const uint16_t n = (uint16_t)(t.seq - first);
+
+    struct __attribute__((packed)) {
+        uint8_t version;
+        uint8_t tier;
+        uint16_t bucket_s;
+        uint32_t seq;          // Sequence number after the last bucket, "since" for the next request
+        uint32_t age_ms;       // Time from the end of the last bucket to now
+        uint16_t n;
+        uint16_t bucket_size;
+    } hdr = {
+        1, tier, TIER_BUCKET_S[tier], t.seq,
+        t.seq > 0 ? (uint32_t)(millis() - t.index * t.bucket_ms) : 0,
+        n, (uint16_t)sizeof(Bucket)
+    };
+    static_assert(sizeof(hdr) == 16, "Trend header size");
+    out.write((const char*)&hdr, sizeof(hdr));
+
+    // The ring wraps at most once
+    const uint16_t start = first % t.len;
+    const uint16_t n1 = min<uint16_t>(n, t.len - start);
+    out.write((const char*)&t.ring[start], n1 * sizeof(Bucket));
+    if (n > n1) out.write((const char*)&t.ring[0], (n - n1) * sizeof(Bucket));
+    return sizeof(hdr) + n * sizeof(Bucket);
+}
+
+// Buckets held by a tier
+uint16_t TrendStore::getCount(uint8_t tier) const {
+    if (tier >= TIERS) return 0;
+    return tiers[tier].seq < tiers[tier].len ? (uint16_t)tiers[tier].seq : tiers[tier].len;
+}
+
+// === P R I V A T E ===
+
+// Add one sample to a tier, close its open bucket first if the sample belongs to a later one
+void TrendStore::add(Tier &t, unsigned long t_ms, bool hdg_ok, float pitch_deg, float roll_deg, float rot_dpm, uint8_t cal) {
+    const uint32_t index = t_ms / t.bucket_ms;
+    if (t.n > 0 && index != t.index) {
+        const uint32_t gap = (index > t.index) ? index - t.index - 1 : 0;
+        this->close(t);
+
+        // Empty buckets for the time without samples, at most one full ring
+        Bucket e;
+        e.hdg_mean = e.hdg_min = e.hdg_max = NA_HDG;
+        e.pitch_mean = e.pitch_min = e.pitch_max = NA;
+        e.roll_mean = e.roll_min = e.roll_max = NA;
+        e.rot_mean = e.rot_min = e.rot_max = NA;
+        e.cal_min = 0xFF;
+        e.cal_max = 0;
+        for (uint32_t i = 0; i < gap && i < t.len; i++) this->push(t, e);
+    }
+
+    if (t.n == 0) {
+        t.index = index;
+        t.hdg_ref = hdg_unwrapped;
+        t.hdg_n = 0;
+        t.pitch.reset();
+        t.roll.reset();
+        t.rot.reset();
+        t.cal_lo = 0xFF;
+        t.cal_hi = 0;
+    }
+    t.n++;
+
+    if (hdg_ok) {
+        const int64_t d = hdg_unwrapped - t.hdg_ref;
+        if (t.hdg_n == 0) { t.hdg_sum = d; t.hdg_lo = d; t.hdg_hi = d; }
+        else {
+            t.hdg_sum += d;
+            if (d < t.hdg_lo) t.hdg_lo = d;
+            if (d > t.hdg_hi) t.hdg_hi = d;
+        }
+        t.hdg_n++;
+    }
+    t.pitch.add(pitch_deg);
+    t.roll.add(roll_deg);
+    t.rot.add(rot_dpm);
+    t.cal_lo = calMin(t.cal_lo, cal);
+    t.cal_hi = calMax(t.cal_hi, cal);
+}
+
+// Quantize the open bucket of a tier into its ring
+void TrendStore::close(Tier &t) {
+    Bucket b;
+    if (t.hdg_n > 0) {
+        b.hdg_mean = hdgCenti(t.hdg_ref + t.hdg_sum / t.hdg_n);
+        b.hdg_min  = hdgCenti(t.hdg_ref + t.hdg_lo);
+        b.hdg_max  = hdgCenti(t.hdg_ref + t.hdg_hi);
+    } else b.hdg_mean = b.hdg_min = b.hdg_max = NA_HDG;
+
+    b.pitch_mean = quantize(t.pitch, t.pitch.sum / max<uint16_t>(t.pitch.n, 1), 100.0f);
+    b.pitch_min  = quantize(t.pitch, t.pitch.lo, 100.0f);
+    b.pitch_max  = quantize(t.pitch, t.pitch.hi, 100.0f);
+    b.roll_mean  = quantize(t.roll, t.roll.sum / max<uint16_t>(t.roll.n, 1), 100.0f);
+    b.roll_min   = quantize(t.roll, t.roll.lo, 100.0f);
+    b.roll_max   = quantize(t.roll, t.roll.hi, 100.0f);
+    b.rot_mean   = quantize(t.rot, t.rot.sum / max<uint16_t>(t.rot.n, 1), 10.0f);
+    b.rot_min    = quantize(t.rot, t.rot.lo, 10.0f);
+    b.rot_max    = quantize(t.rot, t.rot.hi, 10.0f);
+    b.cal_min    = t.cal_lo;
+    b.cal_max    = t.cal_hi;
+
+    this->push(t, b);
+    t.n = 0;
+}
+
+// Store a closed bucket in the ring of a tier, overwriting the oldest
+void TrendStore::push(Tier &t, const Bucket &b) {
+    t.ring[t.seq % t.len] = b;
+    t.seq++;
+}
+
+// Unwrapped binary angle to heading in 0.01°, 0...35999
+uint16_t TrendStore::hdgCenti(int64_t bam) {
+    const uint32_t c = (uint32_t)(((uint64_t)(uint32_t)bam * 36000ULL + 0x80000000ULL) >> 32);
+    return (uint16_t)(c >= 36000 ? 0 : c);
+}
+
+// Scale and clamp a channel value to int16, NA if the channel had no valid values
+int16_t TrendStore::quantize(const Acc &a, float v, float scale) {
+    if (a.n == 0) return NA;
+    const long q = lroundf(v * scale);
+    return (int16_t)(q > 32767 ? 32767 : (q < -32767 ? -32767 : q));
+}
+
+// Lowest of each 2-bit calibration level (system, gyro, accelerometer, magnetometer)
+uint8_t TrendStore::calMin(uint8_t a, uint8_t b) {
+    uint8_t r = 0;
+    for (uint8_t shift = 0; shift < 8; shift += 2) {
+        const uint8_t la = (a >> shift) & 0x03, lb = (b >> shift) & 0x03;
+        r |= (la < lb ? la : lb) << shift;
+    }
+    return r;
+}
+
+// Highest of each 2-bit calibration level
+uint8_t TrendStore::calMax(uint8_t a, uint8_t b) {
+    uint8_t r = 0;
+    for (uint8_t shift = 0; shift < 8; shift += 2) {
+        const uint8_t la = (a >> shift) & 0x03, lb = (b >> shift) & 0x03;
+        r |= (la > lb ? la : lb) << shift;
+    }
+    return r;
+}
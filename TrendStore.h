@@ -0,0 +1,122 @@
+#pragma once
+
+#include <Arduino.h>
+#include "bam.h"
+#include "OutputPipeline.h"
+#include "ResponseWriter.h"
+
+// === T R E N D S T O R E  C L A S S ===
+//
+// - Class TrendStore - "the trends" keeps the recent history of heading,
+//   pitch, roll, rate of turn and calibration levels in RAM for the trend
+//   charts of the web UI
+// - Tiers: 1 s buckets for 10 min, 10 s buckets for 2 h, 2 min buckets for
+//   24 h, each bucket with min, max and mean of every channel
+// - TIER_BUCKET_S and TIER_LEN are the only settings: the bucket array, the
+//   memory check and the trend page (lengths, buttons) follow them
+// - Samples: registered as an output sink, trends.registerSinks(pipeline),
+//   every 199 ms and independent of WiFi. Every tier accumulates the open
+//   bucket directly, so a sample costs the same in every tier (O(1)), a
+//   closed bucket is copied into the ring of its tier
+// - Heading is unwrapped as a binary angle, so min, max and mean stay right
+//   across north and in full turns
+// - Gaps (no samples) are stored as empty buckets, a channel without valid
+//   values in a bucket is 0xFFFF (heading) or INT16_MIN (others)
+// - Memory: all tiers in one static array, sized at compile time and checked
+//   against MEMORY_BUDGET (getMemoryBytes() for the web UI)
+// - Download: trends.stream(out, tier, since) writes a 16-byte header and the
+//   buckets closed after sequence number since, oldest first (format in README)
+// - Uses: OutputPipeline, ResponseWriter
+
+class TrendStore {
+
+public:
+
+    static constexpr uint8_t TIERS = 3;
+    static constexpr uint16_t TIER_BUCKET_S[TIERS] = { 1, 10, 120 };
+    static constexpr uint16_t TIER_LEN[TIERS]      = { 600, 720, 720 };
+    static constexpr size_t MEMORY_BUDGET          = 55296;   // 54 kB for the buckets of all tiers
+
+    // One closed bucket as stored and sent, little endian
+    struct __attribute__((packed)) Bucket {
+        uint16_t hdg_mean, hdg_min, hdg_max;        // Magnetic heading, 0.01°, 0xFFFF = not available
+        int16_t pitch_mean, pitch_min, pitch_max;   // 0.01°
+        int16_t roll_mean, roll_min, roll_max;      // 0.01°
+        int16_t rot_mean, rot_min, rot_max;         // Rate of turn, 0.1°/min, positive to starboard
+        uint8_t cal_min, cal_max;                   // Calibration status byte, per 2-bit level, min 0xFF and max 0 = empty
+    };
+    static_assert(sizeof(Bucket) == 26, "Bucket size");
+
+    TrendStore();
+
+    void registerSinks(OutputPipeline &pipeline);
+    bool record(const OutputSample &s, uint8_t changed);
+    size_t stream(ResponseWriter &out, uint8_t tier, uint32_t since) const;
+
+    // Debug
+    static constexpr size_t getMemoryBytes() { return sizeof(buckets); }
+    uint32_t getSamples() const { return samples; }
+    uint32_t getSeq(uint8_t tier) const { return tier < TIERS ? tiers[tier].seq : 0; }
+    uint16_t getCount(uint8_t tier) const;
+    float getUpdateUs() const { return update_avg_us; }
+
+private:
+
+    static constexpr unsigned long RECORD_MS = 199;
+    static constexpr uint16_t NA_HDG = 0xFFFF;   // Heading not available
+    static constexpr int16_t NA = INT16_MIN;      // Pitch, roll or rate of turn not available
+
+    static constexpr size_t TOTAL_BUCKETS = TIER_LEN[0] + TIER_LEN[1] + TIER_LEN[2];
+    static_assert(TIERS == 3, "TOTAL_BUCKETS");
+
+    // Running min, max and sum of one channel in the open bucket, invalid values skipped
+    struct Acc {
+        float sum = 0.0f, lo = 0.0f, hi = 0.0f;
+        uint16_t n = 0;
+        void reset() { n = 0; }
+        void add(float v) {
+            if (!validf(v)) return;
+            if (n == 0) { sum = v; lo = v; hi = v; }
+            else { sum += v; if (v < lo) lo = v; if (v > hi) hi = v; }
+            n++;
+        }
+    };
+
+    // Open bucket and ring position of one tier
+    struct Tier {
+        Bucket* ring = nullptr;
+        uint16_t len = 0;
+        unsigned long bucket_ms = 0;
+        uint32_t seq = 0;          // Buckets closed so far, the next one goes to ring[seq % len]
+        uint32_t index = 0;        // Open bucket, sample_ms / bucket_ms
+        uint16_t n = 0;            // Samples in the open bucket
+        int64_t hdg_ref = 0;       // Unwrapped heading at the first sample of the open bucket, BAM
+        int64_t hdg_sum = 0, hdg_lo = 0, hdg_hi = 0;   // Relative to hdg_ref, BAM
+        uint16_t hdg_n = 0;
+        Acc pitch, roll, rot;
+        uint8_t cal_lo = 0, cal_hi = 0;
+    };
+
+    void add(Tier &t, unsigned long t_ms, bool hdg_ok, float pitch_deg, float roll_deg, float rot_dpm, uint8_t cal);
+    void close(Tier &t);
+    void push(Tier &t, const Bucket &b);
+    static uint16_t hdgCenti(int64_t bam);
+    static int16_t quantize(const Acc &a, float v, float scale);
+    static uint8_t calMin(uint8_t a, uint8_t b);
+    static uint8_t calMax(uint8_t a, uint8_t b);
+
+    Bucket buckets[TOTAL_BUCKETS];
+    static_assert(sizeof(Bucket) * TOTAL_BUCKETS <= MEMORY_BUDGET, "TrendStore exceeds its memory budget");
+
+    Tier tiers[TIERS];
+
+    // Heading unwrapping
+    bool hdg_prev_valid = false;
+    bam32_t hdg_prev_bam = 0;
+    int64_t hdg_unwrapped = 0;
+
+    unsigned long last_sample_ms = 0;
+    uint32_t samples = 0;
+    float update_avg_us = 0.0f;   // Debug
+
+};
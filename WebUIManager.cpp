@@ -2,7 +2,7 @@
 #include "secrets.h"
 
 // Value for static const char* array
-const char* WebUIManager::HEADER_KEYS[1] = {"Cookie"};
+const char* WebUIManager::HEADER_KEYS[2] = {"Cookie", "If-None-Match"};
 
 // === P U B L I C ===
 
@@ -10,12 +10,29 @@ const char* WebUIManager::HEADER_KEYS[1] = {"Cookie"};
 WebUIManager::WebUIManager(
     CMPS14Processor &compassref,
     CMPS14Preferences &compass_prefsref,
+    WifiManager &wifiref,
     SignalKBroker &signalkref,
+    ESPNowBroker &espnowref,
+    NMEA0183Broker &nmearef,
+    NMEA2000Broker &n2kref,
+    OutputPipeline &pipelineref,
+    DeviationLearner &learnerref,
+    FlightRecorder &recorderref,
+    TrendStore &trendsref,
     DisplayManager &displayref
     ) : server(80),
+        out(server),
         compass(compassref),
         compass_prefs(compass_prefsref), 
+        wifi(wifiref),
         signalk(signalkref),
+        espnow(espnowref),
+        nmea(nmearef),
+        n2k(n2kref),
+        pipeline(pipelineref),
+        learner(learnerref),
+        recorder(recorderref),
+        trends(trendsref),
         display(displayref) {
           for (uint8_t i = 0; i < MAX_SESSIONS; i++) {
             sessions[i].token[0] = '\0';
@@ -42,7 +59,7 @@ void WebUIManager::begin() {
     // If NVS password equals the default, show warning
     display.showInfoMessage("DEFAULT PASSWORD!", "CHANGE NOW!");
   }
-  server.collectHeaders(HEADER_KEYS, 1);
+  server.collectHeaders(HEADER_KEYS, 2);
   this->setupRoutes();
   server.begin();
 }
@@ -57,6 +74,7 @@ void WebUIManager::setLoopRuntimeInfo(float avg_us) {
   runtime_avg_us = avg_us;
 }
 
+
 // === P R I V A T E ===
 
 // Set the handlers for webserver endpoints
@@ -88,6 +106,10 @@ void WebUIManager::setupRoutes() {
     if (!this->requireAuth()) return;
     this->handleStatus();
   });
+  server.on("/status/debug", HTTP_GET, [this]() {
+    if (!this->requireAuth()) return;
+    this->handleStatusDebug();
+  });
   server.on("/cal/on", HTTP_POST, [this]() {
     if (!this->requireAuth()) return;
     this->handleStartCalibration();
@@ -112,6 +134,26 @@ void WebUIManager::setupRoutes() {
     if (!this->requireAuth()) return;
     this->handleSetDeviations();
   });
+  server.on("/devlearn/adopt", HTTP_POST, [this]() {
+    if (!this->requireAuth()) return;
+    this->handleAdoptLearnedDeviations();
+  });
+  server.on("/devlearn/reset", HTTP_POST, [this]() {
+    if (!this->requireAuth()) return;
+    this->handleResetLearner();
+  });
+  server.on("/espnow/pair", HTTP_POST, [this]() {
+    if (!this->requireAuth()) return;
+    this->handleEspNowPair();
+  });
+  server.on("/espnow/unpair", HTTP_POST, [this]() {
+    if (!this->requireAuth()) return;
+    this->handleEspNowUnpair();
+  });
+  server.on("/recorder/log", HTTP_GET, [this]() {
+    if (!this->requireAuth()) return;
+    this->handleRecorderDownload();
+  });
   server.on("/calmode/set", HTTP_POST, [this]() {
     if (!this->requireAuth()) return;
     this->handleSetCalmode();
@@ -132,6 +174,14 @@ void WebUIManager::setupRoutes() {
     if (!this->requireAuth()) return;
     this->handleDeviationTable();
   });
+  server.on("/trend", HTTP_GET, [this]() {
+    if (!this->requireAuth()) return;
+    this->handleTrendPage();
+  });
+  server.on("/trend/data", HTTP_GET, [this]() {
+    if (!this->requireAuth()) return;
+    this->handleTrendData();
+  });
   server.on("/level", HTTP_POST, [this]() {
     if (!this->requireAuth()) return;
     this->handleLevel();
@@ -232,6 +282,31 @@ void WebUIManager::handleStatus() {
   status_doc["stored"]               = compass.isCalProfileStored();
   status_doc["version"]              = SW_VERSION;
   status_doc["firmware"]             = compass.getFwVersion();
+  const MotionAnalyzer::Estimate &me = compass.getMotionAnalyzer().getEstimate();
+  status_doc["mo_roll_t"]            = me.roll_period_s;
+  status_doc["mo_roll_rms"]          = me.roll_rms_deg;
+  status_doc["mo_roll_sig"]          = me.roll_sig_deg;
+  status_doc["mo_pitch_t"]           = me.pitch_period_s;
+  status_doc["mo_pitch_rms"]         = me.pitch_rms_deg;
+  status_doc["mo_pitch_sig"]         = me.pitch_sig_deg;
+  const auto &win = compass.getWindowMinMaxDelta();
+  JsonArray win_arr = status_doc.createNestedArray("mm_win");
+  for (uint8_t i = 0; i < CMPS14Processor::MINMAX_WINDOWS; i++) {
+    JsonObject o = win_arr.createNestedObject();
+    o["n"]    = CMPS14Processor::MINMAX_WINDOW_NAMES[i];
+    o["pmin"] = win.pitch_min_rad[i] * RAD_TO_DEG;
+    o["pmax"] = win.pitch_max_rad[i] * RAD_TO_DEG;
+    o["rmin"] = win.roll_min_rad[i] * RAD_TO_DEG;
+    o["rmax"] = win.roll_max_rad[i] * RAD_TO_DEG;
+  }
+  HarmonicCoeffs lhc = learner.getCoeffs();
+  status_doc["dl_a"]                 = lhc.A;
+  status_doc["dl_b"]                 = lhc.B;
+  status_doc["dl_c"]                 = lhc.C;
+  status_doc["dl_d"]                 = lhc.D;
+  status_doc["dl_e"]                 = lhc.E;
+  status_doc["dl_conf"]              = learner.getConfidence();
+  status_doc["dl_steady"]            = learner.isSteady();
   // Debug
   status_doc["heap_free"]            = heap_free;
   status_doc["heap_total"]           = heap_total; 
@@ -244,9 +319,90 @@ void WebUIManager::handleStatus() {
   server.sendHeader("Pragma", "no-cache");
   server.sendHeader("Expires", "0");
 
-  char out[1048];
-  size_t n = serializeJson(status_doc, out, sizeof(out));
-  server.send(200, "application/json; charset=utf-8", out);
+  serializeJson(status_doc, status_buf, sizeof(status_buf));
+  server.send(200, "application/json; charset=utf-8", status_buf);
+}
+
+// Web UI handler for debug counters and timings of each subsystem, plain text lines written straight to the response
+void WebUIManager::handleStatusDebug() {
+
+  const unsigned long now_ms = millis();
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
+  server.send(200, "text/plain; charset=utf-8", "");
+  out.begin();
+
+  out.printf("Last page: %lu B in %lu chunks (%lu appends, %lu flushes)\n",
+    (unsigned long)resp_bytes, (unsigned long)resp_chunks, (unsigned long)resp_appends, (unsigned long)resp_flushes);
+  out.printf("NVS config: v%u, load %lu µs, saves/writes: %lu/%lu%s\n", compass_prefs.getStoredVersion(), compass_prefs.getLoadTimeUs(),
+    (unsigned long)compass_prefs.getSaveCount(), (unsigned long)compass_prefs.getWriteCount(), compass_prefs.getDirtyFields() ? " (pending)" : "");
+  out.printf("NVS flush: %lu µs, max %lu µs\n", compass_prefs.getLastFlushUs(), compass_prefs.getMaxFlushUs());
+  if (compass.getFirstTrueHeadingMs()) {
+    out.printf("Boot: %s, first true heading: %lu ms\n", compass.isWarmStarted() ? "warm" : "cold", compass.getFirstTrueHeadingMs());
+  } else out.printf("Boot: %s, first true heading: n/a\n", compass.isWarmStarted() ? "warm" : "cold");
+  out.printf("Learned dev: %lu samples (%lu rejected, %lu without variation), %u/8 sectors, RMS %.1f°, update %.1f µs\n",
+    (unsigned long)learner.getSampleCount(), (unsigned long)learner.getRejectedCount(), (unsigned long)learner.getNoVariationCount(),
+    learner.getSectorsCovered(), learner.getResidualRmsDeg(), learner.getUpdateUs());
+  out.printf("Dev curve render: %lu µs, TTFB: %lu µs, serve: %lu µs, cache hits: %lu, 304: %lu\n",
+    dev_render_us, dev_ttfb_us, dev_serve_us, (unsigned long)dev_cache_hits, (unsigned long)dev_not_modified);
+  if (recorder.isOk()) {
+    out.printf("Recorder: %lu samples, %lu events, %lu blocks (%lu B), write %.1f µs, errors %lu\n",
+      (unsigned long)recorder.getSamples(), (unsigned long)recorder.getEvents(), (unsigned long)recorder.getBlocks(),
+      (unsigned long)recorder.getBytesWritten(), recorder.getWriteUs(), (unsigned long)recorder.getWriteErrors());
+  } else out.print("Recorder: n/a\n");
+  out.printf("Recorder files: %u (current #%lu), LittleFS %lu/%lu kB\n", recorder.getFileCount(), (unsigned long)recorder.getFileSeq(),
+    (unsigned long)(recorder.getFsUsed() / 1024), (unsigned long)(recorder.getFsTotal() / 1024));
+  out.printf("Trends: %lu samples, buckets %u/%u/%u, RAM %lu/%lu B, update %.1f µs\n", (unsigned long)trends.getSamples(),
+    trends.getCount(0), trends.getCount(1), trends.getCount(2),
+    (unsigned long)TrendStore::getMemoryBytes(), (unsigned long)TrendStore::MEMORY_BUDGET, trends.getUpdateUs());
+  const MotionAnalyzer &motion = compass.getMotionAnalyzer();
+  out.printf("Motion FFT: %lu blocks, buffer %u %%, block %lu µs, max step %lu µs\n", (unsigned long)motion.getBlocks(),
+    motion.getFillPercent(), (unsigned long)motion.getBlockUs(), (unsigned long)motion.getStepMaxUs());
+  out.printf("Heading path: %s, %.1f µs per update\n", compass.isFixedPointHeading() ? "binary angles" : "float", compass.getProcessUs());
+  const auto &lut = compass.getDeviationLookup();
+  out.printf("Dev table: build %lu µs, swaps: %lu, lookups during build: %lu, waits: %lu\n", lut.getBuildUs(),
+    (unsigned long)lut.getSwapCount(), (unsigned long)lut.getReadsDuringBuild(), (unsigned long)lut.getBuildWaits());
+
+  out.printf("ESP-NOW: %lu ok, %lu failed, %lu skipped, success %.1f %%, latency %lu µs (max %lu)\n",
+    (unsigned long)espnow.getTxOk(), (unsigned long)(espnow.getTxFail() + espnow.getTxErrors()), (unsigned long)espnow.getTxSkipped(),
+    espnow.getSuccessRate() * 100.0f, (unsigned long)espnow.getLatencyAvgUs(), (unsigned long)espnow.getLatencyMaxUs());
+  out.printf("ESP-NOW rate: every %lu ms, deadband %.1f°, congestions: %lu\n",
+    espnow.getTxIntervalMs(), espnow.getDeadbandDeg(), (unsigned long)espnow.getCongestionCount());
+  out.printf("ESP-NOW commands: %lu executed (last ack %u), %lu dropped, %lu invalid, %lu not paired (%u paired), peers expired: %lu\n",
+    (unsigned long)espnow.getCommandCount(), (unsigned)espnow.getLastAck(), (unsigned long)espnow.getCommandDrops(),
+    (unsigned long)espnow.getCommandInvalid(), (unsigned long)espnow.getCommandRejected(), espnow.getPairedCount(),
+    (unsigned long)espnow.getPeerExpiredCount());
+  ESPNowBroker::PeerInfo peers[ESPNowBroker::MAX_SUBSCRIBERS];
+  const uint8_t peer_n = espnow.getPeers(peers, ESPNowBroker::MAX_SUBSCRIBERS, now_ms);
+  for (uint8_t i = 0; i < peer_n; i++) {
+    const ESPNowBroker::PeerInfo &p = peers[i];
+    out.printf("ESP-NOW peer %02X:%02X:%02X:%02X:%02X:%02X: %lu ok, %lu failed, every %lu ms, fields 0x%x, hello %lu ms ago\n",
+      p.mac[0], p.mac[1], p.mac[2], p.mac[3], p.mac[4], p.mac[5], (unsigned long)p.ok, (unsigned long)p.fail,
+      (unsigned long)p.interval_ms, (unsigned)p.fields, (unsigned long)p.age_ms);
+  }
+  out.printf("SignalK deltas: %s, websocket %s, ws sends %lu (%.1f µs), UDP sends %lu (%.1f µs), UDP errors %lu\n",
+    signalk.isUdpMode() ? "UDP" : "websocket", signalk.isOpen() ? "open" : "closed", (unsigned long)signalk.getWsSends(),
+    signalk.getWsSendUs(), (unsigned long)signalk.getUdpSends(), signalk.getUdpSendUs(), (unsigned long)signalk.getUdpErrors());
+  out.printf("NMEA 0183: %lu sentences, TCP clients: %u, UDP errors: %lu, TCP dropped: %lu\n", (unsigned long)nmea.getSentenceCount(),
+    nmea.getClientCount(), (unsigned long)nmea.getUdpErrors(), (unsigned long)nmea.getTcpDropped());
+  out.printf("NMEA 2000: %s, address %u%s, tx %lu, dropped %lu, rx %lu, bus off: %lu, address changes: %lu\n",
+    n2k.getBusState(), n2k.getAddress(), n2k.isClaimed() ? "" : " (claiming)", (unsigned long)n2k.getTxFrames(),
+    (unsigned long)n2k.getTxDropped(), (unsigned long)n2k.getRxFrames(), (unsigned long)n2k.getBusOffCount(),
+    (unsigned long)n2k.getAddressChanges());
+  out.printf("Output fan-out: %lu passes, avg %.1f µs, max %lu µs\n", (unsigned long)pipeline.getPassCount(),
+    pipeline.getPassUs(), (unsigned long)pipeline.getPassMaxUs());
+  for (uint8_t i = 0; i < pipeline.getSinkCount(); i++) {
+    const OutputSink &k = pipeline.getSink(i);
+    out.printf("Output %s: every %lu ms, %lu sent, %lu skipped, %.1f µs\n", k.name, (unsigned long)k.interval_ms,
+      (unsigned long)k.sends, (unsigned long)k.skipped, k.avg_us);
+  }
+  out.printf("WiFi connect: %lu ms (%s, assoc %lu ms, DHCP %lu ms), fallbacks to full scan: %lu\n", wifi.getConnectMs(),
+    wifi.getConnectMode(), wifi.getAssocMs(), wifi.getDhcpMs(), (unsigned long)wifi.getFallbackCount());
+  out.printf("WiFi up/down: %lu/%lu s, losses: %lu, last reason: %u\n", wifi.getDwellMs(WifiState::CONNECTED, now_ms) / 1000,
+    (wifi.getDwellMs(WifiState::CONNECTING, now_ms) + wifi.getDwellMs(WifiState::DISCONNECTED, now_ms)) / 1000,
+    (unsigned long)wifi.getLossCount(), wifi.getLastDisconnectReason());
+
+  out.end();
 }
 
 // Web UI handler for installation offset, to correct raw compass heading
@@ -301,6 +457,230 @@ void WebUIManager::handleSetDeviations() {
   this->handleRoot();
 }
 
+// Web UI handler to adopt the deviation curve learned from COG
+void WebUIManager::handleAdoptLearnedDeviations() {
+  float measured_deviations[8];
+  HarmonicCoeffs hc;
+  const bool ok = learner.adopt(measured_deviations, hc);
+  if (ok) compass_prefs.saveDeviationSettings(measured_deviations, hc);
+  display.showSuccessMessage("ADOPT LEARNED", ok);
+  this->handleRoot();
+}
+
+// Web UI handler to restart deviation learning
+void WebUIManager::handleResetLearner() {
+  learner.reset();
+  display.showInfoMessage("DEV LEARNING", "RESET");
+  this->handleRoot();
+}
+
+// Web UI handler for ESP-NOW PAIR button
+void WebUIManager::handleEspNowPair() {
+  espnow.startPairing(millis());
+  display.showInfoMessage("ESPNOW PAIRING", "SEND FROM DISPL");
+  this->handleRoot();
+}
+
+// Web UI handler for ESP-NOW UNPAIR button
+void WebUIManager::handleEspNowUnpair() {
+  espnow.unpairAll();
+  display.showInfoMessage("ESPNOW", "ALL UNPAIRED");
+  this->handleRoot();
+}
+
+// Web UI handler to download the flight recorder log in parts, all files oldest first as one binary
+// stream when concatenated, the part continues at f (file) and o (offset), X-Rec-Next gives the next one
+void WebUIManager::handleRecorderDownload() {
+  if (!recorder.isOk()) {
+    server.send(503, "text/plain", "Flight recorder not available");
+    return;
+  }
+
+  RecorderCursor from;
+  from.seq = server.hasArg("f") ? strtoul(server.arg("f").c_str(), nullptr, 10) : 0;
+  from.offset = server.hasArg("o") ? strtoul(server.arg("o").c_str(), nullptr, 10) : 0;
+  const RecorderCursor end = recorder.span(from);
+
+  // Uptime in the file name to map sample times of the current boot to wall clock
+  char disposition[64];
+  snprintf(disposition, sizeof(disposition), "attachment; filename=\"cmps14-rec-%lu.bin\"", (unsigned long)millis());
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.sendHeader("Content-Disposition", disposition);
+  server.sendHeader("Cache-Control", "no-store");
+  if (!recorder.isEnd(end)) {
+    char next[32];
+    snprintf(next, sizeof(next), "f=%lu&o=%lu", (unsigned long)end.seq, (unsigned long)end.offset);
+    server.sendHeader("X-Rec-Next", next);
+  }
+  server.send(200, "application/octet-stream", "");
+  out.begin();
+  recorder.stream(out, from, end);
+  out.end();
+}
+
+// Web UI handler for trend data: binary buckets of one tier, only the ones after s when given
+void WebUIManager::handleTrendData() {
+  long t = server.hasArg("t") ? server.arg("t").toInt() : 0;
+  if (t < 0 || t >= TrendStore::TIERS) t = 0;
+  const uint32_t since = server.hasArg("s") ? strtoul(server.arg("s").c_str(), nullptr, 10) : 0;
+
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.sendHeader("Cache-Control", "no-store");
+  server.send(200, "application/octet-stream", "");
+  out.begin();
+  trends.stream(out, (uint8_t)t, since);
+  out.end();
+}
+
+// Web UI handler for the trend chart page, charts drawn by the browser from /trend/data
+void WebUIManager::handleTrendPage() {
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.sendHeader("Connection", "close");
+  server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
+  server.send(200, "text/html; charset=utf-8", "");
+  out.begin();
+
+  out.print(R"(
+    <!DOCTYPE html><html><head><meta charset="utf-8">
+    <meta name="viewport" content="width=device-width, initial-scale=1, maximum-scale=5, user-scalable=yes">
+    <link rel="icon" href="data:,">
+    <title>Trends</title>
+    <style>
+      * { box-sizing: border-box } 
+      html { font-family: Helvetica; margin: 0; padding: 0; text-align: center; }
+      body{background:#000; color:#fff; max-width: 768px; margin: 0 auto; padding: 0; font-size: clamp(8px, 3vmin, 14px);}
+      .card{font-size: clamp(8px, 3vmin, 14px); width:92%; margin:8px auto; padding:8px;background:#0b0b0b;border-radius:6px;box-shadow:0 0 0 1px #222 inset}
+      .button { background-color: #00A300; border: none; color: white; padding: 6px 10px; font-size: clamp(8px, 3vmin, 14px); margin: 2px; cursor: pointer; border-radius:6px; }
+      .button:disabled { opacity:0.5; cursor:default; }
+      canvas{width:100%; background:#000; display:block; margin:4px 0;}
+      h2{margin:8px 0; font-size: clamp(10px, 4vmin, 16px);}
+      a{color:#fff; text-decoration:none;}
+    </style>
+    </head><body>
+    <h2>TRENDS</h2>
+    <div class="card">)");
+
+  // Tier buttons and lengths from the TrendStore settings
+  for (uint8_t i = 0; i < TrendStore::TIERS; i++) {
+    const uint32_t span_s = (uint32_t)TrendStore::TIER_LEN[i] * TrendStore::TIER_BUCKET_S[i];
+    if (span_s % 3600 == 0) out.printf("<button class=\"button\" id=\"b%u\" onclick='sel(%u)'>%lu H</button>", i, i, (unsigned long)(span_s / 3600));
+    else out.printf("<button class=\"button\" id=\"b%u\" onclick='sel(%u)'>%lu MIN</button>", i, i, (unsigned long)(span_s / 60));
+  }
+  out.printf("<script>const LEN=[%u,%u,%u], BS=[%u,%u,%u];</script>",
+    TrendStore::TIER_LEN[0], TrendStore::TIER_LEN[1], TrendStore::TIER_LEN[2],
+    TrendStore::TIER_BUCKET_S[0], TrendStore::TIER_BUCKET_S[1], TrendStore::TIER_BUCKET_S[2]);
+
+  out.print(R"(
+    <canvas id="c0" width="760" height="150"></canvas>
+    <canvas id="c1" width="760" height="110"></canvas>
+    <canvas id="c2" width="760" height="110"></canvas>
+    <canvas id="c3" width="760" height="110"></canvas>
+    <canvas id="c4" width="760" height="70"></canvas>
+    <div id="info">Loading...</div>
+    </div>
+    <p style="margin:20px;"><a href="/">BACK</a></p>
+    <script>
+      const TICK=[120,1800,14400];
+      let tier=0, seq=0, bs=1, age=0, rows=[], timer=null;
+      function sel(t){
+        tier=t; seq=0; rows=[];
+        for(let i=0;i<3;i++) document.getElementById('b'+i).disabled=(i===t);
+        clearInterval(timer); load(); timer=setInterval(load, Math.max(2003, BS[t]*1000));
+      }
+      function load(){
+        fetch('/trend/data?t='+tier+'&s='+seq).then(r=>{
+          if(r.status === 401){ location.replace('/'); return; }
+          return r.arrayBuffer();
+        }).then(buf=>{
+          if(!buf) return;
+          const v=new DataView(buf), n=v.getUint16(12,true), sz=v.getUint16(14,true), s=v.getUint32(4,true);
+          bs=v.getUint16(2,true); age=v.getUint32(8,true);
+          if(s-n !== seq) rows=[];   // Not a continuation (first load or restart), full ring received
+          const hd=x=>x===0xFFFF?null:x/100, i16=x=>x===-32768?null:x;
+          for(let i=0;i<n;i++){
+            const o=16+i*sz;
+            rows.push({
+              h:[hd(v.getUint16(o,true)),hd(v.getUint16(o+2,true)),hd(v.getUint16(o+4,true))],
+              p:[6,8,10].map(k=>{const x=i16(v.getInt16(o+k,true)); return x===null?null:x/100;}),
+              r:[12,14,16].map(k=>{const x=i16(v.getInt16(o+k,true)); return x===null?null:x/100;}),
+              t:[18,20,22].map(k=>{const x=i16(v.getInt16(o+k,true)); return x===null?null:x/10;}),
+              c:v.getUint8(o+24)
+            });
+          }
+          if(rows.length>LEN[tier]) rows=rows.slice(rows.length-LEN[tier]);
+          seq=s; draw();
+        }).catch(_=>{ document.getElementById('info').textContent='Trend fetch failed'; });
+      }
+      function chart(id, label, key, fixed, wrap){
+        const cv=document.getElementById(id), g=cv.getContext('2d'), W=cv.width, H=cv.height, L=40, R=6, T=12, B=14;
+        const span=LEN[tier]*bs, N=rows.length;
+        g.clearRect(0,0,W,H);
+        let lo=fixed?fixed[0]:Infinity, hi=fixed?fixed[1]:-Infinity;
+        if(!fixed){
+          rows.forEach(b=>{ if(b[key][0]!==null){ lo=Math.min(lo,b[key][1]); hi=Math.max(hi,b[key][2]); } });
+          if(lo>hi){ lo=-1; hi=1; }
+          const m=Math.max(Math.abs(lo),Math.abs(hi),1); lo=-m; hi=m;
+        }
+        const X=i=>L+(W-L-R)*(1-((N-1-i)*bs+age/1000)/span), Y=y=>T+(H-T-B)*(hi-y)/(hi-lo);
+        g.strokeStyle='#222'; g.fillStyle='#aaa'; g.font='10px Helvetica'; g.textAlign='right';
+        [lo,(lo+hi)/2,hi].forEach(y=>{ g.beginPath(); g.moveTo(L,Y(y)); g.lineTo(W-R,Y(y)); g.stroke(); g.fillText(y.toFixed(0),L-4,Y(y)+4); });
+        g.textAlign='center';
+        for(let s=0;s<=span;s+=TICK[tier]){
+          const x=L+(W-L-R)*(1-s/span); g.beginPath(); g.moveTo(x,T); g.lineTo(x,H-B); g.stroke();
+          g.fillText(s===0?'now':'-'+(s>=3600?(s/3600)+' h':(s/60)+' min'),x,H-2);
+        }
+        g.textAlign='left'; g.fillText(label,L+4,T-2);
+        g.strokeStyle='#045'; g.lineWidth=Math.max(1,(W-L-R)/LEN[tier]);
+        rows.forEach((b,i)=>{
+          const [m,a,z]=b[key]; if(m===null) return;
+          g.beginPath();
+          if(wrap && z<a){ g.moveTo(X(i),Y(a)); g.lineTo(X(i),Y(360)); g.moveTo(X(i),Y(0)); g.lineTo(X(i),Y(z)); }
+          else { g.moveTo(X(i),Y(a)); g.lineTo(X(i),Y(z)); }
+          g.stroke();
+        });
+        g.strokeStyle='#0af'; g.lineWidth=1.5; g.beginPath();
+        let prev=null;
+        rows.forEach((b,i)=>{
+          const m=b[key][0];
+          if(m===null){ prev=null; return; }
+          if(prev===null || (wrap && Math.abs(m-prev)>180)) g.moveTo(X(i),Y(m)); else g.lineTo(X(i),Y(m));
+          prev=m;
+        });
+        g.stroke();
+      }
+      function calChart(){
+        const cv=document.getElementById('c4'), g=cv.getContext('2d'), W=cv.width, H=cv.height, L=40, R=6, T=12, B=4;
+        const span=LEN[tier]*bs, N=rows.length;
+        g.clearRect(0,0,W,H);
+        const X=i=>L+(W-L-R)*(1-((N-1-i)*bs+age/1000)/span), Y=y=>T+(H-T-B)*(3-y)/3;
+        g.fillStyle='#aaa'; g.font='10px Helvetica'; g.textAlign='left';
+        g.fillText('Calibration min (sys, mag, acc)',L+4,T-2);
+        [[6,'#fff'],[0,'#0af'],[2,'#fa0']].forEach(([sh,col],k)=>{
+          g.strokeStyle=col; g.beginPath(); let on=false;
+          rows.forEach((b,i)=>{
+            if(b.h[0]===null && b.p[0]===null){ on=false; return; }
+            const y=Y(((b.c>>sh)&3)-k*0.08);
+            if(on) g.lineTo(X(i),y); else g.moveTo(X(i),y);
+            on=true;
+          });
+          g.stroke();
+        });
+      }
+      function draw(){
+        chart('c0','Heading (M) °','h',[0,360],true);
+        chart('c1','Pitch °','p',null,false);
+        chart('c2','Roll °','r',null,false);
+        chart('c3','Rate of turn °/min','t',null,false);
+        calChart();
+        document.getElementById('info').textContent=rows.length+' buckets of '+bs+' s, mean line, min...max band';
+      }
+      sel(0);
+    </script>
+    </body></html>)");
+  out.end();
+  this->captureResponseStats();
+}
+
 // Web UI handler to choose calibration mode on boot
 void WebUIManager::handleSetCalmode() {
   if (server.hasArg("c") && server.hasArg("t")) { 
@@ -362,9 +742,6 @@ void WebUIManager::handleSetHeadingMode() {
 // Web UI handler for the configuration HTML page 
 void WebUIManager::handleRoot() {
 
-  // Re-usable buffer for all content creation
-  char buf[256];
-
   CalMode mode_runtime = compass.getCalibrationModeRuntime();
   CalMode mode_boot = compass.getCalibrationModeBoot();
   float measured_deviations[8];
@@ -377,9 +754,10 @@ void WebUIManager::handleRoot() {
   server.sendHeader("Pragma", "no-cache");
   server.sendHeader("Expires", "0");
   server.send(200, "text/html; charset=utf-8", "");
+  out.begin();
 
   // Head and CSS
-  server.sendContent_P(R"(
+  out.print(R"(
     <!DOCTYPE html><html><head><meta charset="utf-8">
     <meta name="viewport" content="width=device-width, initial-scale=1, maximum-scale=5, user-scalable=yes"><link rel="icon" href="data:,">
     <style>
@@ -399,135 +777,145 @@ void WebUIManager::handleRoot() {
     )");
 
   // DIV Calibrate, Stop, Reset
-  server.sendContent_P(R"(
+  out.print(R"(
     <div class='card' id='controls'>)");
   if (mode_runtime == CalMode::FULL_AUTO) {
-    snprintf(buf, sizeof(buf), "Current mode: %s (%s)<br>", calModeToString(mode_runtime), this->ms_to_hms_str(compass.getFullAutoLeft()));
-    server.sendContent(buf);
+    out.printf("Current mode: %s (%s)<br>", calModeToString(mode_runtime), this->ms_to_hms_str(compass.getFullAutoLeft()));
   } else {
-    snprintf(buf, sizeof(buf), "Current mode: %s<br>", calModeToString(mode_runtime));
-    server.sendContent(buf);
+    out.printf("Current mode: %s<br>", calModeToString(mode_runtime));
   }
 
   if (mode_runtime == CalMode::AUTO || mode_runtime == CalMode::MANUAL) {
-    server.sendContent_P(R"(<form action="/cal/off" method="post" style="display:inline"><button class="button button2">STOP</button></form>)");
+    out.print(R"(<form action="/cal/off" method="post" style="display:inline"><button class="button button2">STOP</button></form>)");
     if (!compass.isCalProfileStored()) {
-      server.sendContent_P(R"(<form action="/store/on" method="post" style="display:inline"><button class="button">SAVE</button></form>)");
+      out.print(R"(<form action="/store/on" method="post" style="display:inline"><button class="button">SAVE</button></form>)");
     } else {
-      server.sendContent_P(R"(<form action="/store/on" method="post" style="display:inline"><button class="button button2">REPLACE</button></form>)");
+      out.print(R"(<form action="/store/on" method="post" style="display:inline"><button class="button button2">REPLACE</button></form>)");
     }
   } else if (mode_runtime == CalMode::USE) {
-    server.sendContent_P(R"(<form action="/cal/on" method="post" style="display:inline"><button class="button">CALIBRATE</button></form>)");
+    out.print(R"(<form action="/cal/on" method="post" style="display:inline"><button class="button">CALIBRATE</button></form>)");
   } else if (mode_runtime == CalMode::FULL_AUTO) {
-    server.sendContent_P(R"(<form action="/cal/off" method="post" style="display:inline"><button class="button button2">STOP</button></form>)");
+    out.print(R"(<form action="/cal/off" method="post" style="display:inline"><button class="button button2">STOP</button></form>)");
   }
-  server.sendContent_P(R"(<form action="/reset/on" method="post" style="display:inline"><button class="button button2">RESET</button></form></div>)");
+  out.print(R"(<form action="/reset/on" method="post" style="display:inline"><button class="button button2">RESET</button></form></div>)");
 
   // DIV Calibration mode on boot
-  server.sendContent_P(R"(
+  out.print(R"(
     <div class='card'>
     <form action="/calmode/set" method="post">
     <label>Boot mode </label><label><input type="radio" name="c" value="0")");
-  if (mode_boot == CalMode::FULL_AUTO) server.sendContent_P(R"( checked)");
-  server.sendContent_P(R"(>Full auto </label><label>
+  if (mode_boot == CalMode::FULL_AUTO) out.print(R"( checked)");
+  out.print(R"(>Full auto </label><label>
     <input type="radio" name="c" value="1")");
-  if (mode_boot == CalMode::AUTO) server.sendContent_P(R"( checked)");
-  server.sendContent_P(R"(>Auto </label><label>
+  if (mode_boot == CalMode::AUTO) out.print(R"( checked)");
+  out.print(R"(>Auto </label><label>
     <input type="radio" name="c" value="3")");
-  if (mode_boot == CalMode::USE) server.sendContent_P(R"( checked)");
-  server.sendContent_P(R"(>Use/Manual</label><br>
+  if (mode_boot == CalMode::USE) out.print(R"( checked)");
+  out.print(R"(>Use/Manual</label><br>
     <label>Full auto stops in </label>
     <input type="number" name="t" step="1" min="0" max="60" value=")");
   float to = (float)(compass.getFullAutoTimeout()/1000/60);
-  snprintf(buf, sizeof(buf), "%.0f", to);
-  server.sendContent(buf);
-  server.sendContent_P(R"("> mins (0 never)<br><input type="submit" id="calmodebtn" class="button" value="SAVE"></form></div>)");
+  out.printf("%.0f", to);
+  out.print(R"("> mins (0 never)<br><input type="submit" id="calmodebtn" class="button" value="SAVE"></form></div>)");
 
   // DIV Set installation offset
-  server.sendContent_P(R"(
+  out.print(R"(
     <div class='card'>
     <form action="/offset/set" method="post">
     <label>Installation offset</label>
     <input type="number" name="v" step="1" min="-180" max="180" value=")");
-  snprintf(buf, sizeof(buf), "%.0f", compass.getInstallationOffset());
-  server.sendContent(buf);
-  server.sendContent_P(R"(">&deg; <input type="submit" value="SAVE" class="button"></form></div>)");
+  out.printf("%.0f", compass.getInstallationOffset());
+  out.print(R"(">&deg; <input type="submit" value="SAVE" class="button"></form></div>)");
 
   // DIV Set deviation 
-  server.sendContent_P(R"(
+  out.print(R"(
     <div class='card'>Measured deviations<form action="/dev8/set" method="post"><div>)");
 
   // Row 1: N NE
-  snprintf(buf, sizeof(buf),
+  out.printf(
     "<label>N</label><input name=\"N\"  type=\"number\" step=\"1\" value=\"%.0f\">&deg; "
     "<label>NE</label><input name=\"NE\" type=\"number\" step=\"1\" value=\"%.0f\">&deg; ",
     measured_deviations[0], measured_deviations[1]);
-  server.sendContent(buf);
-  server.sendContent_P(R"(</div><div>)");
+  out.print(R"(</div><div>)");
 
   // Row 2:  E SE
-  snprintf(buf, sizeof(buf),
+  out.printf(
     "<label>E</label><input name=\"E\"  type=\"number\" step=\"1\" value=\"%.0f\">&deg; "
     "<label>SE</label><input name=\"SE\" type=\"number\" step=\"1\" value=\"%.0f\">&deg; ",
     measured_deviations[2], measured_deviations[3]);
-  server.sendContent(buf);
-  server.sendContent_P(R"(</div><div>)");
+  out.print(R"(</div><div>)");
 
   // Row 3: S SW
-  snprintf(buf, sizeof(buf),
+  out.printf(
     "<label>S</label><input name=\"S\"  type=\"number\" step=\"1\" value=\"%.0f\">&deg; "
     "<label>SW</label><input name=\"SW\" type=\"number\" step=\"1\" value=\"%.0f\">&deg; ",
     measured_deviations[4], measured_deviations[5]);
-  server.sendContent(buf);
-  server.sendContent_P(R"(</div><div>)");
+  out.print(R"(</div><div>)");
 
   // Row 4: W NW
-  snprintf(buf, sizeof(buf),
+  out.printf(
     "<label>W</label><input name=\"W\"  type=\"number\" step=\"1\" value=\"%.0f\">&deg; "
     "<label>NW</label><input name=\"NW\" type=\"number\" step=\"1\" value=\"%.0f\">&deg; ",
     measured_deviations[6], measured_deviations[7]);
-  server.sendContent(buf);
 
-  server.sendContent_P(R"(
+  out.print(R"(
     </div>
     <input type="submit" class="button" value="SAVE"></form></div>)");
 
   // DIV Deviation curve
-  server.sendContent_P(R"(
+  out.print(R"(
     <div class='card'>
-    <a href="/deviationdetails"><button class="button">SHOW DEVIATION CURVE</button></a></div>)");
+    <a href="/deviationdetails"><button class="button">SHOW DEVIATION CURVE</button></a>
+    <a href="/trend"><button class="button">SHOW TRENDS</button></a></div>)");
+
+  // DIV Learned deviation
+  HarmonicCoeffs lhc = learner.getCoeffs();
+  out.print(R"(
+    <div class='card'>Learned deviation (COG))");
+  out.printf("<br>A %.1f B %.1f C %.1f D %.1f E %.1f<br>confidence %u %%, %lu samples, %u/8 sectors, RMS %.1f&deg;<br>",
+    lhc.A, lhc.B, lhc.C, lhc.D, lhc.E, learner.getConfidence(), (unsigned long)learner.getSampleCount(),
+    learner.getSectorsCovered(), learner.getResidualRmsDeg());
+  out.printf(R"(<form action="/devlearn/adopt" method="post" style="display:inline"><button class="button"%s>ADOPT</button></form>)",
+    learner.isReady() ? "" : " disabled");
+  out.print(R"(<form action="/devlearn/reset" method="post" style="display:inline"><button class="button button2">RESET</button></form></div>)");
+
+  // DIV ESP-NOW pairing
+  out.printf(R"(
+    <div class='card'>ESP-NOW displays: %u paired%s<br>)",
+    espnow.getPairedCount(), espnow.isPairing() ? ", pairing..." : "");
+  out.print(R"(<form action="/espnow/pair" method="post" style="display:inline"><button class="button">PAIR</button></form>)");
+  out.print(R"(<form action="/espnow/unpair" method="post" style="display:inline"><button class="button button2">UNPAIR ALL</button></form></div>)");
 
   // DIV Set variation 
-  server.sendContent_P(R"(
+  out.print(R"(
     <div class='card'>
     <form action="/magvar/set" method="post">
     <label>Manual variation </label>
     <input type="number" name="v" step="1" min="-180" max="180" value=")");
-  snprintf(buf, sizeof(buf), "%.0f", compass.getManualVariation());
-  server.sendContent(buf);
-  server.sendContent_P(R"(">&deg; <input type="submit" value="SAVE" class="button"></form></div>)");
+  out.printf("%.0f", compass.getManualVariation());
+  out.print(R"(">&deg; <input type="submit" value="SAVE" class="button"></form></div>)");
 
   // DIV Set heading mode TRUE or MAGNETIC
-  server.sendContent_P(R"(
+  out.print(R"(
     <div class='card'>
     <form action="/heading/mode" method="post">
     <label>Heading </label><label><input type="radio" name="m" value="1")");
-    if (send_hdg_true) server.sendContent_P(R"( checked)");
-    server.sendContent_P(R"(>True</label><label>
+    if (send_hdg_true) out.print(R"( checked)");
+    out.print(R"(>True</label><label>
     <input type="radio" name="m" value="0")");
-    if (!send_hdg_true) server.sendContent_P(R"( checked)");
-    server.sendContent_P(R"(>Magnetic</label>
+    if (!send_hdg_true) out.print(R"( checked)");
+    out.print(R"(>Magnetic</label>
     <input type="submit" class="button" value="SAVE"></form></div>)");
 
   // DIV Level attitude
-  server.sendContent_P(R"(<div class='card'>
+  out.print(R"(<div class='card'>
     <form action="/level" method="post" style="display:inline"><button class="button">LEVEL ATTITUDE</button></form></div>)");
 
   // DIV Status
-  server.sendContent_P(R"(<div class='card'><div id="st">Loading...</div></div>)");
+  out.print(R"(<div class='card'><div id="st">Loading...</div></div>)");
 
   // Live JS updater script
-  server.sendContent_P(R"(
+  out.print(R"(
     <script>
       function fmt0(x) {
         return (x === null || x === undefined || Number.isNaN(x)) ? 'NA' : x.toFixed(0);
@@ -587,10 +975,14 @@ void WebUIManager::handleRoot() {
             'Variation: '+fmt0(j.variation)+'\u00B0',
             'Heading (T): '+fmt0(j.heading_true_deg)+'\u00B0',
             'Pitch: '+fmt1(j.pitch_deg)+'\u00B0 ('+fmt1(j.pitch_level)+'\u00B0) Roll: '+fmt1(j.roll_deg)+'\u00B0 ('+fmt1(j.roll_level)+'\u00B0)',
+            ...(j.mm_win||[]).map(w=>'Min/max '+w.n+': pitch '+fmt1(w.pmin)+'...'+fmt1(w.pmax)+'\u00B0, roll '+fmt1(w.rmin)+'...'+fmt1(w.rmax)+'\u00B0'),
+            'Roll: period '+fmt1(j.mo_roll_t)+' s, RMS '+fmt1(j.mo_roll_rms)+'\u00B0, significant '+fmt1(j.mo_roll_sig)+'\u00B0',
+            'Pitch: period '+fmt1(j.mo_pitch_t)+' s, RMS '+fmt1(j.mo_pitch_rms)+'\u00B0, significant '+fmt1(j.mo_pitch_sig)+'\u00B0',
             'Acc: '+j.acc+', Mag: '+j.mag+', Sys: '+j.sys,
             'HcA: '+fmt1(j.hca)+', HcB: '+fmt1(j.hcb)+', HcC: '+fmt1(j.hcc)+', HcD: '+fmt1(j.hcd)+', HcE: '+fmt1(j.hce),
             'Heap: '+j.heap_free+' kB ('+j.heap_percent+' \u0025) free, total '+j.heap_total+' kB',
             'Loop runtime avg: '+fmt1(j.runtime_avg)+' \u00B5s, loop task free stack: '+j.stack_free+' B',
+            'Learned dev: A '+fmt1(j.dl_a)+', B '+fmt1(j.dl_b)+', C '+fmt1(j.dl_c)+', D '+fmt1(j.dl_d)+', E '+fmt1(j.dl_e)+', confidence '+j.dl_conf+' \u0025'+(j.dl_steady ? ', steady' : ''),
             'WiFi: '+j.wifi+' ('+j.rssi+')',
             'SW release: '+j.version+', FW version: '+j.firmware,
             'System uptime: '+j.uptime
@@ -607,26 +999,88 @@ void WebUIManager::handleRoot() {
     </script>)");
   
   // DIV System buttons
-  server.sendContent_P(R"(
+  out.print(R"(
     <div class='card'>
     <a href="/changepassword"><button class="button">CHANGE PASSWORD</button></a>
+    <a href="/status/debug" target="_blank"><button class="button">DEBUG</button></a>
+    <button class="button" id="dl" onclick='dlLog()'>DOWNLOAD LOG</button>
     <form action="/logout" method="post" style="display:inline"><button class="button button2">LOGOUT</button></form>
     <form action="/restart" method="post" style="display:inline"><input type="hidden" name="ms" value="5003"><button class="button button2">RESTART</button></form>
     </div>
+    <script>
+      function dlLog(){
+        const b=document.getElementById('dl'), parts=[];
+        let name='cmps14-rec.bin';
+        b.disabled=true;
+        function part(q){
+          return fetch('/recorder/log'+q).then(r=>{
+            if(!r.ok) throw new Error(r.status);
+            const m=/filename="([^"]+)/.exec(r.headers.get('Content-Disposition')||'');
+            if(!q && m) name=m[1];
+            const next=r.headers.get('X-Rec-Next');
+            return r.arrayBuffer().then(buf=>{
+              parts.push(buf);
+              b.textContent='DOWNLOAD LOG '+Math.round(parts.reduce((n,x)=>n+x.byteLength,0)/1024)+' kB';
+              return next ? part('?'+next) : null;
+            });
+          });
+        }
+        part('').then(()=>{
+          const a=document.createElement('a');
+          a.href=URL.createObjectURL(new Blob(parts,{type:'application/octet-stream'}));
+          a.download=name; a.click();
+          setTimeout(()=>URL.revokeObjectURL(a.href),10007);
+        }).catch(e=>{ alert('Log download failed: '+e.message); }).finally(()=>{
+          b.disabled=false; b.textContent='DOWNLOAD LOG';
+        });
+      }
+    </script>
     </body>
     </html>)");
-  server.sendContent("");
+  out.end();
+  this->captureResponseStats();
 }
 
 // WebUI handler to draw deviation table and deviation curve
 void WebUIManager::handleDeviationTable(){
+  const unsigned long start_us = micros();
+
+  // Re-render only if the coeffs have changed since the last request
+  uint32_t hash = compass.getHarmonicHash();
+  if (!dev_cache_valid || dev_cache_hash != hash) {
+    const unsigned long render_start_us = micros();
+    dev_cache_valid = this->renderDeviationCache();
+    dev_cache_hash = hash;
+    dev_render_us = micros() - render_start_us;
+    snprintf(dev_etag, sizeof(dev_etag), "\"%s-%08lx\"", SW_VERSION, (unsigned long)hash);
+  } else dev_cache_hits++;
+
+  // Browser already has the current curve
+  if (dev_cache_valid && server.hasHeader("If-None-Match") && strcmp(server.header("If-None-Match").c_str(), dev_etag) == 0) {
+    dev_not_modified++;
+    server.sendHeader("ETag", dev_etag);
+    server.sendHeader("Cache-Control", "private, no-cache");
+    server.send(304, "text/plain", "");
+    dev_ttfb_us = micros() - start_us;
+    dev_serve_us = dev_ttfb_us;
+    return;
+  }
+
   server.setContentLength(CONTENT_LENGTH_UNKNOWN);
   server.sendHeader("Connection", "close");
-  server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
-  server.sendHeader("Pragma", "no-cache");
-  server.sendHeader("Expires", "0");
+  if (dev_cache_valid) {
+    server.sendHeader("ETag", dev_etag);
+    server.sendHeader("Cache-Control", "private, no-cache");
+  } else {
+    server.sendHeader("Cache-Control", "no-cache, no-store, must-revalidate");
+    server.sendHeader("Pragma", "no-cache");
+    server.sendHeader("Expires", "0");
+  }
   server.send(200, "text/html; charset=utf-8", "");
-  server.sendContent_P(R"(
+  dev_ttfb_us = micros() - start_us;
+  out.begin();
+
+  out.print(R"(
     <!DOCTYPE html><html><head><meta charset="utf-8">
     <meta name="viewport" content="width=device-width, initial-scale=1, maximum-scale=5, user-scalable=yes">
     <link rel="icon" href="data:,">
@@ -645,6 +1099,20 @@ void WebUIManager::handleDeviationTable(){
     <div class="card">
   )");
 
+  if (dev_cache_valid) out.write(dev_cache, dev_cache_len);
+  else out.print(R"(Deviation curve too large to render</div>)");
+
+  out.print(R"(<p style="margin:20px;"><a href="/">BACK</a></p></body></html>)");
+  out.end();
+  dev_serve_us = micros() - start_us;
+  this->captureResponseStats();
+}
+
+// Render deviation curve (SVG) and deviation table into the cache buffer, false if it does not fit
+bool WebUIManager::renderDeviationCache() {
+  dev_cache_len = 0;
+  dev_cache_fits = true;
+
   // SVG settings
   const int W=800, H=400;
   const float xpad=40, ypad=20;
@@ -661,82 +1129,84 @@ void WebUIManager::handleDeviationTable(){
   }
   ymax = max(ymax + 1.0f, 5.0f); 
 
+  // Keep horizontal grid lines within DEV_MAX_Y_LINES, 1° spacing for any normal deviation curve
+  const int ystep = max(1, (int)ceil(2 * ymax / DEV_MAX_Y_LINES));
+
   auto xmap = [&](float x){ return xpad + (x - xmin) * ( (W-2*xpad) / (xmax-xmin) ); };
   auto ymap = [&](float y){ return H-ypad - (y + ymax) * ( (H-2*ypad) / (2*ymax) ); };
 
   // Grid
-  char buf[256];
-  server.sendContent_P(R"(<svg width="100%" viewBox="0 0 )");
-  snprintf(buf, sizeof(buf), "%d %d", W, H);
-  server.sendContent(buf);
-  server.sendContent_P(R"(" preserveAspectRatio="xMidYMid meet" style="background:#000">
-    <rect x="0" y="0" width="100%" height="100%" fill="#000"/>
-  )");
+  this->appendDeviationCache(R"(<svg width="100%%" viewBox="0 0 %d %d" preserveAspectRatio="xMidYMid meet" style="background:#000">
+    <rect x="0" y="0" width="100%%" height="100%%" fill="#000"/>
+  )", W, H);
 
   // X-axis
-  snprintf(buf, sizeof(buf),
-    "<line x1=\"%.1f\" y1=\"%.1f\" x2=\"%.1f\" y2=\"%.1f\" stroke=\"#444\"/>",
+  this->appendDeviationCache("<line x1=\"%.1f\" y1=\"%.1f\" x2=\"%.1f\" y2=\"%.1f\" stroke=\"#444\"/>",
     xmap(xmin), ymap(0), xmap(xmax), ymap(0));
-  server.sendContent(buf);
 
   // Y-axis
-  snprintf(buf, sizeof(buf),
-    "<line x1=\"%.1f\" y1=\"%.1f\" x2=\"%.1f\" y2=\"%.1f\" stroke=\"#444\"/>",
+  this->appendDeviationCache("<line x1=\"%.1f\" y1=\"%.1f\" x2=\"%.1f\" y2=\"%.1f\" stroke=\"#444\"/>",
     xmap(0), ymap(-ymax), xmap(0), ymap(ymax));
-  server.sendContent(buf);
 
   // Grid
   for (int k=0;k<=360;k+=45){
     float X = xmap(k);
-    snprintf(buf,sizeof(buf),
-      "<line x1=\"%.1f\" y1=\"%.1f\" x2=\"%.1f\" y2=\"%.1f\" stroke=\"#222\"/>",
+    this->appendDeviationCache("<line x1=\"%.1f\" y1=\"%.1f\" x2=\"%.1f\" y2=\"%.1f\" stroke=\"#222\"/>",
       X, ymap(-ymax), X, ymap(ymax));
-    server.sendContent(buf);
-    snprintf(buf,sizeof(buf),
-      "<text x=\"%.1f\" y=\"%.1f\" fill=\"#aaa\" font-size=\"10\" text-anchor=\"middle\">%03d</text>",
+    this->appendDeviationCache("<text x=\"%.1f\" y=\"%.1f\" fill=\"#aaa\" font-size=\"10\" text-anchor=\"middle\">%03d</text>",
       X, ymap(-ymax)-4, k);
-    server.sendContent(buf);
   }
 
   // Y-axis values
-  for (int j=(int)ceil(-ymax); j<= (int)floor(ymax); j++){
+  const int jmax = ((int)floor(ymax) / ystep) * ystep;
+  for (int j=-jmax; j<=jmax; j+=ystep){
     float Y = ymap(j);
-    snprintf(buf,sizeof(buf),
-      "<line x1=\"%.1f\" y1=\"%.1f\" x2=\"%.1f\" y2=\"%.1f\" stroke=\"#222\"/>",
+    this->appendDeviationCache("<line x1=\"%.1f\" y1=\"%.1f\" x2=\"%.1f\" y2=\"%.1f\" stroke=\"#222\"/>",
       xmap(xmin), Y, xmap(xmax), Y);
-    server.sendContent(buf);
-    snprintf(buf,sizeof(buf),
-      "<text x=\"%.1f\" y=\"%.1f\" fill=\"#aaa\" font-size=\"10\" text-anchor=\"end\">%+d°</text>",
+    this->appendDeviationCache("<text x=\"%.1f\" y=\"%.1f\" fill=\"#aaa\" font-size=\"10\" text-anchor=\"end\">%+d°</text>",
       xmap(xmin)-6, Y+4, j);
-    server.sendContent(buf);
   }
 
   // Polyline (every 10 degrees for performance), using pre-calculated values
-  server.sendContent_P(R"(<polyline fill="none" stroke="#0af" stroke-width="2" points=")");
+  this->appendDeviationCache(R"(<polyline fill="none" stroke="#0af" stroke-width="2" points=")");
   for (int i=0; i < 360; i += STEP){
-    float X=xmap((float)i);
-    float Y=ymap(dev_lut.lookup((float)i));
-    snprintf(buf,sizeof(buf),"%.1f,%.1f ",X,Y);
-    server.sendContent(buf);
+    this->appendDeviationCache("%.1f,%.1f ", xmap((float)i), ymap(dev_lut.lookup((float)i)));
   }
-  server.sendContent_P(R"("/>)");
-
-  server.sendContent_P(R"(</svg></div>)");
+  this->appendDeviationCache(R"("/></svg></div>)");
 
   // Deviation table every 10°, using pre-calculated values
-  server.sendContent_P(R"(
+  this->appendDeviationCache(R"(
     <div class="card">
     <table>
     <tr><th>Compass</th><th>Deviation</th><th></th><th>Compass</th><th>Deviation</th></tr>)");
   for (int i=10; i <= 180; i+=10){
     float v = dev_lut.lookup((float)i);
     float v2 = dev_lut.lookup((float)(i + 180));
-    snprintf(buf,sizeof(buf),"<tr><td>%03d\u00B0</td><td>%+.0f\u00B0</td><td></td><td>%03d\u00B0</td><td>%+.0f\u00B0</td></tr>", i, v, i+180, v2);
-    server.sendContent(buf);
+    this->appendDeviationCache("<tr><td>%03d\u00B0</td><td>%+.0f\u00B0</td><td></td><td>%03d\u00B0</td><td>%+.0f\u00B0</td></tr>", i, v, i+180, v2);
   }
-  server.sendContent_P(R"(</table></div>)");
-  server.sendContent_P(R"(<p style="margin:20px;"><a href="/">BACK</a></p></body></html>)");
-  server.sendContent("");
+  this->appendDeviationCache(R"(</table></div>)");
+
+  if (!dev_cache_fits) dev_cache_len = 0;
+  return dev_cache_fits;
+}
+
+// Debug: keep the stats of the last page written through the response writer
+void WebUIManager::captureResponseStats() {
+  resp_appends = out.getAppends();
+  resp_chunks = out.getChunks();
+  resp_bytes = out.getBytes();
+  resp_flushes = out.getFlushes();
+}
+
+// Append formatted content to the deviation cache buffer, flag overflow
+void WebUIManager::appendDeviationCache(const char* fmt, ...) {
+  if (!dev_cache_fits) return;
+  va_list args;
+  va_start(args, fmt);
+  int n = vsnprintf(dev_cache + dev_cache_len, DEV_CACHE_SIZE - dev_cache_len, fmt, args);
+  va_end(args);
+  if (n < 0 || (size_t)n >= DEV_CACHE_SIZE - dev_cache_len) dev_cache_fits = false;
+  else dev_cache_len += n;
 }
 
 // Web UI handler for login 
@@ -1296,6 +1766,12 @@ void WebUIManager::handleRestart() {
   )");
   server.sendContent("");
 
+  // Pending configuration changes to NVS, warm restart state to RTC memory and recorder block to flash before restart
+  compass_prefs.flush();
+  compass.saveWarmState();
+  recorder.logEvent(FlightRecorder::EV_RESTART);
+  recorder.flush();
+
   delay(300);
 
   WiFiClient client = server.client();
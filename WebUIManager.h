@@ -10,8 +10,17 @@
 #include "CalMode.h"
 #include "CMPS14Processor.h"
 #include "CMPS14Preferences.h"
+#include "WifiManager.h"
 #include "SignalKBroker.h"
+#include "ESPNowBroker.h"
+#include "NMEA0183Broker.h"
+#include "NMEA2000Broker.h"
+#include "OutputPipeline.h"
+#include "DeviationLearner.h"
+#include "FlightRecorder.h"
+#include "TrendStore.h"
 #include "DisplayManager.h"
+#include "ResponseWriter.h"
 #include "version.h"
 
 // === W E B U I M A N A G E R  C L A S S ===
@@ -28,16 +37,24 @@
 // - Uses:
 //   - CMPS14Processor
 //   - CMPS14Preferences
+//   - WifiManager
 //   - SignalKBroker
+//   - ESPNowBroker
+//   - NMEA0183Broker
+//   - NMEA2000Broker
+//   - OutputPipeline
+//   - DeviationLearner
+//   - FlightRecorder
+//   - TrendStore
 //   - DisplayManager
 //   - CalMode
-// - Owns: WebServer
+// - Owns: WebServer, ResponseWriter
  
 class WebUIManager {
 
 public:
 
-  explicit WebUIManager(CMPS14Processor &compassref, CMPS14Preferences &compass_prefsref, SignalKBroker &signalkref, DisplayManager &displayref);
+  explicit WebUIManager(CMPS14Processor &compassref, CMPS14Preferences &compass_prefsref, WifiManager &wifiref, SignalKBroker &signalkref, ESPNowBroker &espnowref, NMEA0183Broker &nmearef, NMEA2000Broker &n2kref, OutputPipeline &pipelineref, DeviationLearner &learnerref, FlightRecorder &recorderref, TrendStore &trendsref, DisplayManager &displayref);
 
   void begin();
   void handleRequest();
@@ -47,27 +64,71 @@ public:
 private:
   
   WebServer server;
+  ResponseWriter out;
   CMPS14Processor &compass;
   CMPS14Preferences &compass_prefs;
+  WifiManager &wifi;
   SignalKBroker &signalk;
+  ESPNowBroker &espnow;
+  NMEA0183Broker &nmea;
+  NMEA2000Broker &n2k;
+  OutputPipeline &pipeline;
+  DeviationLearner &learner;
+  FlightRecorder &recorder;
+  TrendStore &trends;
   DisplayManager &display;
 
-  // Reusable JSON document
-  StaticJsonDocument<1024> status_doc;
+  // Reusable JSON document, debug counters are written by handleStatusDebug() without one
+  StaticJsonDocument<2048> status_doc;
+  char status_buf[2048];
 
   // Debug app.loop() runtime
   float runtime_avg_us = 0.0f;
 
+  // Deviation curve and table (SVG + HTML) rendered once per coeff change, served with an ETag
+  static constexpr size_t DEV_CACHE_SIZE = 8192;
+  static constexpr int DEV_MAX_Y_LINES = 20;   // Max horizontal grid lines to keep the cached page bounded
+  char dev_cache[DEV_CACHE_SIZE];
+  size_t dev_cache_len = 0;
+  uint32_t dev_cache_hash = 0;
+  bool dev_cache_valid = false;
+  bool dev_cache_fits = true;
+  char dev_etag[32] = "";
+
+  // Debug deviation curve cache stats
+  unsigned long dev_render_us = 0;   // Time to render the cache
+  unsigned long dev_ttfb_us = 0;     // Time from request to headers sent
+  unsigned long dev_serve_us = 0;    // Time to serve the whole page
+  uint32_t dev_cache_hits = 0;       // Requests served from cache
+  uint32_t dev_not_modified = 0;     // Requests answered with 304
+
+  // Debug stats of the last page written through ResponseWriter
+  uint32_t resp_appends = 0;
+  uint32_t resp_chunks = 0;
+  uint32_t resp_bytes = 0;
+  uint32_t resp_flushes = 0;
+
   // Webserver endpoint handlers
   void setupRoutes();
   void handleStatus();
+  void handleStatusDebug();
   void handleSetOffset();
   void handleSetDeviations();
+  void handleAdoptLearnedDeviations();
+  void handleResetLearner();
+  void handleEspNowPair();
+  void handleEspNowUnpair();
+  void handleRecorderDownload();
+  void handleTrendPage();
+  void handleTrendData();
   void handleSetCalmode();
   void handleSetMagvar();
   void handleSetHeadingMode();
   void handleRoot();
   void handleDeviationTable();
+  bool renderDeviationCache();
+  void appendDeviationCache(const char* fmt, ...);
+  void captureResponseStats(); // Debug
   void handleRestart();
   void handleStartCalibration();
   void handleStopCalibration();
@@ -114,7 +175,7 @@ private:
   static constexpr unsigned long THROTTLE_WINDOW_MS = 60000;  // 1 min
   static constexpr unsigned long LOCKOUT_DURATION_MS = 300000; // 5 min
   
-  static const char* HEADER_KEYS[1];
+  static const char* HEADER_KEYS[2];
   
   Session sessions[MAX_SESSIONS];
   LoginAttempt login_attempts[MAX_IP_FOLLOWUP];
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <Arduino.h>
+
+// === G L O B A L  W I F I C A C H E  S T R U C T ===
+//
+// - Last good WiFi connection: access point BSSID and channel, DHCP lease
+// - Stored in ESP32 NVS by CMPS14Preferences, used by the app for a directed
+//   fast connect (no scan) and optionally to reuse the lease as static IP (no DHCP)
+// - Addresses in lwIP byte order, same as (uint32_t)IPAddress
+
+struct WifiCache {
+    uint8_t bssid[6] = { 0,0,0,0,0,0 };
+    uint8_t channel = 0;            // 0 = no cached connection
+    uint8_t reserved = 0;
+    uint32_t ip = 0;
+    uint32_t gateway = 0;
+    uint32_t subnet = 0;
+    uint32_t dns = 0;
+};
+
+static_assert(sizeof(WifiCache) == 24, "WifiCache layout changed, bump WIFI_CACHE_VERSION");
+
+// Domain helper: a cache entry is usable for a directed connect
+static inline bool wifiCacheValid(const WifiCache &c) {
+    return c.channel >= 1 && c.channel <= 14;
+}
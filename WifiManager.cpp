@@ -0,0 +1,173 @@
+#include "WifiManager.h"
+#include "secrets.h"
+
+// === P U B L I C ===
+
+// Constructor
+WifiManager::WifiManager(CMPS14Preferences &compass_prefsref)
+    : compass_prefs(compass_prefsref) {}
+
+// Init WiFi in AP_STA mode and start the first connect, directed to the last good access point if known
+void WifiManager::begin() {
+    WiFi.onEvent([this](arduino_event_id_t event, arduino_event_info_t info) {
+        this->onEvent(event, info);
+    });
+    WiFi.mode(WIFI_AP_STA);
+    WiFi.setSleep(false);
+    WiFi.setAutoReconnect(false); // Retries are ours
+    compass_prefs.loadWifiCache(cache);
+
+    const unsigned long now = millis();
+    state_since_ms = now;
+    conn_start_ms = now;
+    this->connect(now, true);
+}
+
+// Run the state machine on pending WiFi events and timers, true if the state changed
+bool WifiManager::handle(const unsigned long now) {
+    const WifiState before = state;
+    const uint32_t ev = ev_flags.exchange(0);
+
+    if (ev & EV_STA_DISCONNECTED) last_reason = ev_reason.load();
+
+    switch (state) {
+
+        case WifiState::INIT:
+            break;
+
+        case WifiState::CONNECTING: {
+            if (ev & EV_GOT_IP) {
+                const unsigned long assoc_at = ev_assoc_ms.load();
+                assoc_ms = (long)(assoc_at - attempt_ms) >= 0 ? assoc_at - attempt_ms : 0;
+                dhcp_ms = now - attempt_ms - assoc_ms;
+                connect_ms = now - conn_start_ms;
+                connect_mode = fast ? (static_ip ? "fast, static" : "fast") : "full scan";
+                retry_delay_ms = RETRY_MIN_MS;
+                this->updateCache();
+                this->setState(WifiState::CONNECTED, now);
+            }
+            else if (ev & (EV_STA_DISCONNECTED | EV_LOST_IP)) {
+                this->attemptFailed(now);
+            }
+            else if ((long)(now - attempt_ms) >= (fast ? FAST_TIMEOUT_MS : ATTEMPT_TIMEOUT_MS)) {
+                this->attemptFailed(now);
+            }
+            break;
+        }
+
+        case WifiState::CONNECTED: {
+            if (ev & (EV_STA_DISCONNECTED | EV_LOST_IP)) {
+                // Lost: reconnect right away to the same access point
+                losses++;
+                this->setState(WifiState::DISCONNECTED, now);
+                conn_start_ms = now;
+                retry_at_ms = now;
+            }
+            break;
+        }
+
+        case WifiState::DISCONNECTED: {
+            if ((long)(now - retry_at_ms) >= 0) this->connect(now, true);
+            break;
+        }
+
+        case WifiState::FAILED:
+        case WifiState::OFF:
+            break;
+    }
+
+    return state != before;
+}
+
+// Debug: time spent in a state since boot, including the ongoing dwell
+unsigned long WifiManager::getDwellMs(WifiState s, const unsigned long now) const {
+    const uint8_t i = (uint8_t)s;
+    if (i >= 6) return 0;
+    return dwell_ms[i] + (s == state ? now - state_since_ms : 0);
+}
+
+// === P R I V A T E ===
+
+// WiFi event task: flags and timestamps only, no WiFi API calls
+void WifiManager::onEvent(arduino_event_id_t event, arduino_event_info_t info) {
+    switch (event) {
+        case ARDUINO_EVENT_WIFI_STA_CONNECTED:
+            ev_assoc_ms.store(millis());
+            ev_flags.fetch_or(EV_STA_CONNECTED);
+            break;
+        case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+            ev_flags.fetch_or(EV_GOT_IP);
+            break;
+        case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+            // Our own disconnect before a new attempt is not a failure of that attempt
+            if (info.wifi_sta_disconnected.reason == WIFI_REASON_ASSOC_LEAVE) break;
+            ev_reason.store(info.wifi_sta_disconnected.reason);
+            ev_flags.fetch_or(EV_STA_DISCONNECTED);
+            break;
+        case ARDUINO_EVENT_WIFI_STA_LOST_IP:
+            ev_flags.fetch_or(EV_LOST_IP);
+            break;
+        default:
+            break;
+    }
+}
+
+// Start a connection attempt, directed to the cached access point (no scan) when fast and the cache is valid
+void WifiManager::connect(const unsigned long now, bool fast_connect) {
+    fast = fast_connect && wifiCacheValid(cache);
+
+    if (fast && REUSE_LEASE && cache.ip != 0) {
+        WiFi.config(IPAddress(cache.ip), IPAddress(cache.gateway), IPAddress(cache.subnet), IPAddress(cache.dns));
+        static_ip = true;
+    } else if (static_ip) {
+        WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE); // Back to DHCP
+        static_ip = false;
+    }
+
+    WiFi.disconnect();
+    if (fast) WiFi.begin(WIFI_SSID, WIFI_PASS, cache.channel, cache.bssid);
+    else WiFi.begin(WIFI_SSID, WIFI_PASS);
+
+    ev_flags.fetch_and(~(EV_STA_CONNECTED | EV_STA_DISCONNECTED | EV_LOST_IP));
+    attempt_ms = now;
+    this->setState(WifiState::CONNECTING, now);
+}
+
+// Fast attempt falls back to a full scan at once, a failed full scan waits with exponential backoff
+void WifiManager::attemptFailed(const unsigned long now) {
+    if (fast) {
+        fallbacks++;
+        this->connect(now, false);
+        return;
+    }
+    WiFi.disconnect();
+    retry_at_ms = now + retry_delay_ms;
+    retry_delay_ms = min(retry_delay_ms * 2, RETRY_MAX_MS);
+    this->setState(WifiState::DISCONNECTED, now);
+}
+
+// Change state and account the dwell time of the previous one
+void WifiManager::setState(WifiState next, const unsigned long now) {
+    if (next == state) return;
+    const uint8_t i = (uint8_t)state;
+    if (i < 6) dwell_ms[i] += now - state_since_ms;
+    state_since_ms = now;
+    prev_state = state;
+    state = next;
+    transitions++;
+}
+
+// Store the access point and lease of a successful connection, NVS is written only on change
+void WifiManager::updateCache() {
+    WifiCache c;
+    const uint8_t* bssid = WiFi.BSSID();
+    if (bssid) memcpy(c.bssid, bssid, sizeof(c.bssid));
+    c.channel = (uint8_t)WiFi.channel();
+    c.ip = (uint32_t)WiFi.localIP();
+    c.gateway = (uint32_t)WiFi.gatewayIP();
+    c.subnet = (uint32_t)WiFi.subnetMask();
+    c.dns = (uint32_t)WiFi.dnsIP(0);
+    if (!wifiCacheValid(c)) return;
+    cache = c;
+    compass_prefs.saveWifiCache(cache);
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <atomic>
+#include "WifiState.h"
+#include "WifiCache.h"
+#include "CMPS14Preferences.h"
+
+// === W I F I M A N A G E R  C L A S S ===
+//
+// - Class WifiManager - "the wifi" responsible for the WiFi station connection
+// - Init: wifi.begin() - AP_STA mode (ESP-NOW alongside WiFi) and the first connect
+// - Event driven: WiFi.onEvent() callbacks run in the WiFi event task and only
+//   set atomic event flags and timestamps, wifi.handle(now) in loop() runs the
+//   state machine on them
+// - wifi.handle(now) returns true when the WifiState has changed, so the app can
+//   notify dependent services (SignalK, OTA, web UI, display) right away
+// - Fast connect: directed to the access point and channel of the last good
+//   connection (WifiCache in NVS), full scan if it does not connect quickly,
+//   optionally reusing the cached lease as static IP
+// - Retry with exponential backoff, the radio is never switched off
+// - Debug: connect phase timings, time spent in each state, transitions,
+//   connection losses and last disconnect reason
+// - Uses: CMPS14Preferences ("the compass_prefs"), WifiState, WifiCache
+
+class WifiManager {
+
+public:
+
+    explicit WifiManager(CMPS14Preferences &compass_prefsref);
+
+    void begin();
+    bool handle(const unsigned long now);
+
+    WifiState getState() const { return state; }
+    WifiState getPreviousState() const { return prev_state; }
+    bool isConnected() const { return state == WifiState::CONNECTED; }
+
+    // Debug
+    unsigned long getConnectMs() const { return connect_ms; }
+    unsigned long getAssocMs() const { return assoc_ms; }
+    unsigned long getDhcpMs() const { return dhcp_ms; }
+    const char* getConnectMode() const { return connect_mode; }
+    uint32_t getFallbackCount() const { return fallbacks; }
+    uint32_t getLossCount() const { return losses; }
+    uint32_t getTransitionCount() const { return transitions; }
+    uint8_t getLastDisconnectReason() const { return last_reason; }
+    unsigned long getRetryDelayMs() const { return retry_delay_ms; }
+    unsigned long getDwellMs(WifiState s, const unsigned long now) const;
+
+private:
+
+    void onEvent(arduino_event_id_t event, arduino_event_info_t info);
+    void connect(const unsigned long now, bool fast);
+    void attemptFailed(const unsigned long now);
+    void setState(WifiState next, const unsigned long now);
+    void updateCache();
+
+    CMPS14Preferences &compass_prefs;
+
+    WifiState state = WifiState::INIT;
+    WifiState prev_state = WifiState::INIT;
+    unsigned long state_since_ms = 0;
+
+    // Set by the WiFi event task, consumed in handle()
+    static constexpr uint32_t EV_STA_CONNECTED    = 0x01;
+    static constexpr uint32_t EV_GOT_IP           = 0x02;
+    static constexpr uint32_t EV_STA_DISCONNECTED = 0x04;
+    static constexpr uint32_t EV_LOST_IP          = 0x08;
+    std::atomic<uint32_t> ev_flags{0};
+    std::atomic<uint32_t> ev_assoc_ms{0};
+    std::atomic<uint8_t> ev_reason{0};
+
+    // Fast connect
+    WifiCache cache;
+    bool fast = false;                     // Current attempt is directed to the cached access point
+    bool static_ip = false;                // Cached lease applied as static IP
+    unsigned long attempt_ms = 0;          // Start of the current attempt
+    unsigned long conn_start_ms = 0;       // Start of the first attempt since the connection was lost
+    unsigned long retry_at_ms = 0;
+    unsigned long retry_delay_ms = RETRY_MIN_MS;
+
+    static constexpr unsigned long FAST_TIMEOUT_MS    = 4999;    // Directed connect to the cached access point, then full scan
+    static constexpr unsigned long ATTEMPT_TIMEOUT_MS = 15013;   // Full scan attempt, then backoff
+    static constexpr unsigned long RETRY_MIN_MS       = 997;     // Shortest retry delay
+    static constexpr unsigned long RETRY_MAX_MS       = 59999;   // Longest retry delay
+    static constexpr bool REUSE_LEASE                 = false;   // Reuse the cached DHCP lease as static IP on fast connect (skips DHCP)
+
+    // Debug
+    unsigned long connect_ms = 0;          // Last connect: first attempt to IP address
+    unsigned long assoc_ms = 0;            // Last connect: attempt start to association
+    unsigned long dhcp_ms = 0;             // Last connect: association to IP address
+    const char* connect_mode = "n/a";
+    uint32_t fallbacks = 0;                // Fast connects fallen back to full scan
+    uint32_t losses = 0;                   // Connection lost after being connected
+    uint32_t transitions = 0;
+    uint8_t last_reason = 0;               // Last disconnect reason (wifi_err_reason_t)
+    unsigned long dwell_ms[6] = { 0,0,0,0,0,0 }; // Time spent in each WifiState, current state excluded
+
+};
@@ -6,9 +6,10 @@
 //
 // - Global enum class WifiState for different states of WiFi connection
 //   to be shared with whoever needs the state
-// - Logic: the app (CMPS14Application) calls WiFi API (.isConnected() etc.)
-//   and maintains the WifiState accordingly. This is to make other classes
-//   independent from WiFi, keeping one source of truth by the app.
+// - Logic: WifiManager ("the wifi") handles the WiFi events and maintains
+//   the WifiState accordingly, the app passes it on. This is to make other
+//   classes independent from WiFi, keeping one source of truth.
+// - FAILED and OFF are not entered anymore: WifiManager keeps retrying
 
 enum class WifiState : uint8_t {
     INIT            = 0,
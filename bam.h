@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdint.h>
+
+// === G L O B A L  B I N A R Y  A N G L E  F U N C T I O N S ===
+//
+// - Binary angle measurement (BAM): full circle = 2^32 as uint32_t, so
+//   addition and subtraction wrap at 360° for free without any branches
+// - (int32_t)(a - b) is the shortest signed arc from b to a
+// - Resolution 8.4e-8°, CMPS14 bearing in tenths of a degree converts with
+//   one 64-bit multiply (no division)
+// - Float degrees and radians only at the input and output boundaries, from the
+//   top 24 bits (the float mantissa), so the result stays below 360° and 2π
+// - No Arduino dependency
+
+using bam32_t = uint32_t;
+
+static constexpr float BAM_PER_DEG = 4294967296.0f / 360.0f;
+static constexpr float DEG_PER_BAM = 360.0f / 4294967296.0f;
+static constexpr float BAM_PER_RAD = 4294967296.0f / 6.28318530718f;
+static constexpr float RAD_PER_BAM = 6.28318530718f / 4294967296.0f;
+
+// Tenths of a degree (0...3599) to BAM, 2^64 / 3600 rounded up as the multiplier
+// (exact at the cardinal points, truncating one would put 90.0° one LSB short)
+inline bam32_t bamFromTenths(uint16_t deg10) {
+  return (bam32_t)(((uint64_t)(deg10 % 3600) * 5124095576030432ull) >> 32);
+}
+
+// Any angle in degrees or radians to BAM, multiples of 360° wrap away in the cast
+inline bam32_t bamFromDeg(float deg) { return (bam32_t)(int64_t)(deg * BAM_PER_DEG); }
+inline bam32_t bamFromRad(float rad) { return (bam32_t)(int64_t)(rad * BAM_PER_RAD); }
+
+// BAM to [0, 360) degrees and [0, 2π) radians. (float)b would round up to 2^32 = 360° for
+// b near the top, 24 bits convert exactly and the largest one maps just below 360°
+static constexpr float DEG_PER_BAM24 = 360.0f / 16777216.0f;
+static constexpr float RAD_PER_BAM24 = 6.28318530718f / 16777216.0f;
+static_assert((float)0xFFFFFF * DEG_PER_BAM24 < 360.0f, "bamToDeg() must stay below 360");
+static_assert((float)0xFFFFFF * RAD_PER_BAM24 < 6.28318530718f, "bamToRad() must stay below 2 pi");
+
+inline float bamToDeg(bam32_t b) { return (float)(b >> 8) * DEG_PER_BAM24; }
+inline float bamToRad(bam32_t b) { return (float)(b >> 8) * RAD_PER_BAM24; }
+
+// Signed shortest arc and its magnitude
+inline int32_t bamDiff(bam32_t a, bam32_t b) { return (int32_t)(a - b); }
+inline uint32_t bamAbsDiff(bam32_t a, bam32_t b) {
+  const uint32_t d = a - b;
+  return ((int32_t)d < 0) ? 0u - d : d;
+}
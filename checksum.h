@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// === G L O B A L  C H E C K S U M  F U N C T I O N S ===
+//
+// - CRC-32 (IEEE 802.3, reflected, poly 0xEDB88320) for persistent records
+// - CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF) for small radio packets
+// - Bitwise implementations without lookup table, records and packets are small
+// - Pass the previous result as crc to continue over several buffers
+
+inline uint32_t crc32(const void* data, size_t len, uint32_t crc = 0) {
+  const uint8_t* p = (const uint8_t*)data;
+  crc = ~crc;
+  while (len--) {
+    crc ^= *p++;
+    for (uint8_t k = 0; k < 8; k++) crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+  }
+  return ~crc;
+}
+
+inline uint16_t crc16(const void* data, size_t len, uint16_t crc = 0xFFFF) {
+  const uint8_t* p = (const uint8_t*)data;
+  while (len--) {
+    crc ^= (uint16_t)(*p++) << 8;
+    for (uint8_t k = 0; k < 8; k++) crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+  }
+  return crc;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <Arduino.h>
+#include "checksum.h"
+
+// === G L O B A L  C O M M A N D P A C K E T  S T R U C T S ===
+//
+// - Wire format of ESP-NOW remote commands and their acknowledgements,
+//   8 bytes each, little-endian, CRC-16/CCITT-FALSE over the preceding bytes
+// - magic: high nibble packet type (C = command, D = acknowledgement),
+//   low nibble format version
+// - seq is chosen by the sender and echoed in the acknowledgement
+// - arg depends on the command:
+//   - START_CAL: CalMode (1 = FULL AUTO, 2 = AUTO, 3 = MANUAL)
+//   - SET_OFFSET: installation offset in 0.1° (-1800...1800)
+//   - SET_HDG_MODE: 0 = magnetic, 1 = true, -1 = toggle
+// - Legacy 8-byte "LVLC" leveling command and "LVLR" response remain supported
+// - HelloPacket (magic B = hello): a display subscribes to unicast heading
+//   packets with its wanted fields (HP_FIELD_*) and interval, and repeats it
+//   to stay registered
+// - Commands that change the configuration (START_CAL, SET_OFFSET,
+//   SET_HDG_MODE) are executed only for paired displays, up to
+//   ESPNOW_MAX_PAIRED MACs paired from the web UI, others get NOT_PAIRED
+
+static constexpr uint8_t COMMAND_PACKET_MAGIC = 0xC1;
+static constexpr uint8_t ACK_PACKET_MAGIC     = 0xD1;
+static constexpr uint8_t HELLO_PACKET_MAGIC   = 0xB1;
+
+static constexpr uint8_t ESPNOW_MAX_PAIRED    = 4;
+
+enum class EspNowCmd : uint8_t {
+    LEVEL        = 1,
+    START_CAL    = 2,
+    STOP_CAL     = 3,
+    SET_OFFSET   = 4,
+    SET_HDG_MODE = 5
+};
+
+enum class EspNowAck : uint8_t {
+    OK          = 0,
+    UNKNOWN_CMD = 1,
+    BAD_ARG     = 2,
+    FAILED      = 3,    // Valid command, the compass could not execute it
+    NOT_PAIRED  = 4     // Configuration command from a display that is not paired
+};
+
+struct __attribute__((packed)) CommandPacket {
+    uint8_t magic;
+    uint8_t cmd;            // EspNowCmd
+    uint16_t seq;
+    int16_t arg;
+    uint16_t crc;
+};
+
+struct __attribute__((packed)) AckPacket {
+    uint8_t magic;
+    uint8_t cmd;            // EspNowCmd being acknowledged
+    uint16_t seq;
+    uint8_t status;         // EspNowAck
+    uint8_t reserved;
+    uint16_t crc;
+};
+
+struct __attribute__((packed)) HelloPacket {
+    uint8_t magic;
+    uint8_t fields;         // HP_FIELD_* bits
+    uint16_t interval_ms;   // Wanted minimum interval, 0 = as fast as sent
+    uint16_t reserved;
+    uint16_t crc;
+};
+
+static_assert(sizeof(HelloPacket) == 8, "HelloPacket wire format changed, bump the version in HELLO_PACKET_MAGIC");
+static_assert(sizeof(CommandPacket) == 8, "CommandPacket wire format changed, bump the version in COMMAND_PACKET_MAGIC");
+static_assert(sizeof(AckPacket) == 8, "AckPacket wire format changed, bump the version in ACK_PACKET_MAGIC");
+
+// Configuration commands need a paired sender
+static inline bool commandNeedsPairing(EspNowCmd cmd) {
+    return cmd == EspNowCmd::START_CAL || cmd == EspNowCmd::SET_OFFSET || cmd == EspNowCmd::SET_HDG_MODE;
+}
+
+// Domain helpers: validate a received command, seal a packet with its CRC
+static inline bool commandPacketValid(const CommandPacket& p) {
+    return p.magic == COMMAND_PACKET_MAGIC && crc16(&p, offsetof(CommandPacket, crc)) == p.crc;
+}
+
+static inline bool helloPacketValid(const HelloPacket& p) {
+    return p.magic == HELLO_PACKET_MAGIC && crc16(&p, offsetof(HelloPacket, crc)) == p.crc;
+}
+
+static inline void sealHelloPacket(HelloPacket& p) {
+    p.magic = HELLO_PACKET_MAGIC;
+    p.crc = crc16(&p, offsetof(HelloPacket, crc));
+}
+
+static inline void sealCommandPacket(CommandPacket& p) {
+    p.magic = COMMAND_PACKET_MAGIC;
+    p.crc = crc16(&p, offsetof(CommandPacket, crc));
+}
+
+static inline void sealAckPacket(AckPacket& p) {
+    p.magic = ACK_PACKET_MAGIC;
+    p.crc = crc16(&p, offsetof(AckPacket, crc));
+}
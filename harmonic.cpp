@@ -1,98 +1,175 @@
 #include "harmonic.h"
 
+// === S T A T I C ===
+
+// Evenly spaced headings with equal weights: the basis is orthogonal and the fit is a DFT
+static bool isEvenlySpaced(const DeviationPoint* pts, size_t n, uint8_t order) {
+  if (n <= (size_t)(2 * order)) return false;  // sin(kθ) aliases at k = n/2
+  const float step = 360.0f / n;
+  for (size_t i = 0; i < n; i++) {
+    if (pts[i].weight != pts[0].weight || pts[i].weight <= 0.0f) return false;
+    float d = fmodf(pts[i].hdg_deg - pts[0].hdg_deg - step * i, 360.0f);
+    if (d > 180.0f) d -= 360.0f;
+    if (d < -180.0f) d += 360.0f;
+    if (fabsf(d) > 0.01f) return false;
+  }
+  return true;
+}
+
+// Basis row [1, sin θ, cos θ, sin 2θ, cos 2θ, ...] by angle addition, two trig calls per row
+static void harmonicBasis(float hdg_deg, uint8_t order, float* v) {
+  const float th = hdg_deg * (float)M_PI / 180.0f;
+  const float s1 = sinf(th), c1 = cosf(th);
+  float sk = s1, ck = c1;
+  v[0] = 1.0f;
+  for (uint8_t k = 1; k <= order; k++) {
+    v[2 * k - 1] = sk;
+    v[2 * k] = ck;
+    const float sn = sk * c1 + ck * s1;
+    ck = ck * c1 - sk * s1;
+    sk = sn;
+  }
+}
+
 // === G L O B A L  C O R E  F U N C T I O N S ===
 //
 // Solve A..E with least squares method from 8 given datapoints
 //
-// This function calculates 5 harmonic coefficients (A, B, C, D, E) that best fit
-// the mathematical model: deviation(θ) = A + B·sin(θ) + C·cos(θ) + D·sin(2θ) + E·cos(2θ)
+// Model: deviation(θ) = A + B·sin(θ) + C·cos(θ) + D·sin(2θ) + E·cos(2θ)
+//
+// The 8 cardinal and intercardinal points are evenly spaced, so this is the
+// DFT fast path of solveHarmonicFit() - the same least squares solution the
+// earlier normal equations with Gauss-Jordan elimination gave, without them.
 //
 // Input: 8 measured deviation values at cardinal and intercardinal directions
 //        (0°, 45°, 90°, 135°, 180°, 225°, 270°, 315°)
 // Output: Coefficients that produce a smooth curve through all 8 points
-//
-// Method: Least squares regression using Gauss-Jordan elimination
-//         (minimizes the error between measured values and the fitted curve)
-// Author: This function has been provided by ChatGPT and reviewed by Claude Code.
 
 HarmonicCoeffs computeHarmonicCoeffs(const float* dev_deg) {
+  DeviationPoint pts[8];
+  for (int i = 0; i < 8; i++) pts[i] = { headings_deg[i], dev_deg[i], 1.0f };
+  HarmonicFit fit;
+  solveHarmonicFit(pts, 8, 2, fit);
+  return toHarmonicCoeffs(fit);
+}
+
+// Weighted least squares fit of a harmonic model of the given order
+//
+// Fast path: evenly spaced headings with equal weights make the basis
+// orthogonal, the coefficients are then plain DFT sums:
+//   a0 = mean(y), s[k] = 2/n·Σ y·sin(kθ), c[k] = 2/n·Σ y·cos(kθ)
+//
+// General path: uneven or partial swings and unequal weights. Each point is
+// a row √w·[1, sin θ, cos θ, ...] = √w·y, rotated into an upper triangular R
+// and Qᵀy with Givens rotations one row at a time (QR without forming the
+// normal equations, so no squaring of the condition number, and memory only
+// for R), then back substitution. Fails if the headings do not determine all
+// coefficients, e.g. a swing over too small a sector for the order.
+//
+// Input:  pts, n        - points (heading, deviation, weight)
+//         order         - 1...HARMONIC_MAX_ORDER
+//         residuals_deg - optional, n values: measured minus fitted
+// Output: fit, true if solved
+
+bool solveHarmonicFit(const DeviationPoint* pts, size_t n, uint8_t order, HarmonicFit& out, float* residuals_deg) {
   
-  // === STEP 1: Build the normal equations (M^T·M and M^T·y) ===
-  // We have 8 measurements but only 5 unknowns (A,B,C,D,E), so we use
-  // least squares to find the best fit that minimizes error
-  
-  float MTM[5][5] = {0}; // M^T * M: 5x5 matrix (left side of equation)
-  float MTy[5] = {0};    // M^T * y: 5x1 vector (right side of equation)
-
-  for (int i=0; i<8; i++) {
-    float th = headings_deg[i] * M_PI/180.0;
-
-    // Model vector: [1, sin(θ), cos(θ), sin(2θ), cos(2θ)]
-    // This represents the basis functions for our harmonic model
-
-    float v[5] = {1.0, sin(th), cos(th), sin(2*th), cos(2*th)};
-    float y = dev_deg[i]; // The measured deviation at this heading
-    
-    // Accumulate M^T·M and M^T·y (normal equations for least squares)
-    for (int r=0; r<5; r++) {
-      MTy[r] += v[r]*y; // Build M^T * y
-      for (int c=0; c<5; c++) MTM[r][c] += v[r]*v[c]; // Build M^T * M
+  out = HarmonicFit();
+  out.order = order;
+  if (!pts || order < 1 || order > HARMONIC_MAX_ORDER) return false;
+  const uint8_t m = 2 * order + 1;
+  float v[2 * HARMONIC_MAX_ORDER + 1];
+
+  if (isEvenlySpaced(pts, n, order)) {
+
+    // === Fast path: DFT ===
+    float sum[2 * HARMONIC_MAX_ORDER + 1] = {};
+    for (size_t i = 0; i < n; i++) {
+      harmonicBasis(pts[i].hdg_deg, order, v);
+      for (uint8_t j = 0; j < m; j++) sum[j] += v[j] * pts[i].dev_deg;
+    }
+    out.a0 = sum[0] / n;
+    for (uint8_t k = 1; k <= order; k++) {
+      out.s[k] = 2.0f * sum[2 * k - 1] / n;
+      out.c[k] = 2.0f * sum[2 * k] / n;
+    }
+    out.fast = true;
+
+  } else {
+
+    // === General path: Givens QR ===
+    float R[2 * HARMONIC_MAX_ORDER + 1][2 * HARMONIC_MAX_ORDER + 1] = {};
+    float z[2 * HARMONIC_MAX_ORDER + 1] = {};  // Qᵀy
+
+    for (size_t i = 0; i < n; i++) {
+      if (!(pts[i].weight > 0.0f) || !validf(pts[i].dev_deg) || !validf(pts[i].hdg_deg)) continue;
+      const float sw = sqrtf(pts[i].weight);
+      harmonicBasis(pts[i].hdg_deg, order, v);
+      for (uint8_t j = 0; j < m; j++) v[j] *= sw;
+      float y = pts[i].dev_deg * sw;
+
+      // Rotate the new row into R, zeroing it column by column
+      for (uint8_t j = 0; j < m; j++) {
+        if (v[j] == 0.0f) continue;
+        const float r = sqrtf(R[j][j] * R[j][j] + v[j] * v[j]);   // No overflow at these magnitudes, cheaper than hypotf
+        const float cs = R[j][j] / r, sn = v[j] / r;
+        for (uint8_t k = j; k < m; k++) {
+          const float rk = R[j][k];
+          R[j][k] = cs * rk + sn * v[k];
+          v[k] = cs * v[k] - sn * rk;
+        }
+        const float zj = z[j];
+        z[j] = cs * zj + sn * y;
+        y = cs * y - sn * zj;
+      }
     }
-  }
-
-  // === STEP 2: Create augmented matrix for Gauss-Jordan elimination ===
-  // Format: [MTM | MTy] becomes a 5x6 matrix
-  // We'll transform the left side to identity matrix, leaving solution on right
 
-  float A[5][6]; // Augmented matrix [MTM | MTy]
-  for (int r=0; r<5; r++) {
-    for (int c=0; c<5; c++) A[r][c] = MTM[r][c]; // Copy MTM to left side
-    A[r][5] = MTy[r]; // Add MTy as the rightmost column
+    // Back substitution R·x = Qᵀy, rank check on the diagonal
+    float rmax = 0.0f;
+    for (uint8_t j = 0; j < m; j++) rmax = fmaxf(rmax, fabsf(R[j][j]));
+    float x[2 * HARMONIC_MAX_ORDER + 1];
+    for (int j = m - 1; j >= 0; j--) {
+      if (fabsf(R[j][j]) <= 1e-3f * rmax || rmax == 0.0f) return false;
+      float acc = z[j];
+      for (uint8_t k = j + 1; k < m; k++) acc -= R[j][k] * x[k];
+      x[j] = acc / R[j][j];
+    }
+    out.a0 = x[0];
+    for (uint8_t k = 1; k <= order; k++) {
+      out.s[k] = x[2 * k - 1];
+      out.c[k] = x[2 * k];
+    }
   }
 
-  // === STEP 3: Gauss-Jordan elimination with partial pivoting ===
-  // This transforms the matrix to reduced row echelon form (RREF):
-  // [1 0 0 0 0 | A]
-  // [0 1 0 0 0 | B]
-  // [0 0 1 0 0 | C]
-  // [0 0 0 1 0 | D]
-  // [0 0 0 0 1 | E]
-
-  for (int i=0; i<5; i++) { // Process each column
-
-    // STEP 3.1: Find pivot (largest absolute value in column i)
-    // This improves numerical stability by avoiding division by small numbers
-
-    int piv = i;
-    for (int r=i+1; r<5; r++)
-      if (fabs(A[r][i]) > fabs(A[piv][i])) piv = r; // Found a larger pivot
-
-    // STEP 3.2: Swap rows if needed (move pivot to diagonal)
-
-    if (piv != i)
-      for (int c=i; c<6; c++) { float tmp = A[i][c]; A[i][c] = A[piv][c]; A[piv][c] = tmp; }
-
-    // STEP 3.3: Normalize pivot row (make diagonal element = 1)
-
-    float diag = A[i][i];
-    if (fabs(diag) < 1e-9) continue; // Skip if nearly zero (singular matrix)
-    for (int c=i; c<6; c++) A[i][c] /= diag; // Divide entire row by diagonal element
-
-    // STEP 3.4: Eliminate column i in all other rows (make them 0)
-
-    for (int r=0; r<5; r++) {
-      if (r == i) continue; // Skip the pivot row itself
-      float f = A[r][i]; // Factor to eliminate this element
-      for (int c=i; c<6; c++) A[r][c] -= f * A[i][c]; // Row_r = Row_r - factor * Pivot_row
+  // Residuals and weighted RMS
+  float sse = 0.0f, wsum = 0.0f;
+  for (size_t i = 0; i < n; i++) {
+    const float r = pts[i].dev_deg - evalHarmonicFit(out, pts[i].hdg_deg);
+    if (residuals_deg) residuals_deg[i] = r;
+    if (pts[i].weight > 0.0f && validf(r)) {
+      sse += pts[i].weight * r * r;
+      wsum += pts[i].weight;
     }
   }
+  out.rms_deg = (wsum > 0.0f) ? sqrtf(sse / wsum) : NAN;
+  out.ok = true;
+  return true;
+}
 
-  // === STEP 4: Extract solution from rightmost column ===
-  // After elimination, the augmented matrix is [I | solution]
-  // The last column now contains our coefficients A, B, C, D, E
+// Evaluate a harmonic fit at a heading (deg)
+float evalHarmonicFit(const HarmonicFit& fit, float hdg_deg) {
+  float v[2 * HARMONIC_MAX_ORDER + 1];
+  harmonicBasis(hdg_deg, fit.order, v);
+  float dev = fit.a0;
+  for (uint8_t k = 1; k <= fit.order; k++) dev += fit.s[k] * v[2 * k - 1] + fit.c[k] * v[2 * k];
+  return dev;
+}
 
-  HarmonicCoeffs res = {A[0][5], A[1][5], A[2][5], A[3][5], A[4][5]};
-  return res;
+// The A..E model from a fit, harmonics above the 2nd are dropped
+HarmonicCoeffs toHarmonicCoeffs(const HarmonicFit& fit) {
+  HarmonicCoeffs h = { fit.a0, 0, 0, 0, 0 };
+  if (fit.order >= 1) { h.B = fit.s[1]; h.C = fit.c[1]; }
+  if (fit.order >= 2) { h.D = fit.s[2]; h.E = fit.c[2]; }
+  return h;
 }
 
 // Calculate deviation (deg) for given heading (deg) using harmonic model
@@ -123,49 +200,21 @@ float computeDeviation(const HarmonicCoeffs& h, float hdg_deg) {
        + h.E*cosf(2*th);  // 2nd harmonic cosine component (captures elliptical effects)
 }
 
-// === D E V I A T I O N  L O O K U P  T A B L E  C L A S S ===
-
-// === P U B L I C ===
-
-// Build the lookup table by computing deviation for each 1° of 360°
-void DeviationLookup::build(const HarmonicCoeffs &hc) {
-
-  for (int i = 0; i < SIZE; i++) {
-    float hdg_deg = (float)i;
-    float th = hdg_deg * M_PI / 180.0f;
-    lut[i] = hc.A + hc.B*sinf(th) + hc.C*cosf(th) + hc.D*sinf(2*th) + hc.E*cosf(2*th);
-  }
-  valid = true;
-}
-
-// Return an interpolated value from lookup table based on HDG(C)
-float DeviationLookup::lookup(float compass_deg) const {
-  if (!valid) return 0.0f;
-
-  // Validate input
-  if (!validf(compass_deg)) return 0.0f;
-
-  // Normalize to [0, 360) range
-  while (compass_deg >= 360.0f) compass_deg -= 360.0f;
-  while (compass_deg < 0.0f) compass_deg += 360.0f;
-
-  // Interpolate (linear)
-  int idx = (int)compass_deg;
-  float frac = compass_deg - idx;
-
-  // Ensure idx is within bounds
-  if (idx < 0 || idx >= SIZE) return 0.0f;
-
-  int next = (idx + 1) % SIZE;
-  float result = lut[idx] * (1.0f - frac) + lut[next] * frac;
-
-  return result;
-}
-
 // Return shortest arc on 360° (for instance 359° to 001° is 2° not 358°)
 float computeAngDiffRad(float a, float b) {
     float d = a - b;
     while (d > M_PI) d -= 2.0f * M_PI;
     while (d <= -M_PI) d += 2.0f * M_PI;
     return d;
-}
\ No newline at end of file
+}
+
+// Return FNV-1a hash of the 5 coeffs, used as a cache key for anything derived from the deviation model
+uint32_t computeHarmonicHash(const HarmonicCoeffs& h) {
+    const uint8_t* p = (const uint8_t*)&h;
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < sizeof(HarmonicCoeffs); i++) {
+        hash ^= p[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
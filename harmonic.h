@@ -4,7 +4,16 @@
 #define M_PI 3.14159265358979323846
 #endif
 
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+#include <atomic>
+
+#if defined(ARDUINO)
 #include <Arduino.h>
+#else
+#include <chrono>
+#endif
 
 // === G L O B A L  C O R E  S T R U C T U R E S ===
 //
@@ -19,43 +28,277 @@ struct HarmonicCoeffs {
 
 static constexpr float headings_deg[8] = { 0, 45, 90, 135, 180, 225, 270, 315 };
 
+// === G L O B A L  H A R M O N I C  S O L V E R  S T R U C T U R E S ===
+//
+// - DeviationPoint: one measured deviation at any heading, with a weight
+//   (e.g. 1 / variance of the measurement, 0 = ignore)
+// - HarmonicFit: solution of order 1...HARMONIC_MAX_ORDER
+//   deviation(θ) = a0 + Σk ( s[k]·sin(kθ) + c[k]·cos(kθ) ), k = 1...order
+//   order 2 is the A...E model: A = a0, B = s[1], C = c[1], D = s[2], E = c[2]
+// - fast: solved with the orthogonal DFT path, rms_deg: weighted residual RMS
+
+static constexpr uint8_t HARMONIC_MAX_ORDER = 4;
+
+struct DeviationPoint {
+  float hdg_deg;
+  float dev_deg;
+  float weight;
+};
+
+struct HarmonicFit {
+  uint8_t order = 0;
+  float a0 = 0.0f;
+  float s[HARMONIC_MAX_ORDER + 1] = {};   // Index 0 unused
+  float c[HARMONIC_MAX_ORDER + 1] = {};
+  float rms_deg = NAN;
+  bool ok = false;
+  bool fast = false;
+};
+
 // === G L O B A L  C O R E  F U N C T I O N S ===
 //
 // - Compute 5 coeffs from measured deviations at 8 cardinal/intercardinal points
+// - Solve a harmonic fit of any order from any number of weighted points,
+//   optionally with the residual of each point
+// - Evaluate a fit at a heading, reduce a fit to the 5 coeffs (order 2)
 // - Compute deviation based on the coeffs at any heading (degrees)
 // - Compute shortest arc on 360° (for instance 359° to 001° is 2° not 358°) in radians
+// - Compute a 32-bit hash of the 5 coeffs to detect changes of the deviation model
 // - Inline helper to check float validity
 
 HarmonicCoeffs computeHarmonicCoeffs(const float* dev_deg);
+bool solveHarmonicFit(const DeviationPoint* pts, size_t n, uint8_t order, HarmonicFit& out, float* residuals_deg = nullptr);
+float evalHarmonicFit(const HarmonicFit& fit, float hdg_deg);
+HarmonicCoeffs toHarmonicCoeffs(const HarmonicFit& fit);
 float computeDeviation(const HarmonicCoeffs& h, float hdg_deg);
 float computeAngDiffRad(float a, float b);
+uint32_t computeHarmonicHash(const HarmonicCoeffs& h);
 inline bool validf(float x) { return !isnan(x) && isfinite(x); }
 
+// Clock of the lookup table build time: micros() on the ESP32, steady clock in the host tests
+inline unsigned long harmonicMicros() {
+#if defined(ARDUINO)
+  return micros();
+#else
+  return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
 // === D E V I A T I O N  L O O K U P  T A B L E  C L A S S ===
 //
-// - Simple class DeviationLookup - provides the lookup table for computed deviations
-// - Lookup table for each 1° over 360°
-// - Build takes the 5 coeffs and computes the deviation for each 1° into the lookup table
-// - Lookup returns a deviation at any heading
-//   based on linear interpolation between two deviations in the lookup table
+// - Class template DeviationLookupT<N, Storage> - provides the lookup table for computed deviations
+// - Lookup table of N entries over 360° (N = 360 is 1° spacing), Storage is float
+//   or int16_t centidegrees (half the memory, 0.005° quantization)
+// - Build takes the 5 coeffs and computes the deviation for each entry using
+//   angle addition recurrences (sin/cos evaluated only every 64 entries to stop drift)
+// - Lookup returns a deviation at any heading based on linear interpolation
+//   between two entries: heading as a 32-bit phase, so the wrap to [0, 360)
+//   is free, index and fraction from one 64-bit multiply, guard entry lut[N] = lut[0]
+// - lookupPhase() takes the 32-bit phase directly (binary angle, see bam.h)
+// - Double-buffered: readers use the published table while the other one is
+//   built, then the table index is swapped atomically
+//   - build(): build and publish at once (first table at boot)
+//   - rebuild(): start a background build, buildStep() continues it a few entries
+//     per call from the loop and publishes when complete, a newer rebuild() restarts it
+//   - Readers pin the table they index with a per-table reader count, a build
+//     does not start writing the retired table until its readers are done
+//     (the step waits for the next call, build_waits counts those)
+//   - Hash of the coeffs of the published table, build time, swaps, waits and
+//     lookups served while building for the status block
+// - Single writer: build(), rebuild(), buildStep() and the getters from the
+//   loop task only, lookup(), lookupPhase() and getReadsDuringBuild() from any task
+// - DeviationLookup is the table used by CMPS14Processor
 
-class DeviationLookup {
+template <typename Storage> struct LutStorage;
+
+template <> struct LutStorage<float> {
+  static float encode(float dev_deg) { return dev_deg; }
+  static float decode(float v) { return v; }
+};
+
+template <> struct LutStorage<int16_t> {
+  static int16_t encode(float dev_deg) {
+    const float c = roundf(dev_deg * 100.0f);
+    return (int16_t)(c > 32767.0f ? 32767.0f : (c < -32768.0f ? -32768.0f : c));
+  }
+  static float decode(int16_t v) { return v * 0.01f; }
+};
+
+template <int N, typename Storage = float>
+class DeviationLookupT {
 
 public:
 
-  explicit DeviationLookup() {
-    for (int i = 0; i < SIZE; i++) {
-      lut[i] = 0.0f;
+  static_assert(N >= 8 && N <= 65536, "DeviationLookupT: N out of range");
+
+  explicit DeviationLookupT() {
+    for (int b = 0; b < 2; b++) {
+      for (int i = 0; i <= N; i++) lut[b][i] = LutStorage<Storage>::encode(0.0f);
     }
   }
 
-  void build(const HarmonicCoeffs &hc);
+  bool build(const HarmonicCoeffs &hc);
+  void rebuild(const HarmonicCoeffs &hc);
+  bool buildStep(int entries);
   float lookup(float compass_deg) const;
+  float lookupPhase(uint32_t phase) const;
+
+  bool isBuilding() const { return build_pos.load(std::memory_order_relaxed) >= 0; }
+  uint32_t getHash() const { return hash[active.load(std::memory_order_acquire)]; }
+  unsigned long getBuildUs() const { return build_us; }
+  uint32_t getSwapCount() const { return swaps; }
+  uint32_t getBuildWaits() const { return build_waits; }
+  uint32_t getReadsDuringBuild() const { return reads_during_build.load(std::memory_order_relaxed); }
+
+  static constexpr int size() { return N; }
+  static constexpr size_t bytes() { return 2 * sizeof(Storage) * (N + 1); }
 
 private:
 
-  static constexpr int SIZE = 360;
-  float lut[SIZE];
-  bool valid = false;
+  void fill(Storage* t, const HarmonicCoeffs &hc, int from, int to);
+  void publish();
+
+  static constexpr int RESEED = 64;
+  Storage lut[2][N + 1];
+  uint32_t hash[2] = { 0, 0 };
+  std::atomic<uint8_t> active{0};        // Published table
+  std::atomic<bool> valid{false};
+  mutable std::atomic<uint32_t> readers[2] = { {0}, {0} };   // Lookups in progress per table
+
+  // Background build into lut[active ^ 1]
+  HarmonicCoeffs pending = { 0,0,0,0,0 };
+  std::atomic<int> build_pos{-1};        // Next entry, -1 = idle
+  unsigned long build_acc_us = 0;        // CPU time of the current build so far
+  unsigned long build_us = 0;            // CPU time of the last completed build
+  uint32_t swaps = 0;
+  uint32_t build_waits = 0;              // Steps deferred for readers of the retired table
+  mutable std::atomic<uint32_t> reads_during_build{0};
+
+};
+
+using DeviationLookup = DeviationLookupT<360, float>;
+
+// Build the whole table into the back buffer and publish it, false if readers of the
+// retired table made it wait (buildStep() then completes it)
+template <int N, typename Storage>
+bool DeviationLookupT<N, Storage>::build(const HarmonicCoeffs &hc) {
+  pending = hc;
+  build_pos.store(0, std::memory_order_relaxed);
+  build_acc_us = 0;
+  return this->buildStep(N);
+}
+
+// Start building a new table in the background, the first table is built at once
+template <int N, typename Storage>
+void DeviationLookupT<N, Storage>::rebuild(const HarmonicCoeffs &hc) {
+  if (!valid.load(std::memory_order_relaxed)) {
+    this->build(hc);
+    return;
+  }
+  pending = hc;
+  build_pos.store(0, std::memory_order_relaxed);
+  build_acc_us = 0;
+}
+
+// Continue the background build by a number of entries, true when a new table was published
+template <int N, typename Storage>
+bool DeviationLookupT<N, Storage>::buildStep(int entries) {
+  const int from = build_pos.load(std::memory_order_relaxed);
+  if (from < 0) return false;
+  const uint8_t back = active.load(std::memory_order_relaxed) ^ 1;
+
+  // Lookups that pinned the back buffer while it was published may still be reading it
+  if (from == 0 && readers[back].load() != 0) {
+    build_waits++;
+    return false;
+  }
+
+  const unsigned long start_us = harmonicMicros();
+  const int to = (from + entries < N) ? from + entries : N;
+  this->fill(lut[back], pending, from, to);
+  build_acc_us += harmonicMicros() - start_us;
+  if (to < N) {
+    build_pos.store(to, std::memory_order_relaxed);
+    return false;
+  }
+  build_pos.store(-1, std::memory_order_relaxed);
+  this->publish();
+  return true;
+}
+
+// Compute entries [from, to), sin/cos of each entry rotated from the previous one
+template <int N, typename Storage>
+void DeviationLookupT<N, Storage>::fill(Storage* t, const HarmonicCoeffs &hc, int from, int to) {
+
+  const double step = 2.0 * M_PI / N;
+  const float sd = (float)sin(step);
+  const float cd = (float)cos(step);
+  float s1 = 0.0f, c1 = 1.0f;
+
+  for (int i = from; i < to; i++) {
+    if (i == from || i % RESEED == 0) {
+      s1 = (float)sin(step * i);
+      c1 = (float)cos(step * i);
+    }
+    const float s2 = 2.0f * s1 * c1;
+    const float c2 = c1 * c1 - s1 * s1;
+    t[i] = LutStorage<Storage>::encode(hc.A + hc.B*s1 + hc.C*c1 + hc.D*s2 + hc.E*c2);
+    const float sn = s1 * cd + c1 * sd;
+    c1 = c1 * cd - s1 * sd;
+    s1 = sn;
+  }
+  if (to == N) t[N] = t[0];
+}
+
+// Swap the completed back buffer in
+template <int N, typename Storage>
+void DeviationLookupT<N, Storage>::publish() {
+  const uint8_t next = active.load(std::memory_order_relaxed) ^ 1;
+  hash[next] = computeHarmonicHash(pending);
+  active.store(next);   // Sequentially consistent with the reader count, see lookupPhase()
+  build_us = build_acc_us;
+  swaps++;
+  valid.store(true, std::memory_order_release);
+}
+
+// Return an interpolated value from lookup table based on HDG(C)
+template <int N, typename Storage>
+float DeviationLookupT<N, Storage>::lookup(float compass_deg) const {
+  if (!valid.load(std::memory_order_acquire)) return 0.0f;
+
+  // Validate input
+  if (!validf(compass_deg)) return 0.0f;
+
+  // Heading as 32-bit phase, any multiple of 360° wraps away in the cast
+  return this->lookupPhase((uint32_t)(int64_t)(compass_deg * (4294967296.0f / 360.0f)));
+}
+
+// Return an interpolated value from lookup table based on HDG(C) as 32-bit phase (2^32 = 360°)
+template <int N, typename Storage>
+float DeviationLookupT<N, Storage>::lookupPhase(uint32_t phase) const {
+  if (!valid.load(std::memory_order_acquire)) return 0.0f;
+
+  // Pin the published table: count in, then check it is still the published one.
+  // A build either sees the count or the reader sees the swap and moves over
+  uint8_t b = active.load();
+  readers[b].fetch_add(1);
+  while (active.load() != b) {
+    readers[b].fetch_sub(1);
+    b = active.load();
+    readers[b].fetch_add(1);
+  }
+  const Storage* t = lut[b];
+  if (build_pos.load(std::memory_order_relaxed) >= 0) reads_during_build.fetch_add(1, std::memory_order_relaxed);
+
+  // Index in the high word, fraction in the low word
+  const uint64_t pos = (uint64_t)phase * (uint32_t)N;
+  const uint32_t idx = (uint32_t)(pos >> 32);
+  const float frac = (float)(uint32_t)pos * (1.0f / 4294967296.0f);
 
-};
\ No newline at end of file
+  // Interpolate (linear), lut[N] is lut[0]
+  const float a = LutStorage<Storage>::decode(t[idx]);
+  const float c = LutStorage<Storage>::decode(t[idx + 1]);
+  readers[b].fetch_sub(1);
+  return a + (c - a) * frac;
+}
@@ -0,0 +1,126 @@
+#include "heading_filter.h"
+
+// === G L O B A L  H E A D I N G  F I L T E R  F U N C T I O N S ===
+
+static constexpr float DEG_RAD = (float)M_PI / 180.0f;
+static constexpr float RAD_DEG = 180.0f / (float)M_PI;
+static constexpr uint32_t WARM_RESEED_BAM = (uint32_t)(WARM_RESEED_DEG * BAM_PER_DEG);
+
+// Heading path in binary angles: wraparound is free, no normalization branches
+void processHeadingFixed(HeadingState& st, const HeadingParams& p, const DeviationLookup& lut, uint16_t raw_10, unsigned long now_ms) {
+
+    // Heading (C)
+    const bam32_t raw = bamFromTenths(raw_10) + bamFromDeg(p.offset_deg);
+    if (st.warm_filter_check) {
+        // Restored filter state: keep it only if the boat did not turn during the restart
+        st.warm_filter_check = false;
+        if (validf(st.compass_deg) && bamAbsDiff(raw, bamFromDeg(st.compass_deg)) > WARM_RESEED_BAM) st.compass_deg = NAN;
+        st.compass_bam_valid = false;
+    }
+    if (!st.compass_bam_valid) {
+        // Seed from the restored filter state or from the first reading
+        st.compass_bam = validf(st.compass_deg) ? bamFromDeg(st.compass_deg) : raw;
+        st.compass_bam_valid = true;
+    } else {
+        const int32_t alpha_q16 = (int32_t)(p.heading_alpha * 65536.0f + 0.5f);
+        st.compass_bam += (bam32_t)(int32_t)(((int64_t)bamDiff(raw, st.compass_bam) * alpha_q16) >> 16);
+    }
+
+    // Heading (M)
+    st.dev_deg = lut.lookupPhase(st.compass_bam);
+    st.heading_bam = st.compass_bam + bamFromDeg(st.dev_deg);
+
+    // Heading (T)
+    const bool var_ok = validf(p.variation_deg);
+    st.heading_true_bam = st.heading_bam + (var_ok ? bamFromDeg(p.variation_deg) : 0);
+
+    // Rate of turn from successive magnetic headings, smoothed
+    if (st.rot_prev_valid && now_ms != st.sample_ms) {
+        const float rot = (float)bamDiff(st.heading_bam, st.rot_prev_bam) * RAD_PER_BAM * 1000.0f / (float)(now_ms - st.sample_ms);
+        st.rot_rad = validf(st.rot_rad) ? st.rot_rad + p.rot_alpha * (rot - st.rot_rad) : rot;
+    }
+    st.rot_prev_bam = st.heading_bam;
+    st.rot_prev_valid = true;
+
+    // Degrees at the output boundary
+    st.compass_deg = bamToDeg(st.compass_bam);
+    st.heading_deg = bamToDeg(st.heading_bam);
+    st.heading_true_deg = var_ok ? bamToDeg(st.heading_true_bam) : NAN;
+    st.sample_ms = now_ms;
+}
+
+// Heading path in float degrees
+void processHeadingFloat(HeadingState& st, const HeadingParams& p, const DeviationLookup& lut, uint16_t raw_10, unsigned long now_ms) {
+
+    // Heading (C)
+    float raw_deg = (float)raw_10 / 10.0f + p.offset_deg;
+    if (raw_deg >= 360.0f) raw_deg -= 360.0f;
+    if (raw_deg < 0.0f) raw_deg += 360.0f;
+    if (st.warm_filter_check) {
+        // Restored filter state: keep it only if the boat did not turn during the restart
+        st.warm_filter_check = false;
+        if (validf(st.compass_deg) && fabsf(computeAngDiffRad(raw_deg * DEG_RAD, st.compass_deg * DEG_RAD)) * RAD_DEG > WARM_RESEED_DEG) st.compass_deg = NAN;
+    }
+    if (isnan(st.compass_deg)) {
+        st.compass_deg = raw_deg;
+    } else {
+        float diff = raw_deg - st.compass_deg;
+        if (diff > 180.0f) diff -= 360.0f;
+        if (diff < -180.0f) diff += 360.0f;
+        st.compass_deg += p.heading_alpha * diff;
+        if (st.compass_deg >= 360.0f) st.compass_deg -= 360.0f;
+        if (st.compass_deg < 0.0f) st.compass_deg += 360.0f;
+    }
+
+    // Heading (M)
+    st.dev_deg = lut.lookup(st.compass_deg);
+    st.heading_deg = st.compass_deg + st.dev_deg;
+    if (st.heading_deg >= 360.0f) st.heading_deg -= 360.0f;
+    if (st.heading_deg < 0.0f) st.heading_deg += 360.0f;
+
+    // Heading (T)
+    st.heading_true_deg = st.heading_deg + p.variation_deg;
+    if (st.heading_true_deg >= 360.0f) st.heading_true_deg -= 360.0f;
+    if (st.heading_true_deg < 0.0f) st.heading_true_deg += 360.0f;
+
+    // Rate of turn from successive magnetic headings, smoothed
+    if (validf(st.rot_prev_hdg_deg) && now_ms != st.sample_ms) {
+        float d = st.heading_deg - st.rot_prev_hdg_deg;
+        if (d > 180.0f) d -= 360.0f;
+        if (d < -180.0f) d += 360.0f;
+        const float rot = d * DEG_RAD * 1000.0f / (float)(now_ms - st.sample_ms);
+        st.rot_rad = validf(st.rot_rad) ? st.rot_rad + p.rot_alpha * (rot - st.rot_rad) : rot;
+    }
+    st.rot_prev_hdg_deg = st.heading_deg;
+
+    // Binary angles for the output deadbands
+    st.heading_bam = bamFromDeg(st.heading_deg);
+    st.heading_true_bam = validf(st.heading_true_deg) ? bamFromDeg(st.heading_true_deg) : 0;
+    st.sample_ms = now_ms;
+}
+
+// Logged raw frames through the per-sample path, attitude over the arrays
+size_t processHeadingBatch(const RawFrames& in, size_t n, ProcessedFrames& out, HeadingState& st,
+                           const HeadingParams& p, const DeviationLookup& lut, bool fixed_point) {
+    if (!in.t_ms || !in.angle_10) return 0;
+
+    // Heading: sequential, filter and rate of turn carry state
+    for (size_t i = 0; i < n; i++) {
+        if (fixed_point) processHeadingFixed(st, p, lut, in.angle_10[i], in.t_ms[i]);
+        else processHeadingFloat(st, p, lut, in.angle_10[i], in.t_ms[i]);
+        if (out.compass_deg)      out.compass_deg[i] = st.compass_deg;
+        if (out.heading_deg)      out.heading_deg[i] = st.heading_deg;
+        if (out.heading_true_deg) out.heading_true_deg[i] = st.heading_true_deg;
+        if (out.deviation_deg)    out.deviation_deg[i] = st.dev_deg;
+        if (out.rot_rad)          out.rot_rad[i] = st.rot_rad;
+    }
+
+    // Attitude: independent per frame
+    if (in.pitch && out.pitch_deg) {
+        for (size_t i = 0; i < n; i++) out.pitch_deg[i] = (float)in.pitch[i] + p.pitch_level_deg;
+    }
+    if (in.roll && out.roll_deg) {
+        for (size_t i = 0; i < n; i++) out.roll_deg[i] = (float)in.roll[i] + p.roll_level_deg;
+    }
+    return n;
+}
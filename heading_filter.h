@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+#include "harmonic.h"
+#include "bam.h"
+
+// === G L O B A L  H E A D I N G  F I L T E R  S T R U C T S ===
+//
+// - HeadingState: heading filter and rate of turn state with the latest heading
+//   outputs, one per stream of samples (the live sensor, each replay)
+// - HeadingParams: installation offset, variation, smoothing factors and
+//   attitude leveling as explicit values, so logged frames can be reprocessed
+//   with any settings
+// - RawFrames, ProcessedFrames: structure-of-arrays views for batch
+//   processing, n entries each, nullptr = input not present / output not wanted
+// - Warm restart: a restored compass_deg with warm_filter_check set is kept
+//   only if the first reading is within WARM_RESEED_DEG of it
+
+struct HeadingState {
+    float compass_deg = NAN, heading_deg = NAN, heading_true_deg = NAN;
+    float dev_deg = 0.0f;              // Deviation calculated by harmonic model
+    bam32_t compass_bam = 0, heading_bam = 0, heading_true_bam = 0;
+    bool compass_bam_valid = false;
+    float rot_rad = NAN;               // Rate of turn in rad/s, positive to starboard
+    float rot_prev_hdg_deg = NAN;
+    bam32_t rot_prev_bam = 0;
+    bool rot_prev_valid = false;
+    unsigned long sample_ms = 0;       // Time of the latest processed sample (ms)
+    bool warm_filter_check = false;    // First reading after restoring the filter still to be checked
+};
+
+struct HeadingParams {
+    float offset_deg = 0.0f;           // Installation offset of the sensor
+    float variation_deg = NAN;         // Magnetic variation, NAN = no true heading
+    float heading_alpha = 0.15f;       // Smoothing factor for Heading (C)
+    float rot_alpha = 0.2f;            // Smoothing factor for rate of turn
+    float pitch_level_deg = 0.0f;      // Leveling added to pitch and roll (batch only)
+    float roll_level_deg = 0.0f;
+};
+
+struct RawFrames {
+    const uint32_t* t_ms = nullptr;    // Sample time (ms)
+    const uint16_t* angle_10 = nullptr; // CMPS14 bearing in tenths of a degree
+    const int8_t* pitch = nullptr;     // CMPS14 pitch (deg)
+    const int8_t* roll = nullptr;      // CMPS14 roll (deg)
+};
+
+struct ProcessedFrames {
+    float* compass_deg = nullptr;
+    float* heading_deg = nullptr;
+    float* heading_true_deg = nullptr;
+    float* deviation_deg = nullptr;
+    float* rot_rad = nullptr;
+    float* pitch_deg = nullptr;
+    float* roll_deg = nullptr;
+};
+
+static constexpr float WARM_RESEED_DEG = 10.0f;   // Restart the filter if the first reading differs more
+
+// === G L O B A L  H E A D I N G  F I L T E R  F U N C T I O N S ===
+//
+// - One CMPS14 bearing sample (tenths of a degree) to Heading (C), (M), (T)
+//   and rate of turn, deviation from a table the caller built from the coeffs
+// - processHeadingFixed(): binary angles (see bam.h), wraparound is free and
+//   float degrees are produced only for the outputs
+// - processHeadingFloat(): float degrees with normalization branches
+// - Both paths agree within 0.001° (bench_heading_filter). On the host they
+//   take the same time (~38 ns per update), the binary angle path is the
+//   default for its wrap-free arithmetic and integer deadbands, not for speed
+// - processHeadingBatch(): logged raw frames through the same per-sample math
+//   (sequential, the filter carries state), attitude in plain loops over the
+//   arrays the compiler can vectorize, returns the frames processed
+// - No Arduino dependency: the gateway, the replay tool (tools/cmps14replay.cpp)
+//   and the host tests share it
+
+void processHeadingFixed(HeadingState& st, const HeadingParams& p, const DeviationLookup& lut, uint16_t raw_10, unsigned long now_ms);
+void processHeadingFloat(HeadingState& st, const HeadingParams& p, const DeviationLookup& lut, uint16_t raw_10, unsigned long now_ms);
+size_t processHeadingBatch(const RawFrames& in, size_t n, ProcessedFrames& out, HeadingState& st,
+                           const HeadingParams& p, const DeviationLookup& lut, bool fixed_point = true);
@@ -0,0 +1,116 @@
+#include <string.h>
+#include "heading_packet.h"
+
+// === G L O B A L  H E A D I N G P A C K E T  F U N C T I O N S ===
+
+static constexpr float Q_SCALE = 10000.0f;          // 1e-4 rad per LSB
+static constexpr float TWO_PI_F = 6.28318531f;
+
+// Quantize a signed value into int16 with saturation
+static int16_t quantizeSigned(float v) {
+    float q = roundf(v * Q_SCALE);
+    if (q > 32767.0f) q = 32767.0f;
+    if (q < -32767.0f) q = -32767.0f; // INT16_MIN is reserved for n/a
+    return (int16_t)q;
+}
+
+// Quantize a heading into 0...62831, wrapped to one full circle
+static uint16_t quantizeHeading(float rad) {
+    float r = fmodf(rad, TWO_PI_F);
+    if (r < 0.0f) r += TWO_PI_F;
+    uint32_t q = (uint32_t)lroundf(r * Q_SCALE);
+    if (q >= 62832) q = 0;
+    return (uint16_t)q;
+}
+
+// Encode a sample into the wire format
+void encodeHeadingPacket(const HeadingSample& s, HeadingPacket& out) {
+    out.magic        = HEADING_PACKET_MAGIC;
+    out.seq          = s.seq;
+    out.sample_ms    = s.sample_ms;
+    out.heading      = quantizeHeading(s.heading_rad);
+    out.heading_true = isfinite(s.heading_true_rad) ? quantizeHeading(s.heading_true_rad) : 0xFFFF;
+    out.pitch        = isfinite(s.pitch_rad) ? quantizeSigned(s.pitch_rad) : INT16_MIN;
+    out.roll         = isfinite(s.roll_rad) ? quantizeSigned(s.roll_rad) : INT16_MIN;
+    out.rot          = isfinite(s.rot_rad) ? quantizeSigned(s.rot_rad) : INT16_MIN;
+    out.cal          = s.cal;
+    out.crc          = crc16(&out, offsetof(HeadingPacket, crc));
+}
+
+// Decode and validate a received packet
+bool decodeHeadingPacket(const uint8_t* data, size_t len, HeadingSample& out) {
+    if (len != sizeof(HeadingPacket)) return false;
+    HeadingPacket p;
+    memcpy(&p, data, sizeof(p));
+    if (p.magic != HEADING_PACKET_MAGIC) return false;
+    if (crc16(&p, offsetof(HeadingPacket, crc)) != p.crc) return false;
+
+    out.seq              = p.seq;
+    out.sample_ms        = p.sample_ms;
+    out.heading_rad      = p.heading / Q_SCALE;
+    out.heading_true_rad = (p.heading_true == 0xFFFF) ? NAN : p.heading_true / Q_SCALE;
+    out.pitch_rad        = (p.pitch == INT16_MIN) ? NAN : p.pitch / Q_SCALE;
+    out.roll_rad         = (p.roll == INT16_MIN) ? NAN : p.roll / Q_SCALE;
+    out.rot_rad          = (p.rot == INT16_MIN) ? NAN : p.rot / Q_SCALE;
+    out.cal              = p.cal;
+    return true;
+}
+
+// === H E A D I N G P A C K E T S T A T S  C L A S S ===
+
+// === P U B L I C ===
+
+// Account one received packet, true if it was a valid heading packet
+bool HeadingPacketStats::onPacket(const uint8_t* data, size_t len, uint32_t rx_ms) {
+    HeadingSample s;
+    if (!decodeHeadingPacket(data, len, s)) {
+        invalid++;
+        return false;
+    }
+
+    if (have_last) {
+        const uint16_t ahead = (uint16_t)(s.seq - last.seq);
+        const uint16_t behind = (uint16_t)(last.seq - s.seq);
+        if (ahead == 0) {
+            duplicates++;
+            return true;
+        }
+        if (ahead <= MAX_GAP) {
+            lost += ahead - 1;
+        } else if (behind <= MAX_GAP) {
+            // Late packet: already counted as lost when the gap was seen
+            reordered++;
+            if (lost) lost--;
+            received++;
+            this->updateJitter(s.sample_ms, rx_ms);
+            return true;
+        } else {
+            resyncs++;
+            have_offset = false;
+        }
+    }
+    received++;
+    this->updateJitter(s.sample_ms, rx_ms);
+    last = s;
+    have_last = true;
+    return true;
+}
+
+// Reset all counters
+void HeadingPacketStats::reset() {
+    *this = HeadingPacketStats();
+}
+
+// === P R I V A T E ===
+
+// Relative latency against the fastest packet seen, in 16 bits as sample_ms
+void HeadingPacketStats::updateJitter(uint16_t sample_ms, uint32_t rx_ms) {
+    const uint16_t offset = (uint16_t)((uint16_t)rx_ms - sample_ms);
+    if (!have_offset || (int16_t)(offset - min_offset_ms) < 0) {
+        min_offset_ms = offset;
+        have_offset = true;
+    }
+    jitter_ms = (uint16_t)(offset - min_offset_ms);
+    if (jitter_ms > max_jitter_ms) max_jitter_ms = jitter_ms;
+    avg_jitter_ms += JITTER_ALPHA * ((float)jitter_ms - avg_jitter_ms);
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+#include "checksum.h"
+
+// === G L O B A L  H E A D I N G P A C K E T  S T R U C T S ===
+//
+// - Wire format of the ESP-NOW heading telemetry, 18 bytes, little-endian
+// - magic: high nibble packet type (A = heading), low nibble format version
+// - seq increments by one per packet sent, receivers detect loss and reordering
+// - sample_ms: low 16 bits of the sender millis() at the sensor sample,
+//   for jitter and relative latency on the receiver side
+// - Angles quantized to 1e-4 rad (0.0057°), rate of turn to 1e-4 rad/s
+// - Heading true 0xFFFF = not available, pitch, roll and ROT INT16_MIN = not available
+// - cal: CMPS14 calibration status byte as is (sys, gyr, acc, mag 2 bits each)
+// - Unicast subscribers choose optional fields (HP_FIELD_*), fields not
+//   subscribed are sent as not available (cal as 0), magnetic heading is always sent
+// - crc: CRC-16/CCITT-FALSE over all preceding bytes
+// - HeadingSample is the decoded, engineering unit view of one packet
+// - No Arduino dependency: receivers and host tests include heading_packet.h/.cpp
+//   and checksum.h as they are
+
+static constexpr uint8_t HEADING_PACKET_MAGIC = 0xA1;
+
+static constexpr uint8_t HP_FIELD_HEADING_TRUE = 0x01;
+static constexpr uint8_t HP_FIELD_ATTITUDE     = 0x02;   // Pitch and roll
+static constexpr uint8_t HP_FIELD_ROT          = 0x04;
+static constexpr uint8_t HP_FIELD_CAL          = 0x08;
+static constexpr uint8_t HP_FIELDS_ALL         = 0x0F;
+
+struct __attribute__((packed)) HeadingPacket {
+    uint8_t magic;
+    uint16_t seq;
+    uint16_t sample_ms;
+    uint16_t heading;        // Magnetic heading, 1e-4 rad, 0...62831
+    uint16_t heading_true;   // True heading, 1e-4 rad, 0xFFFF = n/a
+    int16_t pitch;           // 1e-4 rad, INT16_MIN = n/a
+    int16_t roll;            // 1e-4 rad, INT16_MIN = n/a
+    int16_t rot;             // Rate of turn, 1e-4 rad/s, INT16_MIN = n/a
+    uint8_t cal;
+    uint16_t crc;
+};
+
+static_assert(sizeof(HeadingPacket) == 18, "HeadingPacket wire format changed, bump the version in HEADING_PACKET_MAGIC");
+
+struct HeadingSample {
+    uint16_t seq = 0;
+    uint16_t sample_ms = 0;
+    float heading_rad = NAN;
+    float heading_true_rad = NAN;
+    float pitch_rad = NAN;
+    float roll_rad = NAN;
+    float rot_rad = NAN;     // rad/s, positive to starboard
+    uint8_t cal = 0;
+};
+
+// === G L O B A L  H E A D I N G P A C K E T  F U N C T I O N S ===
+//
+// - Encode a sample into the wire format, angles wrapped/clamped to their range
+// - Decode and validate (length, magic, CRC) a received packet, false if invalid
+
+void encodeHeadingPacket(const HeadingSample& s, HeadingPacket& out);
+bool decodeHeadingPacket(const uint8_t* data, size_t len, HeadingSample& out);
+
+// === H E A D I N G P A C K E T S T A T S  C L A S S ===
+//
+// - Receiver side link quality for displays, test receivers and host tools
+// - stats.onPacket(data, len, rx_ms) for every received ESP-NOW packet,
+//   rx_ms = receiver millis() at reception
+// - Counts received, invalid (length, magic, CRC), lost (gaps in seq),
+//   duplicate (seq repeated) and reordered (seq behind the newest, arrived
+//   late, taken off the lost count) packets, seq wraps at 65535
+// - A seq jump beyond MAX_GAP either way is a sender restart: counted as a
+//   resync, no loss, the jitter baseline starts over
+// - Jitter: (rx_ms - sample_ms) in 16 bits against its running minimum,
+//   i.e. latency relative to the fastest packet seen, no clock sync needed;
+//   valid while one-way latency stays below 32 s
+
+class HeadingPacketStats {
+
+public:
+
+    static constexpr uint16_t MAX_GAP = 1000;         // ~50 s of packets at 20 Hz
+    static constexpr float JITTER_ALPHA = 0.05f;
+
+    bool onPacket(const uint8_t* data, size_t len, uint32_t rx_ms);
+    void reset();
+
+    const HeadingSample& getLast() const { return last; }
+    uint32_t getReceived() const { return received; }
+    uint32_t getInvalid() const { return invalid; }
+    uint32_t getLost() const { return lost; }
+    uint32_t getDuplicates() const { return duplicates; }
+    uint32_t getReordered() const { return reordered; }
+    uint32_t getResyncs() const { return resyncs; }
+    float getLossRate() const { return (received + lost) ? (float)lost / (float)(received + lost) : 0.0f; }
+    uint16_t getLastJitterMs() const { return jitter_ms; }
+    uint16_t getMaxJitterMs() const { return max_jitter_ms; }
+    float getAvgJitterMs() const { return avg_jitter_ms; }
+
+private:
+
+    HeadingSample last;                 // Newest in seq order
+    bool have_last = false;
+    bool have_offset = false;
+    uint16_t min_offset_ms = 0;
+    uint32_t received = 0;
+    uint32_t invalid = 0;
+    uint32_t lost = 0;
+    uint32_t duplicates = 0;
+    uint32_t reordered = 0;
+    uint32_t resyncs = 0;
+    uint16_t jitter_ms = 0;
+    uint16_t max_jitter_ms = 0;
+    float avg_jitter_ms = 0.0f;
+
+    void updateJitter(uint16_t sample_ms, uint32_t rx_ms);
+
+};
@@ -0,0 +1,163 @@
+#include <math.h>
+#include "nmea0183.h"
+
+// === N M E A S E N T E N C E  C L A S S ===
+
+// === P U B L I C ===
+
+// Start a sentence: "$" + talker + type
+void NmeaSentence::begin(const char* talker, const char* type) {
+    len = 0;
+    overflow = false;
+    this->put('$');
+    while (*talker) this->put(*talker++);
+    while (*type) this->put(*type++);
+}
+
+// Signed fixed-point field, empty if not valid
+void NmeaSentence::fixed(float value, uint8_t decimals) {
+    this->field();
+    if (!isfinite(value)) return;
+    float scale = 1.0f;
+    for (uint8_t i = 0; i < decimals; i++) scale *= 10.0f;
+    this->putFixed((int32_t)lroundf(value * scale), decimals);
+}
+
+// Heading field wrapped to 0...360 after rounding, empty if not valid
+void NmeaSentence::heading(float deg, uint8_t decimals) {
+    this->field();
+    if (!isfinite(deg)) return;
+    int32_t full = 360;
+    for (uint8_t i = 0; i < decimals; i++) full *= 10;
+    int32_t q = (int32_t)lroundf(fmodf(deg, 360.0f) * (float)(full / 360));
+    if (q < 0) q += full;
+    if (q >= full) q -= full;
+    this->putFixed(q, decimals);
+}
+
+// Unsigned fixed-point field (direction given in a separate E/W field), empty if not valid
+void NmeaSentence::fixedAbs(float value, uint8_t decimals) {
+    this->fixed(fabsf(value), decimals);
+}
+
+// Text field
+void NmeaSentence::text(const char* field) {
+    this->field();
+    while (*field) this->put(*field++);
+}
+
+// Empty field
+void NmeaSentence::empty() {
+    this->field();
+}
+
+// Close with "*hh\r\n", returns the total length
+size_t NmeaSentence::end() {
+    static const char HEX_DIGITS[] = "0123456789ABCDEF";
+    const uint8_t cs = checksum(buf, len);
+    this->put('*');
+    this->put(HEX_DIGITS[cs >> 4]);
+    this->put(HEX_DIGITS[cs & 0x0F]);
+    this->put('\r');
+    this->put('\n');
+    buf[len] = '\0';
+    return len;
+}
+
+// XOR of the characters between '$' and '*' (or the end)
+uint8_t NmeaSentence::checksum(const char* sentence, size_t n) {
+    uint8_t cs = 0;
+    size_t i = (n > 0 && (sentence[0] == '$' || sentence[0] == '!')) ? 1 : 0;
+    for (; i < n && sentence[i] != '*'; i++) cs ^= (uint8_t)sentence[i];
+    return cs;
+}
+
+// === P R I V A T E ===
+
+// Append one character, keep room for the terminator
+void NmeaSentence::put(char c) {
+    if (len >= MAX_LEN) {
+        overflow = true;
+        return;
+    }
+    buf[len++] = c;
+}
+
+// Field separator
+void NmeaSentence::field() {
+    this->put(',');
+}
+
+// Write a scaled integer as a decimal number with the given decimals
+void NmeaSentence::putFixed(int32_t scaled, uint8_t decimals) {
+    uint32_t v;
+    if (scaled < 0) {
+        this->put('-');
+        v = (uint32_t)(-(int64_t)scaled);
+    } else v = (uint32_t)scaled;
+
+    char digits[12];
+    uint8_t n = 0;
+    do {
+        digits[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v > 0 || n <= decimals); // At least one digit before the decimal point
+
+    while (n > 0) {
+        if (n == decimals) this->put('.');
+        this->put(digits[--n]);
+    }
+}
+
+// === G L O B A L  N M E A 0 1 8 3  S E N T E N C E  B U I L D E R S ===
+
+// $HCHDG,sensor,dev,E/W,var,E/W
+void buildHDG(NmeaSentence& s, float sensor_deg, float dev_deg, float var_deg) {
+    s.begin("HC", "HDG");
+    s.heading(sensor_deg, 1);
+    s.fixedAbs(dev_deg, 1);
+    if (isfinite(dev_deg)) s.text(dev_deg < 0.0f ? "W" : "E");
+    else s.empty();
+    s.fixedAbs(var_deg, 1);
+    if (isfinite(var_deg)) s.text(var_deg < 0.0f ? "W" : "E");
+    else s.empty();
+    s.end();
+}
+
+// $HCHDM,heading,M
+void buildHDM(NmeaSentence& s, float heading_deg) {
+    s.begin("HC", "HDM");
+    s.heading(heading_deg, 1);
+    s.text("M");
+    s.end();
+}
+
+// $HCHDT,heading,T
+void buildHDT(NmeaSentence& s, float heading_true_deg) {
+    s.begin("HC", "HDT");
+    s.heading(heading_true_deg, 1);
+    s.text("T");
+    s.end();
+}
+
+// $HCXDR,A,pitch,D,PTCH,A,roll,D,ROLL
+void buildXDR(NmeaSentence& s, float pitch_deg, float roll_deg) {
+    s.begin("HC", "XDR");
+    s.text("A");
+    s.fixed(pitch_deg, 1);
+    s.text("D");
+    s.text("PTCH");
+    s.text("A");
+    s.fixed(roll_deg, 1);
+    s.text("D");
+    s.text("ROLL");
+    s.end();
+}
+
+// $HCROT,rot,A (V when not available)
+void buildROT(NmeaSentence& s, float rot_deg_min) {
+    s.begin("HC", "ROT");
+    s.fixed(rot_deg_min, 1);
+    s.text(isfinite(rot_deg_min) ? "A" : "V");
+    s.end();
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// === N M E A S E N T E N C E  C L A S S ===
+//
+// - Class NmeaSentence - builds one NMEA 0183 sentence into a fixed buffer
+// - Fixed-point number formatting without printf/float formatting: the value
+//   is scaled and rounded once to an integer, then written digit by digit
+// - Usage: s.begin("HC", "HDM"); s.fixed(123.4f, 1); s.text("M"); s.end();
+//   gives "$HCHDM,123.4,M*hh\r\n" with the XOR checksum of the characters
+//   between '$' and '*'
+// - Invalid (NaN) numbers become empty fields, as NMEA 0183 expects for
+//   data not available
+// - heading() wraps into 0...360 after rounding, so 359.96° is "0.0", not "360.0"
+// - Max sentence length 82 characters including CRLF, longer is truncated
+//   and isValid() returns false
+// - No Arduino dependency, tested on the host (test/test_nmea0183.cpp)
+
+class NmeaSentence {
+
+public:
+
+    void begin(const char* talker, const char* type);
+    void fixed(float value, uint8_t decimals);
+    void fixedAbs(float value, uint8_t decimals);
+    void heading(float deg, uint8_t decimals);
+    void text(const char* field);
+    void empty();
+    size_t end();
+
+    const char* c_str() const { return buf; }
+    size_t length() const { return len; }
+    bool isValid() const { return !overflow; }
+
+    static uint8_t checksum(const char* sentence, size_t len);
+
+private:
+
+    void put(char c);
+    void field();
+    void putFixed(int32_t scaled, uint8_t decimals);
+
+    static constexpr size_t MAX_LEN = 82;
+    char buf[MAX_LEN + 1];
+    size_t len = 0;
+    bool overflow = false;
+
+};
+
+// === G L O B A L  N M E A 0 1 8 3  S E N T E N C E  B U I L D E R S ===
+//
+// - Heading, attitude and rate of turn sentences from the compass values,
+//   talker "HC" (heading, magnetic compass)
+// - HDG: sensor heading, deviation and variation with E/W
+// - HDM: magnetic heading, HDT: true heading
+// - XDR: pitch and roll as angular transducers (PTCH, ROLL)
+// - ROT: rate of turn in degrees per minute, negative to port
+
+void buildHDG(NmeaSentence& s, float sensor_deg, float dev_deg, float var_deg);
+void buildHDM(NmeaSentence& s, float heading_deg);
+void buildHDT(NmeaSentence& s, float heading_true_deg);
+void buildXDR(NmeaSentence& s, float pitch_deg, float roll_deg);
+void buildROT(NmeaSentence& s, float rot_deg_min);
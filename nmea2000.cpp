@@ -0,0 +1,137 @@
+#include "nmea2000.h"
+
+// === S T A T I C ===
+
+static constexpr float TWO_PI_F = 6.28318531f;
+
+// Little-endian field writers
+static void put16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put32(uint8_t* p, uint32_t v) {
+    for (uint8_t i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static bool valid(float x) {
+    return !isnan(x) && isfinite(x);
+}
+
+// Unsigned angle 0...2π at 1e-4 rad, 0xFFFF = n/a
+static uint16_t angleU16(float rad) {
+    if (!valid(rad)) return 0xFFFF;
+    rad = fmodf(rad, TWO_PI_F);
+    if (rad < 0.0f) rad += TWO_PI_F;
+    long v = lroundf(rad * 10000.0f);
+    if (v > 62831) v = 0; // Rounded up to a full circle
+    return (uint16_t)v;
+}
+
+// Signed value at the given resolution, saturated below the n/a value
+static int16_t scaledI16(float value, float resolution) {
+    if (!valid(value)) return INT16_MAX;
+    const float v = roundf(value / resolution);
+    if (v >= (float)(INT16_MAX - 1)) return INT16_MAX - 1;
+    if (v <= (float)(INT16_MIN + 1)) return INT16_MIN + 1;
+    return (int16_t)v;
+}
+
+static int32_t scaledI32(float value, double resolution) {
+    if (!valid(value)) return INT32_MAX;
+    const double v = round((double)value / resolution);
+    if (v >= (double)(INT32_MAX - 1)) return INT32_MAX - 1;
+    if (v <= (double)(INT32_MIN + 1)) return INT32_MIN + 1;
+    return (int32_t)v;
+}
+
+// Start a full 8-byte frame, unused bytes reserved as 0xFF
+static void beginFrame(N2kFrame& f, uint8_t priority, uint32_t pgn, uint8_t source, uint8_t dest = N2K_ADDR_GLOBAL) {
+    f.id = n2kCanId(priority, pgn, source, dest);
+    f.len = 8;
+    for (uint8_t i = 0; i < 8; i++) f.data[i] = 0xFF;
+}
+
+// === G L O B A L  N M E A 2 0 0 0  F R A M E S ===
+
+// 29-bit identifier: PDU1 (PF < 240) carries the destination in PS, PDU2 is broadcast
+uint32_t n2kCanId(uint8_t priority, uint32_t pgn, uint8_t source, uint8_t dest) {
+    const uint8_t pf = (uint8_t)(pgn >> 8);
+    uint32_t id = ((uint32_t)(priority & 0x07) << 26) | ((pgn & 0x3FFFF) << 8) | source;
+    if (pf < 240) id = (id & ~0xFF00u) | ((uint32_t)dest << 8);
+    return id;
+}
+
+// PGN from an identifier, destination stripped for PDU1
+uint32_t n2kPgn(uint32_t id) {
+    const uint8_t pf = (uint8_t)(id >> 16);
+    const uint32_t pgn = (id >> 8) & 0x3FFFF;
+    return pf < 240 ? (pgn & 0x3FF00) : pgn;
+}
+
+// Destination from an identifier, global for PDU2
+uint8_t n2kDest(uint32_t id) {
+    const uint8_t pf = (uint8_t)(id >> 16);
+    return pf < 240 ? (uint8_t)(id >> 8) : N2K_ADDR_GLOBAL;
+}
+
+// 64-bit NAME, bit 63 = arbitrary address capable
+uint64_t n2kEncodeName(const N2kName& n) {
+    uint64_t name = 0;
+    name |= (uint64_t)(n.unique_number & 0x1FFFFF);
+    name |= (uint64_t)(n.manufacturer_code & 0x7FF) << 21;
+    name |= (uint64_t)n.device_instance << 32;
+    name |= (uint64_t)n.device_function << 40;
+    name |= (uint64_t)(n.device_class & 0x7F) << 49;
+    name |= (uint64_t)(n.system_instance & 0x0F) << 56;
+    name |= (uint64_t)(n.industry_group & 0x07) << 60;
+    name |= (uint64_t)1 << 63;
+    return name;
+}
+
+// PGN 127250 Vessel Heading, priority 2
+void n2kVesselHeading(N2kFrame& f, uint8_t source, uint8_t sid, float heading_rad, float deviation_rad, float variation_rad, uint8_t reference) {
+    beginFrame(f, 2, N2K_PGN_VESSEL_HEADING, source);
+    f.data[0] = sid;
+    put16(&f.data[1], angleU16(heading_rad));
+    put16(&f.data[3], (uint16_t)scaledI16(deviation_rad, 1e-4f));
+    put16(&f.data[5], (uint16_t)scaledI16(variation_rad, 1e-4f));
+    f.data[7] = 0xFC | (reference & 0x03);
+}
+
+// PGN 127251 Rate of Turn, priority 2
+void n2kRateOfTurn(N2kFrame& f, uint8_t source, uint8_t sid, float rot_rad_s) {
+    beginFrame(f, 2, N2K_PGN_RATE_OF_TURN, source);
+    f.data[0] = sid;
+    put32(&f.data[1], (uint32_t)scaledI32(rot_rad_s, 3.125e-8));
+}
+
+// PGN 127257 Attitude, priority 3
+void n2kAttitude(N2kFrame& f, uint8_t source, uint8_t sid, float yaw_rad, float pitch_rad, float roll_rad) {
+    beginFrame(f, 3, N2K_PGN_ATTITUDE, source);
+    f.data[0] = sid;
+    put16(&f.data[1], (uint16_t)scaledI16(yaw_rad, 1e-4f));
+    put16(&f.data[3], (uint16_t)scaledI16(pitch_rad, 1e-4f));
+    put16(&f.data[5], (uint16_t)scaledI16(roll_rad, 1e-4f));
+}
+
+// PGN 60928 ISO Address Claim to global, priority 6
+void n2kAddressClaim(N2kFrame& f, uint8_t source, uint64_t name) {
+    beginFrame(f, 6, N2K_PGN_ADDRESS_CLAIM, source);
+    for (uint8_t i = 0; i < 8; i++) f.data[i] = (uint8_t)(name >> (8 * i));
+}
+
+// PGN 59904 ISO Request, returns the requested PGN
+bool n2kParseRequest(const N2kFrame& f, uint32_t& requested_pgn) {
+    if (n2kPgn(f.id) != N2K_PGN_ISO_REQUEST || f.len < 3) return false;
+    requested_pgn = (uint32_t)f.data[0] | ((uint32_t)f.data[1] << 8) | ((uint32_t)f.data[2] << 16);
+    return true;
+}
+
+// PGN 60928 ISO Address Claim, returns the claimer's NAME
+bool n2kParseAddressClaim(const N2kFrame& f, uint64_t& name) {
+    if (n2kPgn(f.id) != N2K_PGN_ADDRESS_CLAIM || f.len < 8) return false;
+    name = 0;
+    for (uint8_t i = 0; i < 8; i++) name |= (uint64_t)f.data[i] << (8 * i);
+    return true;
+}
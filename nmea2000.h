@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+
+// === G L O B A L  N M E A 2 0 0 0  F R A M E S ===
+//
+// - Pure C++ encoder for single-frame NMEA 2000 PGNs, no Arduino or
+//   ESP-IDF dependencies, so frames can be checked on any host
+// - N2kFrame: 29-bit CAN identifier (priority, PGN, destination, source)
+//   and up to 8 data bytes, multi-byte fields little-endian
+// - 127250 Vessel Heading: SID, heading, deviation, variation 1e-4 rad,
+//   reference (0 = true, 1 = magnetic)
+// - 127251 Rate of Turn: SID, rate 3.125e-8 rad/s (1/32 µrad/s)
+// - 127257 Attitude: SID, yaw, pitch, roll 1e-4 rad
+// - Not available (NaN) fields are sent as the PGN "data not available"
+//   values: 0xFFFF unsigned, 0x7FFF / 0x7FFFFFFF signed
+// - SID ties PGNs from the same sensor sample together, 0...252
+// - 60928 ISO Address Claim with the 64-bit NAME, 59904 ISO Request
+
+static constexpr uint32_t N2K_PGN_ISO_REQUEST     = 59904;
+static constexpr uint32_t N2K_PGN_ADDRESS_CLAIM   = 60928;
+static constexpr uint32_t N2K_PGN_VESSEL_HEADING  = 127250;
+static constexpr uint32_t N2K_PGN_RATE_OF_TURN    = 127251;
+static constexpr uint32_t N2K_PGN_ATTITUDE        = 127257;
+
+static constexpr uint8_t N2K_ADDR_GLOBAL          = 255;
+static constexpr uint8_t N2K_ADDR_NULL            = 254;   // Cannot claim an address
+static constexpr uint8_t N2K_ADDR_MAX             = 251;
+
+static constexpr uint8_t N2K_SID_MAX              = 252;
+
+static constexpr uint8_t N2K_REF_TRUE             = 0;
+static constexpr uint8_t N2K_REF_MAGNETIC         = 1;
+
+struct N2kFrame {
+    uint32_t id = 0;
+    uint8_t len = 0;
+    uint8_t data[8] = {};
+};
+
+struct N2kName {
+    uint32_t unique_number = 0;      // 21 bits
+    uint16_t manufacturer_code = 0;  // 11 bits
+    uint8_t device_instance = 0;
+    uint8_t device_function = 0;
+    uint8_t device_class = 0;        // 7 bits
+    uint8_t system_instance = 0;     // 4 bits
+    uint8_t industry_group = 0;      // 3 bits
+};
+
+uint32_t n2kCanId(uint8_t priority, uint32_t pgn, uint8_t source, uint8_t dest = N2K_ADDR_GLOBAL);
+uint32_t n2kPgn(uint32_t id);
+inline uint8_t n2kSource(uint32_t id) { return (uint8_t)(id & 0xFF); }
+uint8_t n2kDest(uint32_t id);
+inline uint8_t n2kNextSid(uint8_t sid) { return sid >= N2K_SID_MAX ? 0 : sid + 1; }
+
+uint64_t n2kEncodeName(const N2kName& name);
+
+void n2kVesselHeading(N2kFrame& f, uint8_t source, uint8_t sid, float heading_rad, float deviation_rad, float variation_rad, uint8_t reference);
+void n2kRateOfTurn(N2kFrame& f, uint8_t source, uint8_t sid, float rot_rad_s);
+void n2kAttitude(N2kFrame& f, uint8_t source, uint8_t sid, float yaw_rad, float pitch_rad, float roll_rad);
+void n2kAddressClaim(N2kFrame& f, uint8_t source, uint64_t name);
+bool n2kParseRequest(const N2kFrame& f, uint32_t& requested_pgn);
+bool n2kParseAddressClaim(const N2kFrame& f, uint64_t& name);
@@ -0,0 +1,244 @@
+#include "recorder_log.h"
+
+// === P U B L I C ===
+
+// Continue after the existing files (oldest...newest, count of them), start a new file for this boot
+bool RecorderLog::begin(uint32_t oldest, uint32_t newest, uint8_t count) {
+    oldest_seq = oldest;
+    file_seq = newest;
+    boot_seq = newest + 1;
+    file_count = count;
+    block_len = 0;
+    block_has_key = false;
+    return this->openNewFile();
+}
+
+// Append one sample, as a delta to the previous one when possible
+bool RecorderLog::record(const RecorderFrame &f) {
+    if (samples > 0 && f.t_ms == last.t_ms) return false; // No new sensor reading
+
+    uint8_t rec[40];
+    size_t n = 0;
+    if (block_has_key) {
+        n = this->encodeDelta(f, rec);   // 0 = a KEY is needed
+        if (n > 0 && block_len + n > BLOCK_SIZE) {
+            this->writeBlock();
+            n = 0;
+        }
+    }
+    if (n == 0) {
+        n = this->encodeKey(f, rec);
+        this->reserve(n);
+        block_has_key = true;
+    }
+    if (block_len == 0) block_start_ms = this->nowMs();
+    memcpy(block + block_len, rec, n);
+    block_len += n;
+
+    last = f;
+    samples++;
+    return true;
+}
+
+// Append an event record
+void RecorderLog::logEvent(uint8_t code, int32_t arg) {
+    const uint32_t t = this->nowMs();
+    uint8_t rec[10];
+    rec[0] = TAG_EVENT;
+    memcpy(rec + 1, &t, 4);
+    rec[5] = code;
+    memcpy(rec + 6, &arg, 4);
+    this->reserve(sizeof(rec));
+    if (block_len == 0) block_start_ms = t;
+    memcpy(block + block_len, rec, sizeof(rec));
+    block_len += sizeof(rec);
+    events++;
+}
+
+// Write the current block now (before restart, OTA or download)
+void RecorderLog::flush() {
+    this->writeBlock();
+}
+
+// Bounded data loss: a started block is written at latest after FLUSH_MS
+void RecorderLog::handle(const unsigned long now) {
+    if (block_len == 0) return;
+    if ((int32_t)((uint32_t)now - block_start_ms) >= (int32_t)FLUSH_MS) this->writeBlock();
+}
+
+// End of the next download part of at most max_bytes (>= BLOCK_SIZE) from 'from', which is normalized
+RecorderCursor RecorderLog::span(RecorderCursor &from, size_t max_bytes) const {
+    if (from.seq < oldest_seq) {   // First part, or the file was removed since the previous part
+        from.seq = oldest_seq;
+        from.offset = 0;
+    }
+    from.offset = boundary(from.offset);
+
+    RecorderCursor c = from;
+    size_t left = max_bytes;
+    while (c.seq <= file_seq) {
+        const uint32_t size = storage.size(storage.ctx, c.seq);
+        if (c.offset < size && size - c.offset > left) {
+            const uint32_t cut = boundary(c.offset + (uint32_t)left);
+            if (cut > c.offset) c.offset = cut;
+            break;
+        }
+        if (c.offset < size) left -= size - c.offset;
+        c.seq++;
+        c.offset = 0;
+    }
+    return c;
+}
+
+// Next piece of a download part into p, at most n bytes, 0 when c has reached end
+size_t RecorderLog::read(RecorderCursor &c, const RecorderCursor &end, uint8_t* p, size_t n) const {
+    while (c.seq < end.seq || (c.seq == end.seq && c.offset < end.offset)) {
+        size_t want = n;
+        if (c.seq == end.seq && end.offset - c.offset < want) want = end.offset - c.offset;
+        const size_t got = storage.read(storage.ctx, c.seq, c.offset, p, want);
+        if (got > 0) {
+            c.offset += got;
+            return got;
+        }
+        c.seq++;   // End of file, or removed meanwhile
+        c.offset = 0;
+    }
+    return 0;
+}
+
+// === P R I V A T E ===
+
+// Start the next file with its header, removing the oldest beyond MAX_FILES
+bool RecorderLog::openNewFile() {
+    file_seq++;
+
+    if (file_count == 0) oldest_seq = file_seq;
+    while (file_count >= MAX_FILES && oldest_seq < file_seq) {
+        if (storage.remove(storage.ctx, oldest_seq)) file_count--;
+        oldest_seq++;
+    }
+
+    file_bytes = 0;
+    file_open = storage.create(storage.ctx, file_seq);
+    if (!file_open) {
+        write_errors++;
+        return false;
+    }
+
+    RecorderFileHeader h = {};
+    h.magic = RECORDER_MAGIC;
+    h.version = RECORDER_VERSION;
+    h.block_size = BLOCK_SIZE;
+    h.seq = file_seq;
+    h.boot_seq = boot_seq;
+    uint32_t ref_ms = 0, epoch_s = 0;
+    if (storage.clock) storage.clock(storage.ctx, ref_ms, epoch_s);
+    h.epoch_s = epoch_s;
+    h.ref_ms = ref_ms;
+    if (!storage.append(storage.ctx, (const uint8_t*)&h, sizeof(h))) write_errors++;
+    file_bytes = sizeof(h);
+    bytes_written += sizeof(h);
+    file_count++;
+    return true;
+}
+
+// Make room for n bytes in the current block
+bool RecorderLog::reserve(size_t n) {
+    if (block_len + n <= BLOCK_SIZE) return true;
+    this->writeBlock();
+    return n <= BLOCK_SIZE;
+}
+
+// Pad and write the current block, rotating to a new file when the current one is full
+void RecorderLog::writeBlock() {
+    if (block_len == 0) return;
+
+    memset(block + block_len, TAG_PAD, BLOCK_SIZE - block_len);
+    if (file_open && file_bytes + BLOCK_SIZE > MAX_FILE_BYTES) this->openNewFile();
+    if (file_open && storage.append(storage.ctx, block, BLOCK_SIZE)) {
+        file_bytes += BLOCK_SIZE;
+        bytes_written += BLOCK_SIZE;
+        blocks++;
+    } else write_errors++;
+
+    block_len = 0;
+    block_has_key = false;
+}
+
+// millis() from the backend clock
+uint32_t RecorderLog::nowMs() const {
+    uint32_t ms = 0, epoch_s = 0;
+    if (storage.clock) storage.clock(storage.ctx, ms, epoch_s);
+    return ms;
+}
+
+// KEY record: all fields absolute (18 bytes)
+size_t RecorderLog::encodeKey(const RecorderFrame &f, uint8_t* p) const {
+    p[0] = TAG_KEY;
+    memcpy(p + 1, &f.t_ms, 4);
+    memcpy(p + 5, &f.raw_10, 2);
+    p[7] = (uint8_t)f.pitch;
+    p[8] = (uint8_t)f.roll;
+    memcpy(p + 9, &f.hdg_c, 2);
+    memcpy(p + 11, &f.hdg_m, 2);
+    memcpy(p + 13, &f.hdg_t, 2);
+    memcpy(p + 15, &f.rot, 2);
+    p[17] = f.cal;
+    return 18;
+}
+
+// DELTA record: tag, field mask, time step, then zigzag varint differences of the changed fields
+// (bit 0 raw, 1 pitch, 2 roll, 3 compass, 4 magnetic, 5 true, 6 rot, 7 cal as absolute byte),
+// returns 0 if a field became (un)available and a KEY is needed
+size_t RecorderLog::encodeDelta(const RecorderFrame &f, uint8_t* p) const {
+    if ((f.hdg_c == RECORDER_NA_U16) != (last.hdg_c == RECORDER_NA_U16)
+            || (f.hdg_m == RECORDER_NA_U16) != (last.hdg_m == RECORDER_NA_U16)
+            || (f.hdg_t == RECORDER_NA_U16) != (last.hdg_t == RECORDER_NA_U16)
+            || (f.rot == RECORDER_NA_I16) != (last.rot == RECORDER_NA_I16)) return 0;
+
+    const int32_t d[7] = {
+        wrapDiff((int32_t)f.raw_10 - last.raw_10, 3600),
+        (int32_t)f.pitch - last.pitch,
+        (int32_t)f.roll - last.roll,
+        (f.hdg_c == RECORDER_NA_U16) ? 0 : wrapDiff((int32_t)f.hdg_c - last.hdg_c, 36000),
+        (f.hdg_m == RECORDER_NA_U16) ? 0 : wrapDiff((int32_t)f.hdg_m - last.hdg_m, 36000),
+        (f.hdg_t == RECORDER_NA_U16) ? 0 : wrapDiff((int32_t)f.hdg_t - last.hdg_t, 36000),
+        (f.rot == RECORDER_NA_I16) ? 0 : (int32_t)f.rot - last.rot
+    };
+
+    uint8_t mask = 0;
+    for (uint8_t i = 0; i < 7; i++) if (d[i] != 0) mask |= (1 << i);
+    if (f.cal != last.cal) mask |= 0x80;
+
+    size_t n = 0;
+    p[n++] = TAG_DELTA;
+    p[n++] = mask;
+    n += putVarint(p + n, f.t_ms - last.t_ms);
+    for (uint8_t i = 0; i < 7; i++) if (mask & (1 << i)) n += putVarint(p + n, zigzag(d[i]));
+    if (mask & 0x80) p[n++] = f.cal;
+    return n;
+}
+
+// Unsigned LEB128, max 5 bytes
+size_t RecorderLog::putVarint(uint8_t* p, uint32_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+// Shortest difference on a circular range
+int32_t RecorderLog::wrapDiff(int32_t d, int32_t range) {
+    if (d > range / 2) d -= range;
+    if (d < -range / 2) d += range;
+    return d;
+}
+
+// Start of the header or block that contains offset
+uint32_t RecorderLog::boundary(uint32_t offset) {
+    if (offset < sizeof(RecorderFileHeader)) return 0;
+    return sizeof(RecorderFileHeader) + (offset - sizeof(RecorderFileHeader)) / BLOCK_SIZE * BLOCK_SIZE;
+}
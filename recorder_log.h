@@ -0,0 +1,260 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// === R E C O R D E R  L O G ===
+//
+// - Flight recorder log format, writer and decoder, no Arduino dependency:
+//   FlightRecorder feeds it samples and events and provides the LittleFS
+//   backend, host tools and tests use the decoder and an in-memory backend
+// - Format (little endian, tools/recorder2csv.py is the decoder in Python):
+//   - File: 24-byte RecorderFileHeader, then BLOCK_SIZE blocks
+//   - Every block starts with a KEY sample and is padded with 0x00 at the end,
+//     so a damaged block never affects the next one
+//   - KEY: all fields absolute, DELTA: field mask, time step and zigzag
+//     varint differences to the previous sample (typically 4...8 bytes), EVENT
+// - decodeRecorderLog(data, len, on_frame, on_event) calls on_frame(header, frame)
+//   for each KEY and DELTA sample and on_event(header, event) for each event,
+//   returns the number of blocks that were cut short (damaged or unknown record)
+
+struct __attribute__((packed)) RecorderFileHeader {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t reserved;
+    uint16_t block_size;
+    uint32_t seq;          // File sequence number
+    uint32_t boot_seq;     // Sequence number of the first file of this boot
+    uint32_t epoch_s;      // System time at file start if set, else 0
+    uint32_t ref_ms;       // millis() at file start
+};
+static_assert(sizeof(RecorderFileHeader) == 24, "RecorderFileHeader size");
+
+// One sample in the quantized form that is stored
+struct RecorderFrame {
+    uint32_t t_ms = 0;
+    uint16_t raw_10 = 0;   // CMPS14 bearing, 0.1°
+    int8_t pitch = 0;      // CMPS14 pitch and roll, 1°
+    int8_t roll = 0;
+    uint16_t hdg_c = 0;    // Compass, magnetic and true heading, 0.01°, 0xFFFF = n/a
+    uint16_t hdg_m = 0;
+    uint16_t hdg_t = 0;
+    int16_t rot = 0;       // Rate of turn, 1e-4 rad/s, INT16_MIN = n/a
+    uint8_t cal = 0;
+};
+
+struct RecorderEvent {
+    uint32_t t_ms;
+    uint8_t code;
+    int32_t arg;
+};
+
+static constexpr uint32_t RECORDER_MAGIC = 0x31524643;   // "CFR1"
+static constexpr uint8_t RECORDER_VERSION = 1;
+static constexpr uint16_t RECORDER_NA_U16 = 0xFFFF;      // Heading not available
+static constexpr int16_t RECORDER_NA_I16 = INT16_MIN;    // Rate of turn not available
+
+// Storage of the numbered log files, function pointers with a context pointer
+struct RecorderStorage {
+    void* ctx = nullptr;
+    bool (*create)(void* ctx, uint32_t seq) = nullptr;                   // Start an empty file, appended to from now on
+    bool (*append)(void* ctx, const uint8_t* p, size_t n) = nullptr;     // Write and flush to the file created last
+    size_t (*read)(void* ctx, uint32_t seq, uint32_t offset, uint8_t* p, size_t n) = nullptr;   // 0 past the end or no file
+    uint32_t (*size)(void* ctx, uint32_t seq) = nullptr;                 // 0 if there is no such file
+    bool (*remove)(void* ctx, uint32_t seq) = nullptr;
+    void (*clock)(void* ctx, uint32_t &ms, uint32_t &epoch_s) = nullptr; // millis() and system time, 0 if not set
+};
+
+// Position in the log for downloads in parts: file and byte offset in it
+struct RecorderCursor {
+    uint32_t seq = 0;      // 0 = from the oldest file
+    uint32_t offset = 0;
+};
+
+// === R E C O R D E R  L O G  C L A S S ===
+//
+// - Writer: record(frame) and logEvent(code, arg) append to the RAM block,
+//   which is written when full, at latest FLUSH_MS after its first record
+//   (handle(now)) or at flush()
+// - Rotation: a new file at each boot (begin) and at MAX_FILE_BYTES, the
+//   oldest removed beyond MAX_FILES
+// - Download in parts: span(from, max_bytes) normalizes from (first file, or
+//   the oldest one if from was removed meanwhile) and returns where a part of
+//   at most max_bytes ends. Parts end at a header or block boundary, so the
+//   parts concatenated decode like the files. read(c, end, p, n) then copies
+//   the part piece by piece
+
+class RecorderLog {
+
+public:
+
+    static constexpr size_t BLOCK_SIZE            = 1024;
+    static constexpr uint32_t MAX_FILE_BYTES      = 131072;
+    static constexpr uint8_t MAX_FILES            = 8;
+    static constexpr unsigned long FLUSH_MS       = 60013;
+
+    explicit RecorderLog(const RecorderStorage &backend) : storage(backend) {}
+
+    bool begin(uint32_t oldest, uint32_t newest, uint8_t count);
+    bool record(const RecorderFrame &f);
+    void logEvent(uint8_t code, int32_t arg);
+    void flush();
+    void handle(const unsigned long now);
+    RecorderCursor span(RecorderCursor &from, size_t max_bytes) const;
+    size_t read(RecorderCursor &c, const RecorderCursor &end, uint8_t* p, size_t n) const;
+    bool isEnd(const RecorderCursor &c) const { return c.seq > file_seq; }
+
+    uint32_t getSamples() const { return samples; }
+    uint32_t getEvents() const { return events; }
+    uint32_t getBlocks() const { return blocks; }
+    uint32_t getBytesWritten() const { return bytes_written; }
+    uint32_t getWriteErrors() const { return write_errors; }
+    uint32_t getFileSeq() const { return file_seq; }
+    uint32_t getOldestSeq() const { return oldest_seq; }
+    uint8_t getFileCount() const { return file_count; }
+
+private:
+
+    static constexpr uint8_t TAG_PAD   = 0x00;
+    static constexpr uint8_t TAG_KEY   = 0x01;
+    static constexpr uint8_t TAG_DELTA = 0x02;
+    static constexpr uint8_t TAG_EVENT = 0x03;
+
+    bool openNewFile();
+    bool reserve(size_t n);
+    void writeBlock();
+    uint32_t nowMs() const;
+    size_t encodeKey(const RecorderFrame &f, uint8_t* p) const;
+    size_t encodeDelta(const RecorderFrame &f, uint8_t* p) const;
+    static size_t putVarint(uint8_t* p, uint32_t v);
+    static uint32_t zigzag(int32_t v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+    static int32_t wrapDiff(int32_t d, int32_t range);
+    static uint32_t boundary(uint32_t offset);
+
+    RecorderStorage storage;
+    bool file_open = false;
+    uint32_t file_bytes = 0;
+
+    // Current block
+    uint8_t block[BLOCK_SIZE];
+    size_t block_len = 0;
+    bool block_has_key = false;
+    uint32_t block_start_ms = 0;
+    RecorderFrame last;
+
+    // Files
+    uint32_t file_seq = 0;
+    uint32_t boot_seq = 0;
+    uint32_t oldest_seq = 0;
+    uint8_t file_count = 0;
+
+    // Debug
+    uint32_t samples = 0;
+    uint32_t events = 0;
+    uint32_t blocks = 0;
+    uint32_t bytes_written = 0;
+    uint32_t write_errors = 0;
+
+};
+
+// === D E C O D E R ===
+
+// Unsigned LEB128, false if it runs past the end
+inline bool recorderVarint(const uint8_t* p, size_t len, size_t& pos, uint32_t& v) {
+    v = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (pos >= len) return false;
+        const uint8_t b = p[pos++];
+        v |= (uint32_t)(b & 0x7F) << shift;
+        if (b < 0x80) return true;
+    }
+    return false;
+}
+
+// One block, false if it was cut short
+template <typename OnFrame, typename OnEvent>
+bool decodeRecorderBlock(const uint8_t* b, size_t len, const RecorderFileHeader& h, OnFrame& on_frame, OnEvent& on_event) {
+    RecorderFrame f;
+    bool have_key = false;
+    size_t pos = 0;
+    while (pos < len) {
+        const uint8_t tag = b[pos++];
+        if (tag == 0x00) return true;   // Padding
+        if (tag == 0x01) {
+            if (pos + 17 > len) return false;
+            memcpy(&f.t_ms, b + pos, 4);
+            memcpy(&f.raw_10, b + pos + 4, 2);
+            f.pitch = (int8_t)b[pos + 6];
+            f.roll = (int8_t)b[pos + 7];
+            memcpy(&f.hdg_c, b + pos + 8, 2);
+            memcpy(&f.hdg_m, b + pos + 10, 2);
+            memcpy(&f.hdg_t, b + pos + 12, 2);
+            memcpy(&f.rot, b + pos + 14, 2);
+            f.cal = b[pos + 16];
+            pos += 17;
+            have_key = true;
+            on_frame(h, f);
+        } else if (tag == 0x02) {
+            if (!have_key || pos >= len) return false;
+            const uint8_t mask = b[pos++];
+            uint32_t dt;
+            if (!recorderVarint(b, len, pos, dt)) return false;
+            f.t_ms += dt;
+            int32_t d[7] = {};
+            for (int i = 0; i < 7; i++) {
+                if (!(mask & (1 << i))) continue;
+                uint32_t z;
+                if (!recorderVarint(b, len, pos, z)) return false;
+                d[i] = (int32_t)(z >> 1) ^ -(int32_t)(z & 1);
+            }
+            auto wrap = [](int32_t v, int32_t range) { v %= range; return (v < 0) ? v + range : v; };
+            f.raw_10 = (uint16_t)wrap(f.raw_10 + d[0], 3600);
+            f.pitch = (int8_t)(f.pitch + d[1]);
+            f.roll = (int8_t)(f.roll + d[2]);
+            if (f.hdg_c != RECORDER_NA_U16) f.hdg_c = (uint16_t)wrap(f.hdg_c + d[3], 36000);
+            if (f.hdg_m != RECORDER_NA_U16) f.hdg_m = (uint16_t)wrap(f.hdg_m + d[4], 36000);
+            if (f.hdg_t != RECORDER_NA_U16) f.hdg_t = (uint16_t)wrap(f.hdg_t + d[5], 36000);
+            if (f.rot != RECORDER_NA_I16) f.rot = (int16_t)(f.rot + d[6]);
+            if (mask & 0x80) {
+                if (pos >= len) return false;
+                f.cal = b[pos++];
+            }
+            on_frame(h, f);
+        } else if (tag == 0x03) {
+            if (pos + 9 > len) return false;
+            RecorderEvent e;
+            memcpy(&e.t_ms, b + pos, 4);
+            e.code = b[pos + 4];
+            memcpy(&e.arg, b + pos + 5, 4);
+            pos += 9;
+            on_event(h, e);
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Whole log: file headers and their blocks, oldest first
+template <typename OnFrame, typename OnEvent>
+size_t decodeRecorderLog(const uint8_t* data, size_t len, OnFrame on_frame, OnEvent on_event) {
+    RecorderFileHeader h = {};
+    bool have_header = false;
+    size_t pos = 0, damaged = 0;
+    while (pos < len) {
+        uint32_t magic = 0;
+        if (pos + sizeof(h) <= len) memcpy(&magic, data + pos, 4);
+        if (magic == RECORDER_MAGIC) {
+            memcpy(&h, data + pos, sizeof(h));
+            have_header = h.block_size > 0;
+            pos += sizeof(h);
+            continue;
+        }
+        if (!have_header) break;
+        const size_t n = (len - pos < h.block_size) ? len - pos : h.block_size;
+        if (!decodeRecorderBlock(data + pos, n, h, on_frame, on_event)) damaged++;
+        pos += n;
+    }
+    return damaged;
+}
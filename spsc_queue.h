@@ -0,0 +1,50 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+
+// === S P S C Q U E U E  C L A S S  T E M P L A T E ===
+//
+// - Lock-free single producer, single consumer ring queue
+// - Producer and consumer may run in different tasks (e.g. the ESP-NOW
+//   receive callback in the WiFi task and loop()), no locks, no allocation
+// - N must be a power of two, one slot is never left unused: head and tail
+//   run freely and are masked on access
+// - push() returns false when full, pop() returns false when empty
+
+template <typename T, size_t N>
+class SpscQueue {
+
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscQueue size must be a power of two");
+
+public:
+
+    // Producer side
+    bool push(const T& item) {
+        const uint32_t head = head_idx.load(std::memory_order_relaxed);
+        if (head - tail_idx.load(std::memory_order_acquire) >= N) return false;
+        slots[head & (N - 1)] = item;
+        head_idx.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side
+    bool pop(T& out) {
+        const uint32_t tail = tail_idx.load(std::memory_order_relaxed);
+        if (tail == head_idx.load(std::memory_order_acquire)) return false;
+        out = slots[tail & (N - 1)];
+        tail_idx.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t size() const { return head_idx.load(std::memory_order_acquire) - tail_idx.load(std::memory_order_acquire); }
+    bool empty() const { return this->size() == 0; }
+    static constexpr size_t capacity() { return N; }
+
+private:
+
+    T slots[N];
+    std::atomic<uint32_t> head_idx{0};
+    std::atomic<uint32_t> tail_idx{0};
+
+};
@@ -0,0 +1,88 @@
+// Deviation lookup speed: lookup table against direct evaluation of the harmonic model
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "test.h"
+#include "../harmonic.h"
+
+static constexpr int LOOKUPS = 2000000;
+static constexpr int BUILDS = 20000;
+static constexpr double MIN_LOOKUPS_S = 2e7;   // Host floor, the ESP32 needs ~50/s
+
+static const HarmonicCoeffs HC = { 1.5f, -4.0f, 3.0f, 1.2f, -0.8f };
+static volatile float sink;
+
+// Seconds per call of fn over rounds
+template <typename F>
+static double timePerCall(int rounds, F fn) {
+    using clock = std::chrono::steady_clock;
+    const auto t0 = clock::now();
+    for (int i = 0; i < rounds; i++) fn(i);
+    return std::chrono::duration<double>(clock::now() - t0).count() / rounds;
+}
+
+// The table build before the recurrences: 4 trig calls per entry
+static void buildDirect(float* t, const HarmonicCoeffs& hc) {
+    for (int i = 0; i < 360; i++) {
+        const float th = i * (float)M_PI / 180.0f;
+        t[i] = hc.A + hc.B*sinf(th) + hc.C*cosf(th) + hc.D*sinf(2*th) + hc.E*cosf(2*th);
+    }
+}
+
+int main() {
+    static DeviationLookupT<360, float> lut;
+    static DeviationLookupT<360, int16_t> lut16;
+    lut.build(HC);
+    lut16.build(HC);
+
+    // Headings the way the CMPS14 delivers them, tenths of a degree
+    const double direct_s = timePerCall(LOOKUPS, [](int i) { sink = sink + computeDeviation(HC, (i % 3600) * 0.1f); });
+    const double lut_s    = timePerCall(LOOKUPS, [](int i) { sink = sink + lut.lookup((i % 3600) * 0.1f); });
+    const double lut16_s  = timePerCall(LOOKUPS, [](int i) { sink = sink + lut16.lookup((i % 3600) * 0.1f); });
+    const double phase_s  = timePerCall(LOOKUPS, [](int i) { sink = sink + lut.lookupPhase((uint32_t)i * 2654435761u); });
+    // The reader pin (two locked read-modify-writes on x86) is most of the lookup time on the host,
+    // on the ESP32 four sinf/cosf calls cost far more than the two S32C1I atomics
+    printf("deviation_lut: direct %5.1f ns, lookup() %5.1f ns (%.1fx), int16_t %5.1f ns, lookupPhase() %5.1f ns\n",
+        direct_s * 1e9, lut_s * 1e9, direct_s / lut_s, lut16_s * 1e9, phase_s * 1e9);
+
+    static float table[360];
+    const double build_direct_s = timePerCall(BUILDS, [](int) { buildDirect(table, HC); sink = sink + table[7]; });
+    const double build_s        = timePerCall(BUILDS, [](int) { lut.build(HC); });
+    printf("deviation_lut: build 360 entries, trig per entry %.1f us, recurrence %.1f us (%.1fx)\n",
+        build_direct_s * 1e6, build_s * 1e6, build_direct_s / build_s);
+
+    // Lookups from two other threads while the loop rebuilds 45 entries per step
+    static DeviationLookup shared;
+    shared.build(HC);
+    std::atomic<bool> done{false};
+    std::atomic<uint32_t> reads{0};
+    std::thread readers[2];
+    for (auto& t : readers) {
+        t = std::thread([&]() {
+            uint32_t n = 0;
+            float acc = 0.0f;
+            while (!done.load(std::memory_order_relaxed)) acc += shared.lookup((n++ % 3600) * 0.1f);
+            reads += n;
+            sink = acc;
+        });
+    }
+    using clock = std::chrono::steady_clock;
+    const auto t0 = clock::now();
+    uint32_t published = 0;
+    for (int i = 0; i < BUILDS; i++) {
+        shared.rebuild({ (float)i, -4.0f, 3.0f, 1.2f, -0.8f });
+        while (!shared.buildStep(45)) {}
+        published++;
+    }
+    done = true;
+    for (auto& t : readers) t.join();
+    const double conc_s = std::chrono::duration<double>(clock::now() - t0).count();
+    printf("deviation_lut: concurrent, %.1f M lookups/s, %.0f tables/s, %u build waits, %u lookups during build\n",
+        reads.load() / conc_s * 1e-6, published / conc_s, shared.getBuildWaits(), shared.getReadsDuringBuild());
+
+    CHECK(1.0 / lut_s > MIN_LOOKUPS_S);
+    CHECK(published == (uint32_t)BUILDS);
+    CHECK(build_s < build_direct_s);
+    return TEST_RESULT();
+}
@@ -0,0 +1,78 @@
+// Harmonic solver speed: DFT and Givens QR paths against the earlier Gauss-Jordan solver
+
+#include <chrono>
+#include <random>
+#include "test.h"
+#include "gauss_jordan_ref.h"
+
+static constexpr int CARDINAL_ROUNDS = 200000;   // 8 points, order 2
+static constexpr int SWING_ROUNDS = 50000;       // 36 uneven weighted points, order 2 and 4
+static constexpr double MIN_SOLVES_S = 2e4;      // Host floor, the ESP32 solves a few per second at most
+
+static volatile float sink;
+
+// Seconds per call of fn over rounds
+template <typename F>
+static double timePerCall(int rounds, F fn) {
+    using clock = std::chrono::steady_clock;
+    const auto t0 = clock::now();
+    for (int i = 0; i < rounds; i++) fn(i);
+    return std::chrono::duration<double>(clock::now() - t0).count() / rounds;
+}
+
+static void report(const char* what, double new_s, double ref_s) {
+    printf("harmonic: %-22s new %7.0f ns, Gauss-Jordan %7.0f ns, %.1fx\n", what, new_s * 1e9, ref_s * 1e9, ref_s / new_s);
+}
+
+int main() {
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> dev(-10.0f, 10.0f), hdg(0.0f, 360.0f), w(0.5f, 4.0f);
+
+    // 8 cardinal points, the calibration of the web UI
+    float cardinal[64][8];
+    DeviationPoint cardinal_pts[64][8];
+    for (int j = 0; j < 64; j++) {
+        for (int i = 0; i < 8; i++) {
+            cardinal[j][i] = dev(rng);
+            cardinal_pts[j][i] = { headings_deg[i], cardinal[j][i], 1.0f };
+        }
+    }
+    const double dft_s = timePerCall(CARDINAL_ROUNDS, [&](int i) {
+        sink = sink + computeHarmonicCoeffs(cardinal[i & 63]).B;
+    });
+    const double gj8_s = timePerCall(CARDINAL_ROUNDS, [&](int i) {
+        float x[5];
+        solveGaussJordanRef(cardinal_pts[i & 63], 8, 2, x);
+        sink = sink + x[1];
+    });
+    report("8 cardinal, DFT", dft_s, gj8_s);
+
+    // Uneven weighted swing
+    DeviationPoint swing[64][36];
+    for (int j = 0; j < 64; j++) {
+        for (int i = 0; i < 36; i++) swing[j][i] = { hdg(rng), dev(rng), w(rng) };
+    }
+    double givens_s[2], gj_s[2];
+    const uint8_t orders[2] = { 2, HARMONIC_MAX_ORDER };
+    for (int o = 0; o < 2; o++) {
+        givens_s[o] = timePerCall(SWING_ROUNDS, [&](int i) {
+            HarmonicFit fit;
+            solveHarmonicFit(swing[i & 63], 36, orders[o], fit);
+            sink = sink + fit.a0;
+        });
+        gj_s[o] = timePerCall(SWING_ROUNDS, [&](int i) {
+            float x[2 * HARMONIC_MAX_ORDER + 1];
+            solveGaussJordanRef(swing[i & 63], 36, orders[o], x);
+            sink = sink + x[0];
+        });
+        char what[32];
+        snprintf(what, sizeof(what), "36 uneven, Givens o%u", orders[o]);
+        report(what, givens_s[o], gj_s[o]);
+    }
+    printf("harmonic: Givens includes residuals and RMS, Gauss-Jordan only the coefficients\n");
+
+    CHECK(1.0 / dft_s > MIN_SOLVES_S);
+    CHECK(1.0 / givens_s[1] > MIN_SOLVES_S);
+    CHECK(dft_s < gj8_s);
+    return TEST_RESULT();
+}
@@ -0,0 +1,83 @@
+// Heading path per update: binary angles against float degrees, time and agreement
+
+#include <chrono>
+#include "test.h"
+#include "../heading_filter.h"
+
+static constexpr int SAMPLES = 2000000;
+static constexpr double MAX_DIFF_DEG = 1e-3;     // Paths agree within this
+static constexpr double MIN_UPDATES_S = 5e6;     // Host floor, the ESP32 needs ~50/s
+
+// Bearing trace in tenths of a degree: slow turns through north, sensor noise
+static uint16_t bearingAt(int i) {
+    const int turn = (i / 4000) % 2 ? 1 : -1;
+    const int noise = (int)((uint32_t)i * 2654435761u >> 29) - 4;   // -4...3
+    return (uint16_t)(((3600 * 8 + turn * (i % 4000) + noise) % 3600 + 3600) % 3600);
+}
+
+struct PathRun {
+    double s = 0.0;
+    float compass[4096], heading[4096], heading_true[4096], rot[4096];
+};
+
+// Run one path over the trace, keep the first outputs for comparison
+template <typename F>
+static void run(F process, const HeadingParams& p, const DeviationLookup& lut, PathRun& out) {
+    using clock = std::chrono::steady_clock;
+    HeadingState st;
+    const auto t0 = clock::now();
+    for (int i = 0; i < SAMPLES; i++) {
+        process(st, p, lut, bearingAt(i), 20UL * i);
+        if (i < 4096) {
+            out.compass[i] = st.compass_deg;
+            out.heading[i] = st.heading_deg;
+            out.heading_true[i] = st.heading_true_deg;
+            out.rot[i] = st.rot_rad;
+        }
+    }
+    out.s = std::chrono::duration<double>(clock::now() - t0).count();
+}
+
+// Largest difference of two heading series on the circle
+static double maxArc(const float* a, const float* b, int n) {
+    double worst = 0.0;
+    for (int i = 0; i < n; i++) {
+        double d = fabs((double)a[i] - b[i]);
+        if (d > 180.0) d = 360.0 - d;
+        if (d > worst) worst = d;
+    }
+    return worst;
+}
+
+int main() {
+    static DeviationLookup lut;
+    lut.build({ 1.5f, -4.0f, 3.0f, 1.2f, -0.8f });
+    HeadingParams p;
+    p.offset_deg = 2.5f;
+    p.variation_deg = 8.3f;
+
+    static PathRun fixed, flt;
+    run(processHeadingFixed, p, lut, fixed);
+    run(processHeadingFloat, p, lut, flt);
+
+    const double d_c = maxArc(fixed.compass, flt.compass, 4096);
+    const double d_m = maxArc(fixed.heading, flt.heading, 4096);
+    const double d_t = maxArc(fixed.heading_true, flt.heading_true, 4096);
+    double d_rot = 0.0;
+    for (int i = 1; i < 4096; i++) d_rot = fmax(d_rot, fabs((double)fixed.rot[i] - flt.rot[i]));
+    bool in_range = true;
+    for (int i = 0; i < 4096; i++) {
+        if (!(fixed.heading[i] >= 0.0f && fixed.heading[i] < 360.0f)) in_range = false;
+        if (!(flt.heading[i] >= 0.0f && flt.heading[i] < 360.0f)) in_range = false;
+    }
+
+    printf("heading_filter: binary angles %.1f ns/update, float degrees %.1f ns/update, %.2fx\n",
+        fixed.s * 1e9 / SAMPLES, flt.s * 1e9 / SAMPLES, flt.s / fixed.s);
+    printf("heading_filter: max difference C %.2e, M %.2e, T %.2e deg, ROT %.2e rad/s\n", d_c, d_m, d_t, d_rot);
+
+    CHECK(d_c < MAX_DIFF_DEG && d_m < MAX_DIFF_DEG && d_t < MAX_DIFF_DEG);
+    CHECK(d_rot < 1e-3);
+    CHECK(in_range);
+    CHECK(SAMPLES / fixed.s > MIN_UPDATES_S);
+    return TEST_RESULT();
+}
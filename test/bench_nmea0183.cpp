@@ -0,0 +1,56 @@
+// NMEA 0183 sentence throughput: fixed-point builders against snprintf("%.1f")
+
+#include <chrono>
+#include <string.h>
+#include "test.h"
+#include "../nmea0183.h"
+
+static constexpr int ROUNDS = 200000;             // One round: HDG, HDM, HDT, XDR, ROT
+static constexpr double MIN_SENTENCES_S = 1e6;    // Host floor, the ESP32 needs ~40/s
+
+static volatile uint32_t sink;
+
+// snprintf based equivalent of one round
+static void buildPrintf(char* out, size_t n, float h, float p, float r, float rot) {
+    int len = 0;
+    len = snprintf(out, n, "$HCHDG,%.1f,%.1f,E,%.1f,E", h, 1.5f, 7.0f);
+    sink += NmeaSentence::checksum(out, len);
+    len = snprintf(out, n, "$HCHDM,%.1f,M", h);
+    sink += NmeaSentence::checksum(out, len);
+    len = snprintf(out, n, "$HCHDT,%.1f,T", h + 7.0f);
+    sink += NmeaSentence::checksum(out, len);
+    len = snprintf(out, n, "$HCXDR,A,%.1f,D,PTCH,A,%.1f,D,ROLL", p, r);
+    sink += NmeaSentence::checksum(out, len);
+    len = snprintf(out, n, "$HCROT,%.1f,A", rot);
+    sink += NmeaSentence::checksum(out, len);
+}
+
+int main() {
+    using clock = std::chrono::steady_clock;
+    NmeaSentence s;
+    char buf[96];
+
+    auto t0 = clock::now();
+    for (int i = 0; i < ROUNDS; i++) {
+        const float h = (i % 3600) * 0.1f, p = (i % 200) * 0.1f - 10.0f, r = (i % 400) * 0.1f - 20.0f;
+        buildHDG(s, h, 1.5f, 7.0f); sink += s.length();
+        buildHDM(s, h);             sink += s.length();
+        buildHDT(s, h + 7.0f);      sink += s.length();
+        buildXDR(s, p, r);          sink += s.length();
+        buildROT(s, r * 3.0f);      sink += s.length();
+    }
+    const double fixed_s = std::chrono::duration<double>(clock::now() - t0).count();
+
+    t0 = clock::now();
+    for (int i = 0; i < ROUNDS; i++) {
+        const float h = (i % 3600) * 0.1f, p = (i % 200) * 0.1f - 10.0f, r = (i % 400) * 0.1f - 20.0f;
+        buildPrintf(buf, sizeof(buf), h, p, r, r * 3.0f);
+    }
+    const double printf_s = std::chrono::duration<double>(clock::now() - t0).count();
+
+    const double n = 5.0 * ROUNDS;
+    printf("nmea0183: fixed-point %.0f sentences/s (%.0f ns each), snprintf %.0f sentences/s (%.0f ns each), %.1fx\n",
+        n / fixed_s, fixed_s * 1e9 / n, n / printf_s, printf_s * 1e9 / n, printf_s / fixed_s);
+    CHECK(n / fixed_s > MIN_SENTENCES_S);
+    return TEST_RESULT();
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <math.h>
+#include "../harmonic.h"
+
+// === R E F E R E N C E  S O L V E R ===
+//
+// - The solver harmonic.cpp had before the DFT/Givens solver: normal
+//   equations MᵀWM·x = MᵀWy with Gauss-Jordan elimination and partial pivoting
+// - Generalized from the 8 fixed headings to any weighted points and order,
+//   8 equal-weight cardinal points of order 2 is the original computeHarmonicCoeffs()
+// - Used by the host tests and benchmarks only
+
+// Solve into x[0...2·order], false if singular
+inline bool solveGaussJordanRef(const DeviationPoint* pts, size_t n, uint8_t order, float* x) {
+    const int m = 2 * order + 1;
+    float A[2 * HARMONIC_MAX_ORDER + 1][2 * HARMONIC_MAX_ORDER + 2] = {};
+
+    for (size_t i = 0; i < n; i++) {
+        const float th = pts[i].hdg_deg * M_PI / 180.0;
+        float v[2 * HARMONIC_MAX_ORDER + 1];
+        v[0] = 1.0f;
+        for (int k = 1; k <= order; k++) {
+            v[2 * k - 1] = sin(k * th);
+            v[2 * k] = cos(k * th);
+        }
+        const float w = pts[i].weight, y = pts[i].dev_deg;
+        for (int r = 0; r < m; r++) {
+            A[r][m] += w * v[r] * y;
+            for (int c = 0; c < m; c++) A[r][c] += w * v[r] * v[c];
+        }
+    }
+
+    for (int i = 0; i < m; i++) {
+        int piv = i;
+        for (int r = i + 1; r < m; r++)
+            if (fabs(A[r][i]) > fabs(A[piv][i])) piv = r;
+        if (piv != i)
+            for (int c = i; c <= m; c++) { float tmp = A[i][c]; A[i][c] = A[piv][c]; A[piv][c] = tmp; }
+        const float diag = A[i][i];
+        if (fabs(diag) < 1e-9) return false;
+        for (int c = i; c <= m; c++) A[i][c] /= diag;
+        for (int r = 0; r < m; r++) {
+            if (r == i) continue;
+            const float f = A[r][i];
+            for (int c = i; c <= m; c++) A[r][c] -= f * A[i][c];
+        }
+    }
+    for (int r = 0; r < m; r++) x[r] = A[r][m];
+    return true;
+}
+
+// Fit coefficients in the same order as the reference solution
+inline void fitToArray(const HarmonicFit& fit, float* x) {
+    x[0] = fit.a0;
+    for (int k = 1; k <= fit.order; k++) {
+        x[2 * k - 1] = fit.s[k];
+        x[2 * k] = fit.c[k];
+    }
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdio.h>
+#include <math.h>
+
+// === H O S T  T E S T  H E L P E R S ===
+//
+// - Minimal checks for the host tests, no framework
+// - CHECK(cond) and CHECK_NEAR(a, b, eps) count and print failures,
+//   TEST_RESULT() prints the summary and is the exit code of main()
+
+static int test_checks = 0;
+static int test_failures = 0;
+
+#define CHECK(cond) do { \
+    test_checks++; \
+    if (!(cond)) { test_failures++; printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); } \
+} while (0)
+
+#define CHECK_NEAR(a, b, eps) do { \
+    test_checks++; \
+    const double _a = (a), _b = (b); \
+    if (!(fabs(_a - _b) <= (eps))) { test_failures++; printf("%s:%d: %s = %.6f, expected %.6f\n", __FILE__, __LINE__, #a, _a, _b); } \
+} while (0)
+
+#define TEST_RESULT() (printf("%s: %d checks, %d failed\n", __FILE__, test_checks, test_failures), test_failures ? 1 : 0)
@@ -0,0 +1,45 @@
+// Binary angles: conversions, output range and shortest arcs
+
+#include "test.h"
+#include "../bam.h"
+
+// Tenths of a degree convert exactly enough to round trip
+static void testFromTenths() {
+    bool ok = true;
+    for (uint16_t t = 0; t < 3600; t++) {
+        if (lroundf(bamToDeg(bamFromTenths(t)) * 10.0f) != t) ok = false;
+    }
+    CHECK(ok);
+    CHECK(bamFromTenths(900) == 0x40000000u);
+    CHECK(bamFromTenths(3600) == 0);   // Wraps
+}
+
+// Outputs stay in [0, 360) and [0, 2π) up to the last binary angle
+static void testOutputRange() {
+    CHECK(bamToDeg(0xFFFFFFFFu) < 360.0f);
+    CHECK(bamToRad(0xFFFFFFFFu) < 6.28318530718f);
+    bool ok = true;
+    for (uint32_t b = 0xFFFFFFFFu; b > 0xFFFFFFFFu - 100000u; b--) {
+        const float d = bamToDeg(b);
+        if (!(d >= 0.0f && d < 360.0f)) ok = false;
+    }
+    CHECK(ok);
+    CHECK_NEAR(bamToDeg(0x80000000u), 180.0, 0.0);
+    CHECK_NEAR(bamToDeg(bamFromDeg(123.456f)), 123.456, 1e-4);
+}
+
+// Multiples of 360° wrap in the conversion, differences are the shortest arc
+static void testWrapAndDiff() {
+    CHECK(bamFromDeg(-90.0f) == bamFromDeg(270.0f));
+    CHECK(bamFromDeg(450.0f) == bamFromDeg(90.0f));
+    CHECK_NEAR(bamDiff(bamFromDeg(1.0f), bamFromDeg(359.0f)) * (360.0 / 4294967296.0), 2.0, 1e-5);
+    CHECK_NEAR(bamDiff(bamFromDeg(359.0f), bamFromDeg(1.0f)) * (360.0 / 4294967296.0), -2.0, 1e-5);
+    CHECK(bamAbsDiff(bamFromDeg(10.0f), bamFromDeg(350.0f)) == bamAbsDiff(bamFromDeg(350.0f), bamFromDeg(10.0f)));
+}
+
+int main() {
+    testFromTenths();
+    testOutputRange();
+    testWrapAndDiff();
+    return TEST_RESULT();
+}
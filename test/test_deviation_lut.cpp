@@ -0,0 +1,179 @@
+// Deviation lookup table: accuracy against direct evaluation, wrap, background build
+
+#include <atomic>
+#include <thread>
+#include "test.h"
+#include "../harmonic.h"
+
+static const HarmonicCoeffs HC = { 1.5f, -4.0f, 3.0f, 1.2f, -0.8f };
+
+// Storage that parks a lookup between reading its two entries while hold is set
+struct HeldCell { float v; };
+static std::atomic<bool> hold{false}, held{false};
+
+template <> struct LutStorage<HeldCell> {
+    static HeldCell encode(float dev_deg) { return { dev_deg }; }
+    static float decode(HeldCell c) {
+        if (hold) {
+            held = true;
+            while (hold) std::this_thread::yield();
+        }
+        return c.v;
+    }
+};
+
+// Largest difference to computeDeviation() over the circle at 0.01° steps
+template <typename Lut>
+static float maxError(const Lut& lut, const HarmonicCoeffs& hc) {
+    float worst = 0.0f;
+    for (int i = 0; i < 36000; i++) {
+        const float hdg = i * 0.01f;
+        worst = fmaxf(worst, fabsf(lut.lookup(hdg) - computeDeviation(hc, hdg)));
+    }
+    return worst;
+}
+
+// Linear interpolation error of 1° spacing, plus quantization of int16_t storage
+static void testAccuracy() {
+    static DeviationLookupT<360, float> f;
+    static DeviationLookupT<360, int16_t> q;
+    static DeviationLookupT<3600, float> fine;
+    CHECK(f.lookup(123.0f) == 0.0f);   // Not built yet
+    f.build(HC);
+    q.build(HC);
+    fine.build(HC);
+    CHECK(maxError(f, HC) < 2e-3f);
+    CHECK(maxError(q, HC) < 2e-3f + 0.005f);
+    CHECK(maxError(fine, HC) < 1e-4f);
+    CHECK((DeviationLookupT<360, int16_t>::bytes() * 2 == DeviationLookupT<360, float>::bytes()));
+}
+
+// Recurrence with reseeding does not drift over a large table
+static void testRecurrenceDrift() {
+    static DeviationLookupT<65536, float> big;
+    big.build(HC);
+    float worst = 0.0f;
+    for (int i = 0; i < 65536; i += 7) {
+        const float hdg = i * (360.0f / 65536.0f);
+        worst = fmaxf(worst, fabsf(big.lookup(hdg) - computeDeviation(HC, hdg)));
+    }
+    CHECK(worst < 1e-4f);
+}
+
+// Any multiple of 360° and negative headings wrap, invalid input is 0
+static void testWrap() {
+    static DeviationLookup lut;
+    lut.build(HC);
+    CHECK_NEAR(lut.lookup(-10.0f), lut.lookup(350.0f), 1e-4);
+    CHECK_NEAR(lut.lookup(725.0f), lut.lookup(5.0f), 1e-4);
+    CHECK_NEAR(lut.lookup(359.999f), lut.lookup(0.0f), 1e-3);
+    CHECK_NEAR(lut.lookupPhase(0x40000000u), lut.lookup(90.0f), 1e-5);
+    CHECK(lut.lookup(NAN) == 0.0f);
+    CHECK(lut.lookup(INFINITY) == 0.0f);
+}
+
+// Background build keeps serving the old table and publishes the same table as build()
+static void testBackgroundBuild() {
+    static DeviationLookup direct, stepped;
+    const HarmonicCoeffs first = { 0.0f, 1.0f, 0.0f, 0.0f, 0.0f };
+    direct.build(HC);
+    stepped.rebuild(first);   // First table built at once
+    CHECK(!stepped.isBuilding());
+    CHECK(stepped.getSwapCount() == 1);
+    const float old90 = stepped.lookup(90.0f);
+
+    stepped.rebuild(HC);
+    CHECK(stepped.isBuilding());
+    int steps = 0;
+    while (!stepped.buildStep(45)) {
+        CHECK_NEAR(stepped.lookup(90.0f), old90, 0.0);
+        steps++;
+    }
+    CHECK(steps == 7);   // 360 / 45 - 1 steps before the publishing one
+    CHECK(!stepped.isBuilding());
+    CHECK(stepped.getSwapCount() == 2);
+    CHECK(stepped.getHash() == computeHarmonicHash(HC));
+    float worst = 0.0f;
+    for (int i = 0; i < 3600; i++) worst = fmaxf(worst, fabsf(stepped.lookup(i * 0.1f) - direct.lookup(i * 0.1f)));
+    CHECK(worst < 1e-5f);
+}
+
+// A build does not overwrite the retired table while a lookup still reads it
+static void testRetiredTableWait() {
+    static DeviationLookupT<360, HeldCell> lut;
+    lut.build({ 1.0f, 0, 0, 0, 0 });
+
+    float seen = 0.0f;
+    hold = true;
+    std::thread reader([&]() { seen = lut.lookup(100.5f); });
+    while (!held) std::this_thread::yield();
+
+    // Reader is parked in the table of generation 1, publish 2 and start 3 into that table
+    CHECK(lut.build({ 2.0f, 0, 0, 0, 0 }));
+    lut.rebuild({ 3.0f, 0, 0, 0, 0 });
+    for (int i = 0; i < 5; i++) CHECK(!lut.buildStep(360));
+    CHECK(lut.getBuildWaits() == 5);
+    CHECK(lut.isBuilding());
+
+    hold = false;
+    reader.join();
+    CHECK(seen == 1.0f);
+    CHECK(lut.buildStep(360));
+    CHECK(lut.lookup(100.5f) == 3.0f);
+}
+
+// Lookups from other threads during continuous rebuilds never see a torn or retired table.
+// Generation g is the constant table g, so any mix of two tables is not a whole number
+// and a retired table overwritten while read shows up as a step back
+static void testConcurrentReaders() {
+    static DeviationLookup lut;
+    constexpr int GENERATIONS = 3000;
+    constexpr int READERS = 3;
+    lut.build({ 1.0f, 0, 0, 0, 0 });
+
+    std::atomic<bool> done{false};
+    std::atomic<int> torn{0}, backwards{0};
+    std::atomic<uint32_t> reads{0};
+    std::thread readers[READERS];
+    for (int r = 0; r < READERS; r++) {
+        readers[r] = std::thread([&, r]() {
+            uint32_t phase = 0x9E3779B9u * (r + 1), n = 0;
+            float last = 0.0f;
+            while (!done.load()) {
+                phase = phase * 1664525u + 1013904223u;
+                const float v = lut.lookupPhase(phase);
+                if (v != floorf(v)) torn++;
+                if (v < last) backwards++;
+                last = v;
+                n++;
+            }
+            reads += n;
+        });
+    }
+
+    int steps = 0;
+    for (int g = 2; g <= GENERATIONS; g++) {
+        lut.rebuild({ (float)g, 0, 0, 0, 0 });
+        while (!lut.buildStep(45)) steps++;
+    }
+    done = true;
+    for (auto& t : readers) t.join();
+
+    printf("  %u lookups, %d build steps, %u swaps, %u waits, %u lookups during build\n",
+        reads.load(), steps, lut.getSwapCount(), lut.getBuildWaits(), lut.getReadsDuringBuild());
+    CHECK(torn == 0);
+    CHECK(backwards == 0);
+    CHECK(lut.getSwapCount() == GENERATIONS);
+    CHECK(lut.lookup(0.0f) == (float)GENERATIONS);
+    CHECK(lut.getReadsDuringBuild() > 0);
+}
+
+int main() {
+    testAccuracy();
+    testRecurrenceDrift();
+    testWrap();
+    testBackgroundBuild();
+    testRetiredTableWait();
+    testConcurrentReaders();
+    return TEST_RESULT();
+}
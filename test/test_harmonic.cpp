@@ -0,0 +1,138 @@
+// Harmonic deviation solver: DFT fast path, Givens QR path and the earlier Gauss-Jordan solver
+
+#include <random>
+#include "test.h"
+#include "gauss_jordan_ref.h"
+
+static std::mt19937 rng(4711);
+
+static float uniform(float lo, float hi) { return std::uniform_real_distribution<float>(lo, hi)(rng); }
+
+// Random coefficients of a typical deviation curve (a few degrees)
+static HarmonicFit randomCurve(uint8_t order) {
+    HarmonicFit f;
+    f.order = order;
+    f.a0 = uniform(-3.0f, 3.0f);
+    for (uint8_t k = 1; k <= order; k++) {
+        f.s[k] = uniform(-5.0f, 5.0f) / k;
+        f.c[k] = uniform(-5.0f, 5.0f) / k;
+    }
+    return f;
+}
+
+// Largest coefficient difference
+static float maxDiff(const HarmonicFit& a, const HarmonicFit& b) {
+    float d = fabsf(a.a0 - b.a0);
+    for (uint8_t k = 1; k <= a.order; k++) d = fmaxf(d, fmaxf(fabsf(a.s[k] - b.s[k]), fabsf(a.c[k] - b.c[k])));
+    return d;
+}
+
+// 8 cardinal points: same A...E as the Gauss-Jordan solver, also with noisy data
+static void testCardinalMatchesGaussJordan() {
+    float worst = 0.0f;
+    bool solved = true;
+    for (int t = 0; t < 200; t++) {
+        float dev[8];
+        DeviationPoint pts[8];
+        for (int i = 0; i < 8; i++) {
+            dev[i] = uniform(-10.0f, 10.0f);
+            pts[i] = { headings_deg[i], dev[i], 1.0f };
+        }
+        const HarmonicCoeffs h = computeHarmonicCoeffs(dev);
+        float x[5];
+        solved &= solveGaussJordanRef(pts, 8, 2, x);
+        const float got[5] = { h.A, h.B, h.C, h.D, h.E };
+        for (int j = 0; j < 5; j++) worst = fmaxf(worst, fabsf(got[j] - x[j]));
+    }
+    CHECK(solved);
+    CHECK_NEAR(worst, 0.0, 1e-4);
+}
+
+// Evenly spaced equal weights take the DFT path and recover the curve of every order
+static void testFastPath() {
+    for (uint8_t order = 1; order <= HARMONIC_MAX_ORDER; order++) {
+        const HarmonicFit truth = randomCurve(order);
+        DeviationPoint pts[16];
+        for (int i = 0; i < 16; i++) {
+            const float hdg = 10.0f + 22.5f * i;   // Start anywhere, wraps past 360°
+            pts[i] = { hdg, evalHarmonicFit(truth, hdg), 2.0f };
+        }
+        HarmonicFit fit;
+        float res[16];
+        CHECK(solveHarmonicFit(pts, 16, order, fit, res));
+        CHECK(fit.ok && fit.fast);
+        CHECK_NEAR(maxDiff(fit, truth), 0.0, 1e-4);
+        CHECK_NEAR(fit.rms_deg, 0.0, 1e-4);
+        CHECK_NEAR(res[7], 0.0, 1e-4);
+    }
+
+    // Order 4 from 8 points aliases, so the fast path is not used
+    DeviationPoint pts[8];
+    for (int i = 0; i < 8; i++) pts[i] = { headings_deg[i], 1.0f, 1.0f };
+    HarmonicFit fit;
+    solveHarmonicFit(pts, 8, 4, fit);
+    CHECK(!fit.fast);
+}
+
+// Uneven weighted points take the Givens path and match the Gauss-Jordan solution
+static void testGivensPath() {
+    float worst_truth = 0.0f, worst_ref = 0.0f;
+    bool solved = true;
+    for (int t = 0; t < 100; t++) {
+        const uint8_t order = 1 + t % HARMONIC_MAX_ORDER;
+        const HarmonicFit truth = randomCurve(order);
+        DeviationPoint pts[40];
+        for (int i = 0; i < 40; i++) {
+            const float hdg = uniform(0.0f, 360.0f);
+            pts[i] = { hdg, evalHarmonicFit(truth, hdg) + uniform(-0.2f, 0.2f), uniform(0.5f, 4.0f) };
+        }
+        HarmonicFit fit;
+        solved &= solveHarmonicFit(pts, 40, order, fit) && !fit.fast;
+        worst_truth = fmaxf(worst_truth, maxDiff(fit, truth));
+
+        float x[2 * HARMONIC_MAX_ORDER + 1], y[2 * HARMONIC_MAX_ORDER + 1];
+        solved &= solveGaussJordanRef(pts, 40, order, x);
+        fitToArray(fit, y);
+        for (int j = 0; j < 2 * order + 1; j++) worst_ref = fmaxf(worst_ref, fabsf(x[j] - y[j]));
+    }
+    CHECK(solved);
+    CHECK(worst_truth < 0.3f);    // Noise of ±0.2°
+    CHECK(worst_ref < 2e-3f);
+}
+
+// Zero weight and invalid points are ignored
+static void testIgnoredPoints() {
+    const HarmonicFit truth = randomCurve(2);
+    DeviationPoint pts[24];
+    for (int i = 0; i < 20; i++) {
+        const float hdg = 18.0f * i + 3.0f * (i % 3);
+        pts[i] = { hdg, evalHarmonicFit(truth, hdg), 1.0f };
+    }
+    pts[20] = { 90.0f, 50.0f, 0.0f };
+    pts[21] = { 180.0f, NAN, 1.0f };
+    pts[22] = { NAN, 1.0f, 1.0f };
+    pts[23] = { 270.0f, -50.0f, -1.0f };
+    HarmonicFit fit;
+    CHECK(solveHarmonicFit(pts, 24, 2, fit));
+    CHECK_NEAR(maxDiff(fit, truth), 0.0, 1e-3);
+}
+
+// A swing over a small sector does not determine the 2nd harmonic
+static void testRankDeficient() {
+    DeviationPoint pts[10];
+    for (int i = 0; i < 10; i++) pts[i] = { 40.0f + 0.5f * i, 1.0f + 0.01f * i, 1.0f };
+    HarmonicFit fit;
+    CHECK(!solveHarmonicFit(pts, 10, 2, fit));
+    CHECK(!fit.ok);
+    CHECK(!solveHarmonicFit(pts, 10, 0, fit));
+    CHECK(!solveHarmonicFit(pts, 10, HARMONIC_MAX_ORDER + 1, fit));
+}
+
+int main() {
+    testCardinalMatchesGaussJordan();
+    testFastPath();
+    testGivensPath();
+    testIgnoredPoints();
+    testRankDeficient();
+    return TEST_RESULT();
+}
@@ -0,0 +1,125 @@
+// Heading filter: binary angle and float paths, warm restart check, batch processing
+
+#include "test.h"
+#include "../heading_filter.h"
+
+static DeviationLookup lut;
+
+// Both paths settle on the same headings, offset, deviation and variation added
+static void testPaths() {
+    HeadingParams p;
+    p.offset_deg = 5.0f;
+    p.variation_deg = -3.0f;
+    HeadingState fx, fl;
+    for (int i = 0; i < 200; i++) {
+        processHeadingFixed(fx, p, lut, 3575, 20UL * i);   // 357.5° + 5° = 2.5°
+        processHeadingFloat(fl, p, lut, 3575, 20UL * i);
+    }
+    const float dev = computeDeviation({ 1.0f, 2.0f, 0.0f, 0.0f, 0.0f }, 2.5f);
+    CHECK_NEAR(fx.compass_deg, 2.5, 1e-3);
+    CHECK_NEAR(fl.compass_deg, 2.5, 1e-3);
+    CHECK_NEAR(fx.heading_deg, 2.5 + dev, 2e-3);
+    CHECK_NEAR(fl.heading_deg, 2.5 + dev, 2e-3);
+    CHECK_NEAR(fx.heading_true_deg, 2.5 + dev - 3.0 + (2.5 + dev - 3.0 < 0 ? 360.0 : 0.0), 2e-3);
+    CHECK_NEAR(fx.heading_true_deg, fl.heading_true_deg, 2e-3);
+    CHECK_NEAR(fx.rot_rad, 0.0, 1e-6);
+    CHECK(fx.sample_ms == 20UL * 199);
+
+    // No variation, no true heading
+    p.variation_deg = NAN;
+    processHeadingFixed(fx, p, lut, 3575, 5000);
+    processHeadingFloat(fl, p, lut, 3575, 5000);
+    CHECK(isnan(fx.heading_true_deg));
+    CHECK(isnan(fl.heading_true_deg));
+}
+
+// Filter follows a turn through north without leaving [0, 360), rate of turn to starboard is positive
+static void testTurnThroughNorth() {
+    static DeviationLookup flat;   // No deviation, rate of turn is the turn rate of the reading
+    flat.build({ 0, 0, 0, 0, 0 });
+    HeadingParams p;
+    HeadingState st;
+    bool in_range = true;
+    for (int i = 0; i < 400; i++) {
+        processHeadingFixed(st, p, flat, (uint16_t)((3500 + i) % 3600), 100UL * i);   // 1°/s
+        if (!(st.compass_deg >= 0.0f && st.compass_deg < 360.0f)) in_range = false;
+    }
+    CHECK(in_range);
+    CHECK_NEAR(st.rot_rad, 1.0 * M_PI / 180.0, 1e-4);
+}
+
+// A restored filter is kept only if the boat did not turn during the restart
+static void testWarmRestart() {
+    HeadingParams p;
+    HeadingState st;
+    st.compass_deg = 100.0f;
+    st.warm_filter_check = true;
+    processHeadingFixed(st, p, lut, 1050, 0);   // 105°, within 10°
+    CHECK(!st.warm_filter_check);
+    CHECK_NEAR(st.compass_deg, 100.0, 1e-3);     // Seeded from the restored value, not yet filtered
+
+    HeadingState turned;
+    turned.compass_deg = 100.0f;
+    turned.warm_filter_check = true;
+    processHeadingFloat(turned, p, lut, 1300, 0);   // 130°, reseeded from the reading
+    CHECK_NEAR(turned.compass_deg, 130.0, 1e-3);
+}
+
+// Batch output equals the per-sample path, outputs not wanted are skipped, leveling applied
+static void testBatch() {
+    constexpr size_t N = 500;
+    uint32_t t[N];
+    uint16_t a[N];
+    int8_t pitch[N], roll[N];
+    for (size_t i = 0; i < N; i++) {
+        t[i] = 1000 + 199 * i;
+        a[i] = (uint16_t)((3590 + 3 * i + (i % 7)) % 3600);
+        pitch[i] = (int8_t)(i % 11 - 5);
+        roll[i] = (int8_t)(i % 41 - 20);
+    }
+    HeadingParams p;
+    p.offset_deg = -1.5f;
+    p.variation_deg = 7.0f;
+    p.pitch_level_deg = 2.0f;
+    p.roll_level_deg = -1.0f;
+
+    RawFrames in;
+    in.t_ms = t;
+    in.angle_10 = a;
+    in.pitch = pitch;
+    in.roll = roll;
+    float hdg[N], rot[N], pd[N], rd[N];
+    ProcessedFrames out;
+    out.heading_deg = hdg;
+    out.rot_rad = rot;
+    out.pitch_deg = pd;
+    out.roll_deg = rd;
+
+    for (int path = 0; path < 2; path++) {
+        HeadingState batch, live;
+        CHECK(processHeadingBatch(in, N, out, batch, p, lut, path == 0) == N);
+        bool same = true, level = true;
+        for (size_t i = 0; i < N; i++) {
+            if (path == 0) processHeadingFixed(live, p, lut, a[i], t[i]);
+            else processHeadingFloat(live, p, lut, a[i], t[i]);
+            if (hdg[i] != live.heading_deg) same = false;
+            if (i > 0 && rot[i] != live.rot_rad) same = false;
+            if (pd[i] != pitch[i] + 2.0f || rd[i] != roll[i] - 1.0f) level = false;
+        }
+        CHECK(same);
+        CHECK(level);
+    }
+
+    RawFrames none;
+    HeadingState st;
+    CHECK(processHeadingBatch(none, N, out, st, p, lut) == 0);
+}
+
+int main() {
+    lut.build({ 1.0f, 2.0f, 0.0f, 0.0f, 0.0f });
+    testPaths();
+    testTurnThroughNorth();
+    testWarmRestart();
+    testBatch();
+    return TEST_RESULT();
+}
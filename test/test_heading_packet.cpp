@@ -0,0 +1,184 @@
+// ESP-NOW heading packet encode/decode round trip, CRC and receiver statistics
+
+#include <string.h>
+#include "test.h"
+#include "../heading_packet.h"
+
+static constexpr double LSB = 1e-4;   // rad
+
+// CRC-16/CCITT-FALSE and CRC-32 check values of "123456789"
+static void testCrcCheckValues() {
+    const char* s = "123456789";
+    CHECK(crc16(s, 9) == 0x29B1);
+    CHECK(crc32(s, 9) == 0xCBF43926u);
+    CHECK(crc16(s + 4, 5, crc16(s, 4)) == 0x29B1);   // Continued over two buffers
+}
+
+// Every field survives the round trip within one LSB
+static void testRoundTrip() {
+    HeadingSample s;
+    s.seq = 65535;
+    s.sample_ms = 12345;
+    s.heading_rad = 1.2345f;
+    s.heading_true_rad = 6.2f;
+    s.pitch_rad = -0.1234f;
+    s.roll_rad = 0.5678f;
+    s.rot_rad = -0.0421f;
+    s.cal = 0xE4;
+
+    HeadingPacket p;
+    encodeHeadingPacket(s, p);
+    CHECK(p.magic == HEADING_PACKET_MAGIC);
+
+    HeadingSample d;
+    CHECK(decodeHeadingPacket((const uint8_t*)&p, sizeof(p), d));
+    CHECK(d.seq == 65535);
+    CHECK(d.sample_ms == 12345);
+    CHECK_NEAR(d.heading_rad, s.heading_rad, LSB);
+    CHECK_NEAR(d.heading_true_rad, s.heading_true_rad, LSB);
+    CHECK_NEAR(d.pitch_rad, s.pitch_rad, LSB);
+    CHECK_NEAR(d.roll_rad, s.roll_rad, LSB);
+    CHECK_NEAR(d.rot_rad, s.rot_rad, LSB);
+    CHECK(d.cal == 0xE4);
+}
+
+// Headings wrap into one circle, signed values saturate, NAN is not available
+static void testRangesAndNa() {
+    HeadingSample s;
+    s.heading_rad = -0.5f;
+    s.heading_true_rad = NAN;
+    s.pitch_rad = 10.0f;
+    s.roll_rad = -10.0f;
+    s.rot_rad = NAN;
+
+    HeadingPacket p;
+    encodeHeadingPacket(s, p);
+    CHECK(p.heading_true == 0xFFFF);
+    CHECK(p.pitch == 32767);
+    CHECK(p.roll == -32767);   // INT16_MIN is reserved for not available
+    CHECK(p.rot == INT16_MIN);
+
+    HeadingSample d;
+    CHECK(decodeHeadingPacket((const uint8_t*)&p, sizeof(p), d));
+    CHECK_NEAR(d.heading_rad, 2.0 * M_PI - 0.5, LSB);
+    CHECK(isnan(d.heading_true_rad));
+    CHECK(isnan(d.rot_rad));
+
+    // Just below a full circle rounds to 0, not to 62832
+    s.heading_rad = 6.28317f;
+    encodeHeadingPacket(s, p);
+    CHECK(p.heading == 0);
+}
+
+// Any single bit flip, wrong magic or wrong length is rejected
+static void testCorruption() {
+    HeadingSample s;
+    s.heading_rad = 3.0f;
+    HeadingPacket p;
+    encodeHeadingPacket(s, p);
+
+    uint8_t buf[sizeof(HeadingPacket)];
+    int accepted = 0;
+    for (size_t i = 0; i < sizeof(buf) * 8; i++) {
+        memcpy(buf, &p, sizeof(buf));
+        buf[i / 8] ^= (uint8_t)(1 << (i % 8));
+        HeadingSample d;
+        if (decodeHeadingPacket(buf, sizeof(buf), d)) accepted++;
+    }
+    CHECK(accepted == 0);
+
+    HeadingSample d;
+    CHECK(!decodeHeadingPacket((const uint8_t*)&p, sizeof(p) - 1, d));
+
+    HeadingPacket q = p;
+    q.magic = 0xA2;
+    q.crc = crc16(&q, offsetof(HeadingPacket, crc));
+    CHECK(!decodeHeadingPacket((const uint8_t*)&q, sizeof(q), d));
+}
+
+// Packet with the given seq and sample time
+static HeadingPacket packetAt(uint16_t seq, uint16_t sample_ms) {
+    HeadingSample s;
+    s.seq = seq;
+    s.sample_ms = sample_ms;
+    s.heading_rad = 1.0f;
+    HeadingPacket p;
+    encodeHeadingPacket(s, p);
+    return p;
+}
+
+static bool feed(HeadingPacketStats& st, uint16_t seq, uint16_t sample_ms, uint32_t rx_ms) {
+    const HeadingPacket p = packetAt(seq, sample_ms);
+    return st.onPacket((const uint8_t*)&p, sizeof(p), rx_ms);
+}
+
+// Loss, duplicates and reordering from seq, across the 65535 wrap
+static void testStatsSequence() {
+    HeadingPacketStats st;
+    uint16_t seq = 65530;
+    for (int i = 0; i < 4; i++) feed(st, seq++, 0, 0);       // 65530...65533
+    feed(st, 1, 0, 0);                                       // 65534, 65535, 0 lost
+    CHECK(st.getLost() == 3);
+    feed(st, 1, 0, 0);
+    CHECK(st.getDuplicates() == 1);
+    feed(st, 65535, 0, 0);                                   // Late
+    CHECK(st.getReordered() == 1);
+    CHECK(st.getLost() == 2);
+    CHECK(st.getLast().seq == 1);                            // Newest stays the reference
+    feed(st, 2, 0, 0);
+    CHECK(st.getLost() == 2);
+    CHECK(st.getReceived() == 7);
+    CHECK_NEAR(st.getLossRate(), 2.0 / 9.0, 1e-6);
+
+    const HeadingPacket p = packetAt(3, 0);
+    uint8_t bad[sizeof(p)];
+    memcpy(bad, &p, sizeof(p));
+    bad[5] ^= 0x01;
+    CHECK(!st.onPacket(bad, sizeof(bad), 0));
+    CHECK(!st.onPacket((const uint8_t*)&p, sizeof(p) - 1, 0));
+    CHECK(st.getInvalid() == 2);
+    CHECK(st.getReceived() == 7);
+
+    // Sender restart: a jump either way beyond MAX_GAP is no loss
+    feed(st, 40000, 0, 0);
+    feed(st, 0, 0, 0);
+    CHECK(st.getResyncs() == 2);
+    CHECK(st.getLost() == 2);
+    feed(st, 2, 0, 0);
+    CHECK(st.getLost() == 3);
+
+    st.reset();
+    CHECK(st.getReceived() == 0 && st.getLost() == 0 && st.getResyncs() == 0);
+}
+
+// Jitter against the fastest packet, sample_ms and rx_ms in different clocks, across the 16-bit wrap
+static void testStatsJitter() {
+    HeadingPacketStats st;
+    const uint32_t rx0 = 0xFFFFFFFFu - 300;      // Receiver millis() wraps too
+    const uint16_t tx0 = 65200;                  // sample_ms wraps from i = 4
+    const uint16_t delay[] = { 12, 9, 15, 9, 30, 10 };
+    for (uint16_t i = 0; i < 6; i++) {
+        CHECK(feed(st, i, (uint16_t)(tx0 + i * 100), rx0 + i * 100 + delay[i]));
+    }
+    CHECK(st.getLastJitterMs() == 1);
+    CHECK(st.getMaxJitterMs() == 21);            // 30 - 9
+    CHECK(st.getAvgJitterMs() > 0.0f && st.getAvgJitterMs() < 21.0f);
+
+    for (uint16_t i = 6; i < 1000; i++) {
+        feed(st, i, (uint16_t)(tx0 + i * 100), rx0 + i * 100 + 9);
+    }
+    CHECK(st.getLastJitterMs() == 0);
+    CHECK(st.getMaxJitterMs() == 21);
+    CHECK(st.getAvgJitterMs() < 0.01f);
+    CHECK(st.getLost() == 0);
+}
+
+int main() {
+    testCrcCheckValues();
+    testRoundTrip();
+    testRangesAndNa();
+    testCorruption();
+    testStatsSequence();
+    testStatsJitter();
+    return TEST_RESULT();
+}
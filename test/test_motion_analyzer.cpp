@@ -0,0 +1,198 @@
+// Motion spectrum: period and RMS of noisy roll and pitch sines against the analytic values,
+// gap restart, millis() wrap and one phase per step()
+
+#include <random>
+#include "test.h"
+#include "../MotionAnalyzer.h"
+
+static constexpr uint32_t READ_MS = 47;   // As CMPS14Application
+
+// micros() stand-in: every call advances 1000 us, counted
+static uint32_t fake_us = 0;
+static uint32_t micros_calls = 0;
+static uint32_t fakeMicros() {
+    micros_calls++;
+    return fake_us += 1000;
+}
+
+// Roll and pitch sines with noise, quantized to whole degrees as read from the CMPS14
+struct Motion {
+    float roll_amp = 5.0f, roll_period = 8.0f, roll_mean = -2.0f;
+    float pitch_amp = 2.0f, pitch_period = 4.5f, pitch_mean = 3.0f;
+    float noise = 0.5f;
+    bool quantize = true;
+    std::mt19937 rng{ 11 };
+
+    void at(double t_s, float& pitch, float& roll) {
+        std::normal_distribution<float> n(0.0f, noise);
+        pitch = pitch_mean + pitch_amp * (float)sin(2.0 * M_PI * t_s / pitch_period) + n(rng);
+        roll = roll_mean + roll_amp * (float)sin(2.0 * M_PI * t_s / roll_period + 1.0) + n(rng);
+        if (quantize) {
+            pitch = roundf(pitch);
+            roll = roundf(roll);
+        }
+    }
+};
+
+// Feed samples from t0 for duration_ms as CMPS14Processor::update() does, returns the next sample time.
+// t_s counts from 0 so that runs with different t0 see the same motion
+static uint32_t feed(MotionAnalyzer& m, Motion& mo, uint32_t t0, uint32_t duration_ms, bool step = true) {
+    uint32_t dt = 0;
+    for (; dt < duration_ms; dt += READ_MS) {
+        float pitch, roll;
+        mo.at(dt / 1000.0, pitch, roll);
+        m.add(t0 + dt, pitch, roll);
+        if (step) m.step();
+    }
+    return t0 + dt;
+}
+
+// Sample time of the first block, feeding from t, 0 if none within limit_ms
+static uint32_t feedUntilBlock(MotionAnalyzer& m, Motion& mo, uint32_t t, uint32_t limit_ms) {
+    const uint32_t seq = m.getEstimate().seq;
+    for (uint32_t dt = 0; dt < limit_ms; dt += READ_MS) {
+        float pitch, roll;
+        mo.at(dt / 1000.0, pitch, roll);
+        m.add(t + dt, pitch, roll);
+        m.step();
+        if (m.getEstimate().seq != seq) return t + dt;
+    }
+    return 0;
+}
+
+// RMS of a sine after averaging over one DECIM_MS bin
+static float analyticRms(float amp, float period_s) {
+    const float x = (float)M_PI * (MotionAnalyzer::DECIM_MS / 1000.0f) / period_s;
+    return amp / sqrtf(2.0f) * sinf(x) / x;
+}
+
+// Period, RMS and significant amplitude of both axes, means removed, every block
+static void testSines() {
+    static MotionAnalyzer m;
+    Motion mo;
+    uint32_t seq = 0, blocks_ok = 0;
+    uint32_t t = 1000;
+    for (int k = 0; k < 12; k++) {
+        t = feed(m, mo, t, 32000);
+        const MotionAnalyzer::Estimate& e = m.getEstimate();
+        if (e.seq == seq) continue;
+        seq = e.seq;
+        if (fabsf(e.roll_period_s - mo.roll_period) < 0.02f * mo.roll_period
+                && fabsf(e.pitch_period_s - mo.pitch_period) < 0.02f * mo.pitch_period
+                && fabsf(e.roll_rms_deg - analyticRms(mo.roll_amp, mo.roll_period)) < 0.03f * analyticRms(mo.roll_amp, mo.roll_period)
+                && fabsf(e.pitch_rms_deg - analyticRms(mo.pitch_amp, mo.pitch_period)) < 0.03f * analyticRms(mo.pitch_amp, mo.pitch_period)) blocks_ok++;
+    }
+    const MotionAnalyzer::Estimate& e = m.getEstimate();
+    CHECK(e.seq >= 8);
+    CHECK(blocks_ok == e.seq);
+    CHECK_NEAR(e.roll_period_s, mo.roll_period, 0.02 * mo.roll_period);
+    CHECK_NEAR(e.pitch_period_s, mo.pitch_period, 0.02 * mo.pitch_period);
+    CHECK_NEAR(e.roll_rms_deg, analyticRms(mo.roll_amp, mo.roll_period), 0.03 * analyticRms(mo.roll_amp, mo.roll_period));
+    CHECK_NEAR(e.pitch_rms_deg, analyticRms(mo.pitch_amp, mo.pitch_period), 0.03 * analyticRms(mo.pitch_amp, mo.pitch_period));
+    CHECK(e.roll_sig_deg == 2.0f * e.roll_rms_deg);
+    CHECK(e.pitch_sig_deg == 2.0f * e.pitch_rms_deg);
+    CHECK(m.getFillPercent() == 100);
+    printf("  roll %.2f s %.3f deg, pitch %.2f s %.3f deg (analytic %.2f s %.3f deg, %.2f s %.3f deg)\n",
+        e.roll_period_s, e.roll_rms_deg, e.pitch_period_s, e.pitch_rms_deg,
+        mo.roll_period, analyticRms(mo.roll_amp, mo.roll_period), mo.pitch_period, analyticRms(mo.pitch_amp, mo.pitch_period));
+}
+
+// Noise below MIN_RMS_DEG: RMS reported, no period
+static void testNoMotion() {
+    static MotionAnalyzer m;
+    Motion mo;
+    mo.roll_amp = 0.0f;
+    mo.pitch_amp = 0.0f;
+    mo.noise = 0.2f;
+    mo.quantize = false;
+    feed(m, mo, 0, 150000);
+    const MotionAnalyzer::Estimate& e = m.getEstimate();
+    CHECK(e.seq == 1);
+    CHECK(e.roll_rms_deg < MotionAnalyzer::MIN_RMS_DEG && e.pitch_rms_deg < MotionAnalyzer::MIN_RMS_DEG);
+    CHECK(isnan(e.roll_period_s) && isnan(e.pitch_period_s));
+}
+
+// A gap up to MAX_GAP_MS holds the last value, a longer one starts the collection over
+static void testGap() {
+    static MotionAnalyzer held, restarted;
+    Motion mo;
+    const uint32_t fill_ms = MotionAnalyzer::N * MotionAnalyzer::DECIM_MS;   // 128 s
+
+    uint32_t t = feed(held, mo, 0, 100000);
+    const uint8_t fill = held.getFillPercent();
+    t += 4000;
+    uint32_t block = feedUntilBlock(held, mo, t, 200000);
+    CHECK(held.getFillPercent() >= fill);
+    CHECK(block > 0 && block < fill_ms + 1000);   // The gap counts as collected values
+
+    t = feed(restarted, mo, 0, 100000);
+    t += MotionAnalyzer::MAX_GAP_MS + 1000;
+    float pitch, roll;
+    mo.at(0.0, pitch, roll);
+    restarted.add(t, pitch, roll);
+    CHECK(restarted.getFillPercent() == 0);
+    block = feedUntilBlock(restarted, mo, t, 200000);
+    CHECK(block >= t + fill_ms && block < t + fill_ms + 1000);   // A full ring again after the gap
+    CHECK(restarted.getEstimate().seq == 1);
+
+    static MotionAnalyzer backwards;
+    t = feed(backwards, mo, 500000, 100000);
+    backwards.add(1000, pitch, roll);   // Time going backwards is a long gap
+    CHECK(backwards.getFillPercent() == 0);
+}
+
+// Across the millis() wrap the bins continue: same blocks and estimates as a run without the wrap
+static void testWrap() {
+    static MotionAnalyzer plain, wrapped;
+    Motion mo_plain, mo_wrapped;
+    feed(plain, mo_plain, 1000, 300000);
+    const uint32_t t0 = 0xFFFFFFFFu - 60000;   // Wraps 60 s in, before the ring is full
+    const uint32_t end = feed(wrapped, mo_wrapped, t0, 300000);
+    CHECK(end < t0);
+    const MotionAnalyzer::Estimate& a = plain.getEstimate();
+    const MotionAnalyzer::Estimate& b = wrapped.getEstimate();
+    CHECK(a.seq == 6);
+    CHECK(b.seq == a.seq);
+    CHECK(b.roll_period_s == a.roll_period_s && b.roll_rms_deg == a.roll_rms_deg);
+    CHECK(b.pitch_period_s == a.pitch_period_s && b.pitch_rms_deg == a.pitch_rms_deg);
+}
+
+// One phase per step(): prepare, LOG2N butterfly stages and the spectrum, each timed on its own,
+// across the micros() wrap; no clock reads while idle, nothing timed without a clock
+static void testStepPhases() {
+    static MotionAnalyzer m(fakeMicros);
+    Motion mo;
+    feed(m, mo, 0, 130000, false);
+    CHECK(m.getFillPercent() == 100);
+
+    fake_us = 0xFFFFFFFFu - 4500;
+    micros_calls = 0;
+    int steps = 0;
+    while (m.getEstimate().seq == 0 && steps < 100) {
+        m.step();
+        steps++;
+    }
+    CHECK(steps == MotionAnalyzer::LOG2N + 2);
+    CHECK(micros_calls == 2u * steps);
+    CHECK(m.getStepMaxUs() == 1000);
+    CHECK(m.getBlockUs() == 1000u * steps);
+    CHECK(m.getBlocks() == 1);
+
+    micros_calls = 0;
+    m.step();   // Fewer than HOP new values: idle
+    CHECK(micros_calls == 0);
+
+    static MotionAnalyzer untimed;
+    feed(untimed, mo, 0, 150000);
+    CHECK(untimed.getBlocks() == 1);
+    CHECK(untimed.getStepMaxUs() == 0 && untimed.getBlockUs() == 0);
+}
+
+int main() {
+    testSines();
+    testNoMotion();
+    testGap();
+    testWrap();
+    testStepPhases();
+    return TEST_RESULT();
+}
@@ -0,0 +1,104 @@
+// NMEA 0183 sentence builders, fixed-point formatter and checksum
+
+#include <string.h>
+#include <stdlib.h>
+#include "test.h"
+#include "../nmea0183.h"
+
+// Sentence text equals expected (without "*hh\r\n") and carries the right checksum
+static bool sentenceIs(const NmeaSentence& s, const char* expected) {
+    const char* p = s.c_str();
+    const size_t n = strlen(expected);
+    if (s.length() != n + 5 || strncmp(p, expected, n) != 0) {
+        printf("  got \"%s\", expected \"%s\"\n", p, expected);
+        return false;
+    }
+    uint8_t cs = 0;
+    for (size_t i = 1; i < n; i++) cs ^= (uint8_t)expected[i];
+    char tail[6];
+    snprintf(tail, sizeof(tail), "*%02X\r\n", cs);
+    return strcmp(p + n, tail) == 0;
+}
+
+// Checksum of published example sentences
+static void testChecksum() {
+    const char* gga = "$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47";
+    CHECK(NmeaSentence::checksum(gga, strlen(gga)) == 0x47);
+    const char* rmc = "$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*6A";
+    CHECK(NmeaSentence::checksum(rmc, strlen(rmc)) == 0x6A);
+    CHECK(NmeaSentence::checksum("GPGGA", 5) == NmeaSentence::checksum("$GPGGA", 6));   // '$' optional
+}
+
+// Builders with valid values
+static void testSentences() {
+    NmeaSentence s;
+    buildHDG(s, 123.44f, -2.35f, 7.0f);
+    CHECK(sentenceIs(s, "$HCHDG,123.4,2.4,W,7.0,E"));
+    buildHDM(s, 5.0f);
+    CHECK(sentenceIs(s, "$HCHDM,5.0,M"));
+    buildHDT(s, 271.25f);
+    CHECK(sentenceIs(s, "$HCHDT,271.3,T"));
+    buildXDR(s, -1.26f, 0.04f);
+    CHECK(sentenceIs(s, "$HCXDR,A,-1.3,D,PTCH,A,0.0,D,ROLL"));
+    buildROT(s, -35.55f);
+    CHECK(sentenceIs(s, "$HCROT,-35.6,A"));
+    CHECK(s.isValid());
+}
+
+// Not available values are empty fields
+static void testNotAvailable() {
+    NmeaSentence s;
+    buildHDG(s, 10.0f, NAN, NAN);
+    CHECK(sentenceIs(s, "$HCHDG,10.0,,,,"));
+    buildROT(s, NAN);
+    CHECK(sentenceIs(s, "$HCROT,,V"));
+    buildXDR(s, NAN, 2.0f);
+    CHECK(sentenceIs(s, "$HCXDR,A,,D,PTCH,A,2.0,D,ROLL"));
+}
+
+// Headings never print as 360.0 and negative ones wrap
+static void testHeadingWrap() {
+    NmeaSentence s;
+    buildHDM(s, 359.95f);
+    CHECK(sentenceIs(s, "$HCHDM,0.0,M"));
+    buildHDT(s, 359.99f);
+    CHECK(sentenceIs(s, "$HCHDT,0.0,T"));
+    buildHDM(s, 359.94f);
+    CHECK(sentenceIs(s, "$HCHDM,359.9,M"));
+    buildHDM(s, 360.0f);
+    CHECK(sentenceIs(s, "$HCHDM,0.0,M"));
+    buildHDM(s, -0.04f);
+    CHECK(sentenceIs(s, "$HCHDM,0.0,M"));
+    buildHDM(s, -10.0f);
+    CHECK(sentenceIs(s, "$HCHDM,350.0,M"));
+    buildHDG(s, 359.97f, 0.0f, 0.0f);
+    CHECK(sentenceIs(s, "$HCHDG,0.0,0.0,E,0.0,E"));
+
+    // Every value in 0...360 at 0.01° steps stays below 360.0
+    bool ok = true;
+    for (int i = 0; i <= 36000; i++) {
+        buildHDM(s, i / 100.0f);
+        const float v = strtof(s.c_str() + 7, nullptr);
+        if (!(v >= 0.0f && v < 360.0f)) ok = false;
+    }
+    CHECK(ok);
+}
+
+// Longer than 82 characters is truncated and marked invalid
+static void testOverflow() {
+    NmeaSentence s;
+    s.begin("HC", "TXT");
+    for (int i = 0; i < 20; i++) s.fixed(12345.6f, 1);
+    s.end();
+    CHECK(!s.isValid());
+    CHECK(s.length() <= 82);
+}
+
+int main() {
+    testChecksum();
+    testSentences();
+    testNotAvailable();
+    testHeadingWrap();
+    testOverflow();
+    return TEST_RESULT();
+}
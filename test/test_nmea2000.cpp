@@ -0,0 +1,156 @@
+// NMEA 2000 PGN encoder against known-good payloads and CAN identifiers
+
+#include <string.h>
+#include "test.h"
+#include "../nmea2000.h"
+
+static constexpr uint8_t SRC = 0x23;   // Address 35
+
+// Payload equals the expected 8 bytes
+static bool payloadIs(const N2kFrame& f, const uint8_t (&expected)[8]) {
+    if (f.len == 8 && memcmp(f.data, expected, 8) == 0) return true;
+    printf("  got");
+    for (uint8_t i = 0; i < f.len; i++) printf(" %02X", f.data[i]);
+    printf(", expected");
+    for (uint8_t i = 0; i < 8; i++) printf(" %02X", expected[i]);
+    printf("\n");
+    return false;
+}
+
+// 127250 magnetic with deviation and variation, true with both not available
+static void testVesselHeading() {
+    N2kFrame f;
+    n2kVesselHeading(f, SRC, 7, 1.0f, -0.0123f, 0.1309f, N2K_REF_MAGNETIC);
+    CHECK(f.id == 0x09F11223);   // Priority 2, PDU2 broadcast
+    const uint8_t mag[8] = { 0x07, 0x10, 0x27, 0x85, 0xFF, 0x1D, 0x05, 0xFD };
+    CHECK(payloadIs(f, mag));
+
+    n2kVesselHeading(f, SRC, 8, -0.5f, NAN, NAN, N2K_REF_TRUE);   // 2π - 0.5 = 57832
+    const uint8_t tru[8] = { 0x08, 0xE8, 0xE1, 0xFF, 0x7F, 0xFF, 0x7F, 0xFC };
+    CHECK(payloadIs(f, tru));
+
+    n2kVesselHeading(f, SRC, 0, NAN, 10.0f, -10.0f, N2K_REF_MAGNETIC);   // Heading n/a, deviation and variation saturated
+    const uint8_t na[8] = { 0x00, 0xFF, 0xFF, 0xFE, 0x7F, 0x01, 0x80, 0xFD };
+    CHECK(payloadIs(f, na));
+
+    n2kVesselHeading(f, SRC, 0, 6.28317f, 0.0f, 0.0f, N2K_REF_MAGNETIC);   // Just below a full circle rounds to 0
+    CHECK(f.data[1] == 0x00 && f.data[2] == 0x00);
+}
+
+// 127251 at 3.125e-8 rad/s in int32, saturated below the n/a value
+static void testRateOfTurn() {
+    N2kFrame f;
+    n2kRateOfTurn(f, SRC, 3, 0.01f);   // 320000
+    CHECK(f.id == 0x09F11323);
+    const uint8_t stbd[8] = { 0x03, 0x00, 0xE2, 0x04, 0x00, 0xFF, 0xFF, 0xFF };
+    CHECK(payloadIs(f, stbd));
+
+    n2kRateOfTurn(f, SRC, 4, -0.001f);   // -32000
+    const uint8_t port[8] = { 0x04, 0x00, 0x83, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+    CHECK(payloadIs(f, port));
+
+    n2kRateOfTurn(f, SRC, 5, 100.0f);
+    const uint8_t hi[8] = { 0x05, 0xFE, 0xFF, 0xFF, 0x7F, 0xFF, 0xFF, 0xFF };
+    CHECK(payloadIs(f, hi));
+    n2kRateOfTurn(f, SRC, 5, -100.0f);
+    const uint8_t lo[8] = { 0x05, 0x01, 0x00, 0x00, 0x80, 0xFF, 0xFF, 0xFF };
+    CHECK(payloadIs(f, lo));
+    n2kRateOfTurn(f, SRC, 5, NAN);
+    const uint8_t na[8] = { 0x05, 0xFF, 0xFF, 0xFF, 0x7F, 0xFF, 0xFF, 0xFF };
+    CHECK(payloadIs(f, na));
+}
+
+// 127257 signed 1e-4 rad, last byte reserved
+static void testAttitude() {
+    N2kFrame f;
+    n2kAttitude(f, SRC, 9, NAN, 0.0524f, -0.2f);
+    CHECK(f.id == 0x0DF11923);   // Priority 3
+    const uint8_t att[8] = { 0x09, 0xFF, 0x7F, 0x0C, 0x02, 0x30, 0xF8, 0xFF };
+    CHECK(payloadIs(f, att));
+}
+
+// SID counts 0...252 and wraps to 0
+static void testSid() {
+    CHECK(n2kNextSid(0) == 1);
+    CHECK(n2kNextSid(251) == 252);
+    CHECK(n2kNextSid(252) == 0);
+    uint8_t sid = 0;
+    bool in_range = true;
+    for (int i = 0; i < 1000; i++) {
+        sid = n2kNextSid(sid);
+        if (sid > N2K_SID_MAX) in_range = false;
+    }
+    CHECK(in_range);
+}
+
+// PDU1 carries the destination in the identifier, PDU2 is always global
+static void testCanId() {
+    const uint32_t req = n2kCanId(6, N2K_PGN_ISO_REQUEST, 0x10, SRC);
+    CHECK(req == 0x18EA2310);
+    CHECK(n2kPgn(req) == N2K_PGN_ISO_REQUEST);
+    CHECK(n2kDest(req) == SRC);
+    CHECK(n2kSource(req) == 0x10);
+
+    const uint32_t claim = n2kCanId(6, N2K_PGN_ADDRESS_CLAIM, SRC);
+    CHECK(claim == 0x18EEFF23);
+    CHECK(n2kDest(claim) == N2K_ADDR_GLOBAL);
+
+    const uint32_t hdg = n2kCanId(2, N2K_PGN_VESSEL_HEADING, SRC, 0x10);   // Destination ignored
+    CHECK(hdg == 0x09F11223);
+    CHECK(n2kPgn(hdg) == N2K_PGN_VESSEL_HEADING);
+    CHECK(n2kDest(hdg) == N2K_ADDR_GLOBAL);
+    CHECK(n2kCanId(9, N2K_PGN_VESSEL_HEADING, SRC) == 0x05F11223);   // Priority is 3 bits
+}
+
+// NAME fields at their bit positions, masked to their width, arbitrary address capable
+static void testName() {
+    N2kName n;
+    n.unique_number = 0x1ABCDE;
+    n.manufacturer_code = 2046;
+    n.device_function = 140;
+    n.device_class = 60;
+    n.industry_group = 4;
+    CHECK(n2kEncodeName(n) == 0xC0788C00FFDABCDEull);
+
+    N2kName m;
+    m.unique_number = 0xFFFFFFFF;
+    m.manufacturer_code = 0xFFFF;
+    m.device_instance = 0xFF;
+    m.device_function = 0xFF;
+    m.device_class = 0xFF;
+    m.system_instance = 0xFF;
+    m.industry_group = 0xFF;
+    CHECK(n2kEncodeName(m) == 0xFFFEFFFFFFFFFFFFull);   // Bit 48 reserved
+
+    N2kFrame f;
+    n2kAddressClaim(f, SRC, 0xC0788C00FFDABCDEull);
+    const uint8_t claim[8] = { 0xDE, 0xBC, 0xDA, 0xFF, 0x00, 0x8C, 0x78, 0xC0 };
+    CHECK(payloadIs(f, claim));
+    uint64_t name = 0;
+    CHECK(n2kParseAddressClaim(f, name) && name == 0xC0788C00FFDABCDEull);
+}
+
+// ISO Request parsing
+static void testRequest() {
+    N2kFrame f;
+    f.id = n2kCanId(6, N2K_PGN_ISO_REQUEST, 0x10, N2K_ADDR_GLOBAL);
+    f.len = 3;
+    f.data[0] = 0x00; f.data[1] = 0xEE; f.data[2] = 0x00;
+    uint32_t pgn = 0;
+    CHECK(n2kParseRequest(f, pgn) && pgn == N2K_PGN_ADDRESS_CLAIM);
+    f.len = 2;
+    CHECK(!n2kParseRequest(f, pgn));
+    uint64_t name;
+    CHECK(!n2kParseAddressClaim(f, name));
+}
+
+int main() {
+    testVesselHeading();
+    testRateOfTurn();
+    testAttitude();
+    testSid();
+    testCanId();
+    testName();
+    testRequest();
+    return TEST_RESULT();
+}
@@ -0,0 +1,280 @@
+// Flight recorder log: write, rotate, download in parts and decode against an in-memory filesystem
+
+#include <map>
+#include <vector>
+#include <string.h>
+#include "test.h"
+#include "../recorder_log.h"
+
+static constexpr size_t STREAM_BYTES = 16384;   // As FlightRecorder
+static constexpr uint32_t RECORD_MS = 199;
+
+// LittleFS stand-in: numbered files, clock, failure injection
+struct MemFs {
+    std::map<uint32_t, std::vector<uint8_t>> files;
+    uint32_t current = 0;
+    uint32_t ms = 0;
+    uint32_t appends = 0;
+    bool fail = false;
+
+    static MemFs* self(void* ctx) { return static_cast<MemFs*>(ctx); }
+    static bool create(void* ctx, uint32_t seq) {
+        self(ctx)->files[seq].clear();
+        self(ctx)->current = seq;
+        return true;
+    }
+    static bool append(void* ctx, const uint8_t* p, size_t n) {
+        MemFs* fs = self(ctx);
+        if (fs->fail) return false;
+        std::vector<uint8_t>& f = fs->files[fs->current];
+        f.insert(f.end(), p, p + n);
+        fs->appends++;
+        return true;
+    }
+    static size_t read(void* ctx, uint32_t seq, uint32_t offset, uint8_t* p, size_t n) {
+        auto it = self(ctx)->files.find(seq);
+        if (it == self(ctx)->files.end() || offset >= it->second.size()) return 0;
+        if (n > it->second.size() - offset) n = it->second.size() - offset;
+        memcpy(p, it->second.data() + offset, n);
+        return n;
+    }
+    static uint32_t size(void* ctx, uint32_t seq) {
+        auto it = self(ctx)->files.find(seq);
+        return (it == self(ctx)->files.end()) ? 0 : (uint32_t)it->second.size();
+    }
+    static bool remove(void* ctx, uint32_t seq) { return self(ctx)->files.erase(seq) > 0; }
+    static void clock(void* ctx, uint32_t &ms, uint32_t &epoch_s) {
+        ms = self(ctx)->ms;
+        epoch_s = 1700000000u + ms / 1000;
+    }
+
+    RecorderStorage storage() {
+        RecorderStorage st;
+        st.ctx = this;
+        st.create = create;
+        st.append = append;
+        st.read = read;
+        st.size = size;
+        st.remove = remove;
+        st.clock = clock;
+        return st;
+    }
+
+    // All files oldest first, as the download used to send them in one response
+    std::vector<uint8_t> all() const {
+        std::vector<uint8_t> out;
+        for (const auto& f : files) out.insert(out.end(), f.second.begin(), f.second.end());
+        return out;
+    }
+};
+
+// Sample i of a boat turning through north, with unavailable values and calibration changes
+static RecorderFrame frameAt(uint32_t i) {
+    RecorderFrame f;
+    f.t_ms = 1000 + i * RECORD_MS;
+    f.raw_10 = (uint16_t)((i * 7) % 3600);
+    f.pitch = (int8_t)((int)(i % 41) - 20);
+    f.roll = (int8_t)((int)((i * 3) % 91) - 45);
+    f.hdg_c = (uint16_t)((i * 37) % 36000);
+    f.hdg_m = (uint16_t)((f.hdg_c + 150) % 36000);
+    f.hdg_t = (i % 5000 < 300) ? RECORDER_NA_U16 : (uint16_t)((f.hdg_m + 700) % 36000);
+    f.rot = (i % 7000 < 50) ? RECORDER_NA_I16 : (int16_t)((int)(i % 65535) - 32767);
+    f.cal = (uint8_t)((i / 997) & 0xFF);
+    return f;
+}
+
+static bool sameFrame(const RecorderFrame& a, const RecorderFrame& b) {
+    return a.t_ms == b.t_ms && a.raw_10 == b.raw_10 && a.pitch == b.pitch && a.roll == b.roll
+        && a.hdg_c == b.hdg_c && a.hdg_m == b.hdg_m && a.hdg_t == b.hdg_t && a.rot == b.rot && a.cal == b.cal;
+}
+
+// Record frames first...first+n with an event every 1000 frames
+static void recordFrames(RecorderLog& log, MemFs& fs, uint32_t first, uint32_t n) {
+    for (uint32_t i = first; i < first + n; i++) {
+        fs.ms = frameAt(i).t_ms;
+        log.record(frameAt(i));
+        if (i % 1000 == 0) log.logEvent(2, (int32_t)i);
+        log.handle(fs.ms);
+    }
+}
+
+// The whole log downloaded part by part, continuing at the end of each part
+static std::vector<uint8_t> download(RecorderLog& log, size_t* parts = nullptr, size_t* largest = nullptr) {
+    std::vector<uint8_t> out;
+    RecorderCursor c;
+    uint8_t buf[RecorderLog::BLOCK_SIZE];
+    for (size_t k = 0; k < 1000; k++) {
+        const RecorderCursor end = log.span(c, STREAM_BYTES);
+        size_t part = 0, n;
+        while ((n = log.read(c, end, buf, sizeof(buf))) > 0) {
+            out.insert(out.end(), buf, buf + n);
+            part += n;
+        }
+        if (parts) (*parts)++;
+        if (largest && part > *largest) *largest = part;
+        if (log.isEnd(end)) break;
+        c = end;
+    }
+    return out;
+}
+
+// Decoded frames must be consecutive input frames ending with the last one recorded
+static bool decodesTo(const std::vector<uint8_t>& data, uint32_t last, uint32_t* first_out = nullptr) {
+    std::vector<RecorderFrame> frames;
+    size_t events = 0;
+    const size_t damaged = decodeRecorderLog(data.data(), data.size(),
+        [&](const RecorderFileHeader&, const RecorderFrame& f) { frames.push_back(f); },
+        [&](const RecorderFileHeader&, const RecorderEvent&) { events++; });
+    if (damaged != 0 || frames.empty() || events == 0) return false;
+    const uint32_t first = (frames.front().t_ms - 1000) / RECORD_MS;
+    if (first + frames.size() - 1 != last) return false;
+    for (size_t k = 0; k < frames.size(); k++) {
+        if (!sameFrame(frames[k], frameAt(first + (uint32_t)k))) return false;
+    }
+    if (first_out) *first_out = first;
+    return true;
+}
+
+// Many files: rotation keeps MAX_FILES, parts stay bounded and concatenate to the files
+static void testRoundTrip() {
+    MemFs fs;
+    RecorderLog log(fs.storage());
+    CHECK(log.begin(0, 0, 0));
+    const uint32_t N = 300000;
+    recordFrames(log, fs, 0, N);
+    log.flush();
+
+    CHECK(log.getSamples() == N);
+    CHECK(log.getWriteErrors() == 0);
+    CHECK(log.getFileCount() == RecorderLog::MAX_FILES);
+    CHECK(fs.files.size() == RecorderLog::MAX_FILES);
+    CHECK(log.getOldestSeq() == fs.files.begin()->first);
+    CHECK(log.getFileSeq() == fs.files.rbegin()->first);
+    bool sizes_ok = true;
+    for (const auto& f : fs.files) {
+        if (f.second.size() > RecorderLog::MAX_FILE_BYTES || (f.second.size() - 24) % RecorderLog::BLOCK_SIZE != 0) sizes_ok = false;
+    }
+    CHECK(sizes_ok);
+
+    size_t parts = 0, largest = 0;
+    const std::vector<uint8_t> data = download(log, &parts, &largest);
+    CHECK(data == fs.all());
+    CHECK(largest <= STREAM_BYTES);
+    CHECK(parts >= data.size() / STREAM_BYTES);
+    uint32_t first = 0;
+    CHECK(decodesTo(data, N - 1, &first));
+    CHECK(first > 0);   // The oldest files were removed
+    printf("  %u frames, %zu bytes kept in %zu parts, %.1f B/frame\n",
+        N - first, data.size(), parts, (double)data.size() / (N - first));
+}
+
+// A file removed between two parts: the download continues at the oldest file and still decodes
+static void testRemovedBetweenParts() {
+    MemFs fs;
+    RecorderLog log(fs.storage());
+    CHECK(log.begin(0, 0, 0));
+    recordFrames(log, fs, 0, 250000);
+    log.flush();
+
+    RecorderCursor c;
+    RecorderCursor end = log.span(c, STREAM_BYTES);
+    const uint32_t first_seq = c.seq;
+    std::vector<uint8_t> out;
+    uint8_t buf[RecorderLog::BLOCK_SIZE];
+    size_t n;
+    while ((n = log.read(c, end, buf, sizeof(buf))) > 0) out.insert(out.end(), buf, buf + n);
+    CHECK(end.seq == first_seq && end.offset > 0);
+
+    recordFrames(log, fs, 250000, 60000);   // Rotates the partly downloaded file away
+    log.flush();
+    CHECK(fs.files.count(first_seq) == 0);
+
+    c = end;
+    for (int k = 0; k < 1000; k++) {
+        end = log.span(c, STREAM_BYTES);
+        if (k == 0) CHECK(c.seq == log.getOldestSeq() && c.offset == 0);
+        while ((n = log.read(c, end, buf, sizeof(buf))) > 0) out.insert(out.end(), buf, buf + n);
+        if (log.isEnd(end)) break;
+        c = end;
+    }
+    std::vector<RecorderFrame> frames;
+    const size_t damaged = decodeRecorderLog(out.data(), out.size(),
+        [&](const RecorderFileHeader&, const RecorderFrame& f) { frames.push_back(f); },
+        [](const RecorderFileHeader&, const RecorderEvent&) {});
+    CHECK(damaged == 0);
+    CHECK(!frames.empty() && sameFrame(frames.back(), frameAt(310000 - 1)));
+}
+
+// A new boot continues the sequence numbers in a new file, both boots decode
+static void testSecondBoot() {
+    MemFs fs;
+    {
+        RecorderLog log(fs.storage());
+        CHECK(log.begin(0, 0, 0));
+        recordFrames(log, fs, 0, 1000);
+        log.flush();
+    }
+    const uint32_t newest = fs.files.rbegin()->first;
+    RecorderLog log(fs.storage());
+    CHECK(log.begin(fs.files.begin()->first, newest, (uint8_t)fs.files.size()));
+    CHECK(log.getFileSeq() == newest + 1);
+    recordFrames(log, fs, 1000, 1000);
+    log.flush();
+
+    std::vector<uint32_t> boots;
+    const std::vector<uint8_t> data = download(log);
+    decodeRecorderLog(data.data(), data.size(),
+        [&](const RecorderFileHeader& h, const RecorderFrame&) { if (boots.empty() || boots.back() != h.boot_seq) boots.push_back(h.boot_seq); },
+        [](const RecorderFileHeader&, const RecorderEvent&) {});
+    CHECK(boots.size() == 2 && boots[0] == 1 && boots[1] == newest + 1);
+    CHECK(decodesTo(data, 1999));
+}
+
+// A started block is written FLUSH_MS after its first record, also across the millis() wrap
+static void testFlushTiming() {
+    MemFs fs;
+    fs.ms = 0xFFFFFFFFu - 1000;
+    RecorderLog log(fs.storage());
+    CHECK(log.begin(0, 0, 0));
+    const uint32_t header_appends = fs.appends;
+    log.logEvent(1, 0);
+    const uint32_t t0 = fs.ms;
+    log.handle(t0 + RecorderLog::FLUSH_MS - 1);
+    CHECK(fs.appends == header_appends);
+    log.handle(t0 + RecorderLog::FLUSH_MS);
+    CHECK(fs.appends == header_appends + 1);
+    CHECK(log.getBlocks() == 1);
+    log.handle(t0 + 2 * RecorderLog::FLUSH_MS);   // Nothing pending
+    CHECK(fs.appends == header_appends + 1);
+}
+
+// Failed writes are counted, the log carries on once the storage recovers
+static void testWriteErrors() {
+    MemFs fs;
+    RecorderLog log(fs.storage());
+    CHECK(log.begin(0, 0, 0));
+    fs.fail = true;
+    recordFrames(log, fs, 0, 2000);
+    CHECK(log.getWriteErrors() > 0);
+    CHECK(log.getBlocks() == 0);
+    fs.fail = false;
+    recordFrames(log, fs, 2000, 2000);
+    log.flush();
+    CHECK(log.getBlocks() > 0);
+    std::vector<RecorderFrame> frames;
+    const std::vector<uint8_t> data = download(log);
+    const size_t damaged = decodeRecorderLog(data.data(), data.size(),
+        [&](const RecorderFileHeader&, const RecorderFrame& f) { frames.push_back(f); },
+        [](const RecorderFileHeader&, const RecorderEvent&) {});
+    CHECK(damaged == 0);
+    CHECK(!frames.empty() && sameFrame(frames.back(), frameAt(3999)));
+}
+
+int main() {
+    testRoundTrip();
+    testRemovedBetweenParts();
+    testSecondBoot();
+    testFlushTiming();
+    testWriteErrors();
+    return TEST_RESULT();
+}
@@ -0,0 +1,94 @@
+// Sliding window min/max against a brute-force scan of all samples, across the millis() wrap
+
+#include <random>
+#include <vector>
+#include "test.h"
+#include "../window_minmax.h"
+
+static constexpr size_t SLOTS = 60;   // As CMPS14Processor
+
+struct Sample {
+    uint64_t t;   // Unwrapped time, millis() is its low 32 bits
+    float v;
+};
+
+// Brute force: extremes of the samples in the slots of the window ending at now,
+// slots aligned to the first sample and counted on the unwrapped time
+static void bruteForce(const std::vector<Sample>& all, uint64_t origin, uint64_t slot_ms, uint64_t now, float& mn, float& mx) {
+    mn = NAN;
+    mx = NAN;
+    const uint64_t now_slot = (now - origin) / slot_ms;
+    for (const Sample& s : all) {
+        if (now_slot - (s.t - origin) / slot_ms >= SLOTS) continue;
+        if (isnan(mn) || s.v < mn) mn = s.v;
+        if (isnan(mx) || s.v > mx) mx = s.v;
+    }
+}
+
+static bool same(float a, float b) { return a == b || (isnan(a) && isnan(b)); }
+
+// Random samples, gaps and unavailable values, starting shortly before the wrap, every query checked
+static void testBruteForce() {
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> u(-30.0f, 30.0f);
+    for (unsigned long window_ms : { 7000UL, 60000UL, 600000UL, 3600000UL }) {
+        WindowMinMax<SLOTS> w;
+        w.setWindow(window_ms);
+        const uint64_t slot_ms = window_ms / SLOTS;
+        uint64_t t = 0xFFFFFFFFull - window_ms / 3;
+        const uint64_t origin = t - (uint32_t)t % slot_ms;
+        std::vector<Sample> all;
+        long checks = 0, bad = 0;
+        for (int i = 0; i < 60000; i++) {
+            t += (i % 5000 == 4999) ? 5 * window_ms / 4 : 47 + rng() % 200;   // Occasional gap beyond the window
+            const float v = (i % 97 == 0) ? NAN : u(rng);
+            w.add((uint32_t)t, v);
+            if (!isnan(v)) all.push_back({ t, v });
+            while (!all.empty() && t - all.front().t > 2 * window_ms) all.erase(all.begin());
+
+            const uint64_t now = t + ((i % 7 == 0) ? rng() % window_ms : 0);   // Some queries later than the sample
+            float mn, mx;
+            bruteForce(all, origin, slot_ms, now, mn, mx);
+            checks++;
+            if (!same(w.min((uint32_t)now), mn) || !same(w.max((uint32_t)now), mx)) bad++;
+        }
+        CHECK(t > 0xFFFFFFFFull);   // Wrapped
+        if (bad) printf("  window %lu ms: %ld of %ld queries differ\n", window_ms, bad, checks);
+        CHECK(bad == 0);
+    }
+}
+
+// An extreme just before the wrap stays in the window after it and expires one window later
+static void testWrap() {
+    WindowMinMax<SLOTS> w;
+    w.setWindow(60000);
+    const uint32_t t0 = 0xFFFFFFFFu - 2000;
+    w.add(t0, 25.0f);
+    w.add(t0 + 3000, 1.0f);   // Past the wrap
+    CHECK(w.max(t0 + 3000) == 25.0f);
+    CHECK(w.max(t0 + 58000) == 25.0f);
+    CHECK(w.max(t0 + 61000) == 1.0f);
+    CHECK(w.min(t0 + 61000) == 1.0f);
+    CHECK(isnan(w.max(t0 + 3000 + 61000)));
+}
+
+// Time going backwards starts a new window instead of mixing slot numbers
+static void testBackwards() {
+    WindowMinMax<SLOTS> w;
+    w.setWindow(60000);
+    CHECK(isnan(w.min(0)) && isnan(w.max(0)));
+    w.add(500000, 10.0f);
+    w.add(501000, -10.0f);
+    w.add(1000, 3.0f);
+    CHECK(w.max(1000) == 3.0f);
+    CHECK(w.min(1000) == 3.0f);
+    w.add(2000, NAN);
+    CHECK(w.max(2000) == 3.0f);
+}
+
+int main() {
+    testBruteForce();
+    testWrap();
+    testBackwards();
+    return TEST_RESULT();
+}
@@ -0,0 +1,125 @@
+// Write-behind timing of the configuration record against a fake NVS backend
+
+#include <string.h>
+#include "test.h"
+#include "../write_behind.h"
+
+static constexpr unsigned long QUIET_MS = 2999;       // As CMPS14Preferences
+static constexpr unsigned long MAX_DELAY_MS = 29989;
+
+// Preferences stand-in: one blob, write counter, failure injection
+struct FakePreferences {
+    uint8_t blob[16] = {};
+    int puts = 0;
+    bool fail = false;
+    size_t putBytes(const void* p, size_t len) {
+        if (fail) return 0;
+        memcpy(blob, p, len);
+        puts++;
+        return len;
+    }
+};
+
+// RAM record and its backend
+struct Store {
+    FakePreferences prefs;
+    float offset = 0.0f;
+    float variation = 0.0f;
+    static bool write(void* ctx) {
+        Store* s = static_cast<Store*>(ctx);
+        float rec[2] = { s->offset, s->variation };
+        return s->prefs.putBytes(rec, sizeof(rec)) == sizeof(rec);
+    }
+    float stored(int i) const { float rec[2]; memcpy(rec, prefs.blob, sizeof(rec)); return rec[i]; }
+};
+
+// Many changes within the quiet period become one write with the latest values
+static void testCoalescing() {
+    Store s;
+    WriteBehind wb(Store::write, &s, QUIET_MS, MAX_DELAY_MS);
+    unsigned long t = 1000;
+    for (int i = 1; i <= 10; i++) {
+        s.offset = (float)i;
+        wb.mark(0x01, t);
+        wb.handle(t);
+        t += 100;
+    }
+    s.variation = 5.5f;
+    wb.mark(0x02, t);
+    CHECK(wb.getFields() == 0x03);
+    CHECK(wb.getSaves() == 11);
+    for (; t < 10000; t += 10) wb.handle(t);
+    CHECK(s.prefs.puts == 1);
+    CHECK(!wb.isDirty());
+    CHECK_NEAR(s.stored(0), 10.0, 0.0);
+    CHECK_NEAR(s.stored(1), 5.5, 0.0);
+}
+
+// No write before the quiet period after the last change, write exactly when it ends
+static void testQuietPeriod() {
+    Store s;
+    WriteBehind wb(Store::write, &s, QUIET_MS, MAX_DELAY_MS);
+    wb.mark(0x01, 5000);
+    wb.mark(0x01, 6000);
+    CHECK(!wb.handle(6000 + QUIET_MS - 1));
+    CHECK(s.prefs.puts == 0);
+    CHECK(wb.handle(6000 + QUIET_MS));
+    CHECK(s.prefs.puts == 1);
+    CHECK(!wb.handle(20000));   // Nothing pending
+    CHECK(s.prefs.puts == 1);
+}
+
+// Continuous edits are written at latest max delay after the first pending change
+static void testMaxDelay() {
+    Store s;
+    WriteBehind wb(Store::write, &s, QUIET_MS, MAX_DELAY_MS);
+    const unsigned long t0 = 100000;
+    unsigned long written_at = 0;
+    for (unsigned long t = t0; t < t0 + 40000; t += 1000) {
+        wb.mark(0x04, t);
+        for (unsigned long u = t; u < t + 1000; u += 1) {
+            if (wb.handle(u) && written_at == 0) written_at = u;
+        }
+    }
+    CHECK(written_at == t0 + MAX_DELAY_MS);
+    CHECK(s.prefs.puts == 1);   // The next max delay has not passed yet
+}
+
+// Failed write keeps the fields pending and retries after the next quiet period
+static void testRetry() {
+    Store s;
+    WriteBehind wb(Store::write, &s, QUIET_MS, MAX_DELAY_MS);
+    s.prefs.fail = true;
+    wb.mark(0x08, 0);
+    CHECK(!wb.flush(1000));
+    CHECK(wb.getFields() == 0x08);
+    s.prefs.fail = false;
+    CHECK(!wb.handle(1000 + QUIET_MS - 1));
+    CHECK(wb.handle(1000 + QUIET_MS));
+    CHECK(s.prefs.puts == 1);
+}
+
+// flush() writes at once, timing survives the millis() wrap
+static void testFlushAndWrap() {
+    Store s;
+    WriteBehind wb(Store::write, &s, QUIET_MS, MAX_DELAY_MS);
+    CHECK(wb.flush(0));   // Nothing pending, no write
+    CHECK(s.prefs.puts == 0);
+    const unsigned long t = (unsigned long)-1000;
+    wb.mark(0x10, t);
+    CHECK(!wb.handle(t + 500));
+    CHECK(!wb.handle(t + QUIET_MS - 1));
+    CHECK(wb.handle(t + QUIET_MS));   // Past the wrap
+    wb.mark(0x10, 10);
+    CHECK(wb.flush(11));
+    CHECK(s.prefs.puts == 2);
+}
+
+int main() {
+    testCoalescing();
+    testQuietPeriod();
+    testMaxDelay();
+    testRetry();
+    testFlushAndWrap();
+    return TEST_RESULT();
+}
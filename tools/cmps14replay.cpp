@@ -0,0 +1,201 @@
+// cmps14replay - reprocess a flight recorder log with other deviation coeffs or filter settings
+//
+// Usage:
+//   cmps14replay [options] cmps14-rec-<uptime_ms>.bin [out.csv]
+//
+//   --coeffs A,B,C,D,E   deviation coeffs (deg), default 0,0,0,0,0
+//   --offset DEG         installation offset, default 0
+//   --variation DEG      magnetic variation, default none (no true heading)
+//   --alpha X            heading filter smoothing, default 0.15
+//   --rot-alpha X        rate of turn smoothing, default 0.2
+//   --level P,R          pitch and roll leveling (deg), default 0,0
+//   --float              float degree heading path instead of binary angles
+//   --repeat N           process the frames N times for a throughput figure
+//
+// Writes a CSV of the reprocessed frames (stdout if no out.csv) and a summary
+// with frames, samples per second and the largest difference of the compass
+// heading to the one that was logged. Each boot in the log starts from a
+// fresh filter. The recorder keeps a frame every 199 ms, not every sensor
+// reading, so the filter runs at that rate here.
+//
+// Build: make -C tools (host g++, no Arduino)
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "../recorder_log.h"
+#include "../heading_filter.h"
+
+// Frames of one boot as structure of arrays
+struct Segment {
+    uint32_t boot = 0;
+    std::vector<uint32_t> t_ms;
+    std::vector<uint16_t> angle_10, hdg_c;
+    std::vector<int8_t> pitch, roll;
+};
+
+// Processed columns of one segment
+struct Columns {
+    std::vector<float> compass, heading, heading_true, deviation, rot, pitch, roll;
+    void resize(size_t n) {
+        for (auto* v : { &compass, &heading, &heading_true, &deviation, &rot, &pitch, &roll }) v->resize(n);
+    }
+    ProcessedFrames view() {
+        ProcessedFrames o;
+        o.compass_deg = compass.data();
+        o.heading_deg = heading.data();
+        o.heading_true_deg = heading_true.data();
+        o.deviation_deg = deviation.data();
+        o.rot_rad = rot.data();
+        o.pitch_deg = pitch.data();
+        o.roll_deg = roll.data();
+        return o;
+    }
+};
+
+static bool readFile(const char* path, std::vector<uint8_t>& out) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    uint8_t buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.insert(out.end(), buf, buf + n);
+    fclose(f);
+    return true;
+}
+
+// Comma separated floats, true if exactly n were given
+static bool parseList(const char* s, float* v, int n) {
+    for (int i = 0; i < n; i++) {
+        char* end;
+        v[i] = strtof(s, &end);
+        if (end == s) return false;
+        s = end;
+        if (i < n - 1) {
+            if (*s != ',') return false;
+            s++;
+        }
+    }
+    return *s == '\0';
+}
+
+static void putValue(FILE* out, float v, float scale, const char* fmt) {
+    if (isfinite(v)) fprintf(out, fmt, v * scale);
+    fputc(',', out);
+}
+
+static int usage() {
+    fprintf(stderr, "usage: cmps14replay [--coeffs A,B,C,D,E] [--offset DEG] [--variation DEG] [--alpha X]\n"
+                    "                    [--rot-alpha X] [--level P,R] [--float] [--repeat N] log.bin [out.csv]\n");
+    return 2;
+}
+
+int main(int argc, char** argv) {
+    HarmonicCoeffs hc = { 0, 0, 0, 0, 0 };
+    HeadingParams p;
+    bool fixed_point = true;
+    int repeat = 1;
+    const char* paths[2] = { nullptr, nullptr };
+    int npaths = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        const bool has_value = i + 1 < argc;
+        float v[5];
+        if (!strcmp(a, "--coeffs") && has_value && parseList(argv[++i], v, 5)) hc = { v[0], v[1], v[2], v[3], v[4] };
+        else if (!strcmp(a, "--offset") && has_value) p.offset_deg = strtof(argv[++i], nullptr);
+        else if (!strcmp(a, "--variation") && has_value) p.variation_deg = strtof(argv[++i], nullptr);
+        else if (!strcmp(a, "--alpha") && has_value) p.heading_alpha = strtof(argv[++i], nullptr);
+        else if (!strcmp(a, "--rot-alpha") && has_value) p.rot_alpha = strtof(argv[++i], nullptr);
+        else if (!strcmp(a, "--level") && has_value && parseList(argv[++i], v, 2)) { p.pitch_level_deg = v[0]; p.roll_level_deg = v[1]; }
+        else if (!strcmp(a, "--float")) fixed_point = false;
+        else if (!strcmp(a, "--repeat") && has_value) repeat = atoi(argv[++i]);
+        else if (a[0] != '-' && npaths < 2) paths[npaths++] = a;
+        else return usage();
+    }
+    if (npaths == 0 || repeat < 1) return usage();
+
+    std::vector<uint8_t> data;
+    if (!readFile(paths[0], data)) {
+        fprintf(stderr, "cmps14replay: cannot read %s\n", paths[0]);
+        return 1;
+    }
+
+    // Decode into one segment per boot
+    std::vector<Segment> segs;
+    size_t events = 0;
+    const size_t damaged = decodeRecorderLog(data.data(), data.size(),
+        [&](const RecorderFileHeader& h, const RecorderFrame& f) {
+            if (segs.empty() || segs.back().boot != h.boot_seq) {
+                segs.emplace_back();
+                segs.back().boot = h.boot_seq;
+            }
+            Segment& s = segs.back();
+            s.t_ms.push_back(f.t_ms);
+            s.angle_10.push_back(f.raw_10);
+            s.hdg_c.push_back(f.hdg_c);
+            s.pitch.push_back(f.pitch);
+            s.roll.push_back(f.roll);
+        },
+        [&](const RecorderFileHeader&, const RecorderEvent&) { events++; });
+
+    static DeviationLookup lut;
+    lut.build(hc);
+
+    // Process, timed over the repeats
+    std::vector<Columns> cols(segs.size());
+    size_t frames = 0;
+    using clock = std::chrono::steady_clock;
+    const auto t0 = clock::now();
+    for (int r = 0; r < repeat; r++) {
+        for (size_t i = 0; i < segs.size(); i++) {
+            Segment& s = segs[i];
+            const size_t n = s.t_ms.size();
+            cols[i].resize(n);
+            RawFrames in;
+            in.t_ms = s.t_ms.data();
+            in.angle_10 = s.angle_10.data();
+            in.pitch = s.pitch.data();
+            in.roll = s.roll.data();
+            ProcessedFrames out = cols[i].view();
+            HeadingState st;
+            frames += processHeadingBatch(in, n, out, st, p, lut, fixed_point);
+        }
+    }
+    const double secs = std::chrono::duration<double>(clock::now() - t0).count();
+
+    // CSV and the difference to the logged compass heading
+    FILE* out = paths[1] ? fopen(paths[1], "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "cmps14replay: cannot write %s\n", paths[1]);
+        return 1;
+    }
+    fprintf(out, "boot,t_ms,raw_deg,compass_deg,heading_deg,heading_true_deg,deviation_deg,rot_deg_s,pitch_deg,roll_deg\n");
+    double max_diff = 0.0;
+    for (size_t i = 0; i < segs.size(); i++) {
+        const Segment& s = segs[i];
+        const Columns& c = cols[i];
+        for (size_t k = 0; k < s.t_ms.size(); k++) {
+            fprintf(out, "%u,%u,%.1f,", s.boot, s.t_ms[k], s.angle_10[k] / 10.0f);
+            putValue(out, c.compass[k], 1.0f, "%.2f");
+            putValue(out, c.heading[k], 1.0f, "%.2f");
+            putValue(out, c.heading_true[k], 1.0f, "%.2f");
+            putValue(out, c.deviation[k], 1.0f, "%.2f");
+            putValue(out, c.rot[k], 57.2957795f, "%.3f");
+            fprintf(out, "%.0f,%.0f\n", c.pitch[k], c.roll[k]);
+            if (s.hdg_c[k] != 0xFFFF) {
+                double d = fabs(c.compass[k] - s.hdg_c[k] / 100.0);
+                if (d > 180.0) d = 360.0 - d;
+                if (d > max_diff) max_diff = d;
+            }
+        }
+    }
+    if (out != stdout) fclose(out);
+
+    fprintf(stderr, "cmps14replay: %zu frames in %zu boots, %zu events, %zu damaged blocks\n",
+        frames / repeat, segs.size(), events, damaged);
+    fprintf(stderr, "cmps14replay: %.1f M samples/s (%s path), compass heading differs from the log by up to %.2f deg\n",
+        secs > 0.0 ? frames / secs * 1e-6 : 0.0, fixed_point ? "binary angle" : "float", max_diff);
+    return 0;
+}
@@ -0,0 +1,100 @@
+// hpstats - ESP-NOW heading packet link statistics from a receiver capture
+//
+// Usage:
+//   hpstats [--every N] [capture.txt]
+//
+//   --every N   print the running statistics every N packets, default 0 (end only)
+//
+// Reads one received packet per line (stdin if no capture.txt):
+//
+//   <rx_ms> <packet bytes as hex>
+//
+// rx_ms is the receiver millis() at reception. Any ESP32 on the same WiFi
+// channel produces this from its ESP-NOW receive callback, e.g.
+//
+//   Serial.printf("%lu ", millis());
+//   for (int i = 0; i < len; i++) Serial.printf("%02x", data[i]);
+//   Serial.println();
+//
+// Lines that do not start with a number are skipped, so a serial monitor log
+// can be fed as is. Prints received, invalid, lost, duplicate, reordered and
+// resync counts, loss rate and jitter as HeadingPacketStats (heading_packet.h)
+// computes them on a display.
+//
+// Build: make -C tools (host g++, no Arduino)
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../heading_packet.h"
+
+static int usage() {
+    fprintf(stderr, "usage: hpstats [--every N] [capture.txt]\n");
+    return 2;
+}
+
+static int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    c = (char)tolower((unsigned char)c);
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+// "<rx_ms> <hex>" into rx_ms and bytes, false if the line is no packet
+static bool parseLine(const char* line, uint32_t& rx_ms, uint8_t* out, size_t max, size_t& len) {
+    char* end;
+    rx_ms = (uint32_t)strtoul(line, &end, 10);
+    if (end == line || !isspace((unsigned char)*end)) return false;
+    const char* p = end;
+    while (isspace((unsigned char)*p)) p++;
+    len = 0;
+    while (len < max) {
+        const int hi = hexDigit(p[0]);
+        if (hi < 0) break;
+        const int lo = hexDigit(p[1]);
+        if (lo < 0) break;
+        out[len++] = (uint8_t)(hi << 4 | lo);
+        p += 2;
+    }
+    return len > 0;
+}
+
+static void print(const HeadingPacketStats& st) {
+    printf("received %u, invalid %u, lost %u (%.2f %%), duplicates %u, reordered %u, resyncs %u, "
+           "jitter last %u ms, max %u ms, avg %.1f ms\n",
+        st.getReceived(), st.getInvalid(), st.getLost(), 100.0f * st.getLossRate(), st.getDuplicates(),
+        st.getReordered(), st.getResyncs(), st.getLastJitterMs(), st.getMaxJitterMs(), st.getAvgJitterMs());
+}
+
+int main(int argc, char** argv) {
+    long every = 0;
+    const char* path = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--every") && i + 1 < argc) every = atol(argv[++i]);
+        else if (argv[i][0] != '-' && !path) path = argv[i];
+        else return usage();
+    }
+    if (every < 0) return usage();
+
+    FILE* f = path ? fopen(path, "r") : stdin;
+    if (!f) {
+        fprintf(stderr, "hpstats: cannot read %s\n", path);
+        return 1;
+    }
+
+    HeadingPacketStats st;
+    char line[512];
+    long packets = 0;
+    while (fgets(line, sizeof(line), f)) {
+        uint32_t rx_ms;
+        uint8_t data[64];
+        size_t len;
+        if (!parseLine(line, rx_ms, data, sizeof(data), len)) continue;
+        st.onPacket(data, len, rx_ms);
+        if (every > 0 && ++packets % every == 0) print(st);
+    }
+    if (path) fclose(f);
+    print(st);
+    return 0;
+}
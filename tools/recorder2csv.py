@@ -0,0 +1,170 @@
+#!/usr/bin/env python3
+"""Convert a CMPS14 flight recorder log (/recorder/log download) to CSV.
+
+Usage:
+    recorder2csv.py cmps14-rec-<uptime_ms>.bin [out.csv] [--downloaded 2026-10-18T14:40:00]
+
+The log is a sequence of files, each a 24-byte header followed by 1 kB
+blocks. Every block starts with a KEY sample, DELTA samples are
+differences to the previous sample, EVENT records are written between
+samples. See recorder_log.h for the format.
+
+Sample times are millis() of the boot that recorded them. A UTC column is
+filled when the file header carries the system time, or for the newest boot
+when --downloaded (local time of the download) is given together with the
+uptime in the file name.
+"""
+
+import csv
+import datetime
+import re
+import struct
+import sys
+
+MAGIC = 0x31524643  # "CFR1"
+HEADER = struct.Struct("<IBBHIIII")
+KEY = struct.Struct("<IHbbHHHhB")
+EVENT = struct.Struct("<IBi")
+TAG_PAD, TAG_KEY, TAG_DELTA, TAG_EVENT = 0, 1, 2, 3
+NA_U16 = 0xFFFF
+NA_I16 = -32768
+
+EVENTS = {
+    1: "BOOT", 2: "WIFI_UP", 3: "WIFI_DOWN", 4: "CAL_MODE", 5: "CAL_STORED",
+    6: "OFFSET", 7: "DEVIATION", 8: "LEVEL", 9: "HDG_MODE", 10: "RESTART", 11: "OTA",
+}
+CAL_MODES = {0: "USE", 1: "FULL_AUTO", 2: "AUTO", 3: "MANUAL"}
+
+COLUMNS = ["file", "boot", "t_ms", "utc", "type", "raw_deg", "pitch_deg", "roll_deg",
+           "compass_deg", "heading_deg", "heading_true_deg", "rot_deg_s", "cal", "event", "arg"]
+
+
+def varint(buf, pos):
+    value, shift = 0, 0
+    while True:
+        b = buf[pos]
+        pos += 1
+        value |= (b & 0x7F) << shift
+        if b < 0x80:
+            return value, pos
+        shift += 7
+
+
+def unzigzag(v):
+    return (v >> 1) ^ -(v & 1)
+
+
+def hdg(v):
+    return "" if v == NA_U16 else "%.2f" % (v / 100.0)
+
+
+def decode_block(block, header, emit):
+    pos, frame = 0, None
+    while pos < len(block):
+        tag = block[pos]
+        pos += 1
+        if tag == TAG_PAD:
+            return
+        if tag == TAG_KEY:
+            frame = list(KEY.unpack_from(block, pos))
+            pos += KEY.size
+            emit(header, "KEY", frame)
+        elif tag == TAG_DELTA:
+            if frame is None:
+                return  # Damaged block, no KEY before DELTA
+            mask = block[pos]
+            dt, pos = varint(block, pos + 1)
+            frame[0] = (frame[0] + dt) & 0xFFFFFFFF
+            for bit, idx, wrap in ((0, 1, 3600), (1, 2, 0), (2, 3, 0), (3, 4, 36000),
+                                   (4, 5, 36000), (5, 6, 36000), (6, 7, 0)):
+                if mask & (1 << bit):
+                    d, pos = varint(block, pos)
+                    v = frame[idx] + unzigzag(d)
+                    frame[idx] = v % wrap if wrap else v
+            if mask & 0x80:
+                frame[8] = block[pos]
+                pos += 1
+            emit(header, "DELTA", frame)
+        elif tag == TAG_EVENT:
+            t_ms, code, arg = EVENT.unpack_from(block, pos)
+            pos += EVENT.size
+            emit(header, "EVENT", (t_ms, code, arg))
+        else:
+            return  # Unknown tag, skip the rest of the block
+
+
+def main(argv):
+    args = [a for a in argv[1:] if not a.startswith("--")]
+    downloaded = None
+    if "--downloaded" in argv:
+        downloaded = datetime.datetime.fromisoformat(argv[argv.index("--downloaded") + 1])
+        args = [a for a in args if a != argv[argv.index("--downloaded") + 1]]
+    if not args:
+        print(__doc__)
+        return 1
+
+    src = args[0]
+    data = open(src, "rb").read()
+    m = re.search(r"rec-(\d+)\.bin", src)
+    uptime_ms = int(m.group(1)) if m else None
+
+    # Newest boot gets the download time as reference
+    newest_boot, pos, size = 0, 0, 1024
+    while pos + HEADER.size <= len(data):
+        h = HEADER.unpack_from(data, pos)
+        if h[0] == MAGIC:
+            newest_boot, size = max(newest_boot, h[5]), h[3]
+            pos += HEADER.size
+        else:
+            pos += size
+
+    out = open(args[1], "w", newline="") if len(args) > 1 else sys.stdout
+    w = csv.writer(out)
+    w.writerow(COLUMNS)
+
+    def utc(header, t_ms):
+        _, _, _, _, seq, boot, epoch_s, ref_ms = header
+        if epoch_s:
+            t = datetime.datetime.fromtimestamp(epoch_s + (t_ms - ref_ms) / 1000.0, datetime.timezone.utc)
+            return t.isoformat(timespec="milliseconds")
+        if downloaded and uptime_ms is not None and boot == newest_boot:
+            t = downloaded - datetime.timedelta(milliseconds=uptime_ms - t_ms)
+            return t.isoformat(timespec="milliseconds")
+        return ""
+
+    def emit(header, kind, f):
+        seq, boot = header[4], header[5]
+        if kind == "EVENT":
+            t_ms, code, arg = f
+            name = EVENTS.get(code, str(code))
+            if name == "CAL_MODE":
+                arg = CAL_MODES.get(arg, arg)
+            elif name == "OFFSET":
+                arg = "%.2f" % (arg / 100.0)
+            elif name == "LEVEL":
+                arg = "%d/%d" % (struct.unpack("<hh", struct.pack("<i", arg))[::-1])
+            elif name == "DEVIATION":
+                arg = "%08x" % (arg & 0xFFFFFFFF)
+            w.writerow([seq, boot, t_ms, utc(header, t_ms), kind] + [""] * 8 + [name, arg])
+            return
+        t_ms, raw, pitch, roll, c, mh, th, rot, cal = f
+        w.writerow([seq, boot, t_ms, utc(header, t_ms), kind, "%.1f" % (raw / 10.0), pitch, roll,
+                    hdg(c), hdg(mh), hdg(th), "" if rot == NA_I16 else "%.3f" % (rot * 1e-4 * 57.29578),
+                    "0x%02x" % cal, "", ""])
+
+    pos, header = 0, None
+    while pos < len(data):
+        if pos + HEADER.size <= len(data) and struct.unpack_from("<I", data, pos)[0] == MAGIC:
+            header = HEADER.unpack_from(data, pos)
+            pos += HEADER.size
+            continue
+        if header is None:
+            break
+        size = header[3]
+        decode_block(data[pos:pos + size], header, emit)
+        pos += size
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
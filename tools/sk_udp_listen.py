@@ -0,0 +1,146 @@
+#!/usr/bin/env python3
+"""Receive the SignalK UDP deltas of the gateway and report loss and jitter.
+
+Usage:
+    sk_udp_listen.py [--port 4123] [--every 10] [--forward host:port]
+
+Set SK_UDP_ENABLED and SK_DELTA_SEQ in SignalKBroker.h and point SK_HOST at
+the machine running this script. With --forward every datagram is passed on
+as is, e.g. to the SignalK server's UDP data connection, so the server keeps
+its data during the measurement.
+
+Every delta carries sensors.cmps14.deltaSeq, counted per transmitted delta
+(failed sends included). Every --every seconds and at Ctrl-C the script prints:
+
+- received datagrams, datagrams that are no delta JSON
+- lost (gaps in deltaSeq), duplicate and reordered deltas, loss rate
+- inter-arrival time of the heading/attitude deltas (~10 Hz): mean, p50,
+  p99 and max, as the jitter seen by a receiver
+
+Compare "received" and "lost" with the UDP send and error counts in the web
+UI status block: sends - received = lost on the air or in the network stack.
+A reboot of the gateway (deltaSeq back to 1) starts the counting over.
+"""
+
+import json
+import socket
+import sys
+import time
+
+SEQ_PATH = "sensors.cmps14.deltaSeq"
+HEADING_PATH = "navigation.headingMagnetic"
+
+
+class Stats:
+    def __init__(self):
+        self.received = 0
+        self.invalid = 0
+        self.lost = 0
+        self.duplicates = 0
+        self.reordered = 0
+        self.restarts = 0
+        self.last_seq = None
+        self.last_heading_t = None
+        self.gaps_ms = []
+
+    def on_delta(self, seq, has_heading, t):
+        self.received += 1
+        if seq is not None:
+            if self.last_seq is None or seq == 1:
+                if self.last_seq is not None:
+                    self.restarts += 1
+            elif seq == self.last_seq:
+                self.duplicates += 1
+                return
+            elif seq < self.last_seq:
+                self.reordered += 1
+                self.lost = max(0, self.lost - 1)
+                return
+            else:
+                self.lost += seq - self.last_seq - 1
+            self.last_seq = seq
+        if has_heading:
+            if self.last_heading_t is not None:
+                self.gaps_ms.append(1000.0 * (t - self.last_heading_t))
+            self.last_heading_t = t
+
+    def report(self):
+        total = self.received + self.lost
+        rate = 100.0 * self.lost / total if total else 0.0
+        line = ("received %d, invalid %d, lost %d (%.2f %%), duplicates %d, reordered %d, restarts %d"
+                % (self.received, self.invalid, self.lost, rate, self.duplicates, self.reordered, self.restarts))
+        if self.gaps_ms:
+            g = sorted(self.gaps_ms)
+            line += (", heading interval mean %.1f ms, p50 %.1f, p99 %.1f, max %.1f"
+                     % (sum(g) / len(g), g[len(g) // 2], g[min(len(g) - 1, int(len(g) * 0.99))], g[-1]))
+        if self.last_seq is None and self.received:
+            line += " (no %s, set SK_DELTA_SEQ)" % SEQ_PATH
+        print(line, flush=True)
+
+
+def parse(data):
+    """deltaSeq (None if absent) and whether the delta has a heading, None if no delta"""
+    try:
+        delta = json.loads(data)
+        seq, heading = None, False
+        for up in delta["updates"]:
+            for v in up.get("values", []):
+                if v.get("path") == SEQ_PATH:
+                    seq = int(v["value"])
+                elif v.get("path") == HEADING_PATH:
+                    heading = True
+        return seq, heading
+    except (ValueError, KeyError, TypeError):
+        return None
+
+
+def main(argv):
+    port, every, forward = 4123, 10.0, None
+    args = argv[1:]
+    try:
+        while args:
+            a = args.pop(0)
+            if a == "--port":
+                port = int(args.pop(0))
+            elif a == "--every":
+                every = float(args.pop(0))
+            elif a == "--forward":
+                host, fport = args.pop(0).rsplit(":", 1)
+                forward = (host, int(fport))
+            else:
+                raise ValueError(a)
+    except (IndexError, ValueError):
+        print(__doc__, file=sys.stderr)
+        return 2
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind(("", port))
+    sock.settimeout(0.5)
+    out = socket.socket(socket.AF_INET, socket.SOCK_DGRAM) if forward else None
+
+    stats = Stats()
+    next_report = time.monotonic() + every
+    try:
+        while True:
+            try:
+                data, _ = sock.recvfrom(4096)
+                t = time.monotonic()
+                if out:
+                    out.sendto(data, forward)
+                parsed = parse(data)
+                if parsed is None:
+                    stats.invalid += 1
+                else:
+                    stats.on_delta(parsed[0], parsed[1], t)
+            except socket.timeout:
+                pass
+            if time.monotonic() >= next_report:
+                stats.report()
+                next_report += every
+    except KeyboardInterrupt:
+        stats.report()
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+
+// === W I N D O W M I N M A X  C L A S S  T E M P L A T E ===
+//
+// - Sliding time window minimum and maximum of one value
+// - The window is split into SLOTS time slots: samples update the extremes
+//   of the current slot, a finished slot is pushed into two monotonic
+//   deques (max: decreasing values, min: increasing values), slots older
+//   than the window fall off the front
+// - O(1) amortized per sample and per query, memory fixed by SLOTS: no
+//   matter how many samples, each deque holds at most SLOTS entries
+// - Resolution: the window covers the current slot and the SLOTS - 1
+//   slots before it, window_ms / SLOTS is the granularity of the edge
+// - NAN samples are skipped, min()/max() are NAN when the window is empty
+// - millis() wrap: slots are numbered from the first sample and advanced by
+//   elapsed time, compared with (int32_t)(now - slot) as the timers are.
+//   Time going backwards (or a gap of more than 24 days) resets the window
+// - No Arduino dependency, the caller passes millis()
+
+template <size_t SLOTS>
+class WindowMinMax {
+
+    static_assert(SLOTS >= 2, "WindowMinMax needs at least two slots");
+
+public:
+
+    void setWindow(unsigned long window_ms) {
+        slot_ms = window_ms / SLOTS;
+        if (slot_ms == 0) slot_ms = 1;
+        this->reset();
+    }
+
+    void reset() {
+        hi.clear();
+        lo.clear();
+        cur_valid = false;
+    }
+
+    // Add a sample, t_ms from millis()
+    void add(unsigned long t_ms, float v) {
+        if (isnan(v)) return;
+        const uint32_t t = (uint32_t)t_ms;
+        if (cur_valid && (int32_t)(t - cur_start_ms) < 0) this->reset();   // Time went backwards
+        if (cur_valid && t - cur_start_ms >= slot_ms) {
+            const uint32_t steps = (t - cur_start_ms) / slot_ms;
+            const uint32_t slot = cur_slot + steps;
+            hi.expire(slot);
+            lo.expire(slot);
+            hi.push(cur_slot, cur_hi, true);
+            lo.push(cur_slot, cur_lo, false);
+            cur_slot = slot;
+            cur_start_ms += steps * slot_ms;
+            cur_hi = v;
+            cur_lo = v;
+        } else if (!cur_valid) {
+            cur_slot = 0;
+            cur_start_ms = t - t % slot_ms;
+            cur_hi = v;
+            cur_lo = v;
+            cur_valid = true;
+        } else {
+            if (v > cur_hi) cur_hi = v;
+            if (v < cur_lo) cur_lo = v;
+        }
+    }
+
+    // Extremes of the window ending at now_ms
+    float max(unsigned long now_ms) const { return this->query(hi, now_ms, cur_hi, true); }
+    float min(unsigned long now_ms) const { return this->query(lo, now_ms, cur_lo, false); }
+
+    unsigned long getWindowMs() const { return slot_ms * SLOTS; }
+    static constexpr size_t slots() { return SLOTS; }
+
+private:
+
+    // Ring deque of finished slots, monotonic in value from front to back
+    struct Deque {
+        uint32_t slot[SLOTS];
+        float val[SLOTS];
+        uint16_t head = 0;
+        uint16_t count = 0;
+
+        void clear() { head = 0; count = 0; }
+        uint16_t at(uint16_t i) const { return (head + i) % SLOTS; }
+
+        // Drop slots that are out of the window ending in slot now
+        void expire(uint32_t now) {
+            while (count > 0 && (int32_t)(now - slot[head]) >= (int32_t)SLOTS) {
+                head = (head + 1) % SLOTS;
+                count--;
+            }
+        }
+
+        // Drop dominated entries from the back, then append
+        void push(uint32_t s, float v, bool is_max) {
+            while (count > 0) {
+                const float back = val[this->at(count - 1)];
+                if (is_max ? back > v : back < v) break;
+                count--;
+            }
+            if (count == SLOTS) {   // Cannot happen after expire(), keeps the ring safe anyway
+                head = (head + 1) % SLOTS;
+                count--;
+            }
+            const uint16_t i = this->at(count);
+            slot[i] = s;
+            val[i] = v;
+            count++;
+        }
+    };
+
+    float query(const Deque &d, unsigned long now_ms, float cur, bool is_max) const {
+        if (!cur_valid) return NAN;   // Deques are empty as well
+        const int32_t dt = (int32_t)((uint32_t)now_ms - cur_start_ms);
+        const uint32_t now = cur_slot + ((dt > 0) ? (uint32_t)dt / slot_ms : 0);
+        float r = NAN;
+        for (uint16_t i = 0; i < d.count; i++) {   // Front is the extreme once stale slots are skipped
+            const uint16_t k = d.at(i);
+            if ((int32_t)(now - d.slot[k]) < (int32_t)SLOTS) { r = d.val[k]; break; }
+        }
+        if ((int32_t)(now - cur_slot) < (int32_t)SLOTS) {
+            if (isnan(r) || (is_max ? cur > r : cur < r)) r = cur;
+        }
+        return r;
+    }
+
+    unsigned long slot_ms = 1000;
+    Deque hi, lo;
+    uint32_t cur_slot = 0;         // Slot number, counted from the first sample
+    uint32_t cur_start_ms = 0;     // Start time of the current slot
+    float cur_hi = NAN, cur_lo = NAN;
+    bool cur_valid = false;
+
+};
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stdint.h>
+
+// === W R I T E B E H I N D  C L A S S ===
+//
+// - Write-behind timing of a record that is kept in RAM and stored by a backend
+// - mark(field, now): a change was applied to the RAM copy, starts or extends
+//   the quiet period, changes are coalesced into one write
+// - handle(now): writes once there have been no changes for quiet_ms, or at
+//   latest max_delay_ms after the first pending change (continuous edits)
+// - flush(now): writes immediately. On failure the fields stay pending and the
+//   write is retried after the next quiet period
+// - Backend: WriteFn with a context pointer, returns true when the record was
+//   stored. No Arduino dependency, the caller passes millis()
+
+class WriteBehind {
+
+public:
+
+    using WriteFn = bool (*)(void* ctx);
+
+    WriteBehind(WriteFn fn, void* ctx, unsigned long quiet_ms, unsigned long max_delay_ms)
+        : write_fn(fn), write_ctx(ctx), quiet_ms(quiet_ms), max_delay_ms(max_delay_ms) {}
+
+    // Mark a field as changed in RAM
+    void mark(uint8_t field, unsigned long now) {
+        if (!fields) first_ms = now;
+        fields |= field;
+        last_ms = now;
+        saves++;
+    }
+
+    // Quiet period over or max delay reached
+    bool isDue(unsigned long now) const {
+        if (!fields) return false;
+        return (long)(now - last_ms) >= (long)quiet_ms || (long)(now - first_ms) >= (long)max_delay_ms;
+    }
+
+    // Write if due, true when a write was done and succeeded
+    bool handle(unsigned long now) {
+        if (!this->isDue(now)) return false;
+        return this->flush(now);
+    }
+
+    // Write pending fields now, true when nothing is pending afterwards
+    bool flush(unsigned long now) {
+        if (!fields) return true;
+        if (write_fn(write_ctx)) {
+            fields = 0;
+            return true;
+        }
+        last_ms = now;
+        return false;
+    }
+
+    bool isDirty() const { return fields != 0; }
+    uint8_t getFields() const { return fields; }
+    uint32_t getSaves() const { return saves; }
+
+private:
+
+    WriteFn write_fn;
+    void* write_ctx;
+    unsigned long quiet_ms;
+    unsigned long max_delay_ms;
+
+    uint8_t fields = 0;            // Changed in RAM but not yet stored
+    unsigned long first_ms = 0;    // First pending change
+    unsigned long last_ms = 0;     // Latest change or failed write
+    uint32_t saves = 0;            // mark() calls, coalesced into writes
+
+};